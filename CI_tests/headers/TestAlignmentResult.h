@@ -4,4 +4,6 @@
 
 namespace AstroPhotoStacker {
     TestResult test_alignment_result_plate_solving();
+
+    TestResult test_alignment_result_surface();
 }
\ No newline at end of file
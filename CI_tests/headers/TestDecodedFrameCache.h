@@ -0,0 +1,10 @@
+#pragma once
+
+#include "../headers/TestUtils.h"
+
+namespace AstroPhotoStacker {
+    /**
+     * @brief Check the LRU eviction, pinning, hit/miss counters and the round trip through the compressed disk cache of DecodedFrameCache
+     */
+    TestResult test_decoded_frame_cache();
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "../headers/TestUtils.h"
+
+namespace AstroPhotoStacker {
+    /**
+     * @brief Compare the fused calibration (dark and flat frames merged into one pass, both the runtime-selected and the scalar kernel) with applying the calibration frames one by one
+     */
+    TestResult test_fused_calibration();
+}
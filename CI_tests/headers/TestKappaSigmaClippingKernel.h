@@ -0,0 +1,10 @@
+#pragma once
+
+#include "../headers/TestUtils.h"
+
+namespace AstroPhotoStacker {
+    /**
+     * @brief Compare the block kappa-sigma clipping kernel (both the runtime-selected and the scalar implementation) with straightforward per-column clipping
+     */
+    TestResult test_kappa_sigma_clipping_kernel();
+}
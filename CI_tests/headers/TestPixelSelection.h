@@ -0,0 +1,10 @@
+#pragma once
+
+#include "../headers/TestUtils.h"
+
+namespace AstroPhotoStacker {
+    /**
+     * @brief Compare the partial selection functions used by the median-like stackers with the results obtained from fully sorted arrays
+     */
+    TestResult test_pixel_selection();
+}
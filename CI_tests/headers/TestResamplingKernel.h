@@ -0,0 +1,10 @@
+#pragma once
+
+#include "../headers/TestUtils.h"
+
+namespace AstroPhotoStacker {
+    /**
+     * @brief Check that the interpolation kernels reproduce the image for integer shifts, keep flat image flat, interpolate linear gradient and give the same results in SIMD and scalar implementation
+     */
+    TestResult test_resampling_kernel();
+}
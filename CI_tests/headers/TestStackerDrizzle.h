@@ -0,0 +1,11 @@
+#pragma once
+
+#include "../headers/TestUtils.h"
+
+namespace AstroPhotoStacker {
+    /**
+     * @brief Stack dithered frames of an undersampled synthetic scene with drizzle, check that the scene is reconstructed on the finer grid
+     * and that the result does not depend on the number of threads and on splitting the image into slices (memory usage limit)
+     */
+    TestResult test_stacker_drizzle();
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "../headers/TestUtils.h"
+
+namespace AstroPhotoStacker {
+    /**
+     * @brief Push synthetic frames into the live stacker and compare the snapshots with mean values calculated directly, check that the outliers are rejected in kappa-sigma mode
+     */
+    TestResult test_stacker_live();
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "../headers/TestUtils.h"
+
+namespace AstroPhotoStacker {
+    /**
+     * @brief Run nested TaskSchedulers on the shared thread pool and check that all tasks are executed and that exceptions from the tasks are propagated
+     */
+    TestResult test_task_scheduler();
+}
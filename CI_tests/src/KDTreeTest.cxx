@@ -58,5 +58,36 @@ TestResult AstroPhotoStacker::test_kd_tree()   {
             return TestResult(false, "KDTree test failed. Brute force and KDTree results do not match.");
         }
     }
+
+    // batch query must give the same results as the individual queries
+    vector<float> query_points;
+    for (int i = 0; i < 100; i++) {
+        query_points.push_back(random_uniform(-3,7));
+        query_points.push_back(random_uniform(-1,11));
+        query_points.push_back(random_uniform(-2,2));
+    }
+    const size_t n_queries = query_points.size()/3;
+    const vector<long long int> batch_indices = tree.get_k_nearest_neighbors_indices(query_points.data(), n_queries, n_neighbors);
+    for (size_t i_query = 0; i_query < n_queries; i_query++) {
+        const vector<long long int> indices = tree.get_k_nearest_neighbors_indices(&query_points[3*i_query], n_neighbors);
+        if (!equal(indices.begin(), indices.end(), batch_indices.begin() + i_query*n_neighbors)) {
+            return TestResult(false, "KDTree test failed. Batch query and individual query results do not match.");
+        }
+    }
+
+    // points within given distance
+    const float max_distance = 0.5;
+    vector<long long int> close_points = tree.get_nodes_closer_than_x_buffer(query_point, max_distance);
+    sort(close_points.begin(), close_points.end());
+    vector<long long int> close_points_brute_force;
+    for (const tuple<int, float> &index_distance2 : index_distance2_vector) {
+        if (get<1>(index_distance2) < max_distance*max_distance) {
+            close_points_brute_force.push_back(get<0>(index_distance2));
+        }
+    }
+    sort(close_points_brute_force.begin(), close_points_brute_force.end());
+    if (close_points != close_points_brute_force) {
+        return TestResult(false, "KDTree test failed. Brute force and KDTree points closer than given distance do not match.");
+    }
     return TestResult(true, "");
 }
\ No newline at end of file
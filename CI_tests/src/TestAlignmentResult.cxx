@@ -5,6 +5,9 @@
 #include "../../headers/AlignmentResultSurface.h"
 
 #include <map>
+#include <vector>
+#include <random>
+#include <cmath>
 
 using namespace AstroPhotoStacker;
 using namespace std;
@@ -51,5 +54,94 @@ TestResult AstroPhotoStacker::test_alignment_result_plate_solving() {
         }
     }
 
+    // the row transformation must give the same results as the per-pixel transformation
+    const int x_begin = 990;
+    const int x_end = 1010;
+    vector<float> x_reference_row(x_end - x_begin), y_reference_row(x_end - x_begin);
+    alignment_result_from_description->transform_row_to_reference_frame(2285, x_begin, x_end, x_reference_row.data(), y_reference_row.data());
+    for (int x = x_begin; x < x_end; x++) {
+        float x_reference = x;
+        float y_reference = 2285;
+        alignment_result_from_description->transform_to_reference_frame(&x_reference, &y_reference);
+        if (x_reference != x_reference_row[x - x_begin] || y_reference != y_reference_row[x - x_begin]) {
+            message += "AlignmentResultPlateSolving: Row transformation to reference frame differs from the per-pixel transformation at x = " + to_string(x) + ". ";
+            break;
+        }
+    }
+
     return TestResult(message.empty(), message);
-}
\ No newline at end of file
+}
+
+TestResult AstroPhotoStacker::test_alignment_result_surface() {
+    // alignment points on a regular grid with smoothly varying shifts, one of them is invalid
+    const int width = 640;
+    const int height = 480;
+    const int ap_spacing = 64;
+    vector<LocalShift> local_shifts;
+    for (int y = ap_spacing/2; y < height; y += ap_spacing) {
+        for (int x = ap_spacing/2; x < width; x += ap_spacing) {
+            LocalShift shift;
+            shift.x = x;
+            shift.y = y;
+            shift.dx = int(round(4*sin(x/150.) + 2));
+            shift.dy = int(round(3*cos(y/120.) - 1));
+            shift.valid_ap = !(x == 5*ap_spacing/2 && y == 7*ap_spacing/2);
+            shift.score = x + y;
+            local_shifts.push_back(shift);
+        }
+    }
+
+    const AlignmentResultSurface alignment_result(local_shifts, 1);
+    LocalShiftsHandler exact_shifts_handler(local_shifts);
+
+    // the exact interpolation must keep the shifts of the alignment points
+    for (const LocalShift &shift : local_shifts) {
+        if (!shift.valid_ap) {
+            continue;
+        }
+        float x = shift.x - shift.dx;
+        float y = shift.y - shift.dy;
+        exact_shifts_handler.transform_from_reference_to_shifted_frame(&x, &y);
+        if (x != shift.x || y != shift.y) {
+            return TestResult(false, "AlignmentResultSurface: Alignment point (" + to_string(shift.x) + ", " + to_string(shift.y) + ") is shifted to (" + to_string(x) + ", " + to_string(y) + ")");
+        }
+    }
+
+    // the displacement grid must be close to the exact interpolation (which jumps, when the set of the closest alignment points changes),
+    // the row transformation must agree with the per-pixel transformation
+    mt19937 random_generator(7);
+    uniform_int_distribution<int> y_distribution(-20, height + 20);
+    double sum_of_differences = 0;
+    int n_points = 0;
+    vector<float> x_shifted_row(width + 40), y_shifted_row(width + 40);
+    for (int i_line = 0; i_line < 50; i_line++) {
+        const int y = y_distribution(random_generator);
+        alignment_result.transform_row_from_reference_to_shifted_frame(y, -20, width + 20, x_shifted_row.data(), y_shifted_row.data());
+        for (int x = -20; x < width + 20; x++) {
+            float x_grid = x, y_grid = y;
+            alignment_result.transform_from_reference_to_shifted_frame(&x_grid, &y_grid);
+            if (abs(x_grid - x_shifted_row[x + 20]) > 1e-3 || abs(y_grid - y_shifted_row[x + 20]) > 1e-3) {
+                return TestResult(false, "AlignmentResultSurface: Row transformation differs from the per-pixel transformation at (" + to_string(x) + ", " + to_string(y) + ")");
+            }
+
+            float x_exact = x, y_exact = y;
+            exact_shifts_handler.transform_from_reference_to_shifted_frame(&x_exact, &y_exact);
+            const double difference = max(abs(x_grid - x_exact), abs(y_grid - y_exact));
+            if (difference > 3) {
+                return TestResult(false, "AlignmentResultSurface: Displacement grid differs from the exact shifts by " + to_string(difference) + " pixels at (" + to_string(x) + ", " + to_string(y) + ")");
+            }
+            sum_of_differences += difference;
+            n_points++;
+
+            alignment_result.transform_to_reference_frame(&x_grid, &y_grid);
+            if (abs(x_grid - x) > 3 || abs(y_grid - y) > 3) {
+                return TestResult(false, "AlignmentResultSurface: Transformation to the reference frame does not invert the shift at (" + to_string(x) + ", " + to_string(y) + ")");
+            }
+        }
+    }
+    if (sum_of_differences/n_points > 0.15) {
+        return TestResult(false, "AlignmentResultSurface: Average difference between the displacement grid and the exact shifts is " + to_string(sum_of_differences/n_points) + " pixels");
+    }
+
+    return TestResult(true, "");
+}
@@ -0,0 +1,114 @@
+#include "../headers/TestDecodedFrameCache.h"
+
+#include "../../headers/DecodedFrameCache.h"
+
+#include <vector>
+#include <random>
+#include <string>
+#include <memory>
+#include <filesystem>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+namespace {
+    shared_ptr<DecodedFrame> create_frame(int seed) {
+        mt19937 random_generator(seed);
+        uniform_int_distribution<int> distribution(-1, 32767);
+
+        shared_ptr<DecodedFrame> frame = make_shared<DecodedFrame>();
+        frame->width = 64;
+        frame->height = 32;
+        frame->is_raw = true;
+        frame->bayer_pattern = {0, 1, 1, 2};
+        frame->raw_data.resize(frame->width*frame->height);
+        for (PixelType &value : frame->raw_data) {
+            value = distribution(random_generator);
+        }
+        return frame;
+    };
+}
+
+TestResult AstroPhotoStacker::test_decoded_frame_cache()   {
+    using DataType = DecodedFrameCache::DataType;
+
+    const size_t frame_memory = create_frame(0)->get_memory_usage();
+    const vector<InputFrame> input_frames = {InputFrame("frame_0.cr2"), InputFrame("frame_1.cr2"), InputFrame("frame_2.cr2"), InputFrame("video.avi", 7)};
+
+    // budget for 2 frames
+    DecodedFrameCache cache(2*frame_memory);
+    if (cache.get(input_frames[0], DataType::frame_data) != nullptr) {
+        return TestResult(false, "Empty cache returned a frame");
+    }
+
+    cache.pin(input_frames[0]);
+    for (size_t i_frame = 0; i_frame < input_frames.size(); i_frame++) {
+        cache.put(input_frames[i_frame], DataType::frame_data, create_frame(i_frame));
+    }
+
+    // frame 0 is pinned, frames 1 and 2 were evicted as the least recently used ones
+    if (cache.get(input_frames[0], DataType::frame_data) == nullptr || cache.get(input_frames[3], DataType::frame_data) == nullptr) {
+        return TestResult(false, "Pinned or most recently used frame was evicted");
+    }
+    if (cache.get(input_frames[1], DataType::frame_data) != nullptr || cache.get(input_frames[2], DataType::frame_data) != nullptr) {
+        return TestResult(false, "Frames exceeding the memory budget were not evicted");
+    }
+    if (cache.get(input_frames[3], DataType::monochrome) != nullptr) {
+        return TestResult(false, "Monochrome data returned for a frame with only frame data cached");
+    }
+
+    DecodedFrameCache::Statistics statistics = cache.get_statistics();
+    if (statistics.hits != 2 || statistics.misses != 4 || statistics.evictions != 2 || statistics.number_of_frames_in_memory != 2) {
+        return TestResult(false, "Unexpected statistics: hits = " + to_string(statistics.hits) + ", misses = " + to_string(statistics.misses) + ", evictions = " + to_string(statistics.evictions));
+    }
+
+    // evicted frames are stored on the disk and read back
+    const string disk_cache_folder = (filesystem::temp_directory_path() / "AstroPhotoStacker_test_decoded_frame_cache").string();
+    cache.set_disk_cache(disk_cache_folder, 100*frame_memory);
+    cache.unpin(input_frames[0]);
+    cache.put(input_frames[1], DataType::frame_data, create_frame(1));
+    cache.put(input_frames[2], DataType::frame_data, create_frame(2));
+
+    for (size_t i_frame = 0; i_frame < input_frames.size(); i_frame++) {
+        const shared_ptr<const DecodedFrame> frame = cache.get(input_frames[i_frame], DataType::frame_data);
+        const shared_ptr<const DecodedFrame> expected_frame = create_frame(i_frame);
+        if (frame == nullptr) {
+            return TestResult(false, "Frame " + to_string(i_frame) + " not found in the cache");
+        }
+        if (frame->raw_data != expected_frame->raw_data || frame->width != expected_frame->width || frame->height != expected_frame->height || frame->bayer_pattern != expected_frame->bayer_pattern) {
+            return TestResult(false, "Frame " + to_string(i_frame) + " does not match after reading it from the cache");
+        }
+    }
+
+    statistics = cache.get_statistics();
+    if (statistics.disk_hits == 0 || statistics.number_of_frames_on_disk == 0) {
+        return TestResult(false, "Disk cache was not used");
+    }
+
+    // frames of a pass which does not fit into the budget are not stored, except of the pinned ones
+    {
+        const DecodedFrameCache::PinnedFrame pinned_frame(&cache, input_frames[3]);
+        const DecodedFrameCache::PassGuard pass_guard(&cache, 10, frame_memory);
+        if (!pass_guard.is_storing_suspended()) {
+            return TestResult(false, "Storing was not suspended for a pass exceeding the memory budget");
+        }
+        if (cache.put(input_frames[1], DataType::monochrome, create_frame(1)) || !cache.put(input_frames[3], DataType::monochrome, create_frame(3))) {
+            return TestResult(false, "Unexpected storing of frames during a pass exceeding the memory budget");
+        }
+    }
+    if (!cache.put(input_frames[1], DataType::monochrome, create_frame(1))) {
+        return TestResult(false, "Storing was not resumed after the pass");
+    }
+
+    if (DecodedFrameCache::get_global_instance().is_enabled()) {
+        return TestResult(false, "Global decoded frame cache is enabled by default");
+    }
+
+    cache.clear();
+    const bool files_removed = filesystem::is_empty(disk_cache_folder);
+    filesystem::remove_all(disk_cache_folder);
+    if (!files_removed) {
+        return TestResult(false, "Files of the disk cache were not removed");
+    }
+    return TestResult(true, "");
+};
@@ -0,0 +1,70 @@
+#include "../headers/TestFusedCalibration.h"
+
+#include "../../headers/FusedCalibration.h"
+#include "../../headers/DarkFrameHandler.h"
+#include "../../headers/FlatFrameHandler.h"
+#include "../../headers/PixelType.h"
+
+#include <vector>
+#include <random>
+#include <memory>
+#include <string>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+TestResult AstroPhotoStacker::test_fused_calibration()   {
+    const int width = 67;
+    const int height = 23;
+    mt19937 random_generator(11);
+
+    vector<double> dark_image(width*height), flat_image(width*height);
+    for (int i = 0; i < width*height; i++) {
+        dark_image[i] = 50 + random_generator() % 200;
+        flat_image[i] = 2000 + random_generator() % 3000;
+    }
+    const shared_ptr<const CalibrationFrameBase> dark_frame = make_shared<DarkFrameHandler>(width, height, dark_image);
+    const shared_ptr<const CalibrationFrameBase> flat_frame = make_shared<FlatFrameHandler>(width, height, flat_image);
+
+    const vector<vector<shared_ptr<const CalibrationFrameBase>>> calibration_frame_sets = {
+        {dark_frame}, {flat_frame}, {dark_frame, flat_frame}
+    };
+    for (const vector<shared_ptr<const CalibrationFrameBase>> &calibration_frames : calibration_frame_sets) {
+        const shared_ptr<const FusedCalibration> fused_calibration = FusedCalibration::get_instance(calibration_frames);
+        if (fused_calibration == nullptr) {
+            return TestResult(false, "Fused calibration is not available for dark and flat frames");
+        }
+        if (fused_calibration != FusedCalibration::get_instance(calibration_frames)) {
+            return TestResult(false, "Fused calibration is not shared for the same calibration frames");
+        }
+
+        vector<PixelType> light(width*height);
+        for (PixelType &value : light) {
+            value = random_generator() % 32768;
+        }
+
+        const int y_min = 3, y_max = 19;
+        vector<PixelType> expected = light;
+        for (const shared_ptr<const CalibrationFrameBase> &calibration_frame : calibration_frames) {
+            calibration_frame->apply_calibration(&expected, y_min, y_max);
+        }
+
+        vector<PixelType> fused = light;
+        fused_calibration->apply_calibration(&fused, y_min, y_max);
+
+        vector<PixelType> fused_scalar = light;
+        vector<float> offsets(width*height, 0), scales(width*height, 1);
+        for (const shared_ptr<const CalibrationFrameBase> &calibration_frame : calibration_frames) {
+            calibration_frame->add_to_fused_calibration(offsets.data(), scales.data());
+        }
+        apply_fused_calibration_kernel_scalar(&offsets[y_min*width], &scales[y_min*width], &fused_scalar[y_min*width], (y_max - y_min)*width);
+
+        for (int i = 0; i < width*height; i++) {
+            if (fused[i] != expected[i] || fused_scalar[i] != expected[i]) {
+                return TestResult(false, "Mismatch at pixel " + to_string(i) + " with " + to_string(calibration_frames.size()) + " calibration frame(s): expected "
+                                    + to_string(expected[i]) + ", fused " + to_string(fused[i]) + ", fused scalar " + to_string(fused_scalar[i]));
+            }
+        }
+    }
+    return TestResult(true, "");
+};
@@ -0,0 +1,102 @@
+#include "../headers/TestKappaSigmaClippingKernel.h"
+
+#include "../../headers/KappaSigmaClippingKernel.h"
+#include "../../headers/PixelType.h"
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+namespace {
+    // reference implementation: iterative clipping of one column, recalculating mean and sigma from scratch in each iteration
+    void clip_column(vector<PixelType> *column, double kappa, int n_iterations)    {
+        for (int i_iter = 0; i_iter < n_iterations; i_iter++) {
+            double mean(0), mean2(0);
+            int n = 0;
+            for (PixelType value : *column) {
+                if (value >= 0) {
+                    mean  += value;
+                    mean2 += value*value;
+                    n++;
+                }
+            }
+            mean  /= n;
+            mean2 /= n;
+            const double kappa_sigma = kappa*sqrt(mean2 - mean*mean);
+            for (PixelType &value : *column) {
+                if (value >= 0 && abs(value - mean) > kappa_sigma) {
+                    value = -1;
+                }
+            }
+        }
+    };
+}
+
+TestResult AstroPhotoStacker::test_kappa_sigma_clipping_kernel()   {
+    constexpr unsigned int block_size = c_kappa_sigma_block_size;
+    mt19937 random_generator(7);
+
+    for (int i_test = 0; i_test < 2000; i_test++) {
+        const unsigned int n_values = 1 + random_generator() % 50;
+        const double kappa = 0.1f*(1 + random_generator() % 40);
+        const int n_iterations = 1 + random_generator() % 5;
+
+        vector<PixelType> values(n_values*block_size);
+        vector<uint8_t> valid_mask(n_values, 0);
+        vector<vector<PixelType>> reference_columns(block_size, vector<PixelType>(n_values));
+        for (unsigned int i_value = 0; i_value < n_values; i_value++) {
+            for (unsigned int i_column = 0; i_column < block_size; i_column++) {
+                const unsigned int random_number = random_generator();
+                PixelType value = (random_number % 10 == 0) ? (random_number >> 8) % 30000 : 1000 + (random_number >> 8) % 50;
+                if (random_number % 17 == 0) {
+                    value = -1;
+                }
+                values[i_value*block_size + i_column] = value;
+                valid_mask[i_value] |= uint8_t(value >= 0) << i_column;
+                reference_columns[i_column][i_value] = value;
+            }
+        }
+
+        for (vector<PixelType> &column : reference_columns) {
+            clip_column(&column, kappa, n_iterations);
+        }
+
+        for (bool use_scalar_implementation : {false, true}) {
+            vector<uint8_t> mask = valid_mask;
+            double sums[block_size];
+            unsigned int n_kept[block_size];
+            if (use_scalar_implementation) {
+                apply_kappa_sigma_clipping_to_block_scalar(values.data(), mask.data(), n_values, kappa, n_iterations, sums, n_kept);
+            }
+            else {
+                apply_kappa_sigma_clipping_to_block(values.data(), mask.data(), n_values, kappa, n_iterations, sums, n_kept);
+            }
+
+            for (unsigned int i_column = 0; i_column < block_size; i_column++) {
+                double reference_sum = 0;
+                unsigned int reference_n_kept = 0;
+                for (unsigned int i_value = 0; i_value < n_values; i_value++) {
+                    const bool kept_reference = reference_columns[i_column][i_value] >= 0;
+                    const bool kept_kernel    = mask[i_value] & (1 << i_column);
+                    if (kept_reference != kept_kernel) {
+                        return TestResult(false, "Kappa-sigma clipping kernel (" + string(use_scalar_implementation ? "scalar" : "default") + ") kept different values than the reference implementation.");
+                    }
+                    if (kept_reference) {
+                        reference_sum += reference_columns[i_column][i_value];
+                        reference_n_kept++;
+                    }
+                }
+                if (reference_n_kept != n_kept[i_column] || reference_sum != sums[i_column]) {
+                    return TestResult(false, "Kappa-sigma clipping kernel (" + string(use_scalar_implementation ? "scalar" : "default") + ") returned wrong sum or number of kept values.");
+                }
+            }
+        }
+    }
+
+    return TestResult(true, "");
+};
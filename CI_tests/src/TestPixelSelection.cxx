@@ -0,0 +1,70 @@
+#include "../headers/TestPixelSelection.h"
+
+#include "../../headers/PixelSelection.hxx"
+#include "../../headers/PixelType.h"
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <string>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+TestResult AstroPhotoStacker::test_pixel_selection()   {
+    // sorting networks - by the 0-1 principle, it is sufficient to check all the arrays of zeros and ones
+    for (unsigned int n_values = 0; n_values <= PixelSelection::c_max_sorting_network_size; n_values++) {
+        for (unsigned int bits = 0; bits < (1u << n_values); bits++) {
+            vector<PixelType> values(n_values);
+            for (unsigned int i = 0; i < n_values; i++) {
+                values[i] = (bits >> i) & 1;
+            }
+            PixelSelection::sort_small_array(values.data(), n_values);
+            if (!is_sorted(values.begin(), values.end())) {
+                return TestResult(false, "Sorting network for " + to_string(n_values) + " elements does not sort the array.");
+            }
+        }
+    }
+
+    mt19937 random_generator(42);
+    for (unsigned int n_values = 1; n_values < 100; n_values++) {
+        uniform_int_distribution<int> distribution(0, n_values < 20 ? 5 : 4000);
+        vector<PixelType> values(n_values);
+        for (PixelType &value : values) {
+            value = distribution(random_generator);
+        }
+        vector<PixelType> sorted_values = values;
+        sort(sorted_values.begin(), sorted_values.end());
+
+        vector<PixelType> work_array = values;
+        PixelType lower_middle, upper_middle;
+        PixelSelection::select_middle_elements(work_array.data(), n_values, &lower_middle, &upper_middle);
+        if (lower_middle != sorted_values[(n_values-1)/2] || upper_middle != sorted_values[n_values/2]) {
+            return TestResult(false, "Wrong middle elements selected for array with " + to_string(n_values) + " elements.");
+        }
+
+        const unsigned int n_selected = n_values/3;
+        work_array = values;
+        if (PixelSelection::select_nth_element(work_array.data(), n_values, n_selected) != sorted_values[n_selected]) {
+            return TestResult(false, "Wrong n-th element selected for array with " + to_string(n_values) + " elements.");
+        }
+
+        const unsigned int n_tail = n_values/5;
+        work_array = values;
+        PixelSelection::separate_tails(work_array.data(), n_values, n_tail, n_tail);
+        sort(work_array.begin(), work_array.begin() + n_tail);
+        sort(work_array.begin() + n_tail, work_array.end() - n_tail);
+        sort(work_array.end() - n_tail, work_array.end());
+        if (work_array != sorted_values) {
+            return TestResult(false, "Tails were not separated correctly for array with " + to_string(n_values) + " elements.");
+        }
+    }
+
+    vector<PixelType> values_with_invalid = {5, -1, 3, -1, -1, 7, 0};
+    const unsigned int n_valid = PixelSelection::move_valid_values_to_front(values_with_invalid.data(), values_with_invalid.size());
+    if (n_valid != 4 || vector<PixelType>(values_with_invalid.begin(), values_with_invalid.begin() + n_valid) != vector<PixelType>{5, 3, 7, 0}) {
+        return TestResult(false, "Valid values were not moved to the front of the array correctly.");
+    }
+
+    return TestResult(true, "");
+};
@@ -0,0 +1,89 @@
+#include "../headers/TestResamplingKernel.h"
+
+#include "../../headers/ResamplingKernel.h"
+#include "../../headers/PixelType.h"
+
+#include <vector>
+#include <random>
+#include <string>
+#include <cmath>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+TestResult AstroPhotoStacker::test_resampling_kernel()   {
+    const int width = 53;
+    const int line_begin = 7;
+    const int line_end = 41;
+    mt19937 random_generator(5);
+
+    vector<float> image(width*(line_end - line_begin));
+    for (float &value : image) {
+        value = random_generator() % 16000;
+    }
+    vector<float> gradient(width*(line_end - line_begin));
+    for (int y = line_begin; y < line_end; y++) {
+        for (int x = 0; x < width; x++) {
+            gradient[(y - line_begin)*width + x] = 1000 + 16*x + 8*y;
+        }
+    }
+
+    // random positions, including the positions outside of the image
+    const int n_pixels = 1001;
+    vector<float> x_positions(n_pixels), y_positions(n_pixels);
+    uniform_real_distribution<float> x_distribution(-5, width + 5);
+    uniform_real_distribution<float> y_distribution(line_begin - 5, line_end + 5);
+    for (int i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+        x_positions[i_pixel] = x_distribution(random_generator);
+        y_positions[i_pixel] = y_distribution(random_generator);
+    }
+
+    for (const string &method_name : get_interpolation_methods()) {
+        const InterpolationMethod method = string_to_interpolation_method(method_name);
+        const ResamplingKernel kernel(method);
+
+        vector<PixelType> result(n_pixels), result_scalar(n_pixels);
+        kernel.resample(image.data(), width, line_begin, line_end, x_positions.data(), y_positions.data(), n_pixels, result.data());
+        kernel.resample_scalar(image.data(), width, line_begin, line_end, x_positions.data(), y_positions.data(), n_pixels, result_scalar.data());
+        if (result != result_scalar) {
+            return TestResult(false, method_name + ": SIMD and scalar implementations give different results");
+        }
+
+        // integer shift by (-2, 3)
+        for (int y = line_begin; y < line_end - 3; y++) {
+            vector<float> x_line(width - 2), y_line(width - 2, y + 3);
+            for (int x = 0; x < width - 2; x++) {
+                x_line[x] = x + 2;
+            }
+            vector<PixelType> shifted_line(width - 2);
+            kernel.resample(image.data(), width, line_begin, line_end, x_line.data(), y_line.data(), width - 2, shifted_line.data());
+            for (int x = 0; x < width - 2; x++) {
+                if (shifted_line[x] != PixelType(image[(y + 3 - line_begin)*width + x + 2])) {
+                    return TestResult(false, method_name + ": integer shift does not reproduce the image at (" + to_string(x) + ", " + to_string(y) + ")");
+                }
+            }
+        }
+
+        if (method == InterpolationMethod::NEAREST_NEIGHBOR) {
+            continue;
+        }
+
+        // linear gradient is interpolated exactly (up to the rounding and the quantization of the fractional offsets) far from the borders
+        for (int i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+            const float x = x_positions[i_pixel];
+            const float y = y_positions[i_pixel];
+            if (x < 3 || x > width - 4 || y < line_begin + 3 || y > line_end - 4) {
+                continue;
+            }
+            PixelType value;
+            kernel.resample(gradient.data(), width, line_begin, line_end, &x, &y, 1, &value);
+            const float expected = 1000 + 16*x + 8*y;
+            const float max_difference = 24.0/ResamplingKernel::c_number_of_phases + 1;
+            if (fabs(value - expected) > max_difference) {
+                return TestResult(false, method_name + ": wrong interpolation of linear gradient at (" + to_string(x) + ", " + to_string(y) + "), expected " + to_string(expected) + ", got " + to_string(value));
+            }
+        }
+    }
+
+    return TestResult(true, "");
+};
@@ -0,0 +1,124 @@
+#include "../headers/TestStackerDrizzle.h"
+
+#include "../../headers/StackerDrizzle.h"
+#include "../../headers/AlignmentResultTranslationOnly.h"
+#include "../../headers/AlignmentResultPlateSolving.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <cmath>
+#include <filesystem>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+namespace {
+    // brightness of the scene at the position in the reference frame, the period of the pattern is only a few input pixels
+    double get_scene_value(double x, double y, int i_color)  {
+        const double amplitude = 4000 + 1000*i_color;
+        return 10000 + amplitude*sin(2*M_PI*x/11.3)*cos(2*M_PI*y/9.1);
+    };
+}
+
+TestResult AstroPhotoStacker::test_stacker_drizzle()   {
+    const int input_width = 160;
+    const int input_height = 120;
+    const int n_colors = 3;
+    const float scale = 2;
+
+    // 4x4 sub-pixel dithering pattern with random-like integer offsets, some of the frames are slightly rotated
+    vector<unique_ptr<AlignmentResultBase>> alignment_results;
+    for (int i_frame = 0; i_frame < 16; i_frame++) {
+        const float shift_x = 0.25f*(i_frame % 4) + (i_frame*7) % 5 - 2;
+        const float shift_y = 0.25f*(i_frame / 4) + (i_frame*3) % 5 - 2;
+        if (i_frame % 3 == 0) {
+            alignment_results.push_back(make_unique<AlignmentResultPlateSolving>(shift_x, shift_y, input_width/2, input_height/2, 0.002f*(i_frame - 8)));
+        }
+        else {
+            alignment_results.push_back(make_unique<AlignmentResultTranslationOnly>(shift_x, shift_y));
+        }
+    }
+
+    const filesystem::path frames_folder = filesystem::temp_directory_path() / "AstroPhotoStacker_test_stacker_drizzle";
+    filesystem::create_directories(frames_folder);
+    vector<InputFrame> input_frames;
+    for (size_t i_frame = 0; i_frame < alignment_results.size(); i_frame++) {
+        // each input pixel samples the scene at its center, OpenCV stores the colors as BGR and the reader divides 16-bit values by 2
+        cv::Mat image(input_height, input_width, CV_16UC3);
+        for (int y = 0; y < input_height; y++) {
+            for (int x = 0; x < input_width; x++) {
+                float x_reference = x;
+                float y_reference = y;
+                alignment_results[i_frame]->transform_to_reference_frame(&x_reference, &y_reference);
+                for (int i_color = 0; i_color < n_colors; i_color++) {
+                    image.at<cv::Vec3w>(y, x)[2 - i_color] = 2*lround(get_scene_value(x_reference, y_reference, i_color));
+                }
+            }
+        }
+        const string file_address = (frames_folder / ("frame_" + to_string(i_frame) + ".tif")).string();
+        cv::imwrite(file_address, image);
+        input_frames.push_back(InputFrame(file_address));
+    }
+
+    auto stack_frames = [&](unsigned int n_cpu, int memory_usage_limit_in_mb) {
+        StackerDrizzle stacker(n_colors, input_width, input_height, false, scale);
+        stacker.set_number_of_cpu_threads(n_cpu);
+        stacker.set_memory_usage_limit(memory_usage_limit_in_mb);
+        for (size_t i_frame = 0; i_frame < input_frames.size(); i_frame++) {
+            stacker.add_alignment_info(input_frames[i_frame], *alignment_results[i_frame]);
+            stacker.add_photo(input_frames[i_frame]);
+        }
+        stacker.calculate_stacked_photo();
+        return stacker.get_stacked_image();
+    };
+
+    // the limit of 4 MB splits the output into several slices, both with 1 and 4 threads
+    const vector<vector<double>> reference_result = stack_frames(1, 0);
+    const vector<pair<unsigned int, int>> settings = {{4, 0}, {1, 4}, {4, 4}};
+    vector<vector<vector<double>>> results;
+    for (const pair<unsigned int, int> &setting : settings) {
+        results.push_back(stack_frames(setting.first, setting.second));
+    }
+    filesystem::remove_all(frames_folder);
+
+    const int output_width = input_width*scale;
+    const int output_height = input_height*scale;
+    for (size_t i_setting = 0; i_setting < settings.size(); i_setting++) {
+        for (int i_color = 0; i_color < n_colors; i_color++) {
+            for (int i_pixel = 0; i_pixel < output_width*output_height; i_pixel++) {
+                // the partial sums of the threads are added in different order, so only the float rounding errors are allowed
+                if (abs(results[i_setting][i_color][i_pixel] - reference_result[i_color][i_pixel]) > 0.05) {
+                    return TestResult(false, "Drizzle result with " + to_string(settings[i_setting].first) + " threads and memory limit " + to_string(settings[i_setting].second) +
+                                        " MB differs at pixel " + to_string(i_pixel) + ": " + to_string(results[i_setting][i_color][i_pixel]) + " instead of " + to_string(reference_result[i_color][i_pixel]));
+                }
+            }
+        }
+    }
+
+    // output pixel "j" is centered at (j + 0.5)/scale - 0.5 in the reference frame, the border not covered by all the frames is skipped
+    const int border = 10;
+    double sum_of_squared_differences = 0;
+    int n_pixels = 0;
+    for (int y = border; y < output_height - border; y++) {
+        for (int x = border; x < output_width - border; x++) {
+            for (int i_color = 0; i_color < n_colors; i_color++) {
+                const double expected_value = get_scene_value((x + 0.5)/scale - 0.5, (y + 0.5)/scale - 0.5, i_color);
+                const double difference = reference_result[i_color][y*output_width + x] - expected_value;
+                if (abs(difference) > 900) {
+                    return TestResult(false, "Drizzle result differs from the scene by " + to_string(difference) + " at (" + to_string(x) + ", " + to_string(y) + "), color " + to_string(i_color));
+                }
+                sum_of_squared_differences += difference*difference;
+                n_pixels++;
+            }
+        }
+    }
+    const double rms_difference = sqrt(sum_of_squared_differences/n_pixels);
+    if (rms_difference > 180) {
+        return TestResult(false, "RMS difference between the drizzle result and the scene is " + to_string(rms_difference));
+    }
+
+    return TestResult(true, "");
+};
@@ -0,0 +1,83 @@
+#include "../headers/TestStackerLive.h"
+
+#include "../../headers/StackerLive.h"
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include <string>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+TestResult AstroPhotoStacker::test_stacker_live()   {
+    const int width = 37;
+    const int height = 23;
+    const int n_colors = 3;
+    const int n_frames = 20;
+    const size_t n_pixels = size_t(width)*height;
+
+    mt19937 random_generator(42);
+    normal_distribution<double> noise(1000, 30);
+    uniform_int_distribution<int> empty_pixel_distribution(0, 9);
+
+    vector<vector<vector<PixelType>>> frames(n_frames, vector<vector<PixelType>>(n_colors, vector<PixelType>(n_pixels)));
+    for (auto &frame : frames) {
+        for (auto &color : frame) {
+            for (PixelType &value : color) {
+                value = empty_pixel_distribution(random_generator) == 0 ? -1 : PixelType(noise(random_generator));
+            }
+        }
+    }
+    // pixel 0 is never filled, pixel 1 has an outlier in the last frame
+    for (auto &frame : frames) {
+        for (auto &color : frame) {
+            color[0] = -1;
+            color[1] = 1000 + (&frame == &frames.back() ? 5000 : (&frame - &frames[0]) % 3);
+        }
+    }
+
+    for (const string &algorithm : vector<string>{"average", "kappa-sigma mean"}) {
+        StackerLive stacker(n_colors, width, height, false, algorithm);
+        stacker.set_number_of_cpu_threads(4);
+        for (int i_frame = 0; i_frame < n_frames; i_frame++) {
+            stacker.push_frame(frames[i_frame]);
+        }
+        if (stacker.get_number_of_pushed_frames() != n_frames) {
+            return TestResult(false, "Wrong number of pushed frames for algorithm " + algorithm);
+        }
+
+        const vector<vector<double>> snapshot = stacker.snapshot();
+        for (int i_color = 0; i_color < n_colors; i_color++) {
+            if (snapshot[i_color][0] != -1) {
+                return TestResult(false, "Pixel without values is not empty for algorithm " + algorithm);
+            }
+
+            // with kappa-sigma rejection, a few noisy values might be rejected, so only approximate agreement is required for the regular pixels - the outlier in pixel 1 must be rejected
+            for (size_t i_pixel = 1; i_pixel < n_pixels; i_pixel++) {
+                double sum = 0;
+                int count = 0;
+                const int n_frames_to_use = (algorithm != "average" && i_pixel == 1) ? n_frames - 1 : n_frames;
+                for (int i_frame = 0; i_frame < n_frames_to_use; i_frame++) {
+                    const PixelType value = frames[i_frame][i_color][i_pixel];
+                    if (value >= 0) {
+                        sum += value;
+                        count++;
+                    }
+                }
+                const double expected = count > 0 ? sum/count : -1;
+                const double tolerance = (algorithm == "average" || i_pixel == 1) ? 1e-6 : 15;
+                if (abs(snapshot[i_color][i_pixel] - expected) > tolerance) {
+                    return TestResult(false, "Wrong stacked value for algorithm " + algorithm + ": " + to_string(snapshot[i_color][i_pixel]) + " instead of " + to_string(expected));
+                }
+            }
+        }
+
+        stacker.reset();
+        if (stacker.get_number_of_pushed_frames() != 0 || stacker.snapshot()[0][5] != -1) {
+            return TestResult(false, "Live stacker was not reset for algorithm " + algorithm);
+        }
+    }
+
+    return TestResult(true, "");
+};
@@ -0,0 +1,55 @@
+#include "../headers/TestTaskScheduler.h"
+
+#include "../../headers/TaskScheduler.hxx"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+TestResult AstroPhotoStacker::test_task_scheduler()   {
+    const size_t n_outer_tasks = 32;
+    const size_t n_inner_tasks = 100;
+
+    // tasks waiting for their own sub-tasks must not block the pool
+    atomic<size_t> n_tasks_executed = 0;
+    {
+        TaskScheduler outer_scheduler({n_outer_tasks});
+        for (size_t i_outer = 0; i_outer < n_outer_tasks; i_outer++) {
+            outer_scheduler.submit([&n_tasks_executed, n_inner_tasks]() {
+                TaskScheduler inner_scheduler({4});
+                for (size_t i_inner = 0; i_inner < n_inner_tasks; i_inner++) {
+                    inner_scheduler.submit([&n_tasks_executed]() { n_tasks_executed++; }, {1});
+                }
+                inner_scheduler.wait_for_tasks();
+            }, {1});
+        }
+        outer_scheduler.wait_for_tasks();
+    }
+    if (n_tasks_executed != n_outer_tasks*n_inner_tasks) {
+        return TestResult(false, "TaskScheduler test failed. Expected " + to_string(n_outer_tasks*n_inner_tasks) + " tasks to be executed, but " + to_string(n_tasks_executed) + " were executed.");
+    }
+
+    bool exception_caught = false;
+    try {
+        TaskScheduler scheduler({2});
+        for (int i_task = 0; i_task < 20; i_task++) {
+            scheduler.submit([](int task_index) {
+                if (task_index == 5) {
+                    throw runtime_error("exception from task");
+                }
+            }, {1}, i_task);
+        }
+        scheduler.wait_for_tasks();
+    }
+    catch (const runtime_error &e) {
+        exception_caught = string(e.what()) == "exception from task";
+    }
+    if (!exception_caught) {
+        return TestResult(false, "TaskScheduler test failed. Exception thrown in the task was not propagated to wait_for_tasks.");
+    }
+
+    return TestResult(true, "");
+};
@@ -6,6 +6,14 @@
 #include "../headers/TestFitFileSaver.h"
 #include "../headers/TestAlignmentResult.h"
 #include "../headers/AsterismHashTests.h"
+#include "../headers/TestTaskScheduler.h"
+#include "../headers/TestPixelSelection.h"
+#include "../headers/TestKappaSigmaClippingKernel.h"
+#include "../headers/TestStackerLive.h"
+#include "../headers/TestDecodedFrameCache.h"
+#include "../headers/TestFusedCalibration.h"
+#include "../headers/TestResamplingKernel.h"
+#include "../headers/TestStackerDrizzle.h"
 
 #include "../headers/TestUtils.h"
 
@@ -22,9 +30,27 @@ int main(int argc, const char **argv)   {
 
     test_runner.run_test("AlignmentResultPlateSolving",    test_alignment_result_plate_solving);
 
+    test_runner.run_test("AlignmentResultSurface",  test_alignment_result_surface);
+
 
     test_runner.run_test("kd_tree",                 test_kd_tree);
 
+    test_runner.run_test("task_scheduler",          test_task_scheduler);
+
+    test_runner.run_test("pixel_selection",         test_pixel_selection);
+
+    test_runner.run_test("kappa_sigma_clipping_kernel", test_kappa_sigma_clipping_kernel);
+
+    test_runner.run_test("stacker_live",            test_stacker_live);
+
+    test_runner.run_test("decoded_frame_cache",     test_decoded_frame_cache);
+
+    test_runner.run_test("fused_calibration",       test_fused_calibration);
+
+    test_runner.run_test("resampling_kernel",       test_resampling_kernel);
+
+    test_runner.run_test("stacker_drizzle",         test_stacker_drizzle);
+
     test_runner.run_test("Metadata reading - Canon 6D MarkII",    test_metadata_reading,
                         InputFrame("AstroPhotoStacker_test_files/data/CanonEOS6DMarkII_Andromeda/IMG_9138.CR2"),
                         6.3, 180.80f, 1600, 600.f, "RGGB", "Canon 6D Mark II", -1, 23);
@@ -123,7 +123,9 @@ class MyFrame : public wxFrame  {
 
         void add_n_cpu_slider();
         void add_max_memory_spin_ctrl();
+        void add_decoded_frame_cache_settings();
         void add_stacking_algorithm_choice_box();
+        void add_interpolation_method_choice_box();
 
         std::vector<wxStaticText*>      m_algorithm_specific_settings_texts;
         std::vector<wxSpinCtrlDouble*>  m_algorithm_specific_settings_spin_ctrls;
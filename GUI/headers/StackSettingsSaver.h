@@ -44,6 +44,8 @@ class StackSettingsSaver : public AstroPhotoStacker::StackSettings {
         std::string m_separator = "|";
         std::string m_dict_string_n_cpus = "n_cpus";
         std::string m_dict_string_max_memory = "max_memory";
+        std::string m_dict_string_decoded_frame_cache_memory = "decoded_frame_cache_memory";
+        std::string m_dict_string_decoded_frame_cache_folder = "decoded_frame_cache_folder";
         std::string m_dict_string_stacking_algorithm = "stacking_algorithm";
         std::string m_dict_string_hot_pixel_correction = "hot_pixel_correction";
         std::string m_dict_string_use_color_interpolation = "use_color_interpolation";
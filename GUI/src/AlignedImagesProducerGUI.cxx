@@ -126,6 +126,7 @@ void AlignedImagesProducerGUI::initialize_aligned_images_producer()   {
     m_aligned_images_producer = make_unique<AlignedImagesProducer>(stack_settings->get_n_cpus(), stack_settings->get_max_memory());
     m_aligned_images_producer->set_add_datetime(m_add_datetime);
     m_aligned_images_producer->set_save_also_tif_files(m_save_also_tif_files);
+    m_aligned_images_producer->set_interpolation_method(string_to_interpolation_method(stack_settings->get_interpolation_method()));
     if (m_post_processing_tool) {
         m_aligned_images_producer->set_post_processing_tool(*m_post_processing_tool);
     }
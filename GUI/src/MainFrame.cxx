@@ -22,8 +22,10 @@
 #include "../../headers/PixelType.h"
 #include "../../headers/CalibratedPhotoHandler.h"
 #include "../../headers/AdditionalStackerSettingNumerical.h"
+#include "../../headers/StackerFactory.h"
 
 #include <wx/spinctrl.h>
+#include <wx/filepicker.h>
 #include <wx/progdlg.h>
 #include <wx/artprov.h>
 
@@ -793,7 +795,9 @@ void MyFrame::add_button_bar()   {
 void MyFrame::add_stack_settings_preview()   {
     add_n_cpu_slider();
     add_max_memory_spin_ctrl();
+    add_decoded_frame_cache_settings();
     add_stacking_algorithm_choice_box();
+    add_interpolation_method_choice_box();
     add_hot_pixel_correction_checkbox();
     add_color_interpolation_checkbox();
     add_color_stretching_checkbox();
@@ -885,6 +889,31 @@ void MyFrame::add_stacking_algorithm_choice_box()  {
 
 };
 
+void MyFrame::add_interpolation_method_choice_box()  {
+    wxStaticText* interpolation_method_text = new wxStaticText(this, wxID_ANY, "Interpolation:");
+
+    const vector<string> &interpolation_methods = m_stack_settings->get_interpolation_methods();
+    wxArrayString interpolation_methods_wx;
+    int default_choice = 0;
+    for (unsigned int i = 0; i < interpolation_methods.size(); ++i) {
+        interpolation_methods_wx.Add(interpolation_methods[i]);
+        if (interpolation_methods[i] == m_stack_settings->get_interpolation_method()) {
+            default_choice = i;
+        }
+    }
+
+    wxChoice* choice_box_interpolation_method = new wxChoice(this, wxID_ANY, wxDefaultPosition, wxDefaultSize, interpolation_methods_wx);
+    choice_box_interpolation_method->SetSelection(default_choice);
+    choice_box_interpolation_method->SetToolTip("Interpolation used when shifting the frames into the reference frame. Sub-pixel interpolation (bilinear, bicubic, lanczos-3) keeps more fine detail than the nearest neighbor, but it is slower. It is used only with color interpolation or for RGB images.");
+    choice_box_interpolation_method->Bind(wxEVT_CHOICE, [choice_box_interpolation_method, this](wxCommandEvent&){
+        const int current_selection = choice_box_interpolation_method->GetSelection();
+        m_stack_settings->set_interpolation_method(choice_box_interpolation_method->GetString(current_selection).ToStdString());
+    });
+
+    m_sizer_bottom_left->Add(interpolation_method_text, 0, wxEXPAND, 5);
+    m_sizer_bottom_left->Add(choice_box_interpolation_method, 0, wxEXPAND, 5);
+};
+
 void MyFrame::update_algorithm_specific_settings_gui()  {
     vector<AdditionalStackerSettingNumerical> specific_settings = m_stack_settings->get_algorithm_specific_settings_defaults();
 
@@ -1002,6 +1031,30 @@ void MyFrame::add_max_memory_spin_ctrl() {
     m_sizer_top_left->Add(spin_ctrl_max_memory, 0,  wxEXPAND, 5);
 };
 
+void MyFrame::add_decoded_frame_cache_settings()    {
+    wxStaticText* decoded_frame_cache_text = new wxStaticText(this, wxID_ANY, "Decoded frame cache (MB):");
+
+    const int cache_memory_default = m_stack_settings->get_decoded_frame_cache_memory();
+    wxSpinCtrl* spin_ctrl_cache_memory = new wxSpinCtrl(this, wxID_ANY, std::to_string(cache_memory_default), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 100000, cache_memory_default);
+    spin_ctrl_cache_memory->SetToolTip("Memory for the decoded input frames, so that the alignment and the stacking do not decode the same frame again. It is a part of the maximum memory usage. 0 disables the cache.");
+    spin_ctrl_cache_memory->Bind(wxEVT_SPINCTRL, [spin_ctrl_cache_memory, this](wxCommandEvent&){
+        m_stack_settings->set_decoded_frame_cache_memory(spin_ctrl_cache_memory->GetValue());
+        configure_decoded_frame_cache(*m_stack_settings);
+    });
+
+    wxDirPickerCtrl* dir_picker_cache_folder = new wxDirPickerCtrl(this, wxID_ANY, m_stack_settings->get_decoded_frame_cache_folder(), "Select folder for the decoded frame cache");
+    dir_picker_cache_folder->SetToolTip("Optional folder on a local disk for the decoded frames which do not fit into the memory cache.");
+    dir_picker_cache_folder->Bind(wxEVT_DIRPICKER_CHANGED, [dir_picker_cache_folder, this](wxFileDirPickerEvent&){
+        m_stack_settings->set_decoded_frame_cache_folder(dir_picker_cache_folder->GetPath().ToStdString());
+        configure_decoded_frame_cache(*m_stack_settings);
+    });
+    configure_decoded_frame_cache(*m_stack_settings);
+
+    m_sizer_top_left->Add(decoded_frame_cache_text, 0, wxEXPAND, 5);
+    m_sizer_top_left->Add(spin_ctrl_cache_memory, 0,  wxEXPAND, 5);
+    m_sizer_top_left->Add(dir_picker_cache_folder, 0,  wxEXPAND, 5);
+};
+
 void MyFrame::add_image_settings()   {
     add_exposure_correction_spin_ctrl();
     add_input_numbers_overview();
@@ -21,6 +21,8 @@ void StackSettingsSaver::save() {
     if (file.is_open()) {
         file << m_dict_string_n_cpus << m_separator << get_n_cpus() << endl;
         file << m_dict_string_max_memory << m_separator << get_max_memory() << endl;
+        file << m_dict_string_decoded_frame_cache_memory << m_separator << get_decoded_frame_cache_memory() << endl;
+        file << m_dict_string_decoded_frame_cache_folder << m_separator << get_decoded_frame_cache_folder() << endl;
         file << m_dict_string_stacking_algorithm << m_separator << get_stacking_algorithm() << endl;
         file << m_dict_string_hot_pixel_correction << m_separator << use_hot_pixel_correction() << endl;
         file << m_dict_string_use_color_interpolation << m_separator << use_color_interpolation() << endl;
@@ -75,6 +77,12 @@ void StackSettingsSaver::load() {
             else if (key == m_dict_string_max_memory) {
                 set_max_memory(stoi(value));
             }
+            else if (key == m_dict_string_decoded_frame_cache_memory) {
+                set_decoded_frame_cache_memory(stoi(value));
+            }
+            else if (key == m_dict_string_decoded_frame_cache_folder) {
+                set_decoded_frame_cache_folder(value);
+            }
             else if (key == m_dict_string_stacking_algorithm) {
                 set_stacking_algorithm(value);
             }
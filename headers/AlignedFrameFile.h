@@ -0,0 +1,120 @@
+#pragma once
+
+#include "../headers/PixelType.h"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Binary file with a calibrated and aligned frame, which can be stacked again without decoding and calibrating the original file.
+     *
+     * The file contains a header (resolution, number of colors, description of the frame and its alignment) and the color planes split into bands of rows.
+     * Each band of each color is stored as a separate chunk - a validity mask (1 bit per pixel, invalid pixels are the ones with value -1) followed by 16-bit values, optionally compressed (see compress_pixel_data).
+     * The file is read through a memory mapping and only the chunks overlapping with the requested rows are decoded.
+     *
+     * Layout:
+     *  - magic "APSALGN1", then uint32 values: version, width, height, number of colors, rows per band, compression, description length
+     *  - description (frame, alignment and calibration, used to check if the stored frame is up to date)
+     *  - chunk table: for each band and color (band-major) uint64 offset and uint64 size
+     *  - chunks
+     */
+    class AlignedFrameFile {
+        public:
+            AlignedFrameFile()                          = delete;
+            AlignedFrameFile(const AlignedFrameFile&)   = delete;
+            AlignedFrameFile& operator=(const AlignedFrameFile&) = delete;
+
+            enum class Compression : std::uint32_t {
+                none = 0,
+                delta_varint = 1
+            };
+
+            /**
+             * @brief Map the file into the memory and read its header
+             *
+             * @param file_address - path to the file
+             */
+            explicit AlignedFrameFile(const std::string &file_address);
+
+            ~AlignedFrameFile();
+
+            /**
+             * @brief Write the frame into the file. The data are written into a temporary file first, which is then renamed, so an interrupted write never leaves an incomplete file.
+             *
+             * @param file_address - path to the output file
+             * @param data - calibrated data of the whole frame, indexed as [color][y*width + x]
+             * @param width - width of the frame
+             * @param height - height of the frame
+             * @param description - description of the frame and its processing
+             * @param compression - compression of the values
+             * @param rows_per_band - number of rows stored in one chunk
+             */
+            static void write(  const std::string &file_address,
+                                const std::vector<std::vector<PixelType>> &data,
+                                int width,
+                                int height,
+                                const std::string &description,
+                                Compression compression = Compression::none,
+                                int rows_per_band = c_default_rows_per_band);
+
+            /**
+             * @brief Read only the description from the file header, without mapping the whole file
+             *
+             * @param file_address - path to the file
+             * @return std::string - the description, empty string if the file does not exist or it is not valid
+             */
+            static std::string read_description(const std::string &file_address);
+
+            /**
+             * @brief Read the lines <y_min, y_max) of all colors
+             *
+             * @param y_min - first line to read
+             * @param y_max - first line not to read
+             * @return std::vector<std::vector<PixelType>> - data indexed as [color][(y-y_min)*width + x]
+             */
+            std::vector<std::vector<PixelType>> read_lines(int y_min, int y_max) const;
+
+            int get_width()             const { return m_width; };
+
+            int get_height()            const { return m_height; };
+
+            int get_number_of_colors()  const { return m_number_of_colors; };
+
+            const std::string &get_description() const { return m_description; };
+
+            static constexpr int c_default_rows_per_band = 64;
+
+        private:
+            std::string     m_file_address;
+            const unsigned char *m_data = nullptr;
+            std::size_t     m_file_size = 0;
+
+            int             m_width = 0;
+            int             m_height = 0;
+            int             m_number_of_colors = 0;
+            int             m_rows_per_band = 0;
+            Compression     m_compression = Compression::none;
+            std::string     m_description;
+
+            struct Chunk {
+                std::uint64_t offset;
+                std::uint64_t size;
+            };
+            std::vector<Chunk>  m_chunks;
+
+            /**
+             * @brief Decode the rows <row_begin, row_end) of the band into the output buffer
+             */
+            void read_rows_from_chunk(int i_band, int i_color, int row_begin, int row_end, PixelType *output) const;
+
+            static std::size_t get_mask_size(std::size_t n_pixels) { return (n_pixels + 7)/8; };
+
+            static constexpr char           c_magic[8] = {'A','P','S','A','L','G','N','1'};
+            static constexpr std::uint32_t  c_version = 1;
+            static constexpr std::size_t    c_fixed_header_size = 8 + 7*sizeof(std::uint32_t);
+    };
+}
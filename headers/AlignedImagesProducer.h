@@ -9,6 +9,7 @@
 #include "../headers/StackSettings.h"
 #include "../headers/AlignmentResultBase.h"
 #include "../headers/PostProcessingTool.h"
+#include "../headers/ResamplingKernel.h"
 
 #include <functional>
 #include <string>
@@ -85,6 +86,14 @@ namespace AstroPhotoStacker {
                 return {m_datetime_pos_frac_x, m_datetime_pos_frac_y};
             };
 
+            void set_interpolation_method(InterpolationMethod interpolation_method) {
+                m_interpolation_method = interpolation_method;
+            };
+
+            InterpolationMethod get_interpolation_method() const {
+                return m_interpolation_method;
+            };
+
             void set_maximal_output_image_size(int width, int height) {
                 m_max_width = width;
                 m_max_height = height;
@@ -130,6 +139,8 @@ namespace AstroPhotoStacker {
 
             bool m_save_also_tif_files = false;
 
+            InterpolationMethod m_interpolation_method = InterpolationMethod::NEAREST_NEIGHBOR;
+
             std::function<void(std::vector<std::vector<PixelType>>*, PixelType max_value)> m_image_stretching_function = nullptr;
             std::unique_ptr<PostProcessingTool> m_post_processing_tool = nullptr;
 
@@ -29,8 +29,32 @@ namespace AstroPhotoStacker {
 
             virtual void transform_from_reference_to_shifted_frame(float *x, float *y) const = 0;
 
+            /**
+             * @brief Transform the pixels <x_begin, x_end) of the line y from the reference frame to the shifted frame. The default implementation calls transform_from_reference_to_shifted_frame for each pixel,
+             * alignment methods with a transformation affine along the line override it with a loop without virtual calls, which can be vectorised by the compiler.
+             *
+             * @param y - the line in the reference frame
+             * @param x_begin - the first pixel of the line
+             * @param x_end - the first pixel not to transform
+             * @param x_shifted - output buffer for the x coordinates in the shifted frame, (x_end - x_begin) elements
+             * @param y_shifted - output buffer for the y coordinates in the shifted frame, (x_end - x_begin) elements
+             */
+            virtual void transform_row_from_reference_to_shifted_frame(int y, int x_begin, int x_end, float *x_shifted, float *y_shifted) const;
+
             virtual void transform_to_reference_frame(float *x, float *y) const = 0;
 
+            /**
+             * @brief Transform the pixels <x_begin, x_end) of the line y from the shifted frame to the reference frame. The default implementation calls transform_to_reference_frame for each pixel,
+             * alignment methods with a transformation affine along the line override it with a loop without virtual calls.
+             *
+             * @param y - the line in the shifted frame
+             * @param x_begin - the first pixel of the line
+             * @param x_end - the first pixel not to transform
+             * @param x_reference - output buffer for the x coordinates in the reference frame, (x_end - x_begin) elements
+             * @param y_reference - output buffer for the y coordinates in the reference frame, (x_end - x_begin) elements
+             */
+            virtual void transform_row_to_reference_frame(int y, int x_begin, int x_end, float *x_reference, float *y_reference) const;
+
             virtual std::string get_description_string() const;
 
             virtual std::string get_method_specific_description_string() const = 0;
@@ -27,8 +27,22 @@ namespace AstroPhotoStacker {
 
             virtual void transform_from_reference_to_shifted_frame(float *x, float *y) const override {};
 
+            virtual void transform_row_from_reference_to_shifted_frame(int y, int x_begin, int x_end, float *x_shifted, float *y_shifted) const override {
+                for (int x = x_begin; x < x_end; x++) {
+                    x_shifted[x - x_begin] = x;
+                    y_shifted[x - x_begin] = y;
+                }
+            };
+
             virtual void transform_to_reference_frame(float *x, float *y) const override {};
 
+            virtual void transform_row_to_reference_frame(int y, int x_begin, int x_end, float *x_reference, float *y_reference) const override {
+                for (int x = x_begin; x < x_end; x++) {
+                    x_reference[x - x_begin] = x;
+                    y_reference[x - x_begin] = y;
+                }
+            };
+
             virtual std::string get_method_specific_description_string() const override {return s_type_name;};
 
             inline static const std::string s_type_name = "dummy";
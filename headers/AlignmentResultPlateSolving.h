@@ -38,8 +38,12 @@ namespace AstroPhotoStacker {
 
             virtual void transform_from_reference_to_shifted_frame(float *x, float *y) const override;
 
+            virtual void transform_row_from_reference_to_shifted_frame(int y, int x_begin, int x_end, float *x_shifted, float *y_shifted) const override;
+
             virtual void transform_to_reference_frame(float *x, float *y) const override;
 
+            virtual void transform_row_to_reference_frame(int y, int x_begin, int x_end, float *x_reference, float *y_reference) const override;
+
             virtual std::string get_method_specific_description_string() const override;
 
             void get_parameters(float *shift_x,
@@ -30,8 +30,13 @@ namespace AstroPhotoStacker {
              */
             virtual ~AlignmentResultSurface() = default;
 
+            /**
+             * @brief Transform the coordinates from the reference frame to the shifted frame. The local shifts are sampled from a precomputed displacement grid, so it is thread-safe.
+            */
             virtual void transform_from_reference_to_shifted_frame(float *x, float *y) const override;
 
+            virtual void transform_row_from_reference_to_shifted_frame(int y, int x_begin, int x_end, float *x_shifted, float *y_shifted) const override;
+
             virtual void transform_to_reference_frame(float *x, float *y) const override;
 
             virtual std::string get_method_specific_description_string() const override;
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "../headers/PixelType.h"
+#include "../headers/AlignedFrameFile.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <filesystem>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief On-disk storage of calibrated and aligned frames (see AlignedFrameFile). It is used when the stacked image does not fit into the memory and has to be stacked in several slices, or when the same frames are stacked repeatedly with different stacking settings.
+     *
+     * Each frame is decoded and calibrated only once, it is written into its own file and individual slices are then read back from that file.
+     * By default the files are stored in a temporary directory which is removed in the destructor. If a persistent directory is provided, the files are kept there and reused
+     * by the later runs, as long as the description of the frame (input file, alignment, calibration) matches.
+     */
+    class CalibratedFramesSlab {
+        public:
+            CalibratedFramesSlab() = delete;
+
+            CalibratedFramesSlab(const CalibratedFramesSlab&) = delete;
+
+            /**
+             * @brief Construct a new Calibrated Frames Slab object and create the directory for it
+             *
+             * @param number_of_colors - number of color planes stored for each frame
+             * @param width - width of the frames
+             * @param height - height of the frames
+             * @param persistent_directory - directory where the frames are kept between runs. If empty, a temporary directory is created and removed in the destructor.
+             * @param compress - compress the stored pixel values
+             */
+            CalibratedFramesSlab(int number_of_colors, int width, int height, const std::string &persistent_directory = "", bool compress = false);
+
+            /**
+             * @brief Destroy the Calibrated Frames Slab object and remove the temporary files (files in the persistent directory are kept)
+             */
+            ~CalibratedFramesSlab();
+
+            /**
+             * @brief Write calibrated data of the frame into the slab
+             *
+             * @param i_file - index of the frame
+             * @param frame_key - unique identifier of the input frame, used for the file name in the persistent directory
+             * @param description - description of the frame and its processing (alignment, calibration), stored in the file header
+             * @param data - calibrated data, indexed as [color][y*width + x], covering the whole frame
+             */
+            void store_frame(unsigned int i_file, const std::string &frame_key, const std::string &description, const std::vector<std::vector<PixelType>> &data);
+
+            /**
+             * @brief Check if the frame with the same description has already been stored in the persistent directory by a previous run. If yes, it is used for the i_file-th frame.
+             *
+             * @param i_file - index of the frame
+             * @param frame_key - unique identifier of the input frame
+             * @param description - description of the frame and its processing
+             * @return true if the stored frame can be used
+             */
+            bool contains_frame(unsigned int i_file, const std::string &frame_key, const std::string &description);
+
+            /**
+             * @brief Read the lines <y_min, y_max) of the frame from the slab
+             *
+             * @param i_file - index of the frame
+             * @param y_min - first line to read
+             * @param y_max - first line not to read
+             * @return std::vector<std::vector<PixelType>> - data indexed as [color][(y-y_min)*width + x]
+             */
+            std::vector<std::vector<PixelType>> read_lines(unsigned int i_file, int y_min, int y_max) const;
+
+            /**
+             * @brief Get the disk space (in bytes) needed to store given number of frames without compression
+             */
+            unsigned long long get_disk_space_needed(unsigned int number_of_frames) const;
+
+        private:
+            int m_number_of_colors;
+            int m_width;
+            int m_height;
+            bool m_compress;
+
+            std::filesystem::path m_directory;
+            bool m_is_temporary_directory;
+
+            mutable std::mutex m_mutex;
+            mutable std::map<unsigned int, std::shared_ptr<const AlignedFrameFile>> m_frame_files;
+            std::map<unsigned int, std::string> m_frame_file_addresses;
+
+            std::string get_frame_file_address(unsigned int i_file, const std::string &frame_key) const;
+
+            std::shared_ptr<const AlignedFrameFile> get_frame_file(unsigned int i_file) const;
+    };
+}
@@ -8,6 +8,7 @@
 #include "../headers/InputFrame.h"
 #include "../headers/InputFrameReader.h"
 #include "../headers/PixelType.h"
+#include "../headers/ResamplingKernel.h"
 
 #include <memory>
 #include <vector>
@@ -29,6 +30,13 @@ namespace AstroPhotoStacker {
             */
             explicit CalibratedPhotoHandler(const InputFrame &input_frame, bool use_color_interpolation = false);
 
+            /**
+             * @brief Constructor taking the reader with already loaded frame data (for example from FramePrefetcher).
+             * @param input_frame_reader Reader of the input frame, with the image data loaded.
+             * @param use_color_interpolation Whether to use color interpolation.
+            */
+            explicit CalibratedPhotoHandler(std::unique_ptr<InputFrameReader> input_frame_reader, bool use_color_interpolation = false);
+
             /**
              * @brief Add alignment data to the CalibratedPhotoHandler object.
              *
@@ -49,11 +57,28 @@ namespace AstroPhotoStacker {
 
             /**
              * @brief Apply calibration frames to the raw photo, shift and rotate the photo according to the alignment and run color interpolation if requested in the constructor.
+             * The output is produced in strips of lines, each strip is calibrated, debayered and shifted before the next one is started, so the debayered photo is never stored as a whole.
             */
             void calibrate();
 
+            /**
+             * @brief Set the number of threads used to calibrate this photo. It is useful when there are fewer photos than CPU threads (for example a single huge image), otherwise the photos should be processed in parallel instead.
+             *
+             * @param n_threads The number of threads.
+            */
+            void set_number_of_threads(unsigned int n_threads);
+
+            /**
+             * @brief Set the interpolation used to shift the photo into the reference frame. Sub-pixel interpolation is used only if full color planes are available (RGB photo or raw photo with color interpolation),
+             * raw photos without color interpolation are always shifted by nearest neighbor, since the neighboring pixels have different colors.
+             *
+             * @param interpolation_method The interpolation method.
+            */
+            void set_interpolation_method(InterpolationMethod interpolation_method);
+
             /**
              * @brief Set the range of y values to be used in the calibrated data. This is useful to safe memory when stacking large number of images.
+             * Only the lines of the original photo which are mapped (through the alignment) into this range are calibrated, debayered and shifted and the output buffers contain only this range.
              *
              * @param y_min The minimum y value in pixels.
              * @param y_max The maximum y value in pixels.
@@ -97,7 +122,7 @@ namespace AstroPhotoStacker {
             /**
              * @brief Get the value of the pixel at the given index in the reference frame, when color interpolation is used. This method is optimized for speed, no boundary checks are performed.
              *
-             * @param index The index of the pixel in the reference frame.
+             * @param index The index of the pixel in the reference frame, relative to the first line of the y-range (i.e. (y-y_min)*width + x).
              * @param color The color of the pixel at the given index.
              * @return The value of the pixel at the given index.
             */
@@ -113,15 +138,32 @@ namespace AstroPhotoStacker {
                 return m_height;
             };
 
+            int get_y_min() const {
+                return m_y_min;
+            };
+
+            int get_y_max() const {
+                return m_y_max;
+            };
+
             /**
              * @brief Get the data of the calibrated photo.
              *
-             * @return const std::vector<std::vector<PixelType>>& The data of the calibrated photo.
+             * @return const std::vector<std::vector<PixelType>>& The data of the calibrated photo, indexed as [color][(y-y_min)*width + x].
             */
             const std::vector<std::vector<PixelType>>& get_calibrated_data_after_color_interpolation() const {
                 return m_data_shifted_color_interpolation;
             };
 
+            /**
+             * @brief Move the data of the calibrated photo out of the object. The calibrated data are not available in the object afterwards.
+             *
+             * @return std::vector<std::vector<PixelType>> The data of the calibrated photo, indexed as [color][(y-y_min)*width + x].
+            */
+            std::vector<std::vector<PixelType>> release_calibrated_data_after_color_interpolation() {
+                return std::move(m_data_shifted_color_interpolation);
+            };
+
         private:
             int m_width;
             int m_height;
@@ -131,6 +173,11 @@ namespace AstroPhotoStacker {
             int m_y_min = -1;
             int m_y_max = -1;
             unsigned int m_max_allowed_pixel_value = 1 << 14;
+            unsigned int m_n_threads = 1;
+            InterpolationMethod m_interpolation_method = InterpolationMethod::NEAREST_NEIGHBOR;
+
+            // number of output lines processed together by "calibrate"
+            static constexpr int c_strip_height = 64;
 
             const HotPixelIdentifier *m_hot_pixel_identifier    = nullptr;
             std::vector<std::shared_ptr<const CalibrationFrameBase>> m_calibration_frames;
@@ -145,6 +192,12 @@ namespace AstroPhotoStacker {
             std::vector<PixelType> m_data_shifted;
             std::vector<char> m_colors_shifted;
 
-            void fix_hot_pixel(int x, int y, std::vector<PixelType> *data);
+            /**
+             * @brief Get the range of lines in the original photo, which are needed to produce lines <m_y_min, m_y_max) in the reference frame.
+             *
+             * @param y_min_original The first line needed.
+             * @param y_max_original The first line not needed.
+            */
+            void get_y_range_in_original_photo(int *y_min_original, int *y_max_original) const;
     };
 }
\ No newline at end of file
@@ -48,7 +48,37 @@ namespace AstroPhotoStacker {
             */
             virtual float get_updated_pixel_value(float pixel_value, int x, int y) const = 0;
 
-            virtual void apply_calibration(std::vector<PixelType> *data) const;
+            /**
+             * @brief Apply the calibration frame on the data. Only the lines in range <y_min, y_max) are calibrated, the remaining lines are left untouched.
+             *
+             * @param data The data of the full frame (width*height elements)
+             * @param y_min The first line to calibrate
+             * @param y_max The first line not to calibrate. If negative, all the lines up to the end of the frame are calibrated.
+            */
+            virtual void apply_calibration(std::vector<PixelType> *data, int y_min = 0, int y_max = -1) const;
+
+            /**
+             * @brief Check if the calibration can be expressed as "value -> (value - offset)*scale" with per-pixel offset and scale, so that it can be merged with other calibration frames (see FusedCalibration)
+            */
+            virtual bool supports_fused_calibration() const { return false; };
+
+            /**
+             * @brief Merge the calibration into per-pixel offsets and scales of the fused calibration "value -> (value - offset)*scale", applied after the calibrations merged so far
+             *
+             * @param offsets - offsets of the fused calibration (width*height elements)
+             * @param scales - scales of the fused calibration (width*height elements)
+             * @return true if the calibration has been merged, false if it does not support the fused calibration
+            */
+            virtual bool add_to_fused_calibration(float *offsets, float *scales) const { return false; };
+
+            int get_width()     const { return m_width; };
+
+            int get_height()    const { return m_height; };
+
+            /**
+             * @brief Get checksum of the calibration frame data (FNV-1a hash of the dimensions, original and calibrated pixel values), used to recognize if stored calibrated frames were produced with the same calibration frame
+            */
+            unsigned long long get_checksum() const;
 
         protected:
             virtual void calibrate() {};
@@ -0,0 +1,17 @@
+#pragma once
+
+// AVX2 kernels are compiled with the target attribute, so the rest of the code does not require AVX2. They are used only if the CPU supports AVX2 (see cpu_supports_avx2).
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define ASTRO_PHOTO_STACKER_AVX2_KERNELS
+    #include <immintrin.h>
+#endif
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Check whether the CPU supports AVX2 instructions. The result is detected only once.
+     *
+     * @return false if the CPU does not support AVX2 or if the AVX2 kernels are not compiled for this platform
+     */
+    bool cpu_supports_avx2();
+}
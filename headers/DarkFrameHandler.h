@@ -45,6 +45,10 @@ namespace AstroPhotoStacker {
             */
             virtual float get_updated_pixel_value(float pixel_value, int x, int y) const override;
 
+            virtual bool supports_fused_calibration() const override { return true; };
+
+            virtual bool add_to_fused_calibration(float *offsets, float *scales) const override;
+
         private:
             virtual void calibrate() override;
 
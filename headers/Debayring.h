@@ -19,7 +19,25 @@ namespace AstroPhotoStacker {
                                             int *closest_distance,
                                             int n_steps_max = 2);
 
-    std::vector<std::vector<PixelType>> debayer_raw_data(const std::vector<PixelType> &data_original, int width, int height, const std::array<char, 4> &bayer_pattern);
+    /**
+     * @brief Debayer the raw data. Only the lines in range <y_min, y_max) are calculated, the remaining lines are set to zero.
+     *
+     * @return std::vector<std::vector<PixelType>> - 3 color channels, each having width*height elements
+     */
+    std::vector<std::vector<PixelType>> debayer_raw_data(const std::vector<PixelType> &data_original, int width, int height, const std::array<char, 4> &bayer_pattern, int y_min = 0, int y_max = -1);
+
+    /**
+     * @brief Debayer the lines <y_begin, y_end) of the raw data into the output buffers (the first line of each buffer corresponds to y_begin). The last line and the last column of the photo are set to zero.
+     *
+     * @param data_original - raw data, width*height elements
+     * @param width - width of the photo
+     * @param height - height of the photo
+     * @param bayer_pattern - colors of the 2x2 Bayer pattern
+     * @param y_begin - first line to debayer
+     * @param y_end - first line not to debayer
+     * @param result - 3 output buffers (one per color), each having width*(y_end - y_begin) elements
+     */
+    void debayer_raw_data_lines(const PixelType *data_original, int width, int height, const std::array<char, 4> &bayer_pattern, int y_begin, int y_end, PixelType *const result[3]);
 
     void debayer_monochrome(std::vector<PixelType> *data, int width, int height, const std::array<char, 4> &bayer_pattern);
 };
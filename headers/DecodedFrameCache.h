@@ -0,0 +1,244 @@
+#pragma once
+
+#include "../headers/InputFrame.h"
+#include "../headers/Metadata.h"
+#include "../headers/PixelType.h"
+
+#include <string>
+#include <vector>
+#include <array>
+#include <map>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <filesystem>
+#include <cstddef>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Decoded image data of an input frame, as produced by the file readers
+     */
+    struct DecodedFrame {
+        int width   = 0;
+        int height  = 0;
+        bool is_raw = false;
+        std::array<char, 4> bayer_pattern = {-1, -1, -1, -1};
+        Metadata metadata;
+
+        std::vector<PixelType> raw_data;                    // single channel (raw data before debayering, or monochrome image), width*height elements
+        std::vector<std::vector<PixelType>> rgb_data;       // 3 channels, each channel is width*height elements
+
+        std::size_t get_memory_usage() const;
+    };
+
+    /**
+     * @brief Process-wide LRU cache of decoded input frames, limited by the memory budget.
+     *
+     * The same frame is usually read several times during one session (alignment, ranking, preview in the GUI, each slice of the stacking), the cache allows to decode it only once.
+     * Frames can be pinned to keep them in the cache regardless of the budget (for example the reference frame). Optionally, the frames evicted from the memory are stored in a compressed form (see compress_pixel_data) in a folder on the local disk.
+     *
+     * The global instance is disabled (zero memory budget) until set_memory_budget is called, its budget is then subtracted from the memory usage limit of the stackers.
+     */
+    class DecodedFrameCache {
+        public:
+            enum class DataType {
+                frame_data,     // raw data (before debayering) or RGB data of the frame
+                monochrome      // monochrome image calculated from the frame
+            };
+
+            struct Statistics {
+                unsigned long long  hits = 0;
+                unsigned long long  disk_hits = 0;
+                unsigned long long  misses = 0;
+                unsigned long long  evictions = 0;
+                std::size_t         memory_usage = 0;
+                std::size_t         disk_usage = 0;
+                std::size_t         number_of_frames_in_memory = 0;
+                std::size_t         number_of_frames_on_disk = 0;
+            };
+
+            /**
+             * @brief Pins the frame for the lifetime of the object
+             */
+            class PinnedFrame {
+                public:
+                    PinnedFrame(DecodedFrameCache *cache, const InputFrame &input_frame);
+                    ~PinnedFrame();
+
+                    PinnedFrame(const PinnedFrame&) = delete;
+                    PinnedFrame& operator=(const PinnedFrame&) = delete;
+
+                private:
+                    DecodedFrameCache  *m_cache;
+                    InputFrame          m_input_frame;
+            };
+
+            /**
+             * @brief Marks one pass through the frames (for the lifetime of the object). If the frames of the pass do not fit into the memory budget, storing them would only cycle
+             * through the whole LRU list without any hit, so new frames (except of the pinned ones) are not stored during such pass. The cached frames can still be read.
+             */
+            class PassGuard {
+                public:
+                    /**
+                     * @param cache - the cache
+                     * @param number_of_frames - number of frames read in the pass
+                     * @param memory_per_frame - memory needed for one decoded frame in bytes
+                     */
+                    PassGuard(DecodedFrameCache *cache, std::size_t number_of_frames, std::size_t memory_per_frame);
+                    ~PassGuard();
+
+                    PassGuard(const PassGuard&) = delete;
+                    PassGuard& operator=(const PassGuard&) = delete;
+
+                    bool is_storing_suspended() const { return m_storing_suspended; };
+
+                private:
+                    DecodedFrameCache  *m_cache;
+                    bool                m_storing_suspended = false;
+            };
+
+            DecodedFrameCache(const DecodedFrameCache&) = delete;
+            DecodedFrameCache& operator=(const DecodedFrameCache&) = delete;
+
+            /**
+             * @brief Construct the cache
+             *
+             * @param memory_budget - maximal memory used by the frames which are not pinned, in bytes. 0 disables the cache.
+             */
+            explicit DecodedFrameCache(std::size_t memory_budget = c_default_memory_budget);
+
+            /**
+             * @brief Remove the files of the disk cache
+             */
+            ~DecodedFrameCache();
+
+            /**
+             * @brief Get the cache shared by the whole process. It is disabled until its memory budget is set.
+             */
+            static DecodedFrameCache &get_global_instance();
+
+            /**
+             * @brief Set the memory budget, frames are evicted if the current usage exceeds the new budget
+             *
+             * @param memory_budget - maximal memory used by the frames which are not pinned, in bytes. 0 disables the cache.
+             */
+            void set_memory_budget(std::size_t memory_budget);
+
+            std::size_t get_memory_budget() const;
+
+            bool is_enabled() const { return get_memory_budget() > 0; };
+
+            /**
+             * @brief Enable storing of the frames evicted from the memory in a folder on the local disk (compressed). The files are removed when the cache is destroyed or cleared.
+             * If the folder does not change, the cached files are kept and only the budget is updated.
+             *
+             * @param folder - folder for the cached files, it is created if it does not exist. Empty string disables the disk cache.
+             * @param disk_budget - maximal size of the cached files in bytes
+             */
+            void set_disk_cache(const std::string &folder, std::size_t disk_budget);
+
+            /**
+             * @brief Get the cached frame
+             *
+             * @param input_frame - the frame
+             * @param data_type - type of the data
+             * @return std::shared_ptr<const DecodedFrame> - the cached data, nullptr if they are not in the cache (or the file has been modified since they were cached)
+             */
+            std::shared_ptr<const DecodedFrame> get(const InputFrame &input_frame, DataType data_type);
+
+            /**
+             * @brief Store the frame in the cache. Least recently used frames which are not pinned are evicted if the memory budget is exceeded.
+             *
+             * @param input_frame - the frame
+             * @param data_type - type of the data
+             * @param decoded_frame - the data to store
+             * @return true if the frame has been stored, false if the cache is disabled or storing is suspended (see PassGuard)
+             */
+            bool put(const InputFrame &input_frame, DataType data_type, std::shared_ptr<const DecodedFrame> decoded_frame);
+
+            /**
+             * @brief Pin the frame (all its data types), so that it is not evicted from the memory. Pins are counted, each "pin" call must be followed by "unpin".
+             */
+            void pin(const InputFrame &input_frame);
+
+            void unpin(const InputFrame &input_frame);
+
+            /**
+             * @brief Remove all frames from the cache (including pinned ones) and delete the files of the disk cache
+             */
+            void clear();
+
+            Statistics get_statistics() const;
+
+            static constexpr std::size_t c_default_memory_budget = std::size_t(1024)*1024*1024;     // for the explicitly constructed caches, the global instance starts disabled
+
+        private:
+            using CacheKey = std::pair<InputFrame, DataType>;
+
+            struct MemoryEntry {
+                std::shared_ptr<const DecodedFrame>     decoded_frame;
+                std::size_t                             memory_usage;
+                std::filesystem::file_time_type         source_last_write_time;
+                std::list<CacheKey>::iterator           lru_position;
+            };
+
+            struct DiskEntry {
+                std::string                             file_address;
+                std::size_t                             file_size;
+                std::filesystem::file_time_type         source_last_write_time;
+                std::shared_ptr<const DecodedFrame>     frame_without_pixels;   // dimensions and metadata, the pixels are in the file
+                std::list<CacheKey>::iterator           lru_position;
+            };
+
+            struct FrameToSpill {
+                CacheKey                                key;
+                std::shared_ptr<const DecodedFrame>     decoded_frame;
+                std::filesystem::file_time_type         source_last_write_time;
+            };
+
+            mutable std::mutex              m_mutex;
+            std::size_t                     m_memory_budget;
+            std::size_t                     m_memory_usage = 0;
+            std::map<CacheKey, MemoryEntry> m_memory_entries;
+            std::list<CacheKey>             m_memory_lru;   // most recently used at the front
+            std::map<InputFrame, unsigned int> m_pin_counts;
+
+            std::string                     m_disk_cache_folder;
+            std::size_t                     m_disk_budget = 0;
+            std::size_t                     m_disk_usage = 0;
+            std::map<CacheKey, DiskEntry>   m_disk_entries;
+            std::list<CacheKey>             m_disk_lru;
+            unsigned long long              m_disk_file_counter = 0;
+
+            Statistics                      m_statistics;
+            unsigned int                    m_storing_suspension_count = 0; // number of active passes which do not fit into the budget, see PassGuard
+
+            /**
+             * @brief Evict least recently used frames which are not pinned until the memory usage fits into the budget, must be called with m_mutex locked
+             *
+             * @return std::vector<FrameToSpill> - evicted frames which should be written into the disk cache
+             */
+            std::vector<FrameToSpill> evict_frames();
+
+            void remove_memory_entry(std::map<CacheKey, MemoryEntry>::iterator it);
+
+            void remove_disk_entry(std::map<CacheKey, DiskEntry>::iterator it);
+
+            /**
+             * @brief Write the evicted frames into the disk cache, must be called without m_mutex locked
+             */
+            void spill_to_disk(const std::vector<FrameToSpill> &frames_to_spill);
+
+            std::shared_ptr<const DecodedFrame> read_from_disk(const std::string &file_address, const DecodedFrame &frame_without_pixels) const;
+
+            bool is_pinned(const InputFrame &input_frame) const;
+
+            /**
+             * @brief Check if the new frame should be stored in the memory, must be called with m_mutex locked
+             */
+            bool should_store(const InputFrame &input_frame) const;
+
+            static std::filesystem::file_time_type get_source_last_write_time(const InputFrame &input_frame);
+    };
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Displacement field sampled on a regular grid of nodes, interpolated bilinearly between them. It is used to replace expensive per-pixel evaluation
+     * of sparse shifts (nearest neighbors search and inverse distance weighting) by a few multiplications. Outside of the grid, the displacement of the closest edge node is used.
+     *
+     * The object is immutable after construction, so it can be used from several threads at once.
+    */
+    class DisplacementGrid {
+        public:
+            DisplacementGrid() = delete;
+
+            /**
+             * @brief Construct a new Displacement Grid object and evaluate the displacement in its nodes
+             *
+             * @param x_min - x coordinate of the first grid node
+             * @param y_min - y coordinate of the first grid node
+             * @param x_max - the grid is extended at least up to this x coordinate
+             * @param y_max - the grid is extended at least up to this y coordinate
+             * @param spacing - distance between the neighboring nodes in pixels
+             * @param get_displacement - function returning the displacement (dx, dy) at given coordinates
+            */
+            DisplacementGrid(int x_min, int y_min, int x_max, int y_max, int spacing, const std::function<void(float x, float y, float *dx, float *dy)> &get_displacement);
+
+            /**
+             * @brief Shift the coordinates by the interpolated displacement
+             *
+             * @param x - pointer to the x coordinate, it will be overwritten by the shifted coordinate
+             * @param y - pointer to the y coordinate, it will be overwritten by the shifted coordinate
+            */
+            void transform(float *x, float *y) const    {
+                int index_x, index_y;
+                float weight_x, weight_y;
+                get_cell(*x, m_x_min, m_n_nodes_x, &index_x, &weight_x);
+                get_cell(*y, m_y_min, m_n_nodes_y, &index_y, &weight_y);
+
+                const int index = index_y*m_n_nodes_x + index_x;
+                const float weight_00 = (1 - weight_x)*(1 - weight_y);
+                const float weight_10 = weight_x*(1 - weight_y);
+                const float weight_01 = (1 - weight_x)*weight_y;
+                const float weight_11 = weight_x*weight_y;
+                *x += weight_00*m_dx[index] + weight_10*m_dx[index + 1] + weight_01*m_dx[index + m_n_nodes_x] + weight_11*m_dx[index + m_n_nodes_x + 1];
+                *y += weight_00*m_dy[index] + weight_10*m_dy[index + 1] + weight_01*m_dy[index + m_n_nodes_x] + weight_11*m_dy[index + m_n_nodes_x + 1];
+            };
+
+            /**
+             * @brief Shift the pixels <x_begin, x_end) of the line y, the vertical interpolation is done once per grid cell
+             *
+             * @param y - the line
+             * @param x_begin - the first pixel of the line
+             * @param x_end - the first pixel not to transform
+             * @param x_shifted - output buffer for the shifted x coordinates, (x_end - x_begin) elements
+             * @param y_shifted - output buffer for the shifted y coordinates, (x_end - x_begin) elements
+            */
+            void transform_row(int y, int x_begin, int x_end, float *__restrict x_shifted, float *__restrict y_shifted) const;
+
+            static constexpr int c_default_spacing = 16;
+
+        private:
+            int m_x_min;
+            int m_y_min;
+            int m_spacing;
+            float m_inverse_spacing;
+            int m_n_nodes_x;
+            int m_n_nodes_y;
+
+            // displacements in the nodes, indexed as [index_y*m_n_nodes_x + index_x]
+            std::vector<float> m_dx;
+            std::vector<float> m_dy;
+
+            /**
+             * @brief Get index of the grid cell containing the coordinate (clamped to the grid) and the relative position within the cell <0,1>
+            */
+            void get_cell(float coordinate, int coordinate_min, int n_nodes, int *index, float *weight) const   {
+                const float position = std::clamp((coordinate - coordinate_min)*m_inverse_spacing, 0.f, float(n_nodes - 1));
+                *index = std::min(int(position), n_nodes - 2);
+                *weight = position - *index;
+            };
+    };
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Size and last write time of a file, used to check whether a cached object created from the file is still up to date.
+     */
+    struct FileStatus {
+        std::size_t     size = 0;
+        long long       last_write_time = 0; // nanoseconds since epoch
+
+        bool operator==(const FileStatus &other) const { return size == other.size && last_write_time == other.last_write_time; };
+        bool operator!=(const FileStatus &other) const { return !(*this == other); };
+    };
+
+    /**
+     * @brief Get the size and the last write time of the file by one stat call
+     *
+     * @param file_address - path to the file
+     * @param file_status - output, filled only if the call succeeded
+     * @return true if the file exists and its status was read
+     */
+    bool get_file_status(const std::string &file_address, FileStatus *file_status);
+
+    /**
+     * @brief Get the size and the last write time of an opened file by one fstat call
+     *
+     * @param file_descriptor - descriptor of the opened file
+     * @param file_status - output, filled only if the call succeeded
+     * @return true if the status was read
+     */
+    bool get_file_status(int file_descriptor, FileStatus *file_status);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "../headers/FileStatus.h"
+
+#include <string>
+#include <memory>
+#include <map>
+#include <fstream>
+#include <cstddef>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Parsed primary header of a FITS file.
+     *
+     * The header is read in 2880-byte blocks and each 80-character card is parsed only once. The parsed headers are shared - "get_instance" returns the same object for all readers of the file,
+     * so reading the resolution, the metadata and the data of the same file parses the header only once.
+     */
+    class FitFileHeader {
+        public:
+            FitFileHeader()                     = delete;
+            FitFileHeader(const FitFileHeader&) = delete;
+            FitFileHeader& operator=(const FitFileHeader&) = delete;
+
+            /**
+             * @brief Read and parse the header of the FITS file. Use "get_instance" to share the parsed header between the readers.
+             *
+             * @param file_address - path to the FITS file
+             */
+            explicit FitFileHeader(const std::string &file_address);
+
+            /**
+             * @brief Get the shared parsed header of the file. The header is parsed if it is not in the cache yet or if the file has been modified since it was parsed.
+             * The file is checked by a single stat call and the parsing is done without holding the lock of the cache, so that readers of other files are not blocked.
+             *
+             * @param file_address - path to the FITS file
+             * @return std::shared_ptr<const FitFileHeader> - the shared parsed header
+             */
+            static std::shared_ptr<const FitFileHeader> get_instance(const std::string &file_address);
+
+            /**
+             * @brief Get the keywords of the header and their values. String values are without quotes, comments are removed.
+             */
+            const std::map<std::string, std::string>& get_keywords() const { return m_keywords; };
+
+            /**
+             * @brief Get the position of the first byte of the image data in the file
+             */
+            std::size_t get_data_offset()   const { return m_data_offset; };
+
+            /**
+             * @brief Get the size of the image data in bytes (NAXIS1 * NAXIS2 * |BITPIX| / 8)
+             */
+            std::size_t get_data_size()     const { return m_data_size; };
+
+            std::size_t get_file_size()     const { return m_file_status.size; };
+
+        private:
+            /**
+             * @brief Read and parse the header of the FITS file whose status was already read by "get_file_status"
+             */
+            FitFileHeader(const std::string &file_address, const FileStatus &file_status);
+
+            std::string     m_file_address;
+            FileStatus      m_file_status;
+
+            std::map<std::string, std::string> m_keywords;
+            std::size_t     m_data_offset = 0;
+            std::size_t     m_data_size = 0;
+
+            /**
+             * @brief Parse one 80-character card and store its keyword and value
+             *
+             * @param card - pointer to the beginning of the card
+             * @return true if the card is the END card
+             */
+            bool parse_card(const char *card);
+
+            /**
+             * @brief Read the blocks of the header until the END card and parse them
+             */
+            void read_header();
+
+            void calculate_data_size();
+
+            /**
+             * @brief Find the beginning of the data. Standard files have the data at the beginning of the block following the END card.
+             * Files with blank padding blocks after the header and files without the padding of the header are supported as well.
+             *
+             * @param header - the content of the file read so far (complete blocks up to the one with the END card)
+             * @param end_card_position - position of the END card in the file
+             * @param file - the input stream, used to check the blocks after the header
+             */
+            void find_data_offset(const std::string &header, std::size_t end_card_position, std::ifstream *file);
+
+            static constexpr std::size_t c_block_size = 2880;
+            static constexpr std::size_t c_card_size = 80;
+            static constexpr std::size_t c_max_cached_headers = 256;
+    };
+}
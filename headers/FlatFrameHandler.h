@@ -47,6 +47,10 @@ namespace AstroPhotoStacker {
                 return pixel_value * m_data_calibrated[y*m_width + x];
             };
 
+            virtual bool supports_fused_calibration() const override { return true; };
+
+            virtual bool add_to_fused_calibration(float *offsets, float *scales) const override;
+
         private:
             virtual void calibrate() override;
 
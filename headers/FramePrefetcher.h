@@ -0,0 +1,137 @@
+#pragma once
+
+#include "../headers/InputFrame.h"
+#include "../headers/InputFrameReader.h"
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Reads and decodes the input frames ahead in dedicated I/O threads, so that the disk access (and file decoding) overlaps with the calibration and stacking done by the compute threads.
+     *
+     * The consumers are expected to take the frames in ranges of consecutive frames - each consumer takes the next range not started yet and processes its frames in order.
+     * The prefetcher follows this order: it keeps one range active per consumer and loads the lowest not started frame of the active range with the fewest frames loaded ahead, so that all the consumers get their frames.
+     * At most "queue_depth" frames per active range are loaded or waiting to be taken at the same time, and their memory is limited by "memory_budget_in_mb".
+     * Frames can be taken in any order - if the requested frame has not been started by the I/O threads yet (or it has been taken already), it is read synchronously in the calling thread.
+     */
+    class FramePrefetcher {
+        public:
+            FramePrefetcher()                       = delete;
+            FramePrefetcher(const FramePrefetcher&) = delete;
+
+            /**
+             * @brief Start reading the frames in the background
+             *
+             * @param input_frames - frames to read
+             * @param frames_per_range - number of consecutive frames taken by one consumer at once (see get_number_of_consecutive_frames_per_task), 0 means that all the frames are taken in order by one consumer
+             * @param n_consumers - number of threads taking the frames at the same time, each of them working on its own range
+             * @param queue_depth - maximal number of frames being loaded or waiting to be taken, for each consumer
+             * @param memory_budget_in_mb - maximal memory used by the loaded frames waiting to be taken, 0 means no limit. At least one frame is always loaded.
+             * @param n_io_threads - number of I/O threads. Only one thread is used for videos, since their frames have to be decoded sequentially.
+             */
+            FramePrefetcher(const std::vector<InputFrame> &input_frames,
+                            unsigned int frames_per_range = 0,
+                            unsigned int n_consumers    = 1,
+                            unsigned int queue_depth    = c_default_queue_depth,
+                            unsigned int memory_budget_in_mb = c_default_memory_budget_in_mb,
+                            unsigned int n_io_threads   = c_default_number_of_io_threads);
+
+            /**
+             * @brief Stop the I/O threads, frames which have not been taken are dropped
+             */
+            ~FramePrefetcher();
+
+            /**
+             * @brief Take the loaded frame, waiting for it if it is being loaded
+             *
+             * @param frame_index - index of the frame in the vector passed to the constructor
+             * @return std::unique_ptr<InputFrameReader> - reader with the image data loaded
+             */
+            std::unique_ptr<InputFrameReader> get_frame(size_t frame_index);
+
+            /**
+             * @brief Take the loaded frame, waiting for it if it is being loaded. Frames not passed to the constructor are read synchronously.
+             *
+             * @param input_frame - the frame to take
+             * @return std::unique_ptr<InputFrameReader> - reader with the image data loaded
+             */
+            std::unique_ptr<InputFrameReader> get_frame(const InputFrame &input_frame);
+
+            static constexpr unsigned int c_default_queue_depth = 4;
+            static constexpr unsigned int c_default_memory_budget_in_mb = 1024;
+            static constexpr unsigned int c_default_number_of_io_threads = 2;
+
+        private:
+            enum class FrameState {
+                not_started,
+                loading,
+                ready,
+                taken
+            };
+
+            struct FrameSlot {
+                FrameState                          state = FrameState::not_started;
+                std::unique_ptr<InputFrameReader>   reader = nullptr;
+                std::exception_ptr                  exception = nullptr;
+                size_t                              memory_usage = 0;
+            };
+
+            struct ActiveRange {
+                size_t  range_index;
+                size_t  next_frame;     // the lowest frame of the range which might not be started yet
+                size_t  end;
+            };
+
+            std::vector<InputFrame>         m_input_frames;
+            std::map<InputFrame, size_t>    m_frame_indices;
+            std::vector<FrameSlot>          m_slots;
+
+            size_t          m_frames_per_range;
+            unsigned int    m_n_consumers;
+            unsigned int    m_queue_depth;
+            size_t          m_memory_budget;
+
+            std::mutex              m_mutex;
+            std::condition_variable m_condition;
+            bool                    m_stop = false;
+            std::vector<ActiveRange>    m_active_ranges;
+            size_t                      m_next_range_to_activate = 0;
+            std::vector<unsigned int>   m_n_frames_in_queue_per_range;  // loading or ready
+            unsigned int            m_n_frames_in_queue = 0;    // loading or ready
+            unsigned int            m_n_frames_loading = 0;
+            size_t                  m_memory_in_queue = 0;      // memory of the ready frames
+            size_t                  m_last_frame_memory = 0;    // memory of the largest frame loaded so far, used as an estimate for the frames being loaded
+
+            std::vector<std::thread> m_io_threads;
+
+            void io_thread_loop();
+
+            /**
+             * @brief Skip the frames taken by the consumers in the meantime, replace the finished ranges by the next ones. Must be called with m_mutex locked.
+             */
+            void update_active_ranges();
+
+            /**
+             * @brief Get the active range whose next frame should be loaded - the one with the fewest frames loaded ahead. Must be called with m_mutex locked, after "update_active_ranges".
+             *
+             * @return ActiveRange* - nullptr if all the active ranges have "queue_depth" frames in the queue or if there are no active ranges
+             */
+            ActiveRange *get_range_to_load();
+
+            /**
+             * @brief Check if another frame can be loaded, must be called with m_mutex locked
+             */
+            bool can_start_loading();
+
+            std::size_t get_range_index(std::size_t frame_index) const { return frame_index/m_frames_per_range; };
+
+            static size_t get_memory_usage(const InputFrameReader &reader);
+    };
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../headers/PixelType.h"
+#include "../headers/CalibrationFrameBase.h"
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdlib>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Apply the fused calibration "value -> (value - offset)*scale", clamped to <0, max(PixelType)> and truncated, to n_pixels values. AVX2 implementation is used if the CPU supports it, scalar implementation otherwise.
+     *
+     * @param offsets - offset for each pixel (dark frame)
+     * @param scales - scale for each pixel (flat frame)
+     * @param data - the values to calibrate, they are overwritten
+     * @param n_pixels - number of values
+     */
+    void apply_fused_calibration_kernel(const float *offsets, const float *scales, PixelType *data, std::size_t n_pixels);
+
+    /**
+     * @brief Scalar implementation of apply_fused_calibration_kernel, with identical results. It is used as a fallback on CPUs without AVX2.
+     */
+    void apply_fused_calibration_kernel_scalar(const float *offsets, const float *scales, PixelType *data, std::size_t n_pixels);
+
+    /**
+     * @brief All calibration frames of a light frame merged into one per-pixel offset and scale, so that the calibration is done in a single vectorised pass over the data instead of a virtual call per pixel and calibration frame.
+     *
+     * The merged frames are shared by all light frames calibrated with the same calibration frames, see get_instance.
+     */
+    class FusedCalibration {
+        public:
+            FusedCalibration()                          = delete;
+            FusedCalibration(const FusedCalibration&)   = delete;
+            FusedCalibration& operator=(const FusedCalibration&) = delete;
+
+            /**
+             * @brief Merge the calibration frames, in the order in which they would be applied
+             *
+             * @param calibration_frames - the calibration frames, all of them must support the fused calibration (see CalibrationFrameBase::add_to_fused_calibration)
+             */
+            explicit FusedCalibration(const std::vector<std::shared_ptr<const CalibrationFrameBase>> &calibration_frames);
+
+            /**
+             * @brief Get the merged calibration frames, shared by all callers using the same calibration frames
+             *
+             * @param calibration_frames - the calibration frames
+             * @return std::shared_ptr<const FusedCalibration> - the merged frames, nullptr if there are no calibration frames or some of them cannot be merged
+             */
+            static std::shared_ptr<const FusedCalibration> get_instance(const std::vector<std::shared_ptr<const CalibrationFrameBase>> &calibration_frames);
+
+            /**
+             * @brief Calibrate the lines <y_min, y_max) of the data
+             *
+             * @param data - the data of the full frame (width*height elements)
+             * @param y_min - the first line to calibrate
+             * @param y_max - the first line not to calibrate. If negative, all the lines up to the end of the frame are calibrated.
+             */
+            void apply_calibration(std::vector<PixelType> *data, int y_min = 0, int y_max = -1) const;
+
+            int get_width()     const { return m_width; };
+
+            int get_height()    const { return m_height; };
+
+        private:
+            struct AlignedBufferDeleter {
+                void operator()(float *buffer) const { std::free(buffer); };
+            };
+            using AlignedBuffer = std::unique_ptr<float[], AlignedBufferDeleter>;
+
+            int m_width     = 0;
+            int m_height    = 0;
+            AlignedBuffer m_offsets = nullptr;
+            AlignedBuffer m_scales  = nullptr;
+
+            static AlignedBuffer allocate_aligned_buffer(std::size_t size, float value);
+
+            static constexpr std::size_t c_max_cached_instances = 4;
+            static constexpr std::size_t c_buffer_alignment = 64;
+    };
+}
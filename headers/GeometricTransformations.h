@@ -60,6 +60,50 @@ namespace AstroPhotoStacker {
                 *y = -x_new*m_sinx + y_new*m_cosx + m_rotation_center_y;
             };
 
+            /**
+             * @brief Transform the pixels <x_begin, x_end) of the line y from the reference frame to the shifted frame. The terms depending only on y are computed once per line,
+             * the results are identical to calling transform_from_reference_to_shifted_frame for each pixel.
+             *
+             * @param y - the line in the reference frame
+             * @param x_begin - the first pixel of the line
+             * @param x_end - the first pixel not to transform
+             * @param x_shifted - output buffer for the x coordinates in the shifted frame, (x_end - x_begin) elements
+             * @param y_shifted - output buffer for the y coordinates in the shifted frame, (x_end - x_begin) elements
+            */
+            void transform_row_from_reference_to_shifted_frame(int y, int x_begin, int x_end, float *__restrict x_shifted, float *__restrict y_shifted)   const   {
+                const float y_new = (float(y) - m_rotation_center_y - m_shift_y) * m_zoom;
+                const float y_term_x = y_new*m_sinx;
+                const float y_term_y = y_new*m_cosx;
+                const int n_pixels = x_end - x_begin;
+                for (int i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+                    const float x_new = (float(x_begin + i_pixel) - m_rotation_center_x - m_shift_x) * m_zoom;
+                    x_shifted[i_pixel] = x_new*m_cosx + y_term_x + m_rotation_center_x;
+                    y_shifted[i_pixel] = -x_new*m_sinx + y_term_y + m_rotation_center_y;
+                }
+            };
+
+            /**
+             * @brief Transform the pixels <x_begin, x_end) of the line y from the shifted frame to the reference frame. The terms depending only on y are computed once per line,
+             * the results are identical to calling transform_to_reference_frame for each pixel.
+             *
+             * @param y - the line in the shifted frame
+             * @param x_begin - the first pixel of the line
+             * @param x_end - the first pixel not to transform
+             * @param x_reference - output buffer for the x coordinates in the reference frame, (x_end - x_begin) elements
+             * @param y_reference - output buffer for the y coordinates in the reference frame, (x_end - x_begin) elements
+            */
+            void transform_row_to_reference_frame(int y, int x_begin, int x_end, float *__restrict x_reference, float *__restrict y_reference)   const   {
+                const float y_new = (float(y) - m_rotation_center_y) / m_zoom;
+                const float y_term_x = y_new*m_sinx;
+                const float y_term_y = y_new*m_cosx;
+                const int n_pixels = x_end - x_begin;
+                for (int i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+                    const float x_new = (float(x_begin + i_pixel) - m_rotation_center_x) / m_zoom;
+                    x_reference[i_pixel] = x_new*m_cosx - y_term_x + m_rotation_center_x + m_shift_x;
+                    y_reference[i_pixel] = x_new*m_sinx + y_term_y + m_rotation_center_y + m_shift_y;
+                }
+            };
+
             void get_parameters(float *shift_x, float *shift_y, float *rotation_center_x, float *rotation_center_y, float *rotation, float *zoom = nullptr) const {
                 *shift_x = m_shift_x;
                 *shift_y = m_shift_y;
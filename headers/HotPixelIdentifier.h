@@ -9,6 +9,8 @@
 #include <mutex>
 #include <atomic>
 #include <tuple>
+#include <array>
+#include <cstdint>
 
 namespace AstroPhotoStacker {
 
@@ -54,10 +56,11 @@ namespace AstroPhotoStacker {
          * @param width The width of the photo.
          * @param height The height of the photo.
          * @param image_bit_depth The bit depth of the photo.
+         * @param n_cpu The number of threads used to process the rows of the photo.
          * @return A map of hot pixel candidates, where the key is a tuple representing the pixel coordinates (x, y),
          *         and the value is 1.
          */
-        static std::map<std::tuple<int, int>, int> get_hot_pixel_candidates_from_photo(const PixelType* pixel_value_array, int width, int height, int image_bit_depth);
+        static std::map<std::tuple<int, int>, int> get_hot_pixel_candidates_from_photo(const PixelType* pixel_value_array, int width, int height, int image_bit_depth, unsigned int n_cpu = 1);
 
         /**
          * @brief Computes the hot pixels from the added photos.
@@ -70,6 +73,12 @@ namespace AstroPhotoStacker {
          */
         const std::vector<std::tuple<int, int>>& get_hot_pixels() const;
 
+        /**
+         * @brief Gets the checksum of the hot pixel coordinates (FNV-1a hash of the sorted coordinates), used to recognize if stored calibrated frames were produced with the same hot pixels.
+         * @return The checksum.
+         */
+        unsigned long long get_hot_pixels_checksum() const;
+
         /**
          * @brief Saves the hot pixels to a file.
          * @param file_address The address of the file to save the hot pixels to.
@@ -102,6 +111,27 @@ namespace AstroPhotoStacker {
          */
         bool is_hot_pixel(int x, int y) const;
 
+        /**
+         * @brief Gets the hot pixels in the lines <y_min, y_max), sorted by y and then by x.
+         * @param y_min The first line.
+         * @param y_max The first line not to include.
+         * @return A vector of tuples representing the coordinates (x, y) of the hot pixels.
+         */
+        std::vector<std::tuple<int, int>> get_hot_pixels_in_lines(int y_min, int y_max) const;
+
+        /**
+         * @brief Replaces the hot pixels in the lines <y_min, y_max) of the raw data by the average of the same-color neighbors (3x3 neighborhood, or 5x5 if there are no same-color pixels in 3x3).
+         * Only the hot pixels are visited, they are processed in the row-major order.
+         *
+         * @param data The raw data (before debayering), width*height elements.
+         * @param width The width of the photo.
+         * @param height The height of the photo.
+         * @param bayer_pattern The colors of the 2x2 Bayer pattern.
+         * @param y_min The first line to fix.
+         * @param y_max The first line not to fix.
+         */
+        void fix_hot_pixels(std::vector<PixelType> *data, int width, int height, const std::array<char, 4> &bayer_pattern, int y_min, int y_max) const;
+
         /**
          * @brief Gets the number of processed photos.
          * @return The number of processed photos as an atomic integer.
@@ -112,7 +142,14 @@ namespace AstroPhotoStacker {
         unsigned int m_n_cpu = 1;
         std::map<std::tuple<int, int>, int> m_hot_pixel_candidates;
         std::vector<std::tuple<int, int>> m_hot_pixels;
-        std::map<std::tuple<int, int>, char> m_hot_pixels_map;
+
+        // hot pixels sorted by y and x, and a bitmap covering the bounding box of the hot pixels, both rebuilt when the hot pixels change
+        std::vector<std::tuple<int, int>> m_hot_pixels_sorted;
+        std::vector<std::uint64_t> m_hot_pixels_bitmap;
+        int m_bitmap_width = 0;
+        int m_bitmap_height = 0;
+
+        void update_hot_pixels_index();
         std::mutex m_mutex;
         std::atomic<int> m_n_photos_processed = 0;
     };
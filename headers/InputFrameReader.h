@@ -8,8 +8,10 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <memory>
 
 namespace AstroPhotoStacker {
+    struct DecodedFrame;
 
     /**
      * Class for reading image data and metadata from input frames (video or still, raw or non-raw).
@@ -28,6 +30,10 @@ namespace AstroPhotoStacker {
 
             InputFrameReader() = delete;
 
+            /**
+             * Load the image data. The decoded data are taken from the DecodedFrameCache if available, otherwise the frame is decoded and stored in the cache.
+             * The cached data are shared with the cache (not copied), they are copied only if they are about to be modified.
+             */
             void load_input_frame_data();
 
             bool data_are_loaded() const;
@@ -38,15 +44,24 @@ namespace AstroPhotoStacker {
 
             bool is_raw_file_before_debayering() const;
 
-            void debayer();
+            /**
+             * Debayer the raw data. Only the lines in range <y_min, y_max) are debayered, the remaining lines are set to zero.
+             *
+             * @param y_min The first line to debayer.
+             * @param y_max The first line not to debayer. If negative, all the lines up to the end of the frame are debayered.
+             */
+            void debayer(int y_min = 0, int y_max = -1);
 
             const std::vector<std::vector<PixelType>> &get_rgb_data();
 
-            const std::vector<PixelType> &get_raw_data() const { return m_raw_data; };
+            const std::vector<PixelType> &get_raw_data() const;
 
             // we need this for hot pixel correction
-            inline std::vector<PixelType>& get_raw_data_non_const() { return m_raw_data; };
+            std::vector<PixelType>& get_raw_data_non_const();
 
+            /**
+             * Get the monochrome image of the frame. If the data have not been modified, the result is cached in the DecodedFrameCache - if it is already there, the frame does not even need to be loaded.
+             */
             std::vector<PixelType> get_monochrome_data();
 
             void get_photo_resolution(int *width, int *height);
@@ -72,6 +87,7 @@ namespace AstroPhotoStacker {
             bool m_is_raw_before_debayering = false;
             bool m_is_raw_file = false;
             bool m_data_are_loaded = false;
+            bool m_data_are_modified = false; // data were debayered or could have been modified by the caller, they do not correspond to the cached data anymore
             Metadata m_metadata;
 
             std::array<char, 4> m_bayer_pattern = {-1, -1, -1, -1};
@@ -79,8 +95,22 @@ namespace AstroPhotoStacker {
 
             std::vector<std::vector<PixelType>> m_rgb_data; // 3 channels, each channel is width*height elements
 
+            // if not nullptr, the pixel data are read from this frame shared with the DecodedFrameCache, and m_raw_data and m_rgb_data are empty
+            std::shared_ptr<const DecodedFrame> m_shared_frame = nullptr;
+
+            const std::vector<PixelType> &raw_data() const;
+
+            const std::vector<std::vector<PixelType>> &rgb_data() const;
+
+            /**
+             * Copy the data shared with the cache into m_raw_data and m_rgb_data, so that they can be modified
+             */
+            void detach_from_shared_frame();
+
             void read_raw();
 
             void read_non_raw();
+
+            void store_in_cache();
     };
 }
\ No newline at end of file
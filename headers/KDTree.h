@@ -8,6 +8,7 @@
 #include<string>
 #include<memory>
 #include<algorithm>
+#include<numeric>
 #include<fstream>
 #include <stdlib.h>
 #include <array>
@@ -23,22 +24,32 @@ namespace AstroPhotoStacker   {
                     m_coordinates[i] = 0;
                 }
             };
-            KDTreeNode(const CoordinateType *coordinates, const ValueType &star_indices);
-
-            PointIndexType get_child_index(const CoordinateType *coordinates);
 
             std::array<CoordinateType, NumberOfCoordinates> m_coordinates;
             ValueType           m_value;
-            short               m_split_axis            = -1;
-            PointIndexType      m_index_child_left      = -1;
-            PointIndexType      m_index_child_right     = -1;
-            PointIndexType      m_index_parent          = -1;
+    };
 
+    /**
+     * @brief Buffers used by the nearest neighbors search. They can be reused by consecutive queries (from the same thread) to avoid memory allocations.
+     */
+    struct KDTreeSearchBuffer {
+        struct StackEntry {
+            PointIndexType  begin;
+            PointIndexType  end;
+            unsigned int    depth;
+            double          distance_to_split_plane_squared;
+        };
+
+        std::vector<std::tuple<long long int, double>>  indices_and_distances;  // sorted by distance
+        std::vector<StackEntry>                         stack;
     };
 
     /**
-     * @brief Class implementing k-dimensional binary tree, which can be used to search for the nearest neighbors of a point
+     * @brief Class implementing k-dimensional binary tree, which can be used to search for the nearest neighbors of a point.
      *
+     * The tree has an implicit layout: the coordinates are stored in a flat array ordered so that the root of the subtree spanning <begin, end) is in the middle of the range,
+     * its left subtree in <begin, middle) and its right subtree in <middle+1, end). The split axis is given by the depth. The tree is built using std::nth_element (O(n log n))
+     * and searched iteratively using an explicit stack. Nodes keep the indices in the order in which they were added.
      */
     template<typename CoordinateType, unsigned int NumberOfCoordinates, typename ValueType>
     class KDTree    {
@@ -74,7 +85,7 @@ namespace AstroPhotoStacker   {
              *
              */
             long long int get_root_node_index() const {
-                return m_root_node_index;
+                return m_tree_node_indices.empty() ? -1 : m_tree_node_indices[m_tree_node_indices.size()/2];
             }
 
             /**
@@ -112,6 +123,10 @@ namespace AstroPhotoStacker   {
              * @param value - these are the additional data associated with the node
              */
             void add_point(const CoordinateType *coordinates, const ValueType &value)   {
+                if (m_tree_structure_built) {
+                    throw std::runtime_error("KDTree::add_point: tree structure already built.");
+                }
+
                 KDTreeNode<CoordinateType, NumberOfCoordinates, ValueType> node;
                 for (unsigned int i = 0; i < m_n_dim; ++i)  {
                     node.m_coordinates[i] = coordinates[i];
@@ -137,21 +152,20 @@ namespace AstroPhotoStacker   {
                     }
                 }
 
-                for (int i = 0; i < coordinates.size(); ++i)  {
+                for (size_t i = 0; i < coordinates.size(); ++i)  {
                     add_point(coordinates[i], values[i]);
                 }
             };
 
             std::vector<std::tuple<std::array<CoordinateType, NumberOfCoordinates>, ValueType>> get_k_nearest_neighbors(const CoordinateType *query_point, unsigned int n_points)    const   {
-                std::vector<long long int> indices = get_k_nearest_neighbors_indices(query_point, n_points);
+                const std::vector<long long int> indices = get_k_nearest_neighbors_indices(query_point, n_points);
                 std::vector<std::tuple<std::array<CoordinateType, NumberOfCoordinates>, ValueType>> result;
                 result.reserve(indices.size());
                 for (long long int index : indices)  {
                     const KDTreeNode<CoordinateType, NumberOfCoordinates, ValueType> &point = m_nodes[index];
-                    std::array<CoordinateType, NumberOfCoordinates> coordinates = point.m_coordinates;
                     result.push_back (
                         std::tuple<std::array<CoordinateType, NumberOfCoordinates>, ValueType>   (
-                            coordinates,
+                            point.m_coordinates,
                             point.m_value
                         )
                     );
@@ -160,25 +174,56 @@ namespace AstroPhotoStacker   {
             };
 
             /**
-             * @brief Get vector of indices of n closest points to the query point.
+             * @brief Get vector of indices of n closest points to the query point, sorted by the distance.
              *
              * @param coordinates of the query point
              * @param n - number of closest points to return
              */
             std::vector<long long int> get_k_nearest_neighbors_indices(const CoordinateType *coordinates, unsigned int n) const {
+                KDTreeSearchBuffer search_buffer;
+                get_k_nearest_neighbors(coordinates, n, &search_buffer);
+
+                std::vector<long long int> result;
+                result.reserve(search_buffer.indices_and_distances.size());
+                for (const auto &index_and_distance : search_buffer.indices_and_distances)  {
+                    result.push_back(std::get<0>(index_and_distance));
+                }
+                return result;
+            };
+
+            /**
+             * @brief Find the n closest points to the query point, results are stored in search_buffer->indices_and_distances (sorted by the distance)
+             *
+             * @param coordinates of the query point
+             * @param n - number of closest points to find
+             * @param search_buffer - buffers for the search, they can be reused for the next queries
+             */
+            void get_k_nearest_neighbors(const CoordinateType *coordinates, unsigned int n, KDTreeSearchBuffer *search_buffer) const {
                 if (!m_tree_structure_built) {
                     throw std::runtime_error("KDTree::get_k_nearest_neighbors_indices: tree structure not built.");
                 }
                 if (n > m_nodes.size()) {
                     throw std::runtime_error("KDTree::get_k_nearest_neighbors_indices: n must be smaller than the number of nodes.");
                 }
+                get_n_closest_nodes(coordinates, n, search_buffer);
+            };
 
-                std::vector<std::tuple<long long int, double>> indices_and_distances;
-                get_n_closest_nodes_recursive(coordinates, &indices_and_distances, n, m_root_node_index);
-
-                std::vector<long long int> result;
-                for (const auto &index_and_distance : indices_and_distances)  {
-                    result.push_back(std::get<0>(index_and_distance));
+            /**
+             * @brief Get indices of n closest points for each of the query points, one search buffer is reused for all of them.
+             *
+             * @param query_points - coordinates of the query points, indexed as [i_query*NumberOfCoordinates + i_coordinate]
+             * @param n_queries - number of query points
+             * @param n - number of closest points to return for each query point
+             * @return std::vector<long long int> - indices of the closest points, indexed as [i_query*n + i_neighbor], sorted by the distance for each query point
+             */
+            std::vector<long long int> get_k_nearest_neighbors_indices(const CoordinateType *query_points, size_t n_queries, unsigned int n) const {
+                std::vector<long long int> result(n_queries*n);
+                KDTreeSearchBuffer search_buffer;
+                for (size_t i_query = 0; i_query < n_queries; ++i_query)  {
+                    get_k_nearest_neighbors(&query_points[i_query*NumberOfCoordinates], n, &search_buffer);
+                    for (unsigned int i_neighbor = 0; i_neighbor < n; ++i_neighbor)  {
+                        result[i_query*n + i_neighbor] = std::get<0>(search_buffer.indices_and_distances[i_neighbor]);
+                    }
                 }
                 return result;
             };
@@ -188,20 +233,27 @@ namespace AstroPhotoStacker   {
              *
              */
             std::vector<long long int> get_nodes_closer_than_x(const CoordinateType *coordinates, const double distance) const {
-                if (!m_tree_structure_built) {
-                    throw std::runtime_error("KDTree::get_nodes_closer_than_x: tree structure not built.");
-                }
-
-                std::vector<std::tuple<long long int, double>> indices_and_distances;
-                get_nodes_closer_than_x_recursive(coordinates, &indices_and_distances, distance*distance, m_root_node_index);
+                KDTreeSearchBuffer search_buffer;
+                get_nodes_closer_than_x(coordinates, distance, &search_buffer);
 
                 std::vector<long long int> result;
-                for (const auto &index_and_distance : indices_and_distances)  {
+                result.reserve(search_buffer.indices_and_distances.size());
+                for (const auto &index_and_distance : search_buffer.indices_and_distances)  {
                     result.push_back(std::get<0>(index_and_distance));
                 }
                 return result;
             }
 
+            /**
+             * @brief Find all points closer than "distance" to the query point, results are stored in search_buffer->indices_and_distances (not sorted)
+             */
+            void get_nodes_closer_than_x(const CoordinateType *coordinates, const double distance, KDTreeSearchBuffer *search_buffer) const {
+                if (!m_tree_structure_built) {
+                    throw std::runtime_error("KDTree::get_nodes_closer_than_x: tree structure not built.");
+                }
+                get_nodes_closer_than_x_squared(coordinates, distance*distance, search_buffer);
+            }
+
 
             /**
              * @brief Create the tree structure from the added nodes. After this, no more nodes can be added.
@@ -211,12 +263,15 @@ namespace AstroPhotoStacker   {
                 if (m_tree_structure_built) {
                     return;
                 }
-                std::vector<long long int> node_indices;
-                for (unsigned long long int i = 0; i < m_nodes.size(); ++i)  {
-                    node_indices.push_back(i);
-                }
+                m_tree_node_indices.resize(m_nodes.size());
+                std::iota(m_tree_node_indices.begin(), m_tree_node_indices.end(), 0);
+                build_subtree(0, m_tree_node_indices.size(), 0);
 
-                m_root_node_index = build_node(node_indices, 0);
+                m_tree_coordinates.resize(m_nodes.size()*NumberOfCoordinates);
+                for (size_t i_tree = 0; i_tree < m_tree_node_indices.size(); ++i_tree)  {
+                    const std::array<CoordinateType, NumberOfCoordinates> &coordinates = m_nodes[m_tree_node_indices[i_tree]].m_coordinates;
+                    std::copy(coordinates.begin(), coordinates.end(), &m_tree_coordinates[i_tree*NumberOfCoordinates]);
+                }
                 m_tree_structure_built = true;
             };
 
@@ -228,172 +283,128 @@ namespace AstroPhotoStacker   {
         protected:
             bool m_tree_structure_built = false;
             std::vector<KDTreeNode<CoordinateType, NumberOfCoordinates, ValueType>> m_nodes;
-            long long int m_root_node_index = -1;
             unsigned int m_n_dim = 0;
 
+            // implicit tree layout (see class description): node indices and their coordinates, indexed as [i_tree] and [i_tree*NumberOfCoordinates + i_coordinate]
+            std::vector<PointIndexType> m_tree_node_indices;
+            std::vector<CoordinateType> m_tree_coordinates;
+
             /**
-             * @brief Takes a vector of node indices and builds a root node and its child nodes from them. Returns the index of the root node.
-             *
-             * @param node_indices - vector of node indices
-             * @param split_axis - axis along which to split the nodes
-             * @return long long int - index of the build node ("root" node)
+             * @brief Reorder m_tree_node_indices in the range <begin, end) so that the median along the split axis is in the middle, smaller values on the left and larger on the right, then process both halves
              */
-            long long int build_node(const std::vector<long long int> &node_indices, const int split_axis)    {
-                if (node_indices.size() == 0)   {
-                    return -1;
-                }
-                if (node_indices.size() == 1)   {
-                    m_nodes[node_indices[0]].m_split_axis = split_axis;
-                    return node_indices[0];
-                }
-
-                std::vector<std::tuple<long long int, CoordinateType>> node_indices_and_coordinates;
-                for (long long int node_index : node_indices)  {
-                    node_indices_and_coordinates.push_back(std::make_tuple(node_index, m_nodes[node_index].m_coordinates[split_axis]));
+            void build_subtree(size_t begin, size_t end, unsigned int depth)    {
+                if (end - begin < 2)    {
+                    return;
                 }
-
-                std::sort(node_indices_and_coordinates.begin(), node_indices_and_coordinates.end(), [](const std::tuple<long long int, CoordinateType> &a, const std::tuple<long long int, CoordinateType> &b) {
-                    return std::get<1>(a) < std::get<1>(b);
+                const unsigned int split_axis = depth % NumberOfCoordinates;
+                const size_t middle = begin + (end - begin)/2;
+                std::nth_element(m_tree_node_indices.begin() + begin, m_tree_node_indices.begin() + middle, m_tree_node_indices.begin() + end,
+                    [this, split_axis](PointIndexType a, PointIndexType b) {
+                        return m_nodes[a].m_coordinates[split_axis] < m_nodes[b].m_coordinates[split_axis];
                 });
+                build_subtree(begin,      middle, depth + 1);
+                build_subtree(middle + 1, end,    depth + 1);
+            };
 
-                const long long int median_node_index = std::get<0>(node_indices_and_coordinates[node_indices_and_coordinates.size() / 2]);
-                const CoordinateType median_coordinate = std::get<1>(node_indices_and_coordinates[node_indices_and_coordinates.size() / 2]);
-
-                node_indices_and_coordinates.clear();
-
-                m_nodes[median_node_index].m_split_axis = split_axis;
-
-                std::vector<long long int> left_node_indices;
-                std::vector<long long int> right_node_indices;
-                for (const long long int i_node : node_indices)  {
-                    if (i_node == median_node_index)    {
-                        continue;
-                    }
-                    if (m_nodes[i_node].m_coordinates[split_axis] < median_coordinate)    {
-                        left_node_indices.push_back(i_node);
-                    }
-                    else    {
-                        right_node_indices.push_back(i_node);
-                    }
+            double get_distance_squared(const CoordinateType *coordinates_1, const CoordinateType *coordinates_2)   const    {
+                double distance = 0.0;
+                for (unsigned int i = 0; i < NumberOfCoordinates; ++i)  {
+                    distance += pow2(double(coordinates_1[i]) - double(coordinates_2[i]));
                 }
-
-                m_nodes[median_node_index].m_index_child_left  = build_node(left_node_indices,  (split_axis + 1) % m_n_dim);
-                m_nodes[median_node_index].m_index_child_right = build_node(right_node_indices, (split_axis + 1) % m_n_dim);
-
-                return median_node_index;
+                return distance;
             };
 
-
             static inline void update_index_and_distance_vector(std::vector<std::tuple<long long int, double>> *node_indices_and_distances, long long int node_index, double distance, unsigned int requested_neighbors) {
                 if (node_indices_and_distances->size() == requested_neighbors)  {
                     if (distance >= std::get<1>(node_indices_and_distances->back())) {
                         return;
                     }
+                    node_indices_and_distances->pop_back();
                 }
 
-               size_t index_in_vector_to_place = 0;
-                for (size_t i = 0; i < node_indices_and_distances->size(); ++i) {
-                    index_in_vector_to_place = i;
-                    if (distance < std::get<1>((*node_indices_and_distances)[i])) {
-                        break;
-                    }
-                }
-
-                if (node_indices_and_distances->size() < requested_neighbors) {
-                    node_indices_and_distances->resize(node_indices_and_distances->size() + 1);
-                }
-
-                for (size_t i = node_indices_and_distances->size()-1; i > index_in_vector_to_place; --i) {
-                    (*node_indices_and_distances)[i] = (*node_indices_and_distances)[i-1];
-                }
-                (*node_indices_and_distances)[index_in_vector_to_place] = std::tuple<long long int, double>(node_index, distance);
+                // insertion into the sorted vector - requested number of neighbors is small
+                auto position = std::upper_bound(node_indices_and_distances->begin(), node_indices_and_distances->end(), distance,
+                    [](double distance, const std::tuple<long long int, double> &index_and_distance) {
+                        return distance < std::get<1>(index_and_distance);
+                });
+                node_indices_and_distances->insert(position, std::tuple<long long int, double>(node_index, distance));
             };
 
-            void get_n_closest_nodes_recursive( const CoordinateType *coordinates,
-                                                std::vector<std::tuple<long long int, double>> *node_indices_and_distances,
-                                                unsigned int n_neighbors,
-                                                long long int node_index) const {
-
-                if (node_index == -1)   {
+            void get_n_closest_nodes(const CoordinateType *coordinates, unsigned int n_neighbors, KDTreeSearchBuffer *search_buffer) const {
+                std::vector<std::tuple<long long int, double>> &indices_and_distances = search_buffer->indices_and_distances;
+                std::vector<KDTreeSearchBuffer::StackEntry> &stack = search_buffer->stack;
+                indices_and_distances.clear();
+                stack.clear();
+                if (n_neighbors == 0 || m_tree_node_indices.empty()) {
                     return;
                 }
+                indices_and_distances.reserve(n_neighbors + 1);
 
-                const KDTreeNode<CoordinateType, NumberOfCoordinates, ValueType> &node = m_nodes[node_index];
-                const double distance_to_node = get_distance_squared(coordinates, node.m_coordinates);
-
-                update_index_and_distance_vector(node_indices_and_distances, node_index, distance_to_node, n_neighbors);
-
-                const bool go_to_left = coordinates[node.m_split_axis] < node.m_coordinates[node.m_split_axis];
-                if (go_to_left) {
-                    get_n_closest_nodes_recursive(coordinates, node_indices_and_distances, n_neighbors, node.m_index_child_left);
-                }
-                else    {
-                    get_n_closest_nodes_recursive(coordinates, node_indices_and_distances, n_neighbors, node.m_index_child_right);
-                }
+                stack.push_back({0, PointIndexType(m_tree_node_indices.size()), 0, 0.0});
+                while (!stack.empty())  {
+                    KDTreeSearchBuffer::StackEntry entry = stack.back();
+                    stack.pop_back();
 
-                const double distance_to_split_axis = pow2(coordinates[node.m_split_axis] - node.m_coordinates[node.m_split_axis]);
-                if (distance_to_split_axis < std::get<1>(node_indices_and_distances->back()) || node_indices_and_distances->size() < n_neighbors) {
-                    if (go_to_left) {
-                        get_n_closest_nodes_recursive(coordinates, node_indices_and_distances, n_neighbors, node.m_index_child_right);
+                    // the subtree is on the other side of a split plane than the query point, it is skipped if the plane is further than the n-th closest point found so far
+                    if (indices_and_distances.size() == n_neighbors && entry.distance_to_split_plane_squared >= std::get<1>(indices_and_distances.back()))  {
+                        continue;
                     }
-                    else    {
-                        get_n_closest_nodes_recursive(coordinates, node_indices_and_distances, n_neighbors, node.m_index_child_left);
+
+                    // descend to the side of the query point, the other sides are postponed
+                    while (entry.begin < entry.end) {
+                        const PointIndexType middle = entry.begin + (entry.end - entry.begin)/2;
+                        const CoordinateType *node_coordinates = &m_tree_coordinates[size_t(middle)*NumberOfCoordinates];
+                        update_index_and_distance_vector(&indices_and_distances, m_tree_node_indices[middle], get_distance_squared(coordinates, node_coordinates), n_neighbors);
+
+                        const unsigned int split_axis = entry.depth % NumberOfCoordinates;
+                        const double distance_to_split_plane = double(coordinates[split_axis]) - double(node_coordinates[split_axis]);
+                        const double distance_to_split_plane_squared = std::max(entry.distance_to_split_plane_squared, pow2(distance_to_split_plane));
+                        if (distance_to_split_plane < 0) {
+                            stack.push_back({middle + 1, entry.end, entry.depth + 1, distance_to_split_plane_squared});
+                            entry.end = middle;
+                        }
+                        else    {
+                            stack.push_back({entry.begin, middle, entry.depth + 1, distance_to_split_plane_squared});
+                            entry.begin = middle + 1;
+                        }
+                        entry.depth++;
                     }
                 }
             };
 
-
-            void get_nodes_closer_than_x_recursive( const CoordinateType *coordinates,
-                                                std::vector<std::tuple<long long int, double>> *node_indices_and_distances,
-                                                double distance_squared,
-                                                long long int node_index) const {
-
-                if (node_index == -1)   {
+            void get_nodes_closer_than_x_squared(const CoordinateType *coordinates, double distance_squared, KDTreeSearchBuffer *search_buffer) const {
+                std::vector<std::tuple<long long int, double>> &indices_and_distances = search_buffer->indices_and_distances;
+                std::vector<KDTreeSearchBuffer::StackEntry> &stack = search_buffer->stack;
+                indices_and_distances.clear();
+                stack.clear();
+                if (m_tree_node_indices.empty()) {
                     return;
                 }
 
-                const KDTreeNode<CoordinateType, NumberOfCoordinates, ValueType> &node = m_nodes[node_index];
-                const double distance_to_node = get_distance_squared(coordinates, node.m_coordinates);
-
-                if (distance_to_node < distance_squared) {
-                    node_indices_and_distances->push_back(std::tuple<long long int, double>(node_index, distance_to_node));
-                }
-
-                const bool go_to_left = coordinates[node.m_split_axis] < node.m_coordinates[node.m_split_axis];
-                if (go_to_left) {
-                    get_nodes_closer_than_x_recursive(coordinates, node_indices_and_distances, distance_squared, node.m_index_child_left);
-                }
-                else    {
-                    get_nodes_closer_than_x_recursive(coordinates, node_indices_and_distances, distance_squared, node.m_index_child_right);
-                }
-
-                const double distance_to_split_axis = pow2(coordinates[node.m_split_axis] - node.m_coordinates[node.m_split_axis]);
-                if (distance_to_split_axis < distance_squared) {
-                    if (go_to_left) {
-                        get_nodes_closer_than_x_recursive(coordinates, node_indices_and_distances, distance_squared, node.m_index_child_right);
-                    }
-                    else    {
-                        get_nodes_closer_than_x_recursive(coordinates, node_indices_and_distances, distance_squared, node.m_index_child_left);
+                stack.push_back({0, PointIndexType(m_tree_node_indices.size()), 0, 0.0});
+                while (!stack.empty())  {
+                    const KDTreeSearchBuffer::StackEntry entry = stack.back();
+                    stack.pop_back();
+                    if (entry.begin >= entry.end || entry.distance_to_split_plane_squared >= distance_squared)   {
+                        continue;
                     }
-                }
-            };
 
-            double get_distance_squared(const std::array<CoordinateType, NumberOfCoordinates> &coordinates_1, const std::array<CoordinateType, NumberOfCoordinates> &coordinates_2)   const    {
-                double distance = 0.0;
-                for (unsigned int i = 0; i < m_n_dim; ++i)  {
-                    distance += (coordinates_1[i] - coordinates_2[i]) * (coordinates_1[i] - coordinates_2[i]);
-                }
-                return distance;
-            };
+                    const PointIndexType middle = entry.begin + (entry.end - entry.begin)/2;
+                    const CoordinateType *node_coordinates = &m_tree_coordinates[size_t(middle)*NumberOfCoordinates];
+                    const double distance_to_node = get_distance_squared(coordinates, node_coordinates);
+                    if (distance_to_node < distance_squared) {
+                        indices_and_distances.push_back(std::tuple<long long int, double>(m_tree_node_indices[middle], distance_to_node));
+                    }
 
-            double get_distance_squared(const CoordinateType *coordinates_1, const std::array<CoordinateType, NumberOfCoordinates> &coordinates_2)   const    {
-                double distance = 0.0;
-                for (unsigned int i = 0; i < m_n_dim; ++i)  {
-                    distance += (coordinates_1[i] - coordinates_2[i]) * (coordinates_1[i] - coordinates_2[i]);
+                    const unsigned int split_axis = entry.depth % NumberOfCoordinates;
+                    const double distance_to_split_plane = double(coordinates[split_axis]) - double(node_coordinates[split_axis]);
+                    const double distance_to_split_plane_squared = std::max(entry.distance_to_split_plane_squared, pow2(distance_to_split_plane));
+                    const bool go_to_left = distance_to_split_plane < 0;
+                    stack.push_back({entry.begin,  middle,    entry.depth + 1, go_to_left ? entry.distance_to_split_plane_squared : distance_to_split_plane_squared});
+                    stack.push_back({middle + 1,   entry.end, entry.depth + 1, go_to_left ? distance_to_split_plane_squared : entry.distance_to_split_plane_squared});
                 }
-                return distance;
             };
     };
 
 
-}
\ No newline at end of file
+}
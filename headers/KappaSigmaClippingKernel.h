@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../headers/PixelType.h"
+
+#include <cstdint>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Number of pixel columns processed together by the kappa-sigma clipping kernel
+     */
+    constexpr unsigned int c_kappa_sigma_block_size = 8;
+
+    /**
+     * @brief Apply kappa-sigma clipping to a block of "c_kappa_sigma_block_size" pixel columns at once. AVX2 implementation is used if the CPU supports it, scalar implementation otherwise.
+     *
+     * The values are stored in structure-of-arrays layout: values[i_value*c_kappa_sigma_block_size + i_column]. The validity of the values is stored as a bitmap with one byte per row:
+     * bit "i_column" of valid_mask[i_value] is set if the value is used. Clipped values are not overwritten, only their bits in the mask are cleared.
+     *
+     * @param values - values of the pixel columns, n_values*c_kappa_sigma_block_size elements
+     * @param valid_mask - input: values to consider, output: values kept after the clipping. n_values elements
+     * @param n_values - number of values in each column (number of stacked frames)
+     * @param kappa - values further than kappa*sigma from the mean are clipped
+     * @param n_iterations - maximal number of clipping iterations
+     * @param sums_of_kept_values - output: sum of the kept values for each column, c_kappa_sigma_block_size elements
+     * @param numbers_of_kept_values - output: number of the kept values for each column, c_kappa_sigma_block_size elements
+     */
+    void apply_kappa_sigma_clipping_to_block(   const PixelType *values,
+                                                std::uint8_t *valid_mask,
+                                                unsigned int n_values,
+                                                double kappa,
+                                                int n_iterations,
+                                                double *sums_of_kept_values,
+                                                unsigned int *numbers_of_kept_values);
+
+    /**
+     * @brief Scalar implementation of apply_kappa_sigma_clipping_to_block, with identical results. It is used as a fallback on CPUs without AVX2.
+     */
+    void apply_kappa_sigma_clipping_to_block_scalar(const PixelType *values,
+                                                    std::uint8_t *valid_mask,
+                                                    unsigned int n_values,
+                                                    double kappa,
+                                                    int n_iterations,
+                                                    double *sums_of_kept_values,
+                                                    unsigned int *numbers_of_kept_values);
+}
@@ -3,18 +3,29 @@
 #include <vector>
 #include <tuple>
 #include <string>
+#include <memory>
+#include <mutex>
 
 #include "../headers/KDTreeWithBuffer.h"
+#include "../headers/DisplacementGrid.h"
 #include "../headers/LocalShift.h"
 #include "../headers/PixelType.h"
 
 
 namespace AstroPhotoStacker {
+    /**
+     * @brief Class handling the local shifts of alignment points (surface alignment). The shifts between the alignment points are interpolated using inverse distance weighting
+     * of the 3 closest valid alignment points. For transforming the whole images, the interpolated shifts are evaluated once on a coarse grid (see DisplacementGrid)
+     * and sampled bilinearly - the grid is created at the first use and it is thread-safe.
+    */
     class LocalShiftsHandler {
         public:
             LocalShiftsHandler() = default;
 
-            LocalShiftsHandler(const LocalShiftsHandler &local_shifts_handler) = default;
+            /**
+             * @brief Copy constructor - the displacement grids are not copied, the copy creates its own grids when needed
+            */
+            LocalShiftsHandler(const LocalShiftsHandler &local_shifts_handler);
 
             LocalShiftsHandler(const std::vector<LocalShift> &shifts);
 
@@ -24,10 +35,36 @@ namespace AstroPhotoStacker {
                 return m_shifts;
             };
 
+            /**
+             * @brief Transform the coordinates from the reference frame to the shifted frame, by exact evaluation of the interpolated shifts from the alignment points. It is not thread-safe.
+             *
+             * @param x - pointer to the x coordinate, it will be overwritten
+             * @param y - pointer to the y coordinate, it will be overwritten
+             * @param score - if not nullptr, score of the closest valid alignment point will be stored here
+             * @return true if a valid alignment point was found, false otherwise (the coordinates are not changed)
+            */
             bool transform_from_reference_to_shifted_frame(float *x, float *y, float *score = nullptr);
 
+            /**
+             * @brief Transform the coordinates from the shifted frame to the reference frame, by exact evaluation of the interpolated shifts from the alignment points. It is not thread-safe.
+            */
             bool transform_from_shifted_to_reference_frame(float *x, float *y, float *score = nullptr);
 
+            /**
+             * @brief Transform the coordinates from the reference frame to the shifted frame using the displacement grid. It is thread-safe.
+            */
+            void transform_from_reference_to_shifted_frame_grid(float *x, float *y) const;
+
+            /**
+             * @brief Transform the coordinates from the shifted frame to the reference frame using the displacement grid. It is thread-safe.
+            */
+            void transform_from_shifted_to_reference_frame_grid(float *x, float *y) const;
+
+            /**
+             * @brief Transform the pixels <x_begin, x_end) of the line y from the reference frame to the shifted frame using the displacement grid. It is thread-safe.
+            */
+            void transform_row_from_reference_to_shifted_frame_grid(int y, int x_begin, int x_end, float *x_shifted, float *y_shifted) const;
+
 
             inline bool empty() const { return m_empty; };
 
@@ -38,7 +75,7 @@ namespace AstroPhotoStacker {
             std::string to_string() const;
 
         private:
-            bool calculate_shifted_coordinates(float *x, float *y, KDTreeWithBuffer<int,2,std::tuple<int,int,bool,float>> &kd_tree_shifts, float *score = nullptr);
+            bool calculate_shifted_coordinates(float *x, float *y, const KDTreeWithBuffer<int,2,std::tuple<int,int,bool,float>> &kd_tree_shifts, float *score = nullptr) const;
 
             std::vector<LocalShift> m_shifts;
 
@@ -49,5 +86,22 @@ namespace AstroPhotoStacker {
             KDTreeWithBuffer<int,2,std::tuple<int,int,bool,float>> m_kd_tree_shifts_in_reference_coordinates;  // dx, dy, valid_ap, score
 
             bool m_empty = true;
+
+            struct LazyDisplacementGrid {
+                std::once_flag                          once_flag;
+                std::unique_ptr<const DisplacementGrid> grid = nullptr;
+            };
+
+            std::unique_ptr<LazyDisplacementGrid> m_grid_reference_to_shifted = std::make_unique<LazyDisplacementGrid>();
+            std::unique_ptr<LazyDisplacementGrid> m_grid_shifted_to_reference = std::make_unique<LazyDisplacementGrid>();
+
+            /**
+             * @brief Get the displacement grid, create it at the first call
+             *
+             * @param lazy_grid - m_grid_reference_to_shifted or m_grid_shifted_to_reference
+             * @param reference_to_shifted - direction of the transformation
+             * @return const DisplacementGrid* - the grid, nullptr if there are no shifts
+            */
+            const DisplacementGrid *get_displacement_grid(LazyDisplacementGrid *lazy_grid, bool reference_to_shifted) const;
     };
 }
\ No newline at end of file
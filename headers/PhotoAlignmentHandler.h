@@ -4,6 +4,7 @@
 #include "../headers/AlignmentResultBase.h"
 #include "../headers/InputFrame.h"
 #include "../headers/ConfigurableAlgorithmSettings.h"
+#include "../headers/DecodedFrameCache.h"
 
 #include <memory>
 #include <string>
@@ -135,6 +136,7 @@ namespace   AstroPhotoStacker   {
             std::atomic<int> m_n_files_aligned = 0;
             unsigned int m_n_cpu = 1;
             std::unique_ptr<ReferencePhotoHandlerBase> m_reference_photo_handler = nullptr;
+            std::unique_ptr<DecodedFrameCache::PinnedFrame> m_pinned_reference_frame = nullptr; // the reference frame is read repeatedly, it is kept in the decoded frame cache
 
             inline static const std::string c_separator_in_file = " | ";
 
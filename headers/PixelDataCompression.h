@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../headers/PixelType.h"
+
+#include <vector>
+#include <cstddef>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Lossless compression of pixel values - differences of neighboring pixels are zig-zag encoded and stored as variable-length integers.
+     * It is fast and it works well for images, where the neighboring pixels have similar values.
+     *
+     * @param data - pixel values
+     * @param n_pixels - number of pixels
+     * @return std::vector<unsigned char> - compressed data
+     */
+    std::vector<unsigned char> compress_pixel_data(const PixelType *data, std::size_t n_pixels);
+
+    /**
+     * @brief Decompress the data compressed by "compress_pixel_data"
+     *
+     * @param compressed_data - compressed data
+     * @param compressed_size - size of the compressed data in bytes
+     * @param output - output buffer, n_pixels elements
+     * @param n_pixels - number of pixels to decompress
+     * @return true if all the pixels were decompressed, false if the compressed data are too short
+     */
+    bool decompress_pixel_data(const unsigned char *compressed_data, std::size_t compressed_size, PixelType *output, std::size_t n_pixels);
+}
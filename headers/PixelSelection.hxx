@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Helper functions for selecting order statistics from the column of values of one pixel (one value per stacked frame).
+     *
+     * The stacking algorithms usually do not need the whole column to be sorted - median needs one or two elements, cut-off average needs only to separate the tails.
+     * Short columns are sorted by sorting networks (branchless compare-exchange), longer ones are partially ordered by std::nth_element, which is O(n) on average.
+     */
+    namespace PixelSelection {
+
+        template<typename ValueType>
+        inline void compare_exchange(ValueType *values, unsigned int i, unsigned int j)   {
+            const ValueType a = values[i];
+            const ValueType b = values[j];
+            values[i] = std::min(a, b);
+            values[j] = std::max(a, b);
+        };
+
+        /**
+         * @brief Maximal size of the array that is sorted by the sorting network
+         */
+        constexpr unsigned int c_max_sorting_network_size = 8;
+
+        /**
+         * @brief Sort up to "c_max_sorting_network_size" elements using optimal sorting network. Longer arrays are sorted by std::sort.
+         *
+         * @param values - pointer to the first element
+         * @param n_values - number of elements
+         */
+        template<typename ValueType>
+        inline void sort_small_array(ValueType *values, unsigned int n_values)    {
+            auto ce = [values](unsigned int i, unsigned int j) { compare_exchange(values, i, j); };
+            switch (n_values) {
+                case 0:
+                case 1:
+                    return;
+                case 2:
+                    ce(0,1);
+                    return;
+                case 3:
+                    ce(0,2); ce(0,1); ce(1,2);
+                    return;
+                case 4:
+                    ce(0,1); ce(2,3); ce(0,2); ce(1,3); ce(1,2);
+                    return;
+                case 5:
+                    ce(0,1); ce(3,4); ce(2,4); ce(2,3); ce(1,4); ce(0,3); ce(0,2); ce(1,3); ce(1,2);
+                    return;
+                case 6:
+                    ce(1,2); ce(4,5); ce(0,2); ce(3,5); ce(0,1); ce(3,4); ce(1,4); ce(0,3); ce(2,5); ce(1,3); ce(2,4); ce(2,3);
+                    return;
+                case 7:
+                    ce(1,2); ce(3,4); ce(5,6); ce(0,2); ce(3,5); ce(4,6); ce(0,1); ce(4,5); ce(2,6); ce(0,4); ce(1,5); ce(0,3); ce(2,5); ce(1,3); ce(2,4); ce(2,3);
+                    return;
+                case 8:
+                    ce(0,1); ce(2,3); ce(4,5); ce(6,7); ce(0,2); ce(1,3); ce(4,6); ce(5,7); ce(1,2); ce(5,6); ce(0,4); ce(3,7); ce(1,5); ce(2,6); ce(1,4); ce(3,6); ce(2,4); ce(3,5); ce(3,4);
+                    return;
+                default:
+                    std::sort(values, values + n_values);
+                    return;
+            }
+        };
+
+        /**
+         * @brief Reorder the array so that the element at position "n" is the one which would be there in the sorted array. All elements before it are not greater and all elements after it are not smaller.
+         *
+         * @param values - pointer to the first element
+         * @param n_values - number of elements
+         * @param n - index of the element to select
+         * @return ValueType - the selected element
+         */
+        template<typename ValueType>
+        inline ValueType select_nth_element(ValueType *values, unsigned int n_values, unsigned int n)    {
+            if (n_values <= c_max_sorting_network_size) {
+                sort_small_array(values, n_values);
+            }
+            else {
+                std::nth_element(values, values + n, values + n_values);
+            }
+            return values[n];
+        };
+
+        /**
+         * @brief Get the two middle elements of the array (they are identical if the number of elements is odd). The array is reordered.
+         *
+         * @param values - pointer to the first element
+         * @param n_values - number of elements, must be larger than 0
+         * @param lower_middle - output: element at position (n_values-1)/2 of the sorted array
+         * @param upper_middle - output: element at position n_values/2 of the sorted array
+         */
+        template<typename ValueType>
+        inline void select_middle_elements(ValueType *values, unsigned int n_values, ValueType *lower_middle, ValueType *upper_middle)   {
+            *upper_middle = select_nth_element(values, n_values, n_values/2);
+            if (n_values % 2 == 1) {
+                *lower_middle = *upper_middle;
+            }
+            else if (n_values <= c_max_sorting_network_size) {
+                *lower_middle = values[n_values/2 - 1];
+            }
+            else {
+                // after nth_element, the elements in front of the selected one are not greater than it
+                *lower_middle = *std::max_element(values, values + n_values/2);
+            }
+        };
+
+        /**
+         * @brief Reorder the array so that the "n_lower" smallest elements are at its beginning and "n_upper" largest elements are at its end. Order within these groups and within the remaining middle part is not defined.
+         *
+         * @param values - pointer to the first element
+         * @param n_values - number of elements
+         * @param n_lower - number of the smallest elements to move to the beginning
+         * @param n_upper - number of the largest elements to move to the end
+         */
+        template<typename ValueType>
+        inline void separate_tails(ValueType *values, unsigned int n_values, unsigned int n_lower, unsigned int n_upper)  {
+            if (n_lower + n_upper >= n_values || (n_lower == 0 && n_upper == 0)) {
+                return;
+            }
+            if (n_values <= c_max_sorting_network_size) {
+                sort_small_array(values, n_values);
+                return;
+            }
+            if (n_lower > 0) {
+                std::nth_element(values, values + n_lower, values + n_values);
+            }
+            if (n_upper > 0) {
+                std::nth_element(values + n_lower, values + n_values - n_upper, values + n_values);
+            }
+        };
+
+        /**
+         * @brief Move all valid (non-negative) values to the beginning of the array, keeping their order
+         *
+         * @param values - pointer to the first element
+         * @param n_values - number of elements
+         * @return unsigned int - number of valid values
+         */
+        template<typename ValueType>
+        inline unsigned int move_valid_values_to_front(ValueType *values, unsigned int n_values)  {
+            unsigned int n_valid = 0;
+            for (unsigned int i = 0; i < n_values; i++) {
+                const ValueType value = values[i];
+                values[n_valid] = value;
+                n_valid += (value >= 0);
+            }
+            return n_valid;
+        };
+    }
+}
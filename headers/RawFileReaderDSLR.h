@@ -4,6 +4,8 @@
 
 #include <libraw/libraw.h>
 
+#include <memory>
+
 namespace AstroPhotoStacker {
     class RawFileReaderDSLR : public RawFileReaderBase {
         public:
@@ -17,7 +19,42 @@ namespace AstroPhotoStacker {
             virtual Metadata read_metadata_without_cache() override;
 
         private:
-            LibRaw get_libraw_processor();
+            /**
+             * @brief Open the raw file with LibRaw
+             *
+             * @param unpack - if true, the raw data are unpacked (decoded). Resolution and metadata are available without unpacking.
+             * @return std::unique_ptr<LibRaw> - the LibRaw processor (it is too large to be kept on the stack)
+             */
+            std::unique_ptr<LibRaw> open_raw_file(bool unpack) const;
+
+            /**
+             * @brief Read the values of the photosites directly from the unpacked Bayer raw image (without dcraw_process), subtract the black level and apply the camera white balance in one pass.
+             *
+             * @param raw_processor - LibRaw processor with unpacked data
+             * @return std::vector<PixelType> - 15-bit values of the visible area, width*height elements
+             */
+            static std::vector<PixelType> read_bayer_raw_image(LibRaw *raw_processor);
+
+            /**
+             * @brief Read the values of the photosites using the full dcraw_process - used for the sensors without Bayer raw image (X-Trans, linear DNGs, etc.)
+             *
+             * @param raw_processor - LibRaw processor with unpacked data
+             * @return std::vector<PixelType> - 15-bit values, width*height elements
+             */
+            static std::vector<PixelType> read_raw_file_with_dcraw_process(LibRaw *raw_processor);
+
+            /**
+             * @brief Check if the raw data can be read directly from the Bayer raw image
+             */
+            static bool has_bayer_raw_image(const LibRaw &raw_processor);
+
+            /**
+             * @brief Get the multipliers applied to the black-subtracted values - camera white balance normalized to the weakest channel and scaled so that the white level is mapped to 65535 (as in dcraw_process without highlight recovery)
+             *
+             * @param raw_processor - LibRaw processor
+             * @param multipliers - output multipliers for the 4 LibRaw color indices
+             */
+            static void get_color_multipliers(const LibRaw &raw_processor, float multipliers[4]);
     };
 
     bool is_raw_file_dslr_slr(const std::string &file_address);
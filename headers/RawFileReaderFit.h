@@ -1,10 +1,12 @@
 #pragma once
 
 #include "../headers/RawFileReaderBase.h"
+#include "../headers/FitFileHeader.h"
 
 #include <string>
-#include <fstream>
-#include <map>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
 
 namespace AstroPhotoStacker {
 
@@ -18,6 +20,17 @@ namespace AstroPhotoStacker {
 
             virtual void get_photo_resolution(int *width, int *height) override;
 
+            /**
+             * @brief Convert big-endian 16-bit values to PixelType - byte swap, addition of the zero point and division by 2 (PixelType is signed) in one pass.
+             * Source and destination can point to the same memory (in-place conversion).
+             *
+             * @param source - raw data from the file, 2*n_pixels bytes
+             * @param destination - output buffer, n_pixels elements
+             * @param n_pixels - number of pixels
+             * @param zero_point - BZERO value from the header
+             */
+            static void convert_16bit_data(const unsigned char *source, PixelType *destination, std::size_t n_pixels, std::uint16_t zero_point);
+
         protected:
             virtual Metadata read_metadata_without_cache() override;
 
@@ -25,8 +38,7 @@ namespace AstroPhotoStacker {
             std::vector<PixelType> m_data;
             Metadata m_metadata;
 
-            std::map<std::string, std::string> m_metadata_map;
-
+            std::shared_ptr<const FitFileHeader> m_header = nullptr;
 
             int m_width;
             int m_height;
@@ -34,15 +46,19 @@ namespace AstroPhotoStacker {
             unsigned int m_zero_point;
             std::array<char, 4> m_bayer_matrix = {-1,-1,-1,-1};
 
-            void read_data(std::ifstream *file);
-            void read_data_8bit(std::ifstream *file);
-            void read_data_16bit(std::ifstream *file);
-
-            void read_header(std::ifstream *file);
+            /**
+             * @brief Read the raw bytes of the image data directly into the output buffer and convert them in place
+             */
+            void read_data();
 
-            void parse_header(const std::string &header);
+            /**
+             * @brief Convert the raw bytes of the image data into m_data. The source can be the memory of m_data itself.
+             *
+             * @param source - raw data from the file
+             */
+            void convert_data(const unsigned char *source);
 
-            std::string get_header_string(std::ifstream *file);
+            void read_header();
 
             void fill_metadata();
 
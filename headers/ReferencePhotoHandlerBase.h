@@ -9,6 +9,7 @@
 #include "../headers/AlignmentResultBase.h"
 #include "../headers/ConfigurableAlgorithmSettings.h"
 #include "../headers/ReferencePhotoHandlerFactory.h"
+#include "../headers/FramePrefetcher.h"
 
 
 #include <memory>
@@ -78,6 +79,15 @@ namespace AstroPhotoStacker   {
                 return m_configurable_algorithm_settings;
             };
 
+            /**
+             * @brief Set the frame prefetcher from which the frames to align are taken. If nullptr, the frames are read directly.
+             *
+             * @param frame_prefetcher - the prefetcher, it must outlive the alignment
+            */
+            void set_frame_prefetcher(FramePrefetcher *frame_prefetcher)  {
+                m_frame_prefetcher = frame_prefetcher;
+            };
+
         protected:
             /*
             @brief Default constructor. Used to get configuration settings defined in derived classes
@@ -93,5 +103,7 @@ namespace AstroPhotoStacker   {
 
             ConfigurableAlgorithmSettings   m_configurable_algorithm_settings;
 
+            FramePrefetcher *m_frame_prefetcher = nullptr;
+
     };
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "../headers/PixelType.h"
+
+#include <string>
+#include <vector>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Interpolation used when the frames are shifted into the reference frame
+    */
+    enum class InterpolationMethod    {
+        NEAREST_NEIGHBOR,
+        BILINEAR,
+        BICUBIC,
+        LANCZOS3
+    };
+
+    /**
+     * @brief Convert InterpolationMethod enum to string
+     *
+     * @param method InterpolationMethod enum
+     * @return std::string string representation of the InterpolationMethod enum
+    */
+    std::string interpolation_method_to_string(const InterpolationMethod &method);
+
+    /**
+     * @brief Convert string to InterpolationMethod enum
+     *
+     * @param method string representation of the InterpolationMethod enum
+     * @return InterpolationMethod InterpolationMethod enum, exception is thrown for unknown method
+    */
+    InterpolationMethod string_to_interpolation_method(const std::string &method);
+
+    /**
+     * @brief Get string representations of all available interpolation methods
+    */
+    const std::vector<std::string>& get_interpolation_methods();
+
+    /**
+     * @brief Separable interpolation kernel for sampling an image at sub-pixel positions.
+     *
+     * The 1D weights are precomputed for c_number_of_phases fractional offsets, the weight of a source pixel is the product of its horizontal and vertical weights.
+     * Pixel (x,y) of the source image is at integer coordinates, so an integer shift reproduces the source values exactly.
+     * AVX2 implementation (8 output pixels at once) is used if the CPU supports it, scalar implementation otherwise. Both of them give identical results.
+    */
+    class ResamplingKernel {
+        public:
+            ResamplingKernel() = delete;
+
+            /**
+             * @brief Construct a new Resampling Kernel object and precompute the weight tables
+             *
+             * @param method - interpolation method
+            */
+            explicit ResamplingKernel(InterpolationMethod method);
+
+            /**
+             * @brief Sample the source image at given positions
+             *
+             * @param source - lines <line_begin, line_end) of the source image, indexed as [(y-line_begin)*width + x]
+             * @param width - width of the source image
+             * @param line_begin - the first line of the source image available in "source"
+             * @param line_end - the first line of the source image not available in "source"
+             * @param x - x coordinates of the sampled positions in the source image
+             * @param y - y coordinates of the sampled positions in the source image
+             * @param n_pixels - number of sampled positions
+             * @param output - interpolated values, rounded and clamped to the range of PixelType. Pixels outside of the available lines are replaced by the closest available pixels.
+            */
+            void resample(const float *source, int width, int line_begin, int line_end, const float *x, const float *y, int n_pixels, PixelType *output) const;
+
+            /**
+             * @brief Scalar implementation of resample, with identical results. It is used as a fallback on CPUs without AVX2.
+            */
+            void resample_scalar(const float *source, int width, int line_begin, int line_end, const float *x, const float *y, int n_pixels, PixelType *output) const;
+
+            /**
+             * @brief Get the number of source pixels used in each direction
+            */
+            int get_number_of_taps() const  { return m_number_of_taps; };
+
+            /**
+             * @brief Get the offset of the first used source pixel relative to floor(x), it is zero or negative
+            */
+            int get_first_tap_offset() const    { return m_first_tap_offset; };
+
+            /**
+             * @brief Get the offset of the last used source pixel relative to floor(x)
+            */
+            int get_last_tap_offset() const     { return m_first_tap_offset + m_number_of_taps - 1; };
+
+            InterpolationMethod get_method() const  { return m_method; };
+
+            static constexpr int c_number_of_phases = 64;
+
+        private:
+            InterpolationMethod m_method;
+            int m_number_of_taps;
+            int m_first_tap_offset;
+
+            // weights for fractional offset "phase/c_number_of_phases", indexed as [phase*m_number_of_taps + i_tap]
+            std::vector<float> m_weights;
+
+            static float get_weight(InterpolationMethod method, float distance);
+
+            template<int n_taps>
+            void resample_scalar_n_taps(const float *source, int width, int line_begin, int line_end, const float *x, const float *y, int n_pixels, PixelType *output) const;
+    };
+}
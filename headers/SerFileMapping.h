@@ -0,0 +1,97 @@
+#pragma once
+
+#include "../headers/PixelType.h"
+#include "../headers/FileStatus.h"
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Read-only memory mapping of a SER video file, with its header parsed once.
+     *
+     * The mappings are shared - "get_instance" returns the same object for all the frames of the file, so reading a frame does not require opening the file, parsing the header and copying the data through an intermediate buffer.
+     * Recently used mappings are kept open even if no reader holds them, so that the frames of the same video read one after another reuse the mapping.
+     */
+    class SerFileMapping {
+        public:
+            SerFileMapping()                        = delete;
+            SerFileMapping(const SerFileMapping&)   = delete;
+            SerFileMapping& operator=(const SerFileMapping&) = delete;
+
+            /**
+             * @brief Map the SER file into memory and parse its header. Use "get_instance" to share the mapping between the readers.
+             *
+             * @param file_address - path to the SER file
+             */
+            explicit SerFileMapping(const std::string &file_address);
+
+            ~SerFileMapping();
+
+            /**
+             * @brief Get the shared mapping of the file. The mapping is created if it does not exist yet or if the file has been modified since it was mapped.
+             * The file is checked by a single stat call and a new mapping is created without holding the lock of the cache.
+             *
+             * @param file_address - path to the SER file
+             * @return std::shared_ptr<const SerFileMapping> - the shared mapping
+             */
+            static std::shared_ptr<const SerFileMapping> get_instance(const std::string &file_address);
+
+            int get_width()     const { return m_width; };
+
+            int get_height()    const { return m_height; };
+
+            unsigned int get_bit_depth()            const { return m_bit_depth; };
+
+            unsigned int get_bayer_pattern_code()   const { return m_bayer_pattern_code; };
+
+            /**
+             * @brief Number of frames which are completely stored in the file
+             */
+            unsigned int get_number_of_frames()     const { return m_number_of_frames; };
+
+            /**
+             * @brief Get the pointer to the raw data of the frame inside of the mapping, no data are copied. The pointer is valid as long as this object exists.
+             *
+             * @param frame_id - index of the frame
+             * @return const unsigned char* - raw data of the frame, "get_frame_size_in_bytes" bytes
+             */
+            const unsigned char *get_frame_data(unsigned int frame_id) const;
+
+            std::size_t get_frame_size_in_bytes() const { return m_frame_size_in_bytes; };
+
+            /**
+             * @brief Convert the frame directly from the mapping into the destination buffer. 16-bit values are divided by 2 (PixelType is signed), 8-bit values are scaled to 15 bits.
+             *
+             * @param frame_id - index of the frame
+             * @param destination - output buffer, width*height elements
+             */
+            void read_frame(unsigned int frame_id, PixelType *destination) const;
+
+            /**
+             * @brief Get the pointer to the beginning of the file in the mapping (header is at the beginning)
+             */
+            const unsigned char *get_file_data() const { return m_data; };
+
+            std::size_t get_file_size() const { return m_file_status.size; };
+
+        private:
+            std::string     m_file_address;
+            const unsigned char *m_data = nullptr;
+            FileStatus      m_file_status;
+
+            int             m_width = 0;
+            int             m_height = 0;
+            unsigned int    m_bit_depth = 0;
+            unsigned int    m_bayer_pattern_code = 0;
+            unsigned int    m_number_of_frames = 0;
+            std::size_t     m_frame_size_in_bytes = 0;
+
+            std::uint32_t read_uint32(std::size_t position_in_file) const;
+
+            static constexpr std::size_t c_header_size = 178;
+            static constexpr std::size_t c_max_cached_mappings = 8;
+    };
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <mutex>
+#include <map>
+#include <memory>
+#include <functional>
+#include <cstddef>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Thread-safe cache of shared immutable objects, with the least recently used entry evicted once the cache is full.
+     *
+     * Each entry is stored with a stamp (for example the status of the file from which the object was created). An entry is returned only if its stamp matches the stamp of the request, otherwise the object is created again.
+     * By default the objects are created without holding the lock, so that creating an object does not block the other users of the cache. If several threads create the same object at once, the one inserted first is shared and the others are dropped.
+     *
+     * @tparam KeyType - key of the cache, must be ordered by operator<
+     * @tparam ValueType - type of the cached objects
+     * @tparam StampType - stamp of the entries
+     * @tparam StampMatchType - functor returning true if the stamp of an entry matches the stamp of the request
+     */
+    template<typename KeyType, typename ValueType, typename StampType, typename StampMatchType = std::equal_to<StampType>>
+    class SharedInstanceCache {
+        public:
+            /**
+             * @param max_size - maximal number of entries kept in the cache
+             * @param create_without_lock - if false, the objects are created while holding the lock, so that a large object is never created by several threads at once
+             */
+            explicit SharedInstanceCache(std::size_t max_size, bool create_without_lock = true) :
+                m_max_size(max_size),
+                m_create_without_lock(create_without_lock)  {
+            };
+
+            SharedInstanceCache()                           = delete;
+            SharedInstanceCache(const SharedInstanceCache&) = delete;
+
+            /**
+             * @brief Get the cached object for the key, or create it if it is not cached or if its stamp does not match
+             *
+             * @param key - key of the object
+             * @param stamp - stamp the cached object must match
+             * @param create_instance - function returning std::shared_ptr<const ValueType>
+             * @return std::shared_ptr<const ValueType> - the shared object
+             */
+            template<typename CreateFunctionType>
+            std::shared_ptr<const ValueType> get_instance(const KeyType &key, const StampType &stamp, const CreateFunctionType &create_instance)  {
+                std::unique_lock lock(m_mutex);
+                std::shared_ptr<const ValueType> cached_instance = find_matching_instance(key, stamp);
+                if (cached_instance != nullptr) {
+                    return cached_instance;
+                }
+
+                if (!m_create_without_lock) {
+                    std::shared_ptr<const ValueType> instance = create_instance();
+                    insert_instance(key, stamp, instance);
+                    return instance;
+                }
+
+                lock.unlock();
+                std::shared_ptr<const ValueType> instance = create_instance();
+                lock.lock();
+
+                cached_instance = find_matching_instance(key, stamp);
+                if (cached_instance != nullptr) {
+                    return cached_instance;
+                }
+                insert_instance(key, stamp, instance);
+                return instance;
+            };
+
+            /**
+             * @brief Drop all entries, the objects are destroyed once their last user releases them
+             */
+            void clear()    {
+                std::scoped_lock lock(m_mutex);
+                m_entries.clear();
+            };
+
+        private:
+            struct Entry {
+                StampType                           stamp;
+                std::shared_ptr<const ValueType>    instance;
+                unsigned long long                  last_use;
+            };
+
+            std::mutex                      m_mutex;
+            std::map<KeyType, Entry>        m_entries;
+            unsigned long long              m_use_counter = 0;
+            const std::size_t               m_max_size;
+            const bool                      m_create_without_lock;
+
+            // the least recently used entry is evicted if the cache is full, the lock must be held
+            void insert_instance(const KeyType &key, const StampType &stamp, const std::shared_ptr<const ValueType> &instance)   {
+                if (m_entries.size() >= m_max_size) {
+                    auto oldest = m_entries.begin();
+                    for (auto it = m_entries.begin(); it != m_entries.end(); it++) {
+                        if (it->second.last_use < oldest->second.last_use) {
+                            oldest = it;
+                        }
+                    }
+                    m_entries.erase(oldest);
+                }
+                m_entries.emplace(key, Entry{stamp, instance, m_use_counter});
+            };
+
+            // the entry with a different stamp is outdated, it is removed
+            std::shared_ptr<const ValueType> find_matching_instance(const KeyType &key, const StampType &stamp)   {
+                m_use_counter++;
+                auto it = m_entries.find(key);
+                if (it == m_entries.end()) {
+                    return nullptr;
+                }
+                if (StampMatchType()(it->second.stamp, stamp)) {
+                    it->second.last_use = m_use_counter;
+                    return it->second.instance;
+                }
+                m_entries.erase(it);
+                return nullptr;
+            };
+    };
+}
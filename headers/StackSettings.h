@@ -34,11 +34,28 @@ namespace AstroPhotoStacker {
             void set_max_memory(int max_memory);
             int get_max_memory() const;
 
+            // cache of the decoded frames shared by the alignment and the stacking (in MB), 0 disables it
+            void set_decoded_frame_cache_memory(int decoded_frame_cache_memory);
+            int get_decoded_frame_cache_memory() const;
+
+            // folder on the local disk for the decoded frames evicted from the memory cache, empty string disables it
+            void set_decoded_frame_cache_folder(const std::string& decoded_frame_cache_folder);
+            const std::string& get_decoded_frame_cache_folder() const;
+
+            // maximal size of the decoded frames stored in the folder (in MB)
+            void set_decoded_frame_cache_disk_limit(int decoded_frame_cache_disk_limit);
+            int get_decoded_frame_cache_disk_limit() const;
+
             // stacking algorithm
             const std::vector<std::string>& get_stacking_algorithms() const;
             void set_stacking_algorithm(const std::string& stacking_algorithm);
             const std::string& get_stacking_algorithm() const;
 
+            // interpolation used when shifting the frames
+            const std::vector<std::string>& get_interpolation_methods() const;
+            void set_interpolation_method(const std::string& interpolation_method);
+            const std::string& get_interpolation_method() const;
+
             // hot pixel correction
             void set_hot_pixel_correction(bool hot_pixel_correction);
             bool use_hot_pixel_correction() const;
@@ -77,8 +94,12 @@ namespace AstroPhotoStacker {
         private:
             AstroPhotoStacker::InputFrame m_alignment_frame;
             std::string m_stacking_algorithm = "kappa-sigma mean";
+            std::string m_interpolation_method = "nearest neighbor";
             int m_n_cpus = get_max_threads();
             int m_max_memory = 8000;
+            int m_decoded_frame_cache_memory = 0;
+            std::string m_decoded_frame_cache_folder = "";
+            int m_decoded_frame_cache_disk_limit = 20000;
 
             bool  m_hot_pixel_correction = false;
             bool  m_use_color_interpolation = true;
@@ -5,6 +5,10 @@
 #include "../headers/HotPixelIdentifier.h"
 #include "../headers/CalibrationFrameBase.h"
 #include "../headers/CalibratedPhotoHandler.h"
+#include "../headers/CalibratedFramesSlab.h"
+#include "../headers/FramePrefetcher.h"
+#include "../headers/DecodedFrameCache.h"
+#include "../headers/ResamplingKernel.h"
 #include "../headers/AlignmentResultBase.h"
 
 #include "../headers/InputFrame.h"
@@ -17,6 +21,7 @@
 #include <atomic>
 #include <tuple>
 #include <map>
+#include <functional>
 #include <opencv2/opencv.hpp>
 
 
@@ -106,6 +111,21 @@ namespace AstroPhotoStacker {
             */
             static void save_stacked_photo(const std::string &file_address, const std::vector<std::vector<double> > &stacked_image, int width, int height, int image_options = 18);
 
+            /**
+             * @brief Store the calibrated and aligned frames in the folder and reuse them in the later runs, so that stacking the same frames with different settings does not decode and calibrate them again
+             *
+             * @param folder - folder for the stored frames, empty string disables the store
+             * @param compress - compress the stored frames
+            */
+            void set_aligned_frame_store(const std::string &folder, bool compress = true);
+
+            /**
+             * @brief Set the interpolation used to shift the frames into the reference frame
+             *
+             * @param interpolation_method - interpolation method
+            */
+            void set_interpolation_method(InterpolationMethod interpolation_method);
+
             /**
              * @brief Set the number of CPU threads
              *
@@ -208,10 +228,105 @@ namespace AstroPhotoStacker {
             */
             virtual CalibratedPhotoHandler get_calibrated_photo(unsigned int i_file, int y_min, int y_max) const;
 
+            /**
+             * @brief Calibrate and align the input frame, it does not need to be registered in the stack
+             *
+             * @param input_frame - data about the input frame
+             * @param alignment_result - alignment of the frame, if nullptr, no alignment is applied
+             * @param calibration_frame_handlers - calibration frames to be applied
+             * @param y_min - minimal y-coordinate of the photo (for memory consumption limits)
+             * @param y_max - maximal y-coordinate of the photo (for memory consumption limits)
+            */
+            CalibratedPhotoHandler calibrate_frame( const InputFrame &input_frame,
+                                                    const AlignmentResultBase *alignment_result,
+                                                    const std::vector<std::shared_ptr<const CalibrationFrameBase> > &calibration_frame_handlers,
+                                                    int y_min, int y_max) const;
+
+            /**
+             * @brief Calibrate and align the frame, which has already been loaded by the reader
+            */
+            CalibratedPhotoHandler calibrate_frame( std::unique_ptr<InputFrameReader> input_frame_reader,
+                                                    const AlignmentResultBase *alignment_result,
+                                                    const std::vector<std::shared_ptr<const CalibrationFrameBase> > &calibration_frame_handlers,
+                                                    int y_min, int y_max) const;
+
+            /**
+             * @brief Start reading the frames to stack in the background (see FramePrefetcher). The frames are then taken from the prefetcher by "get_calibrated_photo". It should be called before each pass through all the frames.
+             * The threads are expected to take the ranges of consecutive frames given by "get_number_of_consecutive_frames_per_task".
+            */
+            void start_frame_prefetching();
+
+            /**
+             * @brief Start reading only the given frames in the background
+             *
+             * @param frames_to_prefetch - the frames to read
+             * @param frames_per_range - number of consecutive frames processed by one thread at once, the frames are read ahead for each thread
+            */
+            void start_frame_prefetching(const std::vector<InputFrame> &frames_to_prefetch, unsigned int frames_per_range);
+
+            /**
+             * @brief Stop reading the frames in the background, frames not taken so far are dropped
+            */
+            void stop_frame_prefetching();
+
+            /**
+             * @brief Get the memory budget of the frame prefetching - the configured budget, but at most a quarter of the memory usage limit
+            */
+            int get_prefetch_memory_budget_in_mb() const;
+
+            /**
+             * @brief Get the memory (in bytes) available for the stacking arrays - the memory usage limit minus the memory reserved for the frame prefetching,
+             * for the decoded frame cache and "memory_reserved". It is 0 if the reserved memory exceeds the limit.
+             *
+             * @param memory_reserved - memory needed for the other data (stacked image, calibrated photos) in bytes
+            */
+            unsigned long long int get_memory_available_for_stacking(unsigned long long int memory_reserved) const;
+
+            /**
+             * @brief Get calibrated data of i_file-th file for the lines <y_min, y_max). If the frames were already stored in the calibrated frames slab, they are read from there, otherwise the file is decoded and calibrated.
+             *
+             * @param i_file - index of the file in the stack
+             * @param y_min - minimal y-coordinate of the photo (for memory consumption limits)
+             * @param y_max - maximal y-coordinate of the photo (for memory consumption limits)
+             * @return std::vector<std::vector<PixelType>> - calibrated data indexed as [color][(y-y_min)*width + x]
+            */
+            std::vector<std::vector<PixelType>> get_calibrated_data(unsigned int i_file, int y_min, int y_max) const;
+
+            /**
+             * @brief Check if the frames should be decoded only once and stored in a slab on disk - this is the case if the stacking has to be split into several slices due to memory limit, or if the aligned frame store is used
+            */
+            virtual bool use_calibrated_frames_slab() const;
+
+            /**
+             * @brief Decode and calibrate all the frames and store them in the slab on disk. Frames already present in the aligned frame store are skipped.
+            */
+            void fill_calibrated_frames_slab();
+
+            /**
+             * @brief Get description of the i_file-th frame and its processing (alignment, calibration frames, hot pixels), used to check if the stored frame is up to date
+             *
+             * @param i_file - index of the file in the stack
+             * @param calibration_frame_checksums - checksums of the calibration frames (see CalibrationFrameBase::get_checksum), calculated once for all the frames
+             * @param hot_pixels_description - description of the hot pixels, calculated once for all the frames
+            */
+            std::string get_calibrated_frame_description(   unsigned int i_file,
+                                                            const std::map<const CalibrationFrameBase*, unsigned long long> &calibration_frame_checksums,
+                                                            const std::string &hot_pixels_description) const;
+
+            /**
+             * @brief Split the lines <y_min, y_max) into blocks and process them in parallel, using m_n_cpu threads
+             *
+             * @param y_min - first line to process
+             * @param y_max - first line not to process
+             * @param process_lines - function processing the lines <y_begin, y_end)
+            */
+            void process_lines_in_parallel(int y_min, int y_max, const std::function<void(int y_begin, int y_end)> &process_lines) const;
+
             int m_number_of_colors;
             int m_width;
             int m_height;
             bool m_interpolate_colors;
+            InterpolationMethod m_interpolation_method = InterpolationMethod::NEAREST_NEIGHBOR;
 
             constexpr static PixelType c_empty_pixel_value = -1;
 
@@ -219,6 +334,16 @@ namespace AstroPhotoStacker {
 
             int m_memory_usage_limit_in_mb = -1;
 
+            bool m_decode_frames_only_once = true;
+            std::unique_ptr<CalibratedFramesSlab> m_calibrated_frames_slab = nullptr;
+            std::string m_aligned_frame_store_folder = "";
+            bool m_aligned_frame_store_compress = true;
+
+            int m_prefetch_queue_depth = FramePrefetcher::c_default_queue_depth;
+            int m_prefetch_memory_budget_in_mb = FramePrefetcher::c_default_memory_budget_in_mb;
+            std::unique_ptr<FramePrefetcher> m_frame_prefetcher = nullptr;
+            std::unique_ptr<DecodedFrameCache::PassGuard> m_decoded_frame_cache_pass_guard = nullptr;
+
             std::vector<InputFrame>     m_frames_to_stack;
             std::vector<bool>           m_apply_alignment; // for calibration frames we just stack them
             std::vector<std::vector<double> > m_stacked_image;
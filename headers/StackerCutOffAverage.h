@@ -20,5 +20,5 @@ class StackerCutOffAverage : public AstroPhotoStacker::StackerMedian {
     protected:
         float m_tail_fraction_to_cut_off = 0.1;
 
-        virtual double get_stacked_value_from_pixel_array(PixelType *ordered_array_begin, unsigned int number_of_stacked_pixels) override;
+        virtual double get_stacked_value_from_pixel_array(PixelType *array_begin, unsigned int number_of_stacked_pixels) override;
 };
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+#include "../headers/StackerSimpleBase.h"
+
+#include <vector>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Class for stacking photos using drizzle integration. Instead of shifting the frames into the reference frame, each input pixel is shrunk into a "drop"
+     * (square of "drop size" times the input pixel size), the drop is mapped into the reference frame and it is distributed onto a finer output grid, proportionally
+     * to the area of its overlap with the output pixels. The output pixel value is the weighted mean of the drops falling into it. With enough dithered frames,
+     * this recovers resolution lost by undersampling.
+     *
+     * The drop is approximated by an axis-aligned square around the mapped pixel center (rotation and zoom of the frame are neglected within one pixel).
+     * Width and height of the stacker (and of the stacked image) are the sizes of the output grid.
+     */
+    class StackerDrizzle : public StackerSimpleBase {
+        public:
+
+            /**
+             * @brief Construct a new Stacker Drizzle object
+             *
+             * @param number_of_colors - number of colors in the stacked photo
+             * @param width - width of the input photos
+             * @param height - height of the input photos
+             * @param interpolate_colors - if false, each pixel of raw files contributes only to its own color channel
+             * @param scale - ratio between the resolution of the output grid and of the input photos
+            */
+            StackerDrizzle(int number_of_colors, int width, int height, bool interpolate_colors, float scale);
+
+            virtual unsigned long long get_maximal_memory_usage(int number_of_frames) const override    {
+                return static_cast<unsigned long long>(m_number_of_colors) * static_cast<unsigned long long>(m_width) * static_cast<unsigned long long>(m_height) * (sizeof(double) + 2*sizeof(float));
+            };
+
+        protected:
+            int     m_input_width;
+            int     m_input_height;
+            float   m_scale;
+            double  m_drop_size = 0.7;
+
+            std::vector<float>  m_flux_individual_threads;     // [thread][color][pixel], see get_accumulator_index
+            std::vector<float>  m_weights_individual_threads;  // [thread][color][pixel], see get_accumulator_index
+
+            /**
+             * @brief Calibrate the input lines needed for output lines <y_min, y_max) and drop their pixels onto the accumulators of given thread
+             *
+             * @param file_index - index of the photo
+             * @param y_min - first line of the output slice
+             * @param y_max - first line after the output slice
+             * @param i_thread - index of the thread (and its accumulators)
+             */
+            virtual void add_photo_to_accumulators(unsigned int file_index, int y_min, int y_max, unsigned int i_thread) override;
+
+            /**
+             * @brief Get the lines of the input photo, which can contribute to the output lines <y_min, y_max)
+             *
+             * @param alignment_result - alignment of the photo, nullptr if no alignment is applied
+             * @param y_min - first line of the output slice
+             * @param y_max - first line after the output slice
+             * @param input_y_min - first line of the input photo
+             * @param input_y_max - first line of the input photo after the range
+             */
+            void get_input_line_range(const AlignmentResultBase *alignment_result, int y_min, int y_max, int *input_y_min, int *input_y_max) const;
+
+            /**
+             * @brief Put all the partial results together
+             *
+             * @param y_min - minimal y-coordinate of the area to be processed
+             * @param y_max - maximal y-coordinate of the area to be processed
+            */
+            virtual void calculate_final_image(int y_min, int y_max) override;
+
+            /**
+             * @brief Allocate arrays for stacking where partial results are stored
+             *
+             * @param dy - number of pixel lines to be processed at once
+            */
+            virtual void allocate_arrays_for_stacking(int dy) override;
+
+            /**
+             * @brief Set again default values to these arrays
+             *
+            */
+            virtual void reset_values_in_arrays_for_stacking() override;
+
+            /**
+             * @brief Clean up the arrays for stacking where partial results were stored
+            */
+            virtual void deallocate_arrays_for_stacking() override;
+
+            /**
+             * @brief Not used - the input pixels do not map 1:1 to the output pixels, they are added in add_photo_to_accumulators
+            */
+            virtual void add_values_to_stack(int i_color, const PixelType *values, size_t n_values, int i_thread) override;
+
+            /**
+             * @brief Get number of output pixel lines that we can proces at once (limited by memory usage)
+             *
+             * @return int - number of pixel lines that we can proces at once
+            */
+            virtual int get_height_range_limit() const override;
+
+            /**
+             * @brief The slab stores the frames already shifted into the reference frame, drizzle needs the calibrated frames before the alignment
+            */
+            virtual bool use_calibrated_frames_slab() const override   { return false; };
+    };
+}
@@ -12,5 +12,10 @@ namespace AstroPhotoStacker {
 
     void configure_stacker(StackerBase* stacker, const StackSettings &settings);
 
+    /**
+     * @brief Apply the decoded frame cache settings to the global DecodedFrameCache, it is shared by the alignment and by all the stackers
+     */
+    void configure_decoded_frame_cache(const StackSettings &settings);
+
     std::unique_ptr<StackerBase> create_stacker(const StackSettings &settings, int number_of_colors, int width, int height);
 }
@@ -22,15 +22,24 @@ namespace AstroPhotoStacker {
             StackerKappaSigmaBase(int number_of_colors, int width, int height, bool interpolate_colors);
 
     protected:
-            virtual double get_stacked_value_from_pixel_array(PixelType *ordered_array_begin, unsigned int number_of_stacked_pixels)  = 0;
+            /**
+             * @brief Apply the kappa-sigma clipping to the whole line, processing several pixels at once (see KappaSigmaClippingKernel.h)
+             */
+            virtual void process_line(int y_index_final_array, int y_index_values_to_stack_array, int i_color) override;
 
             /**
-             * @brief Apply the Kappa-Sigma clipping algorithm to the ordered array of pixels
+             * @brief Calculate the stacked value from the values kept after the kappa-sigma clipping
              *
-             * @param ordered_array_begin - pointer to the first element of the ordered array
-             * @param number_of_stacked_pixels - number of pixels to stack
+             * @param kept_values - values kept after the clipping (not sorted), they are filled only if "needs_kept_values" returns true
+             * @param number_of_kept_values - number of values kept after the clipping, always larger than 0
+             * @param sum_of_kept_values - sum of the values kept after the clipping
+             */
+            virtual double get_stacked_value_from_kept_values(PixelType *kept_values, unsigned int number_of_kept_values, double sum_of_kept_values) = 0;
+
+            /**
+             * @brief If false, the kept values are not copied out of the clipping kernel and only their sum and number are available
              */
-            void apply_kappa_sigma_clipping(PixelType **ordered_array_begin, unsigned int *number_of_stacked_pixels);
+            virtual bool needs_kept_values() const  { return true; };
 
             float   m_kappa       = 3.0;
             int     m_n_iterations  = 3;
@@ -21,6 +21,6 @@ namespace AstroPhotoStacker {
             StackerKappaSigmaMedian(int number_of_colors, int width, int height, bool interpolate_colors);
 
         protected:
-            virtual double get_stacked_value_from_pixel_array(PixelType *ordered_array_begin, unsigned int number_of_stacked_pixels) override;
+            virtual double get_stacked_value_from_kept_values(PixelType *kept_values, unsigned int number_of_kept_values, double sum_of_kept_values) override;
     };
 }
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+#include "../headers/StackerBase.h"
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <functional>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Stacker for live stacking - the frames are added to the running accumulators one at a time, as soon as they are captured, and the current stack can be obtained at any moment.
+     *
+     * Running mean and variance of each pixel are updated by Welford's algorithm. In "kappa-sigma mean" mode, the new value is rejected if it is further than kappa*sigma from the running mean
+     * (once enough frames were stacked to estimate sigma). Unlike the batch kappa-sigma clipping, the rejection is done only against the statistics of the previous frames, so the result depends on the order of the frames.
+     *
+     * The frames registered by "add_photo" are pushed to the stack in "calculate_stacked_photo", so the class can be used also as a regular stacker.
+     *
+     * "push_frame" and "snapshot" can be called concurrently, also from the tasks of the thread pool. The accumulators are locked per block of lines and no lock is held
+     * while waiting for the parallel tasks (the waiting thread may execute other queued tasks, including another "push_frame").
+     */
+    class StackerLive : public StackerBase {
+        public:
+            /**
+             * @brief Construct a new Stacker Live object
+             *
+             * @param number_of_colors - number of colors in the stacked photo
+             * @param width - width of the photo
+             * @param height - height of the photo
+             * @param interpolate_colors - if true, each color will be interpolated from the colors of the neighboring pixels
+             * @param stacking_algorithm - "average" or "kappa-sigma mean"
+            */
+            StackerLive(int number_of_colors, int width, int height, bool interpolate_colors, const std::string &stacking_algorithm = "average");
+
+            /**
+             * @brief Calibrate and align the frame and add it to the running accumulators
+             *
+             * @param input_frame - data about the input frame (either a photo or a frame from a video)
+             * @param alignment_result - alignment of the frame with respect to the reference frame
+             * @param calibration_frame_handlers - vector of calibration frame handlers
+            */
+            void push_frame(const InputFrame &input_frame,
+                            const AlignmentResultBase &alignment_result,
+                            const std::vector<std::shared_ptr<const CalibrationFrameBase> > &calibration_frame_handlers = std::vector<std::shared_ptr<const CalibrationFrameBase> >());
+
+            /**
+             * @brief Add already calibrated and aligned frame to the running accumulators
+             *
+             * @param calibrated_data - calibrated data indexed as [color][y*width + x], negative values are considered as empty pixels
+            */
+            void push_frame(const std::vector<std::vector<PixelType>> &calibrated_data);
+
+            /**
+             * @brief Get the current stacked image, calculated from the running accumulators. Pixels without any value are set to -1.
+             *
+             * @return std::vector<std::vector<double> > - stacked image indexed as [color][y*width + x]
+            */
+            std::vector<std::vector<double> > snapshot() const;
+
+            /**
+             * @brief Get the number of frames pushed to the stack so far
+            */
+            unsigned int get_number_of_pushed_frames() const;
+
+            /**
+             * @brief Drop all the pushed frames and start stacking from scratch. It must not be called while a frame is being pushed.
+            */
+            void reset();
+
+            virtual int get_tasks_total() const override;
+
+            virtual unsigned long long get_maximal_memory_usage(int number_of_frames) const override;
+
+        protected:
+            virtual void calculate_stacked_photo_internal() override;
+
+            virtual void add_photo_to_stack(unsigned int file_index, int y_min, int y_max) override;
+
+            /**
+             * @brief The accumulators cover the whole image, so the stacking is never split into slices
+            */
+            virtual int get_height_range_limit() const override;
+
+        private:
+            bool m_use_kappa_sigma_rejection = false;
+
+            float   m_kappa = 3.0;
+            int     m_min_frames_for_rejection = 10;
+
+            static constexpr int c_lines_per_lock = 64;
+
+            mutable std::mutex m_mutex; // protects the frame counters
+            mutable std::vector<std::mutex> m_line_block_mutexes; // [i_block], each protects the accumulators of c_lines_per_lock lines
+            unsigned int m_n_pushed_frames = 0;
+            unsigned int m_n_frames_from_stack_pushed = 0;
+
+            std::vector<std::vector<unsigned int>>  m_counts;   // [color][pixel]
+            std::vector<std::vector<double>>        m_means;    // [color][pixel]
+            std::vector<std::vector<double>>        m_m2;       // [color][pixel], sum of squared differences from the mean, only used with kappa-sigma rejection
+
+            /**
+             * @brief Call "process_lines" for the blocks of lines covering <y_begin, y_end), each block with its lock held
+            */
+            void for_each_locked_line_block(int y_begin, int y_end, const std::function<void(int y_begin, int y_end)> &process_lines) const;
+
+            /**
+             * @brief Add the values of given lines to the accumulators, the locks of the lines must be held
+             *
+             * @param i_color - color channel
+             * @param values - values of the lines, indexed as [(y-y_min)*width + x]
+             * @param y_begin - first line to process
+             * @param y_end - first line not to process
+             * @param y_min - first line of the "values" array
+            */
+            void add_lines_to_accumulators(int i_color, const PixelType *values, int y_begin, int y_end, int y_min);
+    };
+}
@@ -24,8 +24,8 @@ namespace AstroPhotoStacker {
 
         protected:
 
-            std::vector<std::vector<std::vector<int>>>                  m_values_to_stack_individual_threads;  // [thread][color][pixel]
-            std::vector<std::vector<std::vector<short unsigned int>>>   m_counts_to_stack_individual_threads;  // [thread][color][pixel]
+            std::vector<int>                  m_values_to_stack_individual_threads;  // [thread][color][pixel], see get_accumulator_index
+            std::vector<short unsigned int>   m_counts_to_stack_individual_threads;  // [thread][color][pixel], see get_accumulator_index
 
             /**
              * @brief Put all the partial results together
@@ -54,15 +54,7 @@ namespace AstroPhotoStacker {
             virtual void deallocate_arrays_for_stacking() override;
 
 
-            /**
-             * @brief Process the given pixel for given color
-             *
-             * @param i_color - color index
-             * @param i_pixel - pixel index (it's the total index = y*width + x)
-             * @param value - value of the pixel from individual photo
-             * @param i_thread - thread index
-            */
-            virtual void process_pixel(int i_color, int i_pixel, int value, int i_thread) override;
+            virtual void add_values_to_stack(int i_color, const PixelType *values, size_t n_values, int i_thread) override;
 
             /**
              * @brief Get number of pixel lines that we can proces at once (limited by memory usage)
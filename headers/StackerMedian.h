@@ -4,6 +4,7 @@
 
 #include <vector>
 #include <memory>
+#include <cstdint>
 
 namespace AstroPhotoStacker {
 
@@ -27,21 +28,66 @@ namespace AstroPhotoStacker {
             */
             virtual void calculate_stacked_photo_internal() override;
 
+            /**
+             * @brief Values from all frames for the currently stacked slice, indexed as [color][i_file*m_values_to_stack_frame_size + pixel_index_in_slice].
+             *
+             * Each frame is stored contiguously, so adding a frame is a plain copy. The columns of values of individual pixels are built by a blocked transpose in "process_line".
+             */
             std::vector<std::vector<PixelType>> m_values_to_stack;
 
+            /**
+             * @brief Validity bitmap of m_values_to_stack, indexed as [color][i_file*m_validity_words_per_frame + pixel_index_in_slice/64]. The bit is set if the value is valid (non-negative).
+             */
+            std::vector<std::vector<std::uint64_t>> m_valid_values_bitmap;
+
+            size_t m_values_to_stack_frame_size = 0;
+            size_t m_validity_words_per_frame   = 0;
+
+            /**
+             * @brief Number of pixels transposed together in "process_line"
+             */
+            static constexpr unsigned int c_transpose_tile_width = 64;
+
+            /**
+             * @brief Get pointer to the values of given frame in m_values_to_stack
+             */
+            const PixelType *get_values_to_stack(int i_color, unsigned int file_index, size_t pixel_index_in_slice) const {
+                return &m_values_to_stack[i_color][file_index*m_values_to_stack_frame_size + pixel_index_in_slice];
+            };
+
+            /**
+             * @brief Get validity bits for up to 64 consecutive pixels of given frame
+             *
+             * @param i_color - color channel
+             * @param file_index - index of the frame
+             * @param first_pixel_index_in_slice - index of the first pixel in the slice
+             * @param n_pixels - number of pixels (at most 64)
+             * @return std::uint64_t - bit "i" is set if the value of the pixel "first_pixel_index_in_slice + i" is valid
+             */
+            std::uint64_t get_validity_bits(int i_color, unsigned int file_index, size_t first_pixel_index_in_slice, unsigned int n_pixels) const;
+
             virtual void add_photo_to_stack(unsigned int file_index, int y_min, int y_max) override;
 
             virtual int get_height_range_limit() const override;
 
+            /**
+             * @brief Calculate the stacked values of one line. The columns of the values are transposed from m_values_to_stack in tiles of "c_transpose_tile_width" pixels, only valid values are kept.
+             *
+             * @param y_index_final_array - y-coordinate of the line in the stacked image
+             * @param y_index_values_to_stack_array - y-coordinate of the line in the current slice
+             * @param i_color - color channel
+             */
             virtual void process_line(int y_index_final_array, int y_index_values_to_stack_array, int i_color);
 
             /**
              * @brief The method defines how to stack "number_of_stacked pixels" values from pixels in individual photos into one file. In case of this class it is a median. Can be overriden in derived classes to implement different stacking algorithms.
              *
-             * @param ordered_array_begin       - pointer ot the first element of the ordered array
+             * The values are not sorted and they can be reordered by the method - the implementations should order only as much as they need (see PixelSelection.hxx).
+             *
+             * @param array_begin               - pointer ot the first element of the array, it contains only valid (non-negative) values
              * @param number_of_stacked_pixels  - number of pixels to stack
              */
-            virtual double get_stacked_value_from_pixel_array(PixelType *ordered_array_begin, unsigned int number_of_stacked_pixels);
+            virtual double get_stacked_value_from_pixel_array(PixelType *array_begin, unsigned int number_of_stacked_pixels);
 
             /**
              * @brief Get maximal memory usage, considering the number of frames and their resolution
@@ -20,5 +20,5 @@ class StackerQuantil : public AstroPhotoStacker::StackerMedian {
     protected:
         float m_quantil_fraction    = 0.3;
 
-        virtual double get_stacked_value_from_pixel_array(PixelType *ordered_array_begin, unsigned int number_of_stacked_pixels) override;
+        virtual double get_stacked_value_from_pixel_array(PixelType *array_begin, unsigned int number_of_stacked_pixels) override;
 };
\ No newline at end of file
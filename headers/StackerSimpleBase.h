@@ -2,7 +2,7 @@
 #include "../headers/StackerBase.h"
 
 #include <vector>
-#include <mutex>
+#include <functional>
 
 namespace AstroPhotoStacker {
 
@@ -42,11 +42,6 @@ namespace AstroPhotoStacker {
             */
             virtual void calculate_stacked_photo_internal() override;
 
-
-            std::vector<std::vector<unsigned short>> m_number_of_stacked_pixels;
-
-            std::vector<std::mutex> m_mutexes;
-
             /**
              * @brief Get number of pixel lines that we can proces at once (limited by memory usage)
              *
@@ -56,6 +51,25 @@ namespace AstroPhotoStacker {
 
             virtual void add_photo_to_stack(unsigned int file_index, int y_min, int y_max) override;
 
+            /**
+             * @brief Add the photo to the accumulators owned by given thread. Each stacking thread has its own accumulators, so no locking is needed.
+             *
+             * @param file_index - index of the photo
+             * @param y_min - first line of the slice
+             * @param y_max - first line after the slice
+             * @param i_thread - index of the thread (and its accumulators)
+             */
+            virtual void add_photo_to_accumulators(unsigned int file_index, int y_min, int y_max, unsigned int i_thread);
+
+            /**
+             * @brief Merge the accumulators of all threads into the accumulators of thread 0 using parallel tree reduction: in step "s", accumulators of thread "i + s" are merged
+             * into accumulators of thread "i" for all "i" divisible by "2*s". The pixels are split into chunks, so that all CPUs are used also in the last steps.
+             *
+             * @param n_pixels - number of pixels to merge
+             * @param merge_accumulators - function merging pixels <pixel_begin, pixel_end) of accumulators of "i_thread_source" into accumulators of "i_thread_target" for given color
+             */
+            void reduce_accumulators(size_t n_pixels, const std::function<void(int i_thread_target, int i_thread_source, int i_color, size_t pixel_begin, size_t pixel_end)> &merge_accumulators);
+
             /**
              * @brief Put all the partial results together
             */
@@ -81,15 +95,27 @@ namespace AstroPhotoStacker {
 
 
             /**
-             * @brief Process the given pixel for given color
+             * @brief Add the values of one color channel of a frame to the accumulators of given thread. It is called once per frame and color,
+             * the implementations should be simple loops over contiguous arrays, so that the compiler can vectorize them.
              *
              * @param i_color - color index
-             * @param i_pixel - pixel index (it's the total index = y*width + x)
-             * @param value - value of the pixel from individual photo
+             * @param values - values of the pixels from individual photo, invalid values are negative
+             * @param n_values - number of values (it's the number of pixels in the processed slice)
              * @param i_thread - thread index
             */
-            virtual void process_pixel(int i_color, int i_pixel, int value, int i_thread) = 0;
+            virtual void add_values_to_stack(int i_color, const PixelType *values, size_t n_values, int i_thread) = 0;
 
+            /**
+             * @brief Number of pixels in the slice, i.e. the size of the accumulator for one thread and one color
+             */
+            size_t m_accumulator_size = 0;
+
+            /**
+             * @brief Get index of the first element for given thread and color in the flat accumulator arrays indexed as [thread][color][pixel]
+             */
+            size_t get_accumulator_index(int i_thread, int i_color) const   {
+                return (size_t(i_thread)*m_number_of_colors + i_color)*m_accumulator_size;
+            };
 
             /**
              * @brief Get maximal memory usage, considering the number of frames and their resolution
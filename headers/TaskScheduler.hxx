@@ -1,17 +1,24 @@
 #pragma once
 
+#include "../headers/ThreadPool.hxx"
+
 #include <mutex>
-#include <future>
 #include <vector>
 #include <functional>
 #include <stdexcept>
+#include <exception>
 #include <atomic>
-#include <thread>
 #include <map>
 #include <iostream>
 #include <memory>
 
 namespace AstroPhotoStacker {
+
+    /**
+     * @brief Runs tasks in parallel on the global ThreadPool, while respecting the limits on resources (CPU, memory, ...) used by the tasks running at the same time.
+     *
+     * Tasks which cannot be started because of the resource limits are kept in a buffer and started in the order in which they were submitted, once enough resources are released.
+     */
     class TaskScheduler {
         public:
             /**
@@ -21,16 +28,20 @@ namespace AstroPhotoStacker {
              * @param ignore_exceptions_in_tasks If true, the TaskScheduler will ignore exceptions thrown in tasks and will continue executing remaining tasks. Otherwise, "wait_for_tasks" will rethrow the first exception occuring in the tasks.
              */
             TaskScheduler(const std::vector<size_t> &resource_limits, bool ignore_exceptions_in_tasks = false)   :
+                m_thread_pool(ThreadPool::get_global_instance()),
                 m_resource_limits(resource_limits),
                 m_resource_usage(resource_limits.size(), 0),
                 m_ignore_exceptions_in_tasks(ignore_exceptions_in_tasks)   {
             };
 
             ~TaskScheduler()     {
-                if (!*m_active_exception) {
+                {
+                    std::scoped_lock lock(m_mutex);
                     m_ignore_exceptions_in_tasks = true; // otherwise we might get exceptions in destructor if there are still tasks running
-                    wait_for_tasks();
+                    m_exception_to_rethrow = false;
                 }
+                // running tasks access this object, so we have to wait for them even after an exception
+                m_thread_pool.wait_until([this]() { return m_n_tasks_remaining == 0; });
             }
 
             TaskScheduler()                     = delete;
@@ -45,79 +56,46 @@ namespace AstroPhotoStacker {
              */
             template<typename FunctionType, typename... Args>
             size_t submit(const FunctionType &task, const std::vector<size_t> &resource_requirements, const Args &...args)   {
-                m_n_tasks_remaining++;
                 std::scoped_lock lock(m_mutex);
+                check_resources_limit_correctness(resource_requirements);
+                m_n_tasks_remaining++;
 
                 const size_t this_task_id = m_last_task_id++;
-                check_resources_limit_correctness(resource_requirements);
-                std::shared_ptr<std::atomic<bool>> active_exception = m_active_exception;
-                std::function<void()> task_wrapped = [this, task, resource_requirements, this_task_id, active_exception, args...]() {
+                std::function<void()> task_wrapped = [this, task, resource_requirements, this_task_id, args...]() {
                     try {
                         task(args...);
-                        // if there was an exception in another task, we don't want to start new tasks and we cannot touch member variables - the destructor of TaskSchedulermight have already been called
-                        if (*active_exception) {
-                            return;
-                        }
-                        std::scoped_lock lock(m_mutex);
-                        release_resources(resource_requirements);
-                        m_n_tasks_remaining--;
-
-                        submit_task_from_buffer();
                     }
                     catch(...) {
                         std::scoped_lock lock(m_mutex);
-
-                        // if there was an exception in another task, we just need to terminate task - using any memeber varaible is unsafe - the destructor of TaskSchedulermight have already been called
-                        if (*active_exception) {
-                            return;
-                        }
-                        release_resources(resource_requirements);
-                        m_n_tasks_remaining--;
-                        if (m_ignore_exceptions_in_tasks) {
-                            submit_task_from_buffer();
-                            return;
+                        if (!m_ignore_exceptions_in_tasks && m_active_exception == nullptr) {
+                            m_active_exception = std::current_exception();
+                            m_task_with_active_exception = this_task_id;
+                            m_exception_to_rethrow = true;
+
+                            // tasks which have not been started yet are dropped
+                            m_n_tasks_remaining -= m_remaining_tasks_and_requirements.size();
+                            m_remaining_tasks_and_requirements.clear();
                         }
-                        *active_exception = true;
-                        m_task_with_active_exception = this_task_id;
-                        throw;
                     }
+                    finish_task(resource_requirements);
                 };
 
-                const bool resources_available = enough_resources(resource_requirements);
-                if (resources_available) {
-                    allocate_resources(resource_requirements);
-                    m_futures_and_requirements[this_task_id] = {std::async(std::launch::async, task_wrapped), resource_requirements};
-                }
-                else {
-                    m_remaining_tasks_and_requirements[this_task_id] = {task_wrapped, resource_requirements};
-                }
+                m_remaining_tasks_and_requirements[this_task_id] = {task_wrapped, resource_requirements};
+                submit_task_from_buffer();
                 return this_task_id;
             };
 
             /**
-             * @brief Wait for all tasks to finish
-             *
-             * @param sleep_time_ms The time to sleep between checking if the tasks are finished, in milliseconds
+             * @brief Wait for all tasks to finish. If called from a task running on the thread pool, the waiting thread executes other queued tasks in the meantime.
              */
-            void wait_for_tasks(int sleep_time_ms = 100) {
-                while (true)   {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_ms));
-
-                    std::scoped_lock lock(m_mutex);
-
-                    if (!m_ignore_exceptions_in_tasks && *m_active_exception) {
-                        try {
-                            m_futures_and_requirements.at(m_task_with_active_exception).first.get();
-                        }
-                        catch (...) {
-                            m_ignore_exceptions_in_tasks = true; // otherwise we would get another exception while handling this one
-                            throw;
-                        }
-                    }
+            void wait_for_tasks() {
+                wait_for_tasks_or_exception();
 
-                    if (m_n_tasks_remaining == 0)   {
-                        break;
-                    }
+                std::scoped_lock lock(m_mutex);
+                if (m_active_exception != nullptr && !m_ignore_exceptions_in_tasks) {
+                    m_ignore_exceptions_in_tasks = true; // otherwise we would get another exception while handling this one
+                    m_exception_to_rethrow = false;
+                    std::rethrow_exception(m_active_exception);
                 }
             };
 
@@ -125,23 +103,25 @@ namespace AstroPhotoStacker {
              * @brief Wait for all tasks to finish
              *
              * @param exception_handler The function that will be called when an exception is thrown in any of the tasks. This function can be used to wrap the exception (with additional information) of trigger something.
-             * @param sleep_time_ms The time to sleep between checking if the tasks are finished, in milliseconds
              */
-            void wait_for_tasks_and_modify_exceptions(std::function<void(size_t)> exception_handler, int sleep_time_ms = 100) {
+            void wait_for_tasks_and_modify_exceptions(std::function<void(size_t)> exception_handler) {
                 while (true)   {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_ms));
-
-                    std::scoped_lock lock(m_mutex);
-
-                    if (!m_ignore_exceptions_in_tasks && *m_active_exception) {
+                    wait_for_tasks_or_exception();
+
+                    std::unique_lock lock(m_mutex);
+                    if (m_active_exception != nullptr && !m_ignore_exceptions_in_tasks) {
+                        m_ignore_exceptions_in_tasks = true; // otherwise we would get another exception while handling this one
+                        m_exception_to_rethrow = false;
+                        const size_t task_id = m_task_with_active_exception;
+                        const std::exception_ptr exception = m_active_exception;
+                        lock.unlock();
                         try {
-                            m_futures_and_requirements.at(m_task_with_active_exception).first.get();
+                            std::rethrow_exception(exception);
                         }
                         catch (...) {
-                            m_ignore_exceptions_in_tasks = true; // otherwise we would get another exception while handling this one
-                            const size_t task_id = m_task_with_active_exception;
                             exception_handler(task_id);
                         }
+                        continue;
                     }
 
                     if (m_n_tasks_remaining == 0)   {
@@ -159,37 +139,57 @@ namespace AstroPhotoStacker {
             };
 
         private:
+            ThreadPool &m_thread_pool;
+
             std::mutex m_mutex;
 
-            // this must outlive the TaskScheduler object in case of exception
-            std::shared_ptr<std::atomic<bool>> m_active_exception = std::make_shared<std::atomic<bool>>(false);
-            size_t m_task_with_active_exception = 0;
+            std::exception_ptr  m_active_exception = nullptr;
+            size_t              m_task_with_active_exception = 0;
 
             std::vector<size_t> m_resource_limits;
             std::vector<size_t> m_resource_usage;
             bool m_ignore_exceptions_in_tasks;
-            std::map<size_t, std::pair<std::future<void>, std::vector<size_t>>>                 m_futures_and_requirements;
-            std::unordered_map<size_t, std::pair<std::function<void()>, std::vector<size_t>>>   m_remaining_tasks_and_requirements;
+
+            // ordered by task ID, so that the tasks are started in the order in which they were submitted
+            std::map<size_t, std::pair<std::function<void()>, std::vector<size_t>>>   m_remaining_tasks_and_requirements;
             size_t m_last_task_id = 0;
             std::atomic<size_t> m_n_tasks_remaining = 0;
+            std::atomic<bool>   m_exception_to_rethrow = false;
 
-            void submit_task_from_buffer() {
-                // check if any task can be executed now
-                std::vector<size_t> tasks_to_remove;
-                for (const auto &[i_task, task_and_resource_requirements] : m_remaining_tasks_and_requirements) {
-
-                    const std::function<void()> &task                   = task_and_resource_requirements.first;
-                    const std::vector<size_t> &resource_requirements    = task_and_resource_requirements.second;
+            // the predicate must not lock m_mutex - it is evaluated by the thread pool with its own mutex locked
+            void wait_for_tasks_or_exception()  {
+                m_thread_pool.wait_until([this]() {
+                    return m_n_tasks_remaining == 0 || m_exception_to_rethrow;
+                });
+            };
 
-                    if (enough_resources(resource_requirements)) {
-                        allocate_resources(resource_requirements);
-                        m_futures_and_requirements[i_task] = {std::async(std::launch::async, task), resource_requirements};
-                        tasks_to_remove.push_back(i_task);
-                    }
+            void finish_task(const std::vector<size_t> &resource_requirements) {
+                {
+                    std::scoped_lock lock(m_mutex);
+                    release_resources(resource_requirements);
+                    submit_task_from_buffer();
                 }
+                // the destructor might return as soon as the counter reaches zero, so no member can be touched after that
+                ThreadPool &thread_pool = m_thread_pool;
+                m_n_tasks_remaining--;
+                thread_pool.notify_all();
+            };
+
+            /**
+             * @brief Start the buffered tasks, as long as there are enough resources for them. It must be called with m_mutex locked.
+             */
+            void submit_task_from_buffer() {
+                while (!m_remaining_tasks_and_requirements.empty()) {
+                    auto it = m_remaining_tasks_and_requirements.begin();
+                    const std::vector<size_t> &resource_requirements = it->second.second;
 
-                for (size_t i_task : tasks_to_remove) {
-                    m_remaining_tasks_and_requirements.erase(i_task);
+                    // keep the submission order - do not let later tasks overtake the first waiting one
+                    if (!enough_resources(resource_requirements)) {
+                        break;
+                    }
+                    allocate_resources(resource_requirements);
+                    m_thread_pool.submit(std::move(it->second.first));
+                    m_remaining_tasks_and_requirements.erase(it);
                 }
             };
 
@@ -233,4 +233,4 @@ namespace AstroPhotoStacker {
                 }
             };
     };
-}
\ No newline at end of file
+}
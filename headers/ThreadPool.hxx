@@ -0,0 +1,178 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Long-lived pool of worker threads with per-worker task queues and work stealing. One global instance is shared by all TaskScheduler objects in the process.
+     *
+     * Tasks submitted from a worker thread are put into the queue of that worker, other tasks are distributed round-robin. A worker takes the newest task from its own queue
+     * and if its queue is empty, it steals the oldest task from the queues of the other workers. A worker waiting for other tasks (see wait_until) keeps executing queued tasks,
+     * so nested parallelism (a task waiting for its own sub-tasks) cannot deadlock the pool.
+     */
+    class ThreadPool {
+        public:
+            ThreadPool()                    = delete;
+            ThreadPool(const ThreadPool&)   = delete;
+
+            /**
+             * @brief Construct a new Thread Pool object and start the worker threads
+             *
+             * @param n_threads - number of worker threads
+             */
+            explicit ThreadPool(size_t n_threads)   {
+                n_threads = std::max<size_t>(n_threads, 1);
+                for (size_t i_thread = 0; i_thread < n_threads; i_thread++) {
+                    m_queues.push_back(std::make_unique<WorkerQueue>());
+                }
+                for (size_t i_thread = 0; i_thread < n_threads; i_thread++) {
+                    m_threads.emplace_back([this, i_thread]() { worker_loop(i_thread); });
+                }
+            };
+
+            ~ThreadPool()   {
+                m_stop = true;
+                notify_all();
+                for (std::thread &thread : m_threads) {
+                    thread.join();
+                }
+            };
+
+            /**
+             * @brief Get the thread pool shared by the whole process. It has one worker per hardware thread.
+             */
+            static ThreadPool &get_global_instance()    {
+                static ThreadPool global_instance(std::thread::hardware_concurrency());
+                return global_instance;
+            };
+
+            /**
+             * @brief Put the task into one of the queues. The task must not throw.
+             */
+            void submit(std::function<void()> task) {
+                const size_t queue_index = (s_current_pool == this) ? s_worker_index : (m_next_queue++ % m_queues.size());
+                {
+                    std::scoped_lock lock(m_queues[queue_index]->mutex);
+                    m_queues[queue_index]->tasks.push_back(std::move(task));
+                }
+                m_n_queued_tasks++;
+                notify_all();
+            };
+
+            /**
+             * @brief Block until the predicate is true. If called from a worker thread of this pool, the queued tasks are executed in the meantime.
+             *
+             * The predicate is re-evaluated after each call of notify_all(), so whoever changes the state checked by the predicate has to call notify_all() afterwards.
+             */
+            void wait_until(const std::function<bool()> &predicate)  {
+                const bool is_worker_thread = s_current_pool == this;
+                while (!predicate()) {
+                    if (is_worker_thread && try_run_queued_task()) {
+                        continue;
+                    }
+                    std::unique_lock lock(m_sleep_mutex);
+                    m_sleep_condition.wait(lock, [this, &predicate, is_worker_thread]() {
+                        return predicate() || (is_worker_thread && m_n_queued_tasks > 0);
+                    });
+                }
+            };
+
+            /**
+             * @brief Wake up all threads waiting in wait_until and all idle workers
+             */
+            void notify_all()   {
+                {
+                    // empty critical section, it guarantees that no waiting thread is between checking its predicate and going to sleep
+                    std::scoped_lock lock(m_sleep_mutex);
+                }
+                m_sleep_condition.notify_all();
+            };
+
+            size_t get_number_of_threads() const    {
+                return m_threads.size();
+            };
+
+        private:
+            struct WorkerQueue {
+                std::mutex                          mutex;
+                std::deque<std::function<void()>>   tasks;
+            };
+
+            std::vector<std::unique_ptr<WorkerQueue>>   m_queues;
+            std::vector<std::thread>                    m_threads;
+
+            std::mutex                  m_sleep_mutex;
+            std::condition_variable     m_sleep_condition;
+
+            std::atomic<size_t>         m_n_queued_tasks    = 0;
+            std::atomic<size_t>         m_next_queue        = 0;
+            std::atomic<bool>           m_stop              = false;
+
+            inline static thread_local ThreadPool  *s_current_pool  = nullptr;
+            inline static thread_local size_t       s_worker_index  = 0;
+
+            void worker_loop(size_t worker_index)   {
+                s_current_pool = this;
+                s_worker_index = worker_index;
+                while (true) {
+                    if (try_run_queued_task()) {
+                        continue;
+                    }
+                    std::unique_lock lock(m_sleep_mutex);
+                    m_sleep_condition.wait(lock, [this]() {
+                        return m_stop || m_n_queued_tasks > 0;
+                    });
+                    if (m_stop && m_n_queued_tasks == 0) {
+                        return;
+                    }
+                }
+            };
+
+            bool try_run_queued_task()  {
+                std::function<void()> task;
+                if (!pop_task(&task)) {
+                    return false;
+                }
+                task();
+                return true;
+            };
+
+            /**
+             * @brief Take the newest task from the queue of the current worker, or steal the oldest task from another queue
+             */
+            bool pop_task(std::function<void()> *task)  {
+                if (m_n_queued_tasks == 0) {
+                    return false;
+                }
+
+                const size_t n_queues = m_queues.size();
+                const size_t own_queue_index = (s_current_pool == this) ? s_worker_index : 0;
+                for (size_t i_shift = 0; i_shift < n_queues; i_shift++) {
+                    WorkerQueue &queue = *m_queues[(own_queue_index + i_shift) % n_queues];
+                    std::scoped_lock lock(queue.mutex);
+                    if (queue.tasks.empty()) {
+                        continue;
+                    }
+                    if (i_shift == 0) {
+                        *task = std::move(queue.tasks.back());
+                        queue.tasks.pop_back();
+                    }
+                    else {
+                        *task = std::move(queue.tasks.front());
+                        queue.tasks.pop_front();
+                    }
+                    m_n_queued_tasks--;
+                    return true;
+                }
+                return false;
+            };
+    };
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "../headers/FileStatus.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <string>
+#include <cstddef>
+
+namespace AstroPhotoStacker {
+
+    /**
+     * @brief Keeps an opened video capture for a video file and decodes its frames sequentially.
+     *
+     * Each thread has its own sessions (one per video), so that the frames read one after another by the same thread are decoded without seeking.
+     * Seeking (CAP_PROP_POS_FRAMES) restarts the decoding from the previous keyframe, which is very slow for codecs with long groups of pictures.
+     * Short forward gaps are therefore skipped by decoding the frames in between, only backward jumps and long forward jumps use the seek.
+     * A session is reopened if the video file has been modified since it was opened. The sessions of all threads are closed by "release_all_sessions" at the end of each pass over the frames.
+     */
+    class VideoDecodeSession {
+        public:
+            VideoDecodeSession()                            = delete;
+            VideoDecodeSession(const VideoDecodeSession&)   = delete;
+
+            /**
+             * @brief Open the video file
+             *
+             * @param video_address - path to the video file
+             */
+            explicit VideoDecodeSession(const std::string &video_address);
+
+            /**
+             * @brief Open the video file whose status was already read by "get_file_status"
+             *
+             * @param video_address - path to the video file
+             * @param file_status - size and last write time of the file
+             */
+            VideoDecodeSession(const std::string &video_address, const FileStatus &file_status);
+
+            /**
+             * @brief Read the frame using the session of the calling thread for given video (the session is created if it does not exist yet)
+             *
+             * @param video_address - path to the video file
+             * @param frame_id - index of the frame
+             * @return cv::Mat - the decoded frame
+             */
+            static cv::Mat read_frame(const std::string &video_address, int frame_id);
+
+            /**
+             * @brief Close the sessions of all threads, the videos are reopened by the next read. Sessions which are in use by another thread are closed once its read finishes.
+             */
+            static void release_all_sessions();
+
+            /**
+             * @brief Read the frame from the video. Reading consecutive frames is fast, jumping back is slow. Empty matrix is returned if the frame cannot be read.
+             *
+             * @param frame_id - index of the frame
+             * @return cv::Mat - the decoded frame
+             */
+            cv::Mat read_frame(int frame_id);
+
+        private:
+            std::string         m_video_address;
+            FileStatus          m_file_status;
+            cv::VideoCapture    m_capture;
+            int                 m_next_frame_id = 0;
+            unsigned long long  m_last_use = 0;
+
+            // forward gaps up to this number of frames are decoded through instead of seeking
+            static constexpr int    c_max_frames_to_decode_instead_of_seek = 30;
+            static constexpr size_t c_max_sessions_per_thread = 4;
+    };
+
+    /**
+     * @brief Get the number of consecutive frames which should be processed by one task, so that the decoding of videos stays sequential within the task while the work is still balanced between the threads.
+     *
+     * @param n_frames - total number of frames to process
+     * @param n_threads - number of threads processing the frames
+     * @return unsigned int - number of consecutive frames per task, at least 1
+     */
+    unsigned int get_number_of_consecutive_frames_per_task(size_t n_frames, unsigned int n_threads);
+}
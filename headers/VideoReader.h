@@ -2,6 +2,7 @@
 
 #include "../headers/InputFrame.h"
 #include "../headers/Common.h"
+#include "../headers/VideoDecodeSession.h"
 
 #include <opencv2/opencv.hpp>
 
@@ -13,13 +14,7 @@ namespace AstroPhotoStacker {
 
     template<class ValueType>
     std::vector<ValueType> read_one_channel_from_video_frame(const std::string &video_address, int frame_id, int *width, int *height, int channel) {
-        cv::VideoCapture video(video_address);
-        if (!video.isOpened()) {
-            throw std::runtime_error("Unable to open video file: " + video_address);
-        }
-        video.set(cv::CAP_PROP_POS_FRAMES, frame_id);
-        cv::Mat frame;
-        video.read(frame);
+        const cv::Mat frame = VideoDecodeSession::read_frame(video_address, frame_id);
         *width = frame.cols;
         *height = frame.rows;
         std::vector<ValueType> result(*width*(*height));
@@ -45,13 +40,7 @@ namespace AstroPhotoStacker {
 
     template<class ValueType>
     std::vector<std::vector<ValueType> > read_video_frame_rgb(const std::string &video_address, int frame_id, int *width, int *height) {
-        cv::VideoCapture video(video_address);
-        if (!video.isOpened()) {
-            throw std::runtime_error("Unable to open video file: " + video_address);
-        }
-        video.set(cv::CAP_PROP_POS_FRAMES, frame_id);
-        cv::Mat frame;
-        video.read(frame);
+        const cv::Mat frame = VideoDecodeSession::read_frame(video_address, frame_id);
         *width = frame.cols;
         *height = frame.rows;
         std::vector<std::vector<ValueType>> result(3, std::vector<ValueType>(*width*(*height)));
@@ -81,13 +70,7 @@ namespace AstroPhotoStacker {
 
     template<class ValueType>
     std::vector<ValueType> read_video_frame_as_gray_scale(const std::string &video_address, int frame_id, int *width, int *height) {
-        cv::VideoCapture video(video_address);
-        if (!video.isOpened()) {
-            throw std::runtime_error("Unable to open video file: " + video_address);
-        }
-        video.set(cv::CAP_PROP_POS_FRAMES, frame_id);
-        cv::Mat frame;
-        video.read(frame);
+        const cv::Mat frame = VideoDecodeSession::read_frame(video_address, frame_id);
         *width = frame.cols;
         *height = frame.rows;
 
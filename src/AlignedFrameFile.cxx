@@ -0,0 +1,242 @@
+#include "../headers/AlignedFrameFile.h"
+#include "../headers/PixelDataCompression.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+AlignedFrameFile::AlignedFrameFile(const std::string &file_address) :
+    m_file_address(file_address)   {
+
+    const int file_descriptor = open(file_address.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        throw runtime_error("Unable to open aligned frame file: " + file_address);
+    }
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0 || size_t(file_stat.st_size) < c_fixed_header_size) {
+        close(file_descriptor);
+        throw runtime_error("Invalid aligned frame file: " + file_address);
+    }
+    m_file_size = file_stat.st_size;
+
+    void *mapping = mmap(nullptr, m_file_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    close(file_descriptor); // the mapping keeps its own reference to the file
+    if (mapping == MAP_FAILED) {
+        throw runtime_error("Unable to map aligned frame file into memory: " + file_address);
+    }
+    m_data = static_cast<const unsigned char*>(mapping);
+
+    auto invalid_file = [this]() {
+        munmap(const_cast<unsigned char*>(m_data), m_file_size);
+        m_data = nullptr;
+        return runtime_error("Invalid aligned frame file: " + m_file_address);
+    };
+
+    if (memcmp(m_data, c_magic, sizeof(c_magic)) != 0) {
+        throw invalid_file();
+    }
+    uint32_t header_values[7];
+    memcpy(header_values, m_data + sizeof(c_magic), sizeof(header_values));
+    const uint32_t version              = header_values[0];
+    m_width                             = header_values[1];
+    m_height                            = header_values[2];
+    m_number_of_colors                  = header_values[3];
+    m_rows_per_band                     = header_values[4];
+    m_compression                       = static_cast<Compression>(header_values[5]);
+    const uint32_t description_length   = header_values[6];
+    if (version != c_version || m_rows_per_band <= 0 || header_values[5] > uint32_t(Compression::delta_varint)) {
+        throw invalid_file();
+    }
+
+    const int n_bands = (m_height + m_rows_per_band - 1)/m_rows_per_band;
+    const size_t n_chunks = size_t(n_bands)*m_number_of_colors;
+    const size_t chunk_table_offset = c_fixed_header_size + description_length;
+    if (chunk_table_offset + n_chunks*sizeof(Chunk) > m_file_size) {
+        throw invalid_file();
+    }
+    m_description = string(reinterpret_cast<const char*>(m_data + c_fixed_header_size), description_length);
+
+    m_chunks.resize(n_chunks);
+    memcpy(m_chunks.data(), m_data + chunk_table_offset, n_chunks*sizeof(Chunk));
+    for (const Chunk &chunk : m_chunks) {
+        if (chunk.offset + chunk.size > m_file_size) {
+            throw invalid_file();
+        }
+    }
+
+    // bands are usually read in the order of the slices
+    madvise(mapping, m_file_size, MADV_SEQUENTIAL);
+};
+
+AlignedFrameFile::~AlignedFrameFile()   {
+    if (m_data != nullptr) {
+        munmap(const_cast<unsigned char*>(m_data), m_file_size);
+    }
+};
+
+void AlignedFrameFile::write(   const std::string &file_address,
+                                const std::vector<std::vector<PixelType>> &data,
+                                int width,
+                                int height,
+                                const std::string &description,
+                                Compression compression,
+                                int rows_per_band)  {
+
+    const size_t plane_size = size_t(width)*height;
+    for (const vector<PixelType> &plane : data) {
+        if (plane.size() != plane_size) {
+            throw runtime_error("AlignedFrameFile::write: size of the color plane does not match the frame resolution");
+        }
+    }
+    rows_per_band = max(rows_per_band, 1);
+    const int n_colors = data.size();
+    const int n_bands = (height + rows_per_band - 1)/rows_per_band;
+
+    // chunks are prepared first, so that their offsets are known when writing the chunk table
+    vector<vector<unsigned char>> chunks;
+    chunks.reserve(size_t(n_bands)*n_colors);
+    for (int i_band = 0; i_band < n_bands; i_band++) {
+        const int row_begin = i_band*rows_per_band;
+        const int row_end   = min(row_begin + rows_per_band, height);
+        const size_t n_pixels = size_t(row_end - row_begin)*width;
+
+        for (int i_color = 0; i_color < n_colors; i_color++) {
+            const PixelType *band_data = &data[i_color][size_t(row_begin)*width];
+
+            // invalid pixels are stored as zeros, they are compressed better than -1 next to the valid values
+            vector<unsigned char> mask(get_mask_size(n_pixels), 0);
+            vector<PixelType> values(band_data, band_data + n_pixels);
+            for (size_t i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+                if (values[i_pixel] >= 0) {
+                    mask[i_pixel/8] |= (1 << (i_pixel%8));
+                }
+                else {
+                    values[i_pixel] = 0;
+                }
+            }
+
+            vector<unsigned char> chunk = std::move(mask);
+            if (compression == Compression::delta_varint) {
+                const vector<unsigned char> compressed_values = compress_pixel_data(values.data(), n_pixels);
+                chunk.insert(chunk.end(), compressed_values.begin(), compressed_values.end());
+            }
+            else {
+                const unsigned char *values_bytes = reinterpret_cast<const unsigned char*>(values.data());
+                chunk.insert(chunk.end(), values_bytes, values_bytes + n_pixels*sizeof(PixelType));
+            }
+            chunks.push_back(std::move(chunk));
+        }
+    }
+
+    const uint32_t header_values[7] = {c_version, uint32_t(width), uint32_t(height), uint32_t(n_colors), uint32_t(rows_per_band), uint32_t(compression), uint32_t(description.size())};
+    vector<Chunk> chunk_table(chunks.size());
+    uint64_t offset = c_fixed_header_size + description.size() + chunk_table.size()*sizeof(Chunk);
+    for (size_t i_chunk = 0; i_chunk < chunks.size(); i_chunk++) {
+        chunk_table[i_chunk] = Chunk{offset, chunks[i_chunk].size()};
+        offset += chunks[i_chunk].size();
+    }
+
+    const string temporary_file_address = file_address + ".tmp";
+    {
+        ofstream output_file(temporary_file_address, ios::binary | ios::trunc);
+        if (!output_file.is_open()) {
+            throw runtime_error("Unable to open file " + temporary_file_address + " for writing");
+        }
+        output_file.write(c_magic, sizeof(c_magic));
+        output_file.write(reinterpret_cast<const char*>(header_values), sizeof(header_values));
+        output_file.write(description.data(), description.size());
+        output_file.write(reinterpret_cast<const char*>(chunk_table.data()), chunk_table.size()*sizeof(Chunk));
+        for (const vector<unsigned char> &chunk : chunks) {
+            output_file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+        }
+        if (!output_file.good()) {
+            throw runtime_error("Unable to write file " + temporary_file_address + ". Is there enough disk space?");
+        }
+    }
+    filesystem::rename(temporary_file_address, file_address);
+};
+
+std::string AlignedFrameFile::read_description(const std::string &file_address)    {
+    ifstream input_file(file_address, ios::binary);
+    if (!input_file.is_open()) {
+        return "";
+    }
+    char magic[sizeof(c_magic)];
+    uint32_t header_values[7];
+    input_file.read(magic, sizeof(magic));
+    input_file.read(reinterpret_cast<char*>(header_values), sizeof(header_values));
+    if (!input_file.good() || memcmp(magic, c_magic, sizeof(c_magic)) != 0 || header_values[0] != c_version) {
+        return "";
+    }
+    string description(header_values[6], '\0');
+    input_file.read(description.data(), description.size());
+    return input_file.good() ? description : "";
+};
+
+std::vector<std::vector<PixelType>> AlignedFrameFile::read_lines(int y_min, int y_max) const   {
+    if (y_min < 0 || y_max > m_height || y_min >= y_max) {
+        throw runtime_error("AlignedFrameFile::read_lines: invalid y-range");
+    }
+
+    vector<vector<PixelType>> result(m_number_of_colors, vector<PixelType>(size_t(y_max - y_min)*m_width));
+    const int first_band = y_min/m_rows_per_band;
+    const int last_band  = (y_max - 1)/m_rows_per_band;
+    for (int i_band = first_band; i_band <= last_band; i_band++) {
+        const int band_begin = i_band*m_rows_per_band;
+        const int row_begin = max(y_min, band_begin);
+        const int row_end   = min(y_max, band_begin + m_rows_per_band);
+        for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
+            read_rows_from_chunk(i_band, i_color, row_begin, row_end, &result[i_color][size_t(row_begin - y_min)*m_width]);
+        }
+    }
+    return result;
+};
+
+void AlignedFrameFile::read_rows_from_chunk(int i_band, int i_color, int row_begin, int row_end, PixelType *output) const {
+    const Chunk &chunk = m_chunks[size_t(i_band)*m_number_of_colors + i_color];
+    const int band_begin = i_band*m_rows_per_band;
+    const int band_end = min(band_begin + m_rows_per_band, m_height);
+    const size_t n_pixels_band = size_t(band_end - band_begin)*m_width;
+    const size_t mask_size = get_mask_size(n_pixels_band);
+    if (chunk.size < mask_size) {
+        throw runtime_error("Corrupted aligned frame file: " + m_file_address);
+    }
+
+    const unsigned char *mask = m_data + chunk.offset;
+    const unsigned char *values = mask + mask_size;
+    const size_t values_size = chunk.size - mask_size;
+    const size_t first_pixel = size_t(row_begin - band_begin)*m_width;
+    const size_t n_pixels = size_t(row_end - row_begin)*m_width;
+
+    if (m_compression == Compression::none) {
+        // random access to the rows, only the requested ones are copied
+        if (values_size < n_pixels_band*sizeof(PixelType)) {
+            throw runtime_error("Corrupted aligned frame file: " + m_file_address);
+        }
+        memcpy(output, values + first_pixel*sizeof(PixelType), n_pixels*sizeof(PixelType));
+    }
+    else {
+        vector<PixelType> band_values(n_pixels_band);
+        if (!decompress_pixel_data(values, values_size, band_values.data(), n_pixels_band)) {
+            throw runtime_error("Corrupted aligned frame file: " + m_file_address);
+        }
+        copy(band_values.begin() + first_pixel, band_values.begin() + first_pixel + n_pixels, output);
+    }
+
+    for (size_t i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+        const size_t i_pixel_band = first_pixel + i_pixel;
+        if ((mask[i_pixel_band/8] & (1 << (i_pixel_band%8))) == 0) {
+            output[i_pixel] = -1;
+        }
+    }
+};
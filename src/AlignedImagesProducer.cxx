@@ -190,14 +190,21 @@ void AlignedImagesProducer::produce_aligned_image(const GroupToStack &group_to_s
 
     const std::vector<std::vector<double>> &stacked_image_double = stacker->get_stacked_image();
 
-    const auto [width_crop, height_crop] = calculate_cropped_width_and_height(width_original, height_original);
+    // drizzle stackers produce a finer grid than the input frames, the crop (defined in the input frame coordinates) is scaled accordingly
+    const int width_stacked  = stacker->get_width();
+    const int height_stacked = stacker->get_height();
+    const auto [width_crop_original, height_crop_original] = calculate_cropped_width_and_height(width_original, height_original);
+    const int top_left_corner_x = m_top_left_corner_x*width_stacked/width_original;
+    const int top_left_corner_y = m_top_left_corner_y*height_stacked/height_original;
+    const int width_crop  = min(width_crop_original*width_stacked/width_original, width_stacked - top_left_corner_x);
+    const int height_crop = min(height_crop_original*height_stacked/height_original, height_stacked - top_left_corner_y);
     std::vector<vector<PixelType>> output_image(3, vector<PixelType>(width_crop*height_crop, 0));
     for (int color = 0; color < 3; color++) {
         for (int y = 0; y < height_crop; y++) {
             for (int x = 0; x < width_crop; x++) {
-                const int x_original = x + m_top_left_corner_x;
-                const int y_original = y + m_top_left_corner_y;
-                output_image[color][x + width_crop*y] = stacked_image_double[color][x_original + width_original*y_original];
+                const int x_stacked = x + top_left_corner_x;
+                const int y_stacked = y + top_left_corner_y;
+                output_image[color][x + width_crop*y] = stacked_image_double[color][x_stacked + width_stacked*y_stacked];
             }
         }
     }
@@ -213,6 +220,7 @@ void AlignedImagesProducer::produce_aligned_image(  const InputFrame &input_fram
 
     CalibratedPhotoHandler photo_handler(input_frame, true);
     photo_handler.define_alignment(alignment_result);
+    photo_handler.set_interpolation_method(m_interpolation_method);
 
     for (const auto &calibration_frame_handler : calibration_frame_handlers) {
         photo_handler.register_calibration_frame(calibration_frame_handler);
@@ -10,6 +10,26 @@ std::string AlignmentResultBase::get_description_string() const  {
     return get_type_name() + s_type_separator + get_method_specific_description_string();
 };
 
+void AlignmentResultBase::transform_row_from_reference_to_shifted_frame(int y, int x_begin, int x_end, float *x_shifted, float *y_shifted) const {
+    for (int x = x_begin; x < x_end; x++) {
+        float x_transformed = x;
+        float y_transformed = y;
+        transform_from_reference_to_shifted_frame(&x_transformed, &y_transformed);
+        x_shifted[x - x_begin] = x_transformed;
+        y_shifted[x - x_begin] = y_transformed;
+    }
+};
+
+void AlignmentResultBase::transform_row_to_reference_frame(int y, int x_begin, int x_end, float *x_reference, float *y_reference) const {
+    for (int x = x_begin; x < x_end; x++) {
+        float x_transformed = x;
+        float y_transformed = y;
+        transform_to_reference_frame(&x_transformed, &y_transformed);
+        x_reference[x - x_begin] = x_transformed;
+        y_reference[x - x_begin] = y_transformed;
+    }
+};
+
 std::pair<std::string, std::string> AlignmentResultBase::split_type_and_description(const std::string &description_string) {
     size_t separator_pos = description_string.find(s_type_separator);
     if (separator_pos == std::string::npos) {
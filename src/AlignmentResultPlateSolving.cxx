@@ -71,10 +71,18 @@ void AlignmentResultPlateSolving::transform_from_reference_to_shifted_frame(floa
     m_geometric_transformer->transform_from_reference_to_shifted_frame(x, y);
 };
 
+void AlignmentResultPlateSolving::transform_row_from_reference_to_shifted_frame(int y, int x_begin, int x_end, float *x_shifted, float *y_shifted) const {
+    m_geometric_transformer->transform_row_from_reference_to_shifted_frame(y, x_begin, x_end, x_shifted, y_shifted);
+};
+
 void AlignmentResultPlateSolving::transform_to_reference_frame(float *x, float *y) const {
     m_geometric_transformer->transform_to_reference_frame(x, y);
 };
 
+void AlignmentResultPlateSolving::transform_row_to_reference_frame(int y, int x_begin, int x_end, float *x_reference, float *y_reference) const {
+    m_geometric_transformer->transform_row_to_reference_frame(y, x_begin, x_end, x_reference, y_reference);
+};
+
 string AlignmentResultPlateSolving::get_method_specific_description_string() const {
     float shift_x, shift_y, rotation_center_x, rotation_center_y, rotation, zoom;
     m_geometric_transformer->get_parameters(&shift_x, &shift_y, &rotation_center_x, &rotation_center_y, &rotation, &zoom);
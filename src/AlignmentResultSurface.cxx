@@ -38,11 +38,15 @@ AlignmentResultSurface::AlignmentResultSurface(const AlignmentResultSurface &oth
 };
 
 void AlignmentResultSurface::transform_from_reference_to_shifted_frame(float *x, float *y) const {
-    m_local_shifts_handler->transform_from_reference_to_shifted_frame(x, y);
+    m_local_shifts_handler->transform_from_reference_to_shifted_frame_grid(x, y);
+};
+
+void AlignmentResultSurface::transform_row_from_reference_to_shifted_frame(int y, int x_begin, int x_end, float *x_shifted, float *y_shifted) const {
+    m_local_shifts_handler->transform_row_from_reference_to_shifted_frame_grid(y, x_begin, x_end, x_shifted, y_shifted);
 };
 
 void AlignmentResultSurface::transform_to_reference_frame(float *x, float *y) const {
-    m_local_shifts_handler->transform_from_shifted_to_reference_frame(x, y);
+    m_local_shifts_handler->transform_from_shifted_to_reference_frame_grid(x, y);
 };
 
 string AlignmentResultSurface::get_method_specific_description_string() const {
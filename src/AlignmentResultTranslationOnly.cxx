@@ -42,11 +42,29 @@ void AlignmentResultTranslationOnly::transform_from_reference_to_shifted_frame(f
     *y -= m_shift_y;
 };
 
+void AlignmentResultTranslationOnly::transform_row_from_reference_to_shifted_frame(int y, int x_begin, int x_end, float *__restrict x_shifted, float *__restrict y_shifted) const {
+    const float y_transformed = float(y) - m_shift_y;
+    const int n_pixels = x_end - x_begin;
+    for (int i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+        x_shifted[i_pixel] = float(x_begin + i_pixel) - m_shift_x;
+        y_shifted[i_pixel] = y_transformed;
+    }
+};
+
 void AlignmentResultTranslationOnly::transform_to_reference_frame(float *x, float *y) const {
     *x += m_shift_x;
     *y += m_shift_y;
 };
 
+void AlignmentResultTranslationOnly::transform_row_to_reference_frame(int y, int x_begin, int x_end, float *__restrict x_reference, float *__restrict y_reference) const {
+    const float y_transformed = float(y) + m_shift_y;
+    const int n_pixels = x_end - x_begin;
+    for (int i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+        x_reference[i_pixel] = float(x_begin + i_pixel) + m_shift_x;
+        y_reference[i_pixel] = y_transformed;
+    }
+};
+
 std::string AlignmentResultTranslationOnly::get_method_specific_description_string() const {
     return to_string(m_shift_x) + c_separator_in_description +
            to_string(m_shift_y) + c_separator_in_description +
@@ -0,0 +1,117 @@
+#include "../headers/CalibratedFramesSlab.h"
+
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <system_error>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+CalibratedFramesSlab::CalibratedFramesSlab(int number_of_colors, int width, int height, const std::string &persistent_directory, bool compress) :
+    m_number_of_colors(number_of_colors),
+    m_width(width),
+    m_height(height),
+    m_compress(compress)    {
+
+    m_is_temporary_directory = persistent_directory.empty();
+    if (m_is_temporary_directory) {
+        const long long int time_stamp = chrono::high_resolution_clock::now().time_since_epoch().count();
+        const string directory_name = "AstroPhotoStacker_slab_" + to_string(time_stamp) + "_" + to_string(reinterpret_cast<unsigned long long int>(this));
+        m_directory = filesystem::temp_directory_path() / directory_name;
+    }
+    else {
+        m_directory = persistent_directory;
+    }
+    filesystem::create_directories(m_directory);
+};
+
+CalibratedFramesSlab::~CalibratedFramesSlab()   {
+    m_frame_files.clear();
+    if (m_is_temporary_directory) {
+        std::error_code error_code;
+        filesystem::remove_all(m_directory, error_code);
+    }
+};
+
+void CalibratedFramesSlab::store_frame(unsigned int i_file, const std::string &frame_key, const std::string &description, const std::vector<std::vector<PixelType>> &data)  {
+    if (data.size() < size_t(m_number_of_colors)) {
+        throw runtime_error("CalibratedFramesSlab::store_frame: not enough color planes provided");
+    }
+    const vector<vector<PixelType>> color_planes(data.begin(), data.begin() + m_number_of_colors);
+
+    const string file_address = get_frame_file_address(i_file, frame_key);
+    const AlignedFrameFile::Compression compression = m_compress ? AlignedFrameFile::Compression::delta_varint : AlignedFrameFile::Compression::none;
+    AlignedFrameFile::write(file_address, color_planes, m_width, m_height, description, compression);
+
+    scoped_lock lock(m_mutex);
+    m_frame_files.erase(i_file);
+    m_frame_file_addresses[i_file] = file_address;
+};
+
+bool CalibratedFramesSlab::contains_frame(unsigned int i_file, const std::string &frame_key, const std::string &description)  {
+    if (m_is_temporary_directory) {
+        return false;
+    }
+
+    const string file_address = get_frame_file_address(i_file, frame_key);
+    if (AlignedFrameFile::read_description(file_address) != description) {
+        return false;
+    }
+
+    shared_ptr<const AlignedFrameFile> frame_file = nullptr;
+    try {
+        frame_file = make_shared<const AlignedFrameFile>(file_address);
+    }
+    catch (const std::exception &) {
+        return false;
+    }
+    if (frame_file->get_width() != m_width || frame_file->get_height() != m_height || frame_file->get_number_of_colors() != m_number_of_colors) {
+        return false;
+    }
+
+    scoped_lock lock(m_mutex);
+    m_frame_files[i_file] = frame_file;
+    m_frame_file_addresses[i_file] = file_address;
+    return true;
+};
+
+std::vector<std::vector<PixelType>> CalibratedFramesSlab::read_lines(unsigned int i_file, int y_min, int y_max) const {
+    if (y_min < 0 || y_max > m_height || y_min >= y_max) {
+        throw runtime_error("CalibratedFramesSlab::read_lines: invalid y-range");
+    }
+    return get_frame_file(i_file)->read_lines(y_min, y_max);
+};
+
+unsigned long long CalibratedFramesSlab::get_disk_space_needed(unsigned int number_of_frames) const {
+    return static_cast<unsigned long long>(number_of_frames)*m_number_of_colors*m_width*m_height*sizeof(PixelType);
+};
+
+std::string CalibratedFramesSlab::get_frame_file_address(unsigned int i_file, const std::string &frame_key) const {
+    if (m_is_temporary_directory) {
+        return (m_directory / ("frame_" + to_string(i_file) + ".apsframe")).string();
+    }
+
+    // the same input frame is stored in the same file across the runs, regardless of its position in the stack
+    ostringstream file_name;
+    file_name << "frame_" << hex << setw(16) << setfill('0') << std::hash<string>()(frame_key) << ".apsframe";
+    return (m_directory / file_name.str()).string();
+};
+
+std::shared_ptr<const AlignedFrameFile> CalibratedFramesSlab::get_frame_file(unsigned int i_file) const  {
+    scoped_lock lock(m_mutex);
+    auto it = m_frame_files.find(i_file);
+    if (it != m_frame_files.end()) {
+        return it->second;
+    }
+
+    auto it_address = m_frame_file_addresses.find(i_file);
+    if (it_address == m_frame_file_addresses.end()) {
+        throw runtime_error("CalibratedFramesSlab::read_lines: frame " + to_string(i_file) + " has not been stored");
+    }
+    shared_ptr<const AlignedFrameFile> frame_file = make_shared<const AlignedFrameFile>(it_address->second);
+    m_frame_files[i_file] = frame_file;
+    return frame_file;
+};
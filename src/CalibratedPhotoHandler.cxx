@@ -1,12 +1,21 @@
 #include "../headers/CalibratedPhotoHandler.h"
 #include "../headers/Debayring.h"
+#include "../headers/FusedCalibration.h"
+#include "../headers/TaskScheduler.hxx"
+
+#include <algorithm>
+#include <cmath>
 
 using namespace std;
 using namespace AstroPhotoStacker;
 
-CalibratedPhotoHandler::CalibratedPhotoHandler(const InputFrame &input_frame, bool use_color_interpolation)    {
+CalibratedPhotoHandler::CalibratedPhotoHandler(const InputFrame &input_frame, bool use_color_interpolation) :
+    CalibratedPhotoHandler(make_unique<InputFrameReader>(input_frame), use_color_interpolation)  {
+};
+
+CalibratedPhotoHandler::CalibratedPhotoHandler(std::unique_ptr<InputFrameReader> input_frame_reader, bool use_color_interpolation)    {
     m_use_color_interpolation = use_color_interpolation;
-    m_input_frame_data_original = make_unique<InputFrameReader>(input_frame);
+    m_input_frame_data_original = std::move(input_frame_reader);
     m_input_frame_data_original->get_photo_resolution(&m_width, &m_height);
 
     m_y_min = 0;
@@ -18,17 +27,14 @@ void CalibratedPhotoHandler::define_alignment(const AlignmentResultBase &alignme
 };
 
 void CalibratedPhotoHandler::limit_y_range(int y_min, int y_max) {
+    y_min = max(y_min, 0);
+    y_max = min(y_max, m_height);
     if (y_min >= y_max) {
         return;
     }
 
-    if (y_min >= 0 || y_min < m_height) {
-        y_min = y_min;
-    }
-
-    if (y_max >= 0 || y_max < m_height) {
-        y_max = y_max;
-    }
+    m_y_min = y_min;
+    m_y_max = y_max;
 };
 
 void CalibratedPhotoHandler::register_calibration_frame(std::shared_ptr<const CalibrationFrameBase> calibration_frame_handler)  {
@@ -43,63 +49,259 @@ void CalibratedPhotoHandler::set_bit_depth(unsigned short int bit_depth)    {
     m_max_allowed_pixel_value = 1 << bit_depth;
 };
 
+void CalibratedPhotoHandler::set_number_of_threads(unsigned int n_threads)  {
+    m_n_threads = max(n_threads, 1u);
+};
+
+void CalibratedPhotoHandler::set_interpolation_method(InterpolationMethod interpolation_method)  {
+    m_interpolation_method = interpolation_method;
+};
+
 void CalibratedPhotoHandler::calibrate() {
+    // only the lines of the original photo that will be mapped into <m_y_min, m_y_max) need to be calibrated
+    int y_min_original, y_max_original;
+    get_y_range_in_original_photo(&y_min_original, &y_max_original);
+
+    // The output is produced in strips of lines. For each strip, the lines of the original photo it needs are calibrated and their hot pixels fixed (if not done yet),
+    // then they are debayered into a buffer of the strip size and shifted into the output, while they are still in the cache.
+    // Lines of the original photo are calibrated and fixed in the increasing order, so the result is the same as when processing the whole range at once.
     vector<std::vector<PixelType>*> data_for_calibration = m_input_frame_data_original->get_all_data_for_calibration();
-    // firstly apply the calibration frames on the original data
-    for (const std::shared_ptr<const CalibrationFrameBase> &calibration_frame_handler : m_calibration_frames) {
+    const shared_ptr<const FusedCalibration> fused_calibration = FusedCalibration::get_instance(m_calibration_frames);
+    auto calibrate_lines = [&](int y_begin, int y_end) {
+        // in one pass if the calibration frames can be merged, one by one otherwise
         for (std::vector<PixelType>* data : data_for_calibration) {
-            calibration_frame_handler->apply_calibration(data);
+            if (fused_calibration != nullptr) {
+                fused_calibration->apply_calibration(data, y_begin, y_end);
+                continue;
+            }
+            for (const std::shared_ptr<const CalibrationFrameBase> &calibration_frame_handler : m_calibration_frames) {
+                calibration_frame_handler->apply_calibration(data, y_begin, y_end);
+            }
         }
-    }
+    };
+
+    const bool is_raw_before_debayering = m_input_frame_data_original->is_raw_file_before_debayering();
+    const bool fix_hot_pixels = m_hot_pixel_identifier != nullptr && is_raw_before_debayering;
+    const bool debayer = m_use_color_interpolation && is_raw_before_debayering;
+    const std::array<char, 4> bayer_pattern = m_input_frame_data_original->get_bayer_pattern();
 
-    // have to fix hot pixels before debayering
-    if (m_hot_pixel_identifier != nullptr && m_input_frame_data_original->is_raw_file_before_debayering()) {
-        vector<PixelType>& raw_data = m_input_frame_data_original->get_raw_data_non_const();
-        for (int y = 0; y < m_height; y++) {
-            for (int x = 0; x < m_width; x++) {
-                if (m_hot_pixel_identifier->is_hot_pixel(x, y)) {
-                    fix_hot_pixel(x, y, &raw_data);
+    int calibrated_lines_end = y_min_original;
+    int prepared_lines_end = y_min_original;
+    auto prepare_original_lines = [&](int y_end) {
+        y_end = min(y_end, y_max_original);
+        if (y_end <= prepared_lines_end) {
+            return;
+        }
+        // hot pixel correction uses the calibrated neighbors up to 2 lines below
+        const int y_calibrate_end = fix_hot_pixels ? min(y_end + 2, y_max_original) : y_end;
+        if (y_calibrate_end > calibrated_lines_end) {
+            if (m_n_threads > 1) {
+                const int lines_per_block = max(c_strip_height, (y_calibrate_end - calibrated_lines_end + int(m_n_threads) - 1)/int(m_n_threads));
+                TaskScheduler pool({size_t(m_n_threads)});
+                for (int y_begin = calibrated_lines_end; y_begin < y_calibrate_end; y_begin += lines_per_block) {
+                    pool.submit(calibrate_lines, {1}, y_begin, min(y_begin + lines_per_block, y_calibrate_end));
                 }
+                pool.wait_for_tasks();
             }
+            else {
+                calibrate_lines(calibrated_lines_end, y_calibrate_end);
+            }
+            calibrated_lines_end = y_calibrate_end;
         }
-    }
+        if (fix_hot_pixels) {
+            vector<PixelType>& raw_data = m_input_frame_data_original->get_raw_data_non_const();
+            m_hot_pixel_identifier->fix_hot_pixels(&raw_data, m_width, m_height, bayer_pattern, prepared_lines_end, y_end);
+        }
+        prepared_lines_end = y_end;
+    };
 
-    if (m_use_color_interpolation && m_input_frame_data_original->is_raw_file()) {
-        m_input_frame_data_original->debayer();
-    }
+    // sub-pixel interpolation needs full color planes, raw data without color interpolation are shifted by nearest neighbor
+    const bool resample = m_interpolation_method != InterpolationMethod::NEAREST_NEIGHBOR && (debayer || !is_raw_before_debayering);
+    const ResamplingKernel resampling_kernel(m_interpolation_method);
 
-    // having the interpolated values for all pixels, let's just shift them
-    m_data_shifted_color_interpolation = vector<vector<PixelType>>(3, vector<PixelType>(m_width*m_height, -1));
-    for (int y_shifted = 0; y_shifted < m_height; y_shifted++)  {
-        for (int x_shifted = 0; x_shifted < m_width; x_shifted++)   {
-            float x_original = x_shifted;
-            float y_original = y_shifted;
-            // translations and rotations
+    m_data_shifted_color_interpolation = vector<vector<PixelType>>(3, vector<PixelType>(size_t(m_width)*(m_y_max - m_y_min), -1));
+    auto process_strip = [&](int y_strip_begin, int y_strip_end, bool prepare_lines) {
+        // positions of the pixels in the original photo, -1 if outside of the calibrated lines
+        vector<int> original_indices(size_t(y_strip_end - y_strip_begin)*m_width, -1);
+        int y_original_min = y_max_original;
+        int y_original_max = -1;
+        // coordinates in the original photo are computed for the whole line at once, without a virtual call per pixel
+        vector<float> x_original(original_indices.size());
+        vector<float> y_original(original_indices.size());
+        for (int y_shifted = y_strip_begin; y_shifted < y_strip_end; y_shifted++)  {
+            float *x_original_line = &x_original[size_t(y_shifted - y_strip_begin)*m_width];
+            float *y_original_line = &y_original[size_t(y_shifted - y_strip_begin)*m_width];
             if (m_alignment_result != nullptr) {
-                m_alignment_result->transform_from_reference_to_shifted_frame(&x_original, &y_original);
+                m_alignment_result->transform_row_from_reference_to_shifted_frame(y_shifted, 0, m_width, x_original_line, y_original_line);
+            }
+            else {
+                for (int x_shifted = 0; x_shifted < m_width; x_shifted++)   {
+                    x_original_line[x_shifted] = x_shifted;
+                    y_original_line[x_shifted] = y_shifted;
+                }
+            }
+
+            for (int x_shifted = 0; x_shifted < m_width; x_shifted++)   {
+                const int x_int = int(x_original_line[x_shifted]);
+                const int y_int = int(y_original_line[x_shifted]);
+                if (x_int >= 0 && x_int < m_width && y_int >= y_min_original && y_int < y_max_original) {
+                    original_indices[(y_shifted - y_strip_begin)*m_width + x_shifted] = y_int*m_width + x_int;
+                    y_original_min = min(y_original_min, y_int);
+                    y_original_max = max(y_original_max, y_int);
+                }
+            }
+        }
+        if (y_original_max < 0) {
+            return;
+        }
+
+        // lines of the original photo used by the strip, the interpolation needs also the neighboring lines
+        int lines_begin = y_original_min;
+        int lines_end   = y_original_max + 1;
+        if (resample) {
+            lines_begin = max(y_original_min + resampling_kernel.get_first_tap_offset(), y_min_original);
+            lines_end   = min(y_original_max + resampling_kernel.get_last_tap_offset() + 1, y_max_original);
+        }
+
+        // debayering uses the next line
+        if (prepare_lines) {
+            prepare_original_lines(lines_end + 1);
+        }
+
+        const size_t output_offset = size_t(y_strip_begin - m_y_min)*m_width;
+        const int n_lines = lines_end - lines_begin;
+        auto resample_strip = [&](const PixelType *const *color_lines, int n_colors) {
+            vector<float> source(size_t(n_lines)*m_width);
+            vector<PixelType> resampled_line(m_width);
+            for (int color = 0; color < n_colors; color++) {
+                std::copy(color_lines[color], color_lines[color] + source.size(), source.begin());
+                PixelType *output = &m_data_shifted_color_interpolation[color][output_offset];
+                for (size_t i_line_start = 0; i_line_start < original_indices.size(); i_line_start += m_width) {
+                    resampling_kernel.resample(source.data(), m_width, lines_begin, lines_end, &x_original[i_line_start], &y_original[i_line_start], m_width, resampled_line.data());
+                    for (int x = 0; x < m_width; x++) {
+                        if (original_indices[i_line_start + x] >= 0) {
+                            output[i_line_start + x] = resampled_line[x];
+                        }
+                    }
+                }
             }
+        };
+
+        if (debayer) {
+            vector<PixelType> debayered_lines(3*size_t(n_lines)*m_width);
+            PixelType *const debayered_colors[3] = {&debayered_lines[0], &debayered_lines[size_t(n_lines)*m_width], &debayered_lines[2*size_t(n_lines)*m_width]};
+            const vector<PixelType> &raw_data = m_input_frame_data_original->get_raw_data();
+            debayer_raw_data_lines(raw_data.data(), m_width, m_height, bayer_pattern, lines_begin, lines_end, debayered_colors);
 
-            int x_int = int(x_original);
-            int y_int = int(y_original);
-            if (x_int >= 0 && x_int < m_width && y_int >= 0 && y_int < m_height) {
-                const unsigned int index_shifted = y_shifted*m_width + x_shifted;
+            if (resample) {
+                resample_strip(debayered_colors, 3);
+                return;
+            }
 
-                // This is intentionally the innermost loop, even though it makes things less cache friendly. The reason is that calculating local shifts is quite CPU intensive.
-                // For star alignment, the performance overhead is at the level of 1-2%, but for surface alignment it speeds up things by a factor of ~2x
-                for (int color = 0; color < 3; color++) {
-                    m_data_shifted_color_interpolation[color][index_shifted] = m_input_frame_data_original->get_pixel_value(x_int, y_int, color);
+            const int first_index = lines_begin*m_width;
+            for (int color = 0; color < 3; color++) {
+                PixelType *output = &m_data_shifted_color_interpolation[color][output_offset];
+                for (size_t i = 0; i < original_indices.size(); i++) {
+                    if (original_indices[i] >= 0) {
+                        output[i] = debayered_colors[color][original_indices[i] - first_index];
+                    }
+                }
+            }
+        }
+        else if (is_raw_before_debayering) {
+            // without color interpolation only the color of the raw pixel is filled
+            const vector<PixelType> &raw_data = m_input_frame_data_original->get_raw_data();
+            for (size_t i = 0; i < original_indices.size(); i++) {
+                const int original_index = original_indices[i];
+                if (original_index >= 0) {
+                    const int x = original_index%m_width;
+                    const int y = original_index/m_width;
+                    const int color = bayer_pattern[(y%2)*2 + x%2];
+                    m_data_shifted_color_interpolation[color][output_offset + i] = raw_data[original_index];
+                }
+            }
+        }
+        else {
+            const vector<vector<PixelType>> &rgb_data = m_input_frame_data_original->get_rgb_data();
+            if (resample) {
+                const PixelType *color_lines[3];
+                for (int color = 0; color < min<int>(3, rgb_data.size()); color++) {
+                    color_lines[color] = &rgb_data[color][size_t(lines_begin)*m_width];
+                }
+                resample_strip(color_lines, min<int>(3, rgb_data.size()));
+                return;
+            }
+            for (int color = 0; color < min<int>(3, rgb_data.size()); color++) {
+                PixelType *output = &m_data_shifted_color_interpolation[color][output_offset];
+                const PixelType *input = rgb_data[color].data();
+                for (size_t i = 0; i < original_indices.size(); i++) {
+                    if (original_indices[i] >= 0) {
+                        output[i] = input[original_indices[i]];
+                    }
                 }
             }
         }
+    };
+
+    if (m_n_threads > 1) {
+        // strips are independent once all the needed lines of the original photo are prepared
+        prepare_original_lines(y_max_original);
+        TaskScheduler pool({size_t(m_n_threads)});
+        for (int y_strip_begin = m_y_min; y_strip_begin < m_y_max; y_strip_begin += c_strip_height) {
+            pool.submit(process_strip, {1}, y_strip_begin, min(y_strip_begin + c_strip_height, m_y_max), false);
+        }
+        pool.wait_for_tasks();
+    }
+    else {
+        for (int y_strip_begin = m_y_min; y_strip_begin < m_y_max; y_strip_begin += c_strip_height) {
+            process_strip(y_strip_begin, min(y_strip_begin + c_strip_height, m_y_max), true);
+        }
     }
 
     // clean up unused memory
     m_input_frame_data_original = nullptr;
 };
 
+void CalibratedPhotoHandler::get_y_range_in_original_photo(int *y_min_original, int *y_max_original) const {
+    *y_min_original = 0;
+    *y_max_original = m_height;
+    if (m_alignment_result == nullptr || (m_y_min == 0 && m_y_max == m_height)) {
+        return;
+    }
+
+    // Sample the requested band on a coarse grid (including its borders) and check where the points end up in the original photo.
+    // For rotations and translations the extremes are in the corners, for local shifts the grid spacing is small compared to the alignment boxes.
+    const int step = 16;
+    float y_original_min = m_height;
+    float y_original_max = -1;
+    auto update_range = [&](int x, int y) {
+        float x_original = x;
+        float y_original = y;
+        m_alignment_result->transform_from_reference_to_shifted_frame(&x_original, &y_original);
+        y_original_min = min(y_original_min, y_original);
+        y_original_max = max(y_original_max, y_original);
+    };
+    for (int y = m_y_min; y < m_y_max + step; y += step) {
+        const int y_sample = min(y, m_y_max - 1);
+        for (int x = 0; x < m_width + step; x += step) {
+            update_range(min(x, m_width - 1), y_sample);
+        }
+    }
+
+    // hot pixel correction uses neighbors up to 2 lines away and debayering uses the next line -> add a safety margin
+    const int margin = 8;
+    *y_min_original = max(0, int(floor(y_original_min)) - margin);
+    *y_max_original = min(m_height, int(ceil(y_original_max)) + 1 + margin);
+    if (*y_min_original >= *y_max_original) {
+        // the band is mapped completely outside of the original photo
+        *y_min_original = 0;
+        *y_max_original = 0;
+    }
+};
+
 void CalibratedPhotoHandler::get_value_by_reference_frame_coordinates(int x, int y, PixelType *value, char *color) const {
-    if (x >= 0 && x < m_width && y >= 0 && y < m_height) {
-        const unsigned int index = y*m_width + x;
+    if (x >= 0 && x < m_width && y >= m_y_min && y < m_y_max) {
+        const unsigned int index = (y - m_y_min)*m_width + x;
         *value = m_data_shifted[index];
         *color = m_colors_shifted[index];
     }
@@ -115,8 +317,8 @@ void CalibratedPhotoHandler::get_value_by_reference_frame_coordinates(int x, int
         return;
     }
 
-    if (x >= 0 && x < m_width && y >= 0 && y < m_height) {
-        const unsigned int index = y*m_width + x;
+    if (x >= 0 && x < m_width && y >= m_y_min && y < m_y_max) {
+        const unsigned int index = (y - m_y_min)*m_width + x;
         *value = m_data_shifted_color_interpolation[color][index];
     }
     else {
@@ -125,36 +327,3 @@ void CalibratedPhotoHandler::get_value_by_reference_frame_coordinates(int x, int
 };
 
 
-void CalibratedPhotoHandler::fix_hot_pixel(int x, int y, std::vector<PixelType> *data)    {
-    int n_same_color_neighbors = 0;
-    int new_value = 0;
-    const int index = y*m_width + x;
-    const int color_this_pixel = m_input_frame_data_original->get_raw_color(x,y);
-    for (int shift_size = 1; shift_size <= 2; shift_size++) {
-        for (int i_shift_y = -1*shift_size; i_shift_y <= shift_size; i_shift_y++) {
-            const int neighbor_y = y + i_shift_y;
-            if (neighbor_y < 0 || neighbor_y >= m_height) {
-                continue;
-            }
-            for (int i_shift_x = -1*shift_size; i_shift_x <= shift_size; i_shift_x++) {
-                if (i_shift_x == 0 && i_shift_y == 0) {
-                    continue;
-                }
-                const int neighbor_x = x + i_shift_x;
-                if (neighbor_x < 0 || neighbor_x >= m_width) {
-                    continue;
-                }
-                const int neighbor_index = neighbor_y*m_width + neighbor_x;
-                if (m_input_frame_data_original->get_raw_color(neighbor_x, neighbor_y) == color_this_pixel) {
-                    n_same_color_neighbors++;
-                    new_value += data->at(neighbor_index);
-                }
-            }
-        }
-        if (n_same_color_neighbors != 0) {
-            new_value /= n_same_color_neighbors;
-            data->at(index) = new_value;
-            return;
-        }
-    }
-};
@@ -36,15 +36,32 @@ CalibrationFrameBase::CalibrationFrameBase(int width, int height, const std::vec
     m_colors = std::array<char, 4>{0,0,0,0};
 };
 
-void CalibrationFrameBase::apply_calibration(std::vector<PixelType> *data) const {
+void CalibrationFrameBase::apply_calibration(std::vector<PixelType> *data, int y_min, int y_max) const {
     if (int(data->size()) != m_width*m_height) {
         throw runtime_error("CalibrationFrameBase::apply_calibration: size of the data does not match the size of the calibration frame");
     }
 
-    for (int y = 0; y < m_height; y++) {
+    y_min = max(y_min, 0);
+    y_max = y_max < 0 ? m_height : min(y_max, m_height);
+    for (int y = y_min; y < y_max; y++) {
         for (int x = 0; x < m_width; x++) {
             const int index = y*m_width + x;
             (*data)[index] = force_range<float>(get_updated_pixel_value((*data)[index], x, y), 0, std::numeric_limits<PixelType>::max());
         }
     }
-}
\ No newline at end of file
+}
+
+unsigned long long CalibrationFrameBase::get_checksum() const   {
+    unsigned long long checksum = 14695981039346656037ULL;
+    auto add_bytes = [&checksum](const unsigned char *bytes, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            checksum = (checksum ^ bytes[i]) * 1099511628211ULL;
+        }
+    };
+    const int dimensions[2] = {m_width, m_height};
+    add_bytes(reinterpret_cast<const unsigned char*>(dimensions), sizeof(dimensions));
+    // derived classes may release the original data once the calibrated data are calculated
+    add_bytes(reinterpret_cast<const unsigned char*>(m_data_original.data()), m_data_original.size()*sizeof(PixelType));
+    add_bytes(reinterpret_cast<const unsigned char*>(m_data_calibrated.data()), m_data_calibrated.size()*sizeof(float));
+    return checksum;
+};
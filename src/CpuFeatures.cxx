@@ -0,0 +1,12 @@
+#include "../headers/CpuFeatures.h"
+
+using namespace AstroPhotoStacker;
+
+bool AstroPhotoStacker::cpu_supports_avx2()    {
+#ifdef ASTRO_PHOTO_STACKER_AVX2_KERNELS
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+};
@@ -35,4 +35,15 @@ void DarkFrameHandler::calibrate() {
 
 float DarkFrameHandler::get_updated_pixel_value(float pixel_value, int x, int y) const {
     return max<float>(0, pixel_value - m_data_calibrated[y*m_width + x]);
-};
\ No newline at end of file
+};
+
+bool DarkFrameHandler::add_to_fused_calibration(float *offsets, float *scales) const  {
+    // ((value - offset)*scale - dark) = (value - (offset + dark/scale))*scale
+    const int n_pixels = m_width*m_height;
+    for (int i = 0; i < n_pixels; i++) {
+        if (scales[i] != 0) {
+            offsets[i] += m_data_calibrated[i]/scales[i];
+        }
+    }
+    return true;
+};
@@ -1,5 +1,7 @@
 #include "../headers/Debayring.h"
 
+#include <algorithm>
+
 using namespace AstroPhotoStacker;
 using namespace std;
 
@@ -35,40 +37,74 @@ void AstroPhotoStacker::get_closest_pixel_of_given_color(  const std::vector<Pix
     }
 };
 
-std::vector<std::vector<PixelType>> AstroPhotoStacker::debayer_raw_data(const std::vector<PixelType> &data_original, int width, int height, const std::array<char, 4> &bayer_pattern)  {
+std::vector<std::vector<PixelType>> AstroPhotoStacker::debayer_raw_data(const std::vector<PixelType> &data_original, int width, int height, const std::array<char, 4> &bayer_pattern, int y_min, int y_max)  {
     std::vector<std::vector<PixelType>> result;
     for (int color = 0; color < 3; color++) {
         result.push_back(std::vector<PixelType>(width*height, 0));
     }
 
-    for (int y = 0; y < height-1; y++) {
+    y_min = max(y_min, 0);
+    y_max = y_max < 0 ? height : min(y_max, height);
+    if (y_min < y_max) {
+        PixelType *const result_lines[3] = {&result[0][y_min*width], &result[1][y_min*width], &result[2][y_min*width]};
+        debayer_raw_data_lines(data_original.data(), width, height, bayer_pattern, y_min, y_max, result_lines);
+    }
+    return result;
+}
+
+void AstroPhotoStacker::debayer_raw_data_lines(const PixelType *data_original, int width, int height, const std::array<char, 4> &bayer_pattern, int y_begin, int y_end, PixelType *const result[3])  {
+    // each 2x2 block contains every position of the Bayer pattern exactly once, so the number of pixels of each color is the same for all blocks.
+    // For each parity of the top left pixel, get the colors of the 4 pixels of the block
+    int n_pixels[3] = {0, 0, 0};
+    for (int bayer_index = 0; bayer_index < 4; bayer_index++) {
+        n_pixels[int(bayer_pattern[bayer_index])]++;
+    }
+    int block_colors[4][4];
+    for (int parity_y = 0; parity_y < 2; parity_y++) {
+        for (int parity_x = 0; parity_x < 2; parity_x++) {
+            for (int y2 = 0; y2 < 2; y2++) {
+                for (int x2 = 0; x2 < 2; x2++) {
+                    block_colors[parity_y*2 + parity_x][y2*2 + x2] = bayer_pattern[((parity_y + y2)%2)*2 + (parity_x + x2)%2];
+                }
+            }
+        }
+    }
+
+    const int y_last_debayered = min(y_end, height-1);
+    for (int y = y_begin; y < y_end; y++) {
+        PixelType *result_line[3];
+        for (int color = 0; color < 3; color++) {
+            result_line[color] = result[color] + size_t(y - y_begin)*width;
+        }
+
+        if (y >= y_last_debayered) {
+            for (int color = 0; color < 3; color++) {
+                fill(result_line[color], result_line[color] + width, 0);
+            }
+            continue;
+        }
+
+        const PixelType *line_0 = &data_original[size_t(y)*width];
+        const PixelType *line_1 = line_0 + width;
         for (int x = 0; x < width-1; x++) {
+            const int *colors = block_colors[(y%2)*2 + x%2];
             int this_pixel_rgb[3] = {0, 0, 0};
-            int n_pixels[3] = {0, 0, 0};
 
             // average out 2x2 pixels
-            for (int y2 = 0; y2 < 2; y2++)  {
-                for (int x2 = 0; x2 < 2; x2++)   {
-                    const unsigned int index = (y+y2)*width + (x+x2);
-                    const int bayer_index = ((y2+y)%2)*2 + (x+x2)%2;
-                    const unsigned int color = bayer_pattern[bayer_index];
-                    this_pixel_rgb[color] += data_original[index];
-                    n_pixels[color]++;
-                }
-            }
+            this_pixel_rgb[colors[0]] += line_0[x];
+            this_pixel_rgb[colors[1]] += line_0[x+1];
+            this_pixel_rgb[colors[2]] += line_1[x];
+            this_pixel_rgb[colors[3]] += line_1[x+1];
 
-            // save the result
             for (int color = 0; color < 3; color++) {
-                if (n_pixels[color] == 0)   {
-                    result[color][y*width + x] = 0;
-                    continue;
-                }
-                result[color][y*width + x] = this_pixel_rgb[color]/n_pixels[color];
+                result_line[color][x] = n_pixels[color] == 0 ? 0 : this_pixel_rgb[color]/n_pixels[color];
             }
         }
+        for (int color = 0; color < 3; color++) {
+            result_line[color][width-1] = 0;
+        }
     }
-    return result;
-}
+};
 
 void AstroPhotoStacker::debayer_monochrome(std::vector<PixelType> *data, int width, int height, const std::array<char, 4> &bayer_pattern) {
     for (int y = 0; y < height-1; y++) {
@@ -0,0 +1,373 @@
+#include "../headers/DecodedFrameCache.h"
+#include "../headers/PixelDataCompression.h"
+
+#include <fstream>
+#include <cstdint>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+std::size_t DecodedFrame::get_memory_usage() const  {
+    size_t memory_usage = sizeof(DecodedFrame) + raw_data.size()*sizeof(PixelType);
+    for (const vector<PixelType> &channel : rgb_data) {
+        memory_usage += channel.size()*sizeof(PixelType);
+    }
+    return memory_usage;
+};
+
+DecodedFrameCache::PinnedFrame::PinnedFrame(DecodedFrameCache *cache, const InputFrame &input_frame) :
+    m_cache(cache),
+    m_input_frame(input_frame)  {
+    m_cache->pin(m_input_frame);
+};
+
+DecodedFrameCache::PinnedFrame::~PinnedFrame()  {
+    m_cache->unpin(m_input_frame);
+};
+
+DecodedFrameCache::PassGuard::PassGuard(DecodedFrameCache *cache, std::size_t number_of_frames, std::size_t memory_per_frame) :
+    m_cache(cache)  {
+    scoped_lock lock(m_cache->m_mutex);
+    m_storing_suspended = number_of_frames*memory_per_frame > m_cache->m_memory_budget;
+    if (m_storing_suspended) {
+        m_cache->m_storing_suspension_count++;
+    }
+};
+
+DecodedFrameCache::PassGuard::~PassGuard()  {
+    if (m_storing_suspended) {
+        scoped_lock lock(m_cache->m_mutex);
+        m_cache->m_storing_suspension_count--;
+    }
+};
+
+DecodedFrameCache::DecodedFrameCache(std::size_t memory_budget) :
+    m_memory_budget(memory_budget)  {
+};
+
+DecodedFrameCache::~DecodedFrameCache() {
+    clear();
+};
+
+DecodedFrameCache &DecodedFrameCache::get_global_instance()   {
+    static DecodedFrameCache global_instance(0);
+    return global_instance;
+};
+
+void DecodedFrameCache::set_memory_budget(std::size_t memory_budget)  {
+    vector<FrameToSpill> frames_to_spill;
+    {
+        scoped_lock lock(m_mutex);
+        m_memory_budget = memory_budget;
+        frames_to_spill = evict_frames();
+    }
+    spill_to_disk(frames_to_spill);
+};
+
+std::size_t DecodedFrameCache::get_memory_budget() const  {
+    scoped_lock lock(m_mutex);
+    return m_memory_budget;
+};
+
+void DecodedFrameCache::set_disk_cache(const std::string &folder, std::size_t disk_budget)    {
+    scoped_lock lock(m_mutex);
+    // the settings are applied again before each stacking, the files cached in the same folder are kept
+    if (folder == m_disk_cache_folder) {
+        m_disk_budget = disk_budget;
+        return;
+    }
+    while (!m_disk_entries.empty()) {
+        remove_disk_entry(m_disk_entries.begin());
+    }
+    if (!folder.empty()) {
+        filesystem::create_directories(folder);
+    }
+    m_disk_cache_folder = folder;
+    m_disk_budget = disk_budget;
+};
+
+std::shared_ptr<const DecodedFrame> DecodedFrameCache::get(const InputFrame &input_frame, DataType data_type)  {
+    const CacheKey key(input_frame, data_type);
+    const filesystem::file_time_type source_last_write_time = get_source_last_write_time(input_frame);
+
+    string disk_file_address;
+    shared_ptr<const DecodedFrame> frame_without_pixels = nullptr;
+    {
+        scoped_lock lock(m_mutex);
+        auto it_memory = m_memory_entries.find(key);
+        if (it_memory != m_memory_entries.end()) {
+            if (it_memory->second.source_last_write_time == source_last_write_time) {
+                m_memory_lru.splice(m_memory_lru.begin(), m_memory_lru, it_memory->second.lru_position);
+                m_statistics.hits++;
+                return it_memory->second.decoded_frame;
+            }
+            remove_memory_entry(it_memory);
+        }
+
+        auto it_disk = m_disk_entries.find(key);
+        if (it_disk != m_disk_entries.end()) {
+            if (it_disk->second.source_last_write_time == source_last_write_time) {
+                m_disk_lru.splice(m_disk_lru.begin(), m_disk_lru, it_disk->second.lru_position);
+                disk_file_address       = it_disk->second.file_address;
+                frame_without_pixels    = it_disk->second.frame_without_pixels;
+            }
+            else {
+                remove_disk_entry(it_disk);
+            }
+        }
+
+        if (frame_without_pixels == nullptr) {
+            m_statistics.misses++;
+            return nullptr;
+        }
+    }
+
+    // reading from the disk is done without the lock, if the file has been removed in the meantime, it is a miss
+    shared_ptr<const DecodedFrame> decoded_frame = read_from_disk(disk_file_address, *frame_without_pixels);
+
+    vector<FrameToSpill> frames_to_spill;
+    {
+        scoped_lock lock(m_mutex);
+        if (decoded_frame == nullptr) {
+            m_statistics.misses++;
+            return nullptr;
+        }
+        m_statistics.disk_hits++;
+
+        if (should_store(input_frame) && m_memory_entries.find(key) == m_memory_entries.end()) {
+            m_memory_lru.push_front(key);
+            const size_t memory_usage = decoded_frame->get_memory_usage();
+            m_memory_entries[key] = MemoryEntry{decoded_frame, memory_usage, source_last_write_time, m_memory_lru.begin()};
+            m_memory_usage += memory_usage;
+            frames_to_spill = evict_frames();
+        }
+    }
+    spill_to_disk(frames_to_spill);
+    return decoded_frame;
+};
+
+bool DecodedFrameCache::put(const InputFrame &input_frame, DataType data_type, std::shared_ptr<const DecodedFrame> decoded_frame)   {
+    if (decoded_frame == nullptr) {
+        return false;
+    }
+
+    const CacheKey key(input_frame, data_type);
+    const filesystem::file_time_type source_last_write_time = get_source_last_write_time(input_frame);
+    const size_t memory_usage = decoded_frame->get_memory_usage();
+
+    vector<FrameToSpill> frames_to_spill;
+    {
+        scoped_lock lock(m_mutex);
+        if (!should_store(input_frame)) {
+            return false;
+        }
+
+        auto it = m_memory_entries.find(key);
+        if (it != m_memory_entries.end()) {
+            remove_memory_entry(it);
+        }
+
+        m_memory_lru.push_front(key);
+        m_memory_entries[key] = MemoryEntry{std::move(decoded_frame), memory_usage, source_last_write_time, m_memory_lru.begin()};
+        m_memory_usage += memory_usage;
+        frames_to_spill = evict_frames();
+    }
+    spill_to_disk(frames_to_spill);
+    return true;
+};
+
+void DecodedFrameCache::pin(const InputFrame &input_frame)    {
+    scoped_lock lock(m_mutex);
+    m_pin_counts[input_frame]++;
+};
+
+void DecodedFrameCache::unpin(const InputFrame &input_frame)  {
+    vector<FrameToSpill> frames_to_spill;
+    {
+        scoped_lock lock(m_mutex);
+        auto it = m_pin_counts.find(input_frame);
+        if (it == m_pin_counts.end()) {
+            return;
+        }
+        if (--it->second == 0) {
+            m_pin_counts.erase(it);
+        }
+        frames_to_spill = evict_frames();
+    }
+    spill_to_disk(frames_to_spill);
+};
+
+void DecodedFrameCache::clear()   {
+    scoped_lock lock(m_mutex);
+    m_memory_entries.clear();
+    m_memory_lru.clear();
+    m_memory_usage = 0;
+    m_pin_counts.clear();
+    while (!m_disk_entries.empty()) {
+        remove_disk_entry(m_disk_entries.begin());
+    }
+};
+
+DecodedFrameCache::Statistics DecodedFrameCache::get_statistics() const   {
+    scoped_lock lock(m_mutex);
+    Statistics statistics = m_statistics;
+    statistics.memory_usage = m_memory_usage;
+    statistics.disk_usage   = m_disk_usage;
+    statistics.number_of_frames_in_memory   = m_memory_entries.size();
+    statistics.number_of_frames_on_disk     = m_disk_entries.size();
+    return statistics;
+};
+
+std::vector<DecodedFrameCache::FrameToSpill> DecodedFrameCache::evict_frames()  {
+    vector<FrameToSpill> frames_to_spill;
+    auto it_lru = m_memory_lru.end();
+    while (m_memory_usage > m_memory_budget && it_lru != m_memory_lru.begin()) {
+        it_lru--;
+        if (is_pinned(it_lru->first)) {
+            continue;
+        }
+
+        auto it_entry = m_memory_entries.find(*it_lru);
+        if (!m_disk_cache_folder.empty() && m_disk_entries.find(*it_lru) == m_disk_entries.end()) {
+            frames_to_spill.push_back(FrameToSpill{*it_lru, it_entry->second.decoded_frame, it_entry->second.source_last_write_time});
+        }
+        it_lru = next(it_lru);  // the iterator is invalidated by the removal, continue from the next (more recently used) element
+        remove_memory_entry(it_entry);
+        m_statistics.evictions++;
+    }
+    return frames_to_spill;
+};
+
+void DecodedFrameCache::remove_memory_entry(std::map<CacheKey, MemoryEntry>::iterator it)    {
+    m_memory_usage -= it->second.memory_usage;
+    m_memory_lru.erase(it->second.lru_position);
+    m_memory_entries.erase(it);
+};
+
+void DecodedFrameCache::remove_disk_entry(std::map<CacheKey, DiskEntry>::iterator it)    {
+    error_code error;
+    filesystem::remove(it->second.file_address, error);
+    m_disk_usage -= it->second.file_size;
+    m_disk_lru.erase(it->second.lru_position);
+    m_disk_entries.erase(it);
+};
+
+void DecodedFrameCache::spill_to_disk(const std::vector<FrameToSpill> &frames_to_spill) {
+    for (const FrameToSpill &frame_to_spill : frames_to_spill) {
+        const DecodedFrame &decoded_frame = *frame_to_spill.decoded_frame;
+
+        string file_address;
+        {
+            scoped_lock lock(m_mutex);
+            if (m_disk_cache_folder.empty()) {
+                return;
+            }
+            file_address = m_disk_cache_folder + "/frame_" + std::to_string(m_disk_file_counter++) + ".bin";
+        }
+
+        // file format: number of raw channels (0 or 1), number of RGB channels, then for each channel its compressed size and the compressed data
+        ofstream file(file_address, ios::binary | ios::out);
+        if (!file.is_open()) {
+            continue;
+        }
+        vector<const vector<PixelType>*> channels;
+        if (!decoded_frame.raw_data.empty()) {
+            channels.push_back(&decoded_frame.raw_data);
+        }
+        for (const vector<PixelType> &channel : decoded_frame.rgb_data) {
+            channels.push_back(&channel);
+        }
+        const uint32_t n_channels[2] = {uint32_t(decoded_frame.raw_data.empty() ? 0 : 1), uint32_t(decoded_frame.rgb_data.size())};
+        file.write(reinterpret_cast<const char*>(n_channels), sizeof(n_channels));
+        for (const vector<PixelType> *channel : channels) {
+            const vector<unsigned char> compressed_channel = compress_pixel_data(channel->data(), channel->size());
+            const uint64_t compressed_size = compressed_channel.size();
+            file.write(reinterpret_cast<const char*>(&compressed_size), sizeof(compressed_size));
+            file.write(reinterpret_cast<const char*>(compressed_channel.data()), compressed_size);
+        }
+        file.close();
+        if (!file) {
+            error_code error;
+            filesystem::remove(file_address, error);
+            continue;
+        }
+
+        shared_ptr<DecodedFrame> frame_without_pixels = make_shared<DecodedFrame>();
+        frame_without_pixels->width         = decoded_frame.width;
+        frame_without_pixels->height        = decoded_frame.height;
+        frame_without_pixels->is_raw        = decoded_frame.is_raw;
+        frame_without_pixels->bayer_pattern = decoded_frame.bayer_pattern;
+        frame_without_pixels->metadata      = decoded_frame.metadata;
+
+        error_code error;
+        const size_t file_size = filesystem::file_size(file_address, error);
+
+        scoped_lock lock(m_mutex);
+        auto it = m_disk_entries.find(frame_to_spill.key);
+        if (it != m_disk_entries.end()) {
+            remove_disk_entry(it);
+        }
+        m_disk_lru.push_front(frame_to_spill.key);
+        m_disk_entries[frame_to_spill.key] = DiskEntry{file_address, file_size, frame_to_spill.source_last_write_time, frame_without_pixels, m_disk_lru.begin()};
+        m_disk_usage += file_size;
+
+        while (m_disk_usage > m_disk_budget && !m_disk_lru.empty()) {
+            remove_disk_entry(m_disk_entries.find(m_disk_lru.back()));
+        }
+    }
+};
+
+std::shared_ptr<const DecodedFrame> DecodedFrameCache::read_from_disk(const std::string &file_address, const DecodedFrame &frame_without_pixels) const  {
+    ifstream file(file_address, ios::binary | ios::in);
+    if (!file.is_open()) {
+        return nullptr;
+    }
+
+    shared_ptr<DecodedFrame> decoded_frame = make_shared<DecodedFrame>(frame_without_pixels);
+    const size_t n_pixels = size_t(decoded_frame->width)*decoded_frame->height;
+
+    uint32_t n_channels[2];
+    if (!file.read(reinterpret_cast<char*>(n_channels), sizeof(n_channels))) {
+        return nullptr;
+    }
+    vector<unsigned char> compressed_channel;
+    for (uint32_t i_channel = 0; i_channel < n_channels[0] + n_channels[1]; i_channel++) {
+        uint64_t compressed_size;
+        if (!file.read(reinterpret_cast<char*>(&compressed_size), sizeof(compressed_size))) {
+            return nullptr;
+        }
+        compressed_channel.resize(compressed_size);
+        if (!file.read(reinterpret_cast<char*>(compressed_channel.data()), compressed_size)) {
+            return nullptr;
+        }
+
+        vector<PixelType> channel(n_pixels);
+        if (!decompress_pixel_data(compressed_channel.data(), compressed_size, channel.data(), n_pixels)) {
+            return nullptr;
+        }
+        if (i_channel < n_channels[0]) {
+            decoded_frame->raw_data = std::move(channel);
+        }
+        else {
+            decoded_frame->rgb_data.push_back(std::move(channel));
+        }
+    }
+    return decoded_frame;
+};
+
+bool DecodedFrameCache::is_pinned(const InputFrame &input_frame) const  {
+    return m_pin_counts.find(input_frame) != m_pin_counts.end();
+};
+
+bool DecodedFrameCache::should_store(const InputFrame &input_frame) const  {
+    if (m_memory_budget == 0) {
+        return false;
+    }
+    return m_storing_suspension_count == 0 || is_pinned(input_frame);
+};
+
+std::filesystem::file_time_type DecodedFrameCache::get_source_last_write_time(const InputFrame &input_frame)    {
+    error_code error;
+    const filesystem::file_time_type last_write_time = filesystem::last_write_time(input_frame.get_file_address(), error);
+    return error ? filesystem::file_time_type::min() : last_write_time;
+};
@@ -0,0 +1,62 @@
+#include "../headers/DisplacementGrid.h"
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+DisplacementGrid::DisplacementGrid(int x_min, int y_min, int x_max, int y_max, int spacing, const std::function<void(float x, float y, float *dx, float *dy)> &get_displacement)   {
+    m_x_min = x_min;
+    m_y_min = y_min;
+    m_spacing = max(spacing, 1);
+    m_inverse_spacing = 1.f/m_spacing;
+
+    // at least 2 nodes in each direction, so that each point is inside of a cell
+    m_n_nodes_x = max(2, (max(x_max - x_min, 0) + m_spacing - 1)/m_spacing + 1);
+    m_n_nodes_y = max(2, (max(y_max - y_min, 0) + m_spacing - 1)/m_spacing + 1);
+
+    m_dx.resize(size_t(m_n_nodes_x)*m_n_nodes_y);
+    m_dy.resize(size_t(m_n_nodes_x)*m_n_nodes_y);
+    for (int index_y = 0; index_y < m_n_nodes_y; index_y++) {
+        for (int index_x = 0; index_x < m_n_nodes_x; index_x++) {
+            const size_t index = size_t(index_y)*m_n_nodes_x + index_x;
+            get_displacement(m_x_min + index_x*m_spacing, m_y_min + index_y*m_spacing, &m_dx[index], &m_dy[index]);
+        }
+    }
+};
+
+void DisplacementGrid::transform_row(int y, int x_begin, int x_end, float *__restrict x_shifted, float *__restrict y_shifted) const {
+    int index_y;
+    float weight_y;
+    get_cell(y, m_y_min, m_n_nodes_y, &index_y, &weight_y);
+    const float *dx_top    = &m_dx[size_t(index_y)*m_n_nodes_x];
+    const float *dy_top    = &m_dy[size_t(index_y)*m_n_nodes_x];
+    const float *dx_bottom = dx_top + m_n_nodes_x;
+    const float *dy_bottom = dy_top + m_n_nodes_x;
+
+    int x = x_begin;
+    while (x < x_end) {
+        int index_x;
+        float weight_x;
+        get_cell(x, m_x_min, m_n_nodes_x, &index_x, &weight_x);
+
+        // displacements interpolated vertically at the left and right edge of the cell
+        const float dx_left  = (1 - weight_y)*dx_top[index_x]     + weight_y*dx_bottom[index_x];
+        const float dx_right = (1 - weight_y)*dx_top[index_x + 1] + weight_y*dx_bottom[index_x + 1];
+        const float dy_left  = (1 - weight_y)*dy_top[index_x]     + weight_y*dy_bottom[index_x];
+        const float dy_right = (1 - weight_y)*dy_top[index_x + 1] + weight_y*dy_bottom[index_x + 1];
+
+        // pixels up to the end of the cell - pixels left of the grid use the first node, the last cell is extended to the end of the line
+        int cell_x_end = x_end;
+        if (x < m_x_min) {
+            cell_x_end = m_x_min;
+        }
+        else if (index_x + 2 < m_n_nodes_x) {
+            cell_x_end = m_x_min + (index_x + 1)*m_spacing;
+        }
+        const int segment_end = min(max(cell_x_end, x + 1), x_end);
+        for (; x < segment_end; x++) {
+            const float position = clamp((x - m_x_min)*m_inverse_spacing - index_x, 0.f, 1.f);
+            x_shifted[x - x_begin] = x + (1 - position)*dx_left + position*dx_right;
+            y_shifted[x - x_begin] = y + (1 - position)*dy_left + position*dy_right;
+        }
+    }
+};
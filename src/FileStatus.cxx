@@ -0,0 +1,33 @@
+#include "../headers/FileStatus.h"
+
+#include <sys/stat.h>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+namespace {
+    FileStatus get_file_status_from_stat(const struct stat &file_stat)   {
+        FileStatus file_status;
+        file_status.size = file_stat.st_size;
+        file_status.last_write_time = static_cast<long long>(file_stat.st_mtim.tv_sec)*1000000000LL + file_stat.st_mtim.tv_nsec;
+        return file_status;
+    };
+}
+
+bool AstroPhotoStacker::get_file_status(const std::string &file_address, FileStatus *file_status)  {
+    struct stat file_stat;
+    if (stat(file_address.c_str(), &file_stat) != 0) {
+        return false;
+    }
+    *file_status = get_file_status_from_stat(file_stat);
+    return true;
+};
+
+bool AstroPhotoStacker::get_file_status(int file_descriptor, FileStatus *file_status)  {
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0) {
+        return false;
+    }
+    *file_status = get_file_status_from_stat(file_stat);
+    return true;
+};
@@ -0,0 +1,155 @@
+#include "../headers/FitFileHeader.h"
+
+#include "../headers/Common.h"
+#include "../headers/SharedInstanceCache.hxx"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+FitFileHeader::FitFileHeader(const std::string &file_address) :
+    m_file_address(file_address)    {
+
+    if (!get_file_status(file_address, &m_file_status)) {
+        throw runtime_error("Could not open file " + file_address);
+    }
+    read_header();
+};
+
+FitFileHeader::FitFileHeader(const std::string &file_address, const FileStatus &file_status) :
+    m_file_address(file_address),
+    m_file_status(file_status)  {
+
+    read_header();
+};
+
+void FitFileHeader::read_header()   {
+    ifstream file(m_file_address, ios::binary | ios::in);
+    if (!file.is_open())    {
+        throw runtime_error("Could not open file " + m_file_address);
+    }
+
+    // read whole blocks and parse their cards, until the END card is found
+    string header;
+    size_t end_card_position = string::npos;
+    while (end_card_position == string::npos) {
+        const size_t block_start = header.size();
+        header.resize(block_start + c_block_size);
+        file.read(&header[block_start], c_block_size);
+        const size_t bytes_read = file.gcount();
+        header.resize(block_start + bytes_read);
+
+        for (size_t card_start = block_start; card_start + c_card_size <= header.size(); card_start += c_card_size) {
+            if (parse_card(&header[card_start])) {
+                end_card_position = card_start;
+                break;
+            }
+        }
+
+        if (end_card_position == string::npos && bytes_read < c_block_size) {
+            throw runtime_error("END keyword not found in the header of FIT file " + m_file_address);
+        }
+    }
+
+    calculate_data_size();
+    file.clear();
+    find_data_offset(header, end_card_position, &file);
+};
+
+std::shared_ptr<const FitFileHeader> FitFileHeader::get_instance(const std::string &file_address)  {
+    static SharedInstanceCache<std::string, FitFileHeader, FileStatus> s_cache(c_max_cached_headers);
+
+    FileStatus file_status;
+    if (!get_file_status(file_address, &file_status)) {
+        throw runtime_error("Could not open file " + file_address);
+    }
+
+    return s_cache.get_instance(file_address, file_status, [&file_address, &file_status]() {
+        return shared_ptr<const FitFileHeader>(new FitFileHeader(file_address, file_status));
+    });
+};
+
+bool FitFileHeader::parse_card(const char *card) {
+    string key(card, 8);
+    strip_string(&key, " ");
+    if (key == "END") {
+        return true;
+    }
+
+    // cards without value indicator (COMMENT, HISTORY, blank cards)
+    if (key.empty() || card[8] != '=') {
+        return false;
+    }
+
+    const char *value_begin = card + 9;
+    const char *value_end   = card + c_card_size;
+    while (value_begin < value_end && *value_begin == ' ') {
+        value_begin++;
+    }
+
+    string value;
+    if (value_begin < value_end && *value_begin == '\'') {
+        // string value, quote inside of the string is written as two quotes
+        for (const char *c = value_begin + 1; c < value_end; c++) {
+            if (*c == '\'') {
+                if (c + 1 < value_end && *(c + 1) == '\'') {
+                    value += '\'';
+                    c++;
+                    continue;
+                }
+                break;
+            }
+            value += *c;
+        }
+        strip_string(&value, " ");
+    }
+    else {
+        value = string(value_begin, find(value_begin, value_end, '/'));
+        strip_string(&value, "\'\" ");
+    }
+
+    m_keywords[key] = value;
+    return false;
+};
+
+void FitFileHeader::calculate_data_size()   {
+    const long long width       = stoll(get_with_default<string,string>(m_keywords, "NAXIS1", "0"));
+    const long long height      = stoll(get_with_default<string,string>(m_keywords, "NAXIS2", "0"));
+    const long long bit_depth   = stoll(get_with_default<string,string>(m_keywords, "BITPIX", "16"));
+    m_data_size = max<long long>(width*height*(llabs(bit_depth)/8), 0);
+};
+
+void FitFileHeader::find_data_offset(const std::string &header, std::size_t end_card_position, std::ifstream *file)  {
+    const size_t header_end = end_card_position + c_card_size;
+    m_data_offset = ((header_end + c_block_size - 1)/c_block_size)*c_block_size;
+
+    // header is not padded to the full block - data start after the blank characters following the END keyword
+    if (m_data_offset + m_data_size > m_file_status.size) {
+        m_data_offset = end_card_position + 3;
+        while (m_data_offset < header.size() && header[m_data_offset] == ' ') {
+            m_data_offset++;
+        }
+        if (m_data_offset == header.size()) {
+            file->seekg(m_data_offset);
+            while (file->peek() == ' ') {
+                file->get();
+                m_data_offset++;
+            }
+        }
+        return;
+    }
+
+    // blank blocks between the header and the data (the file is longer than needed by the data)
+    string block(c_block_size, ' ');
+    while (m_data_offset + c_block_size + m_data_size <= m_file_status.size) {
+        file->seekg(m_data_offset);
+        file->read(&block[0], c_block_size);
+        if (file->gcount() != static_cast<streamsize>(c_block_size) || block.find_first_not_of(' ') != string::npos) {
+            break;
+        }
+        m_data_offset += c_block_size;
+    }
+};
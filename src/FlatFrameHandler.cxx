@@ -65,3 +65,11 @@ void FlatFrameHandler::calibrate() {
 
     m_data_original.clear();
 }
+
+bool FlatFrameHandler::add_to_fused_calibration(float *offsets, float *scales) const  {
+    const int n_pixels = m_width*m_height;
+    for (int i = 0; i < n_pixels; i++) {
+        scales[i] *= m_data_calibrated[i];
+    }
+    return true;
+};
@@ -0,0 +1,182 @@
+#include "../headers/FramePrefetcher.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+FramePrefetcher::FramePrefetcher(   const std::vector<InputFrame> &input_frames,
+                                    unsigned int frames_per_range,
+                                    unsigned int n_consumers,
+                                    unsigned int queue_depth,
+                                    unsigned int memory_budget_in_mb,
+                                    unsigned int n_io_threads) :
+    m_input_frames(input_frames),
+    m_slots(input_frames.size()),
+    m_frames_per_range(frames_per_range > 0 ? frames_per_range : max<size_t>(input_frames.size(), 1)),
+    m_n_consumers(max(n_consumers, 1u)),
+    m_queue_depth(max(queue_depth, 1u)),
+    m_memory_budget(size_t(memory_budget_in_mb)*1024*1024)  {
+
+    m_n_frames_in_queue_per_range.resize((m_input_frames.size() + m_frames_per_range - 1)/m_frames_per_range, 0);
+
+    for (size_t i_frame = 0; i_frame < m_input_frames.size(); i_frame++) {
+        m_frame_indices.emplace(m_input_frames[i_frame], i_frame);
+    }
+
+    const bool contains_video = any_of(m_input_frames.begin(), m_input_frames.end(), [](const InputFrame &input_frame) {
+        return input_frame.is_video_frame();
+    });
+    if (contains_video) {
+        n_io_threads = 1;
+    }
+
+    n_io_threads = min<size_t>(max(n_io_threads, 1u), m_input_frames.size());
+    for (unsigned int i_thread = 0; i_thread < n_io_threads; i_thread++) {
+        m_io_threads.emplace_back(&FramePrefetcher::io_thread_loop, this);
+    }
+};
+
+FramePrefetcher::~FramePrefetcher() {
+    {
+        scoped_lock lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    for (thread &io_thread : m_io_threads) {
+        io_thread.join();
+    }
+};
+
+std::unique_ptr<InputFrameReader> FramePrefetcher::get_frame(size_t frame_index)   {
+    unique_lock lock(m_mutex);
+    FrameSlot &slot = m_slots.at(frame_index);
+
+    // the I/O threads did not get to this frame yet (or it was already taken) -> read it in this thread, instead of waiting for the frames in front of it
+    if (slot.state == FrameState::not_started || slot.state == FrameState::taken) {
+        slot.state = FrameState::taken;
+        lock.unlock();
+        return make_unique<InputFrameReader>(m_input_frames[frame_index]);
+    }
+
+    m_condition.wait(lock, [&slot]() { return slot.state == FrameState::ready; });
+    slot.state = FrameState::taken;
+    m_n_frames_in_queue--;
+    m_n_frames_in_queue_per_range[get_range_index(frame_index)]--;
+    m_memory_in_queue -= slot.memory_usage;
+    unique_ptr<InputFrameReader> reader = std::move(slot.reader);
+    const exception_ptr exception = slot.exception;
+    slot.exception = nullptr;
+    lock.unlock();
+    m_condition.notify_all();
+
+    if (exception != nullptr) {
+        rethrow_exception(exception);
+    }
+    return reader;
+};
+
+std::unique_ptr<InputFrameReader> FramePrefetcher::get_frame(const InputFrame &input_frame)    {
+    const auto it = m_frame_indices.find(input_frame);
+    if (it == m_frame_indices.end()) {
+        return make_unique<InputFrameReader>(input_frame);
+    }
+    return get_frame(it->second);
+};
+
+void FramePrefetcher::io_thread_loop()  {
+    unique_lock lock(m_mutex);
+    while (true) {
+        m_condition.wait(lock, [this]() { return m_stop || can_start_loading(); });
+        if (m_stop || m_active_ranges.empty()) {
+            return;
+        }
+
+        ActiveRange *range = get_range_to_load();
+        const size_t frame_index = range->next_frame++;
+        FrameSlot &slot = m_slots[frame_index];
+        slot.state = FrameState::loading;
+        m_n_frames_in_queue++;
+        m_n_frames_in_queue_per_range[range->range_index]++;
+        m_n_frames_loading++;
+        lock.unlock();
+
+        unique_ptr<InputFrameReader> reader = nullptr;
+        exception_ptr exception = nullptr;
+        try {
+            reader = make_unique<InputFrameReader>(m_input_frames[frame_index]);
+        }
+        catch (...) {
+            exception = current_exception();
+        }
+
+        lock.lock();
+        slot.memory_usage = reader != nullptr ? get_memory_usage(*reader) : 0;
+        slot.reader = std::move(reader);
+        slot.exception = exception;
+        slot.state = FrameState::ready;
+        m_n_frames_loading--;
+        m_memory_in_queue += slot.memory_usage;
+        m_last_frame_memory = max(m_last_frame_memory, slot.memory_usage);
+        m_condition.notify_all();
+    }
+};
+
+void FramePrefetcher::update_active_ranges()   {
+    auto skip_started_frames = [this](ActiveRange *range) {
+        while (range->next_frame < range->end && m_slots[range->next_frame].state != FrameState::not_started) {
+            range->next_frame++;
+        }
+    };
+
+    for (ActiveRange &range : m_active_ranges) {
+        skip_started_frames(&range);
+    }
+    m_active_ranges.erase(remove_if(m_active_ranges.begin(), m_active_ranges.end(), [](const ActiveRange &range) {
+        return range.next_frame >= range.end;
+    }), m_active_ranges.end());
+
+    // the consumers take the ranges in order - once all the frames of a range are started, its consumer will continue with the next range not taken by the others
+    while (m_active_ranges.size() < m_n_consumers && m_next_range_to_activate < m_n_frames_in_queue_per_range.size()) {
+        const size_t range_index = m_next_range_to_activate++;
+        ActiveRange range{range_index, range_index*m_frames_per_range, min((range_index + 1)*m_frames_per_range, m_slots.size())};
+        skip_started_frames(&range);
+        if (range.next_frame < range.end) {
+            m_active_ranges.push_back(range);
+        }
+    }
+};
+
+FramePrefetcher::ActiveRange *FramePrefetcher::get_range_to_load()  {
+    ActiveRange *result = nullptr;
+    for (ActiveRange &range : m_active_ranges) {
+        const unsigned int n_frames_in_queue = m_n_frames_in_queue_per_range[range.range_index];
+        if (n_frames_in_queue >= m_queue_depth) {
+            continue;
+        }
+        if (result == nullptr || n_frames_in_queue < m_n_frames_in_queue_per_range[result->range_index]) {
+            result = &range;
+        }
+    }
+    return result;
+};
+
+bool FramePrefetcher::can_start_loading()  {
+    update_active_ranges();
+    if (m_active_ranges.empty()) {
+        return true; // the thread will find out that there is nothing to do and finish
+    }
+    if (m_n_frames_in_queue >= m_queue_depth*m_n_consumers || get_range_to_load() == nullptr) {
+        return false;
+    }
+    if (m_n_frames_in_queue == 0 || m_memory_budget == 0) {
+        return true;
+    }
+    // frames being loaded do not have their memory accounted yet, the largest frame loaded so far is used as an estimate
+    return m_memory_in_queue + (m_n_frames_loading + 1)*m_last_frame_memory <= m_memory_budget;
+};
+
+size_t FramePrefetcher::get_memory_usage(const InputFrameReader &reader)    {
+    const size_t n_pixels = size_t(reader.get_width())*reader.get_height();
+    return n_pixels*sizeof(PixelType)*(reader.is_raw_file_before_debayering() ? 1 : 3);
+};
@@ -0,0 +1,151 @@
+#include "../headers/FusedCalibration.h"
+#include "../headers/CpuFeatures.h"
+#include "../headers/Common.h"
+#include "../headers/SharedInstanceCache.hxx"
+
+#include <stdexcept>
+#include <limits>
+#include <algorithm>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+namespace {
+    using CalibrationFramesStamp = std::vector<std::weak_ptr<const CalibrationFrameBase>>;
+
+    // the cached entry is valid only if it was created from the same calibration frames - a new frame could have been allocated at the address of a destroyed one,
+    // but it cannot share the control block with the weak pointer of the destroyed frame
+    struct CalibrationFramesStampMatch {
+        bool operator()(const CalibrationFramesStamp &a, const CalibrationFramesStamp &b) const {
+            if (a.size() != b.size()) {
+                return false;
+            }
+            for (size_t i_frame = 0; i_frame < a.size(); i_frame++) {
+                if (a[i_frame].owner_before(b[i_frame]) || b[i_frame].owner_before(a[i_frame])) {
+                    return false;
+                }
+            }
+            return true;
+        };
+    };
+}
+
+void AstroPhotoStacker::apply_fused_calibration_kernel_scalar(const float *offsets, const float *scales, PixelType *data, std::size_t n_pixels)    {
+    constexpr float max_value = std::numeric_limits<PixelType>::max();
+    for (size_t i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+        const float value = (float(data[i_pixel]) - offsets[i_pixel])*scales[i_pixel];
+        data[i_pixel] = force_range<float>(value, 0, max_value);
+    }
+};
+
+#ifdef ASTRO_PHOTO_STACKER_AVX2_KERNELS
+
+namespace {
+    __attribute__((target("avx2")))
+    inline __m256i calibrate_8_values(__m128i values_16bit, const float *offsets, const float *scales)  {
+        const __m256 zero       = _mm256_setzero_ps();
+        const __m256 max_value  = _mm256_set1_ps(std::numeric_limits<PixelType>::max());
+
+        const __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(values_16bit));
+        __m256 result = _mm256_mul_ps(_mm256_sub_ps(values, _mm256_loadu_ps(offsets)), _mm256_loadu_ps(scales));
+        // NaN is mapped to the maximal value, as in the scalar implementation
+        result = _mm256_max_ps(_mm256_min_ps(result, max_value), zero);
+        return _mm256_cvttps_epi32(result);
+    };
+
+    __attribute__((target("avx2")))
+    void apply_fused_calibration_kernel_avx2(const float *offsets, const float *scales, PixelType *data, std::size_t n_pixels)  {
+        size_t i_pixel = 0;
+        for (; i_pixel + 16 <= n_pixels; i_pixel += 16) {
+            const __m256i values_16bit = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data[i_pixel]));
+            const __m256i result_low  = calibrate_8_values(_mm256_castsi256_si128(values_16bit), &offsets[i_pixel], &scales[i_pixel]);
+            const __m256i result_high = calibrate_8_values(_mm256_extracti128_si256(values_16bit, 1), &offsets[i_pixel + 8], &scales[i_pixel + 8]);
+            // packing works within 128-bit lanes, the permutation restores the order of the values
+            const __m256i result = _mm256_permute4x64_epi64(_mm256_packs_epi32(result_low, result_high), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&data[i_pixel]), result);
+        }
+        apply_fused_calibration_kernel_scalar(&offsets[i_pixel], &scales[i_pixel], &data[i_pixel], n_pixels - i_pixel);
+    };
+}
+
+#endif
+
+void AstroPhotoStacker::apply_fused_calibration_kernel(const float *offsets, const float *scales, PixelType *data, std::size_t n_pixels)   {
+#ifdef ASTRO_PHOTO_STACKER_AVX2_KERNELS
+    if (cpu_supports_avx2()) {
+        apply_fused_calibration_kernel_avx2(offsets, scales, data, n_pixels);
+        return;
+    }
+#endif
+    apply_fused_calibration_kernel_scalar(offsets, scales, data, n_pixels);
+};
+
+FusedCalibration::FusedCalibration(const std::vector<std::shared_ptr<const CalibrationFrameBase>> &calibration_frames)  {
+    if (calibration_frames.empty()) {
+        throw runtime_error("FusedCalibration: no calibration frames provided");
+    }
+    m_width  = calibration_frames[0]->get_width();
+    m_height = calibration_frames[0]->get_height();
+    const size_t n_pixels = size_t(m_width)*m_height;
+
+    m_offsets   = allocate_aligned_buffer(n_pixels, 0);
+    m_scales    = allocate_aligned_buffer(n_pixels, 1);
+    for (const std::shared_ptr<const CalibrationFrameBase> &calibration_frame : calibration_frames) {
+        if (calibration_frame->get_width() != m_width || calibration_frame->get_height() != m_height) {
+            throw runtime_error("FusedCalibration: calibration frames have different resolutions");
+        }
+        if (!calibration_frame->add_to_fused_calibration(m_offsets.get(), m_scales.get())) {
+            throw runtime_error("FusedCalibration: calibration frame does not support the fused calibration");
+        }
+    }
+};
+
+std::shared_ptr<const FusedCalibration> FusedCalibration::get_instance(const std::vector<std::shared_ptr<const CalibrationFrameBase>> &calibration_frames)  {
+    if (calibration_frames.empty()) {
+        return nullptr;
+    }
+    for (const std::shared_ptr<const CalibrationFrameBase> &calibration_frame : calibration_frames) {
+        if (!calibration_frame->supports_fused_calibration()) {
+            return nullptr;
+        }
+    }
+
+    // the merged frames are as large as the light frames, so they are created under the lock - the threads calibrating the first frames wait for one instance instead of creating their own
+    static SharedInstanceCache<std::vector<const CalibrationFrameBase*>, FusedCalibration, CalibrationFramesStamp, CalibrationFramesStampMatch> s_cache(c_max_cached_instances, false);
+
+    vector<const CalibrationFrameBase*> key;
+    for (const std::shared_ptr<const CalibrationFrameBase> &calibration_frame : calibration_frames) {
+        key.push_back(calibration_frame.get());
+    }
+    const CalibrationFramesStamp stamp(calibration_frames.begin(), calibration_frames.end());
+
+    return s_cache.get_instance(key, stamp, [&calibration_frames]() {
+        return make_shared<const FusedCalibration>(calibration_frames);
+    });
+};
+
+void FusedCalibration::apply_calibration(std::vector<PixelType> *data, int y_min, int y_max) const {
+    if (data->size() != size_t(m_width)*m_height) {
+        throw runtime_error("FusedCalibration::apply_calibration: size of the data does not match the size of the calibration frame");
+    }
+
+    y_min = max(y_min, 0);
+    y_max = y_max < 0 ? m_height : min(y_max, m_height);
+    if (y_min >= y_max) {
+        return;
+    }
+    const size_t first_pixel = size_t(y_min)*m_width;
+    const size_t n_pixels = size_t(y_max - y_min)*m_width;
+    apply_fused_calibration_kernel(&m_offsets[first_pixel], &m_scales[first_pixel], data->data() + first_pixel, n_pixels);
+};
+
+FusedCalibration::AlignedBuffer FusedCalibration::allocate_aligned_buffer(std::size_t size, float value)    {
+    // aligned_alloc requires the size to be a multiple of the alignment
+    const size_t size_in_bytes = ((size*sizeof(float) + c_buffer_alignment - 1)/c_buffer_alignment)*c_buffer_alignment;
+    float *buffer = static_cast<float*>(std::aligned_alloc(c_buffer_alignment, max(size_in_bytes, c_buffer_alignment)));
+    if (buffer == nullptr) {
+        throw runtime_error("FusedCalibration: unable to allocate memory for the calibration frames");
+    }
+    std::fill(buffer, buffer + size, value);
+    return AlignedBuffer(buffer);
+};
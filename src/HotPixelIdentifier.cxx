@@ -38,7 +38,7 @@ void HotPixelIdentifier::add_photo(const InputFrame &input_frame)    {
 };
 
 void HotPixelIdentifier::add_photo(const PixelType *pixel_value_array, int width, int height, int image_bit_depth) {
-    const auto hot_pixel_candidates = get_hot_pixel_candidates_from_photo(pixel_value_array, width, height, image_bit_depth);
+    const auto hot_pixel_candidates = get_hot_pixel_candidates_from_photo(pixel_value_array, width, height, image_bit_depth, m_n_cpu);
     {
         scoped_lock lock(m_mutex);
         for (const auto &hot_pixel_candidate : hot_pixel_candidates) {
@@ -62,9 +62,9 @@ void HotPixelIdentifier::compute_hot_pixels()   {
         const int hot_pixel_candidate_value = hot_pixel_candidate.second;
         if (hot_pixel_candidate_value > m_n_photos_processed*0.5) {
             m_hot_pixels.push_back(hot_pixel_candidate_coordinates);
-            m_hot_pixels_map[hot_pixel_candidate_coordinates] = 1;
         }
     }
+    update_hot_pixels_index();
 };
 
 
@@ -72,43 +72,97 @@ const vector<tuple<int,int>> &HotPixelIdentifier::get_hot_pixels() const   {
     return m_hot_pixels;
 };
 
-std::map<std::tuple<int,int>,int> HotPixelIdentifier::get_hot_pixel_candidates_from_photo(const PixelType *pixel_value_array, int width, int height, int image_bit_depth) {
-    std::map<std::tuple<int,int>, int> hot_pixel_candidates;
+unsigned long long HotPixelIdentifier::get_hot_pixels_checksum() const  {
+    vector<tuple<int,int>> hot_pixels_sorted = m_hot_pixels;
+    sort(hot_pixels_sorted.begin(), hot_pixels_sorted.end());
+
+    unsigned long long checksum = 14695981039346656037ULL;
+    for (const tuple<int,int> &hot_pixel : hot_pixels_sorted) {
+        const int coordinates[2] = {get<0>(hot_pixel), get<1>(hot_pixel)};
+        const unsigned char *bytes = reinterpret_cast<const unsigned char*>(coordinates);
+        for (size_t i = 0; i < sizeof(coordinates); i++) {
+            checksum = (checksum ^ bytes[i]) * 1099511628211ULL;
+        }
+    }
+    return checksum;
+};
+
+std::map<std::tuple<int,int>,int> HotPixelIdentifier::get_hot_pixel_candidates_from_photo(const PixelType *pixel_value_array, int width, int height, int image_bit_depth, unsigned int n_cpu) {
     const int max_value = pow(2, image_bit_depth)-1;
-    int hot_pixel_threshold = 0.8*max_value;
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            const int current_pixel_index = y*width + x;
-            const int current_pixel_value = pixel_value_array[current_pixel_index];
-            if (current_pixel_value < hot_pixel_threshold) {
+    const int hot_pixel_threshold = 0.8*max_value;
+
+    auto is_isolated_bright_pixel = [pixel_value_array, width, height](int x, int y) {
+        const int current_pixel_index = y*width + x;
+        const int current_pixel_value = pixel_value_array[current_pixel_index];
+        for (int i_shift_y = -1; i_shift_y <= 1; i_shift_y++) {
+            const int neighbor_y = y + i_shift_y;
+            if (neighbor_y < 0 || neighbor_y >= height) {
                 continue;
             }
+            for (int i_shift_x = -1; i_shift_x <= 1; i_shift_x++) {
+                if (i_shift_x == 0 && i_shift_y == 0) {
+                    continue;
+                }
+                const int neighbor_x = x + i_shift_x;
+                if (neighbor_x < 0 || neighbor_x >= width) {
+                    continue;
+                }
+                const int neighbor_pixel_value = pixel_value_array[current_pixel_index + i_shift_x + i_shift_y*width];
+                if (neighbor_pixel_value > current_pixel_value*0.52) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
 
-            bool is_hot_pixel = true;
-            for (int i_shift_y = -1; i_shift_y <= 1; i_shift_y++) {
-                const int neighbor_y = y + i_shift_y;
-                if (neighbor_y < 0 || neighbor_y >= height) {
+    auto find_candidates_in_lines = [&](int y_begin, int y_end, vector<tuple<int,int>> *candidates) {
+        constexpr int block_size = 64;
+        for (int y = y_begin; y < y_end; y++) {
+            const PixelType *row = &pixel_value_array[size_t(y)*width];
+            for (int x_block = 0; x_block < width; x_block += block_size) {
+                const int x_block_end = min(x_block + block_size, width);
+
+                // almost all blocks contain no bright pixel - check the whole block at once (the loop is vectorised by the compiler)
+                bool contains_bright_pixel = false;
+                for (int x = x_block; x < x_block_end; x++) {
+                    contains_bright_pixel |= row[x] >= hot_pixel_threshold;
+                }
+                if (!contains_bright_pixel) {
                     continue;
                 }
-                for (int i_shift_x = -1; i_shift_x <= 1; i_shift_x++) {
-                    if (i_shift_x == 0 && i_shift_y == 0) {
-                        continue;
-                    }
-                    const int neighbor_x = x + i_shift_x;
-                    if (neighbor_x < 0 || neighbor_x >= width) {
-                        continue;
-                    }
-                    const int neighbor_pixel_index = current_pixel_index + i_shift_x + i_shift_y*width;
-                    const int neighbor_pixel_value = pixel_value_array[neighbor_pixel_index];
-                    if (neighbor_pixel_value > current_pixel_value*0.52) {
-                        is_hot_pixel = false;
-                        break;
+
+                for (int x = x_block; x < x_block_end; x++) {
+                    if (row[x] >= hot_pixel_threshold && is_isolated_bright_pixel(x, y)) {
+                        candidates->push_back(std::make_tuple(x,y));
                     }
                 }
             }
-            if (is_hot_pixel) {
-                hot_pixel_candidates[std::make_tuple(x,y)] = 1;
-            }
+        }
+    };
+
+    const int n_blocks = n_cpu > 1 ? min<int>(height, 4*n_cpu) : 1;
+    const int lines_per_block = n_blocks > 0 ? (height + n_blocks - 1)/n_blocks : 0;
+    vector<vector<tuple<int,int>>> candidates_in_blocks(n_blocks);
+    if (n_blocks > 1) {
+        TaskScheduler pool({size_t(n_cpu)});
+        for (int i_block = 0; i_block < n_blocks; i_block++) {
+            const int y_begin = i_block*lines_per_block;
+            const int y_end = min(y_begin + lines_per_block, height);
+            pool.submit([&find_candidates_in_lines, &candidates_in_blocks, i_block, y_begin, y_end]() {
+                find_candidates_in_lines(y_begin, y_end, &candidates_in_blocks[i_block]);
+            }, {1});
+        }
+        pool.wait_for_tasks();
+    }
+    else if (n_blocks == 1) {
+        find_candidates_in_lines(0, height, &candidates_in_blocks[0]);
+    }
+
+    std::map<std::tuple<int,int>, int> hot_pixel_candidates;
+    for (const vector<tuple<int,int>> &candidates : candidates_in_blocks) {
+        for (const tuple<int,int> &candidate : candidates) {
+            hot_pixel_candidates[candidate] = 1;
         }
     }
     return hot_pixel_candidates;
@@ -126,7 +180,6 @@ void HotPixelIdentifier::save_hot_pixels_to_file(const std::string &file_address
 
 void HotPixelIdentifier::load_hot_pixels_from_file(const std::string &file_address) {
     m_hot_pixels.clear();
-    m_hot_pixels_map.clear();
     ifstream input_file(file_address);
     if (!input_file.is_open()) {
         throw runtime_error("Could not open file " + file_address);
@@ -140,9 +193,9 @@ void HotPixelIdentifier::load_hot_pixels_from_file(const std::string &file_addre
         const int x = stoi(elements[0]);
         const int y = stoi(elements[1]);
         m_hot_pixels.push_back(std::make_tuple(x,y));
-        m_hot_pixels_map[std::make_tuple(x,y)] = 1;
     }
     input_file.close();
+    update_hot_pixels_index();
 };
 
 void HotPixelIdentifier::set_n_cpu(unsigned int n_cpu) {
@@ -151,13 +204,122 @@ void HotPixelIdentifier::set_n_cpu(unsigned int n_cpu) {
 
 void HotPixelIdentifier::set_hot_pixels(const std::vector<std::tuple<int,int>> &hot_pixels) {
     m_hot_pixels = hot_pixels;
-    for (const tuple<int,int> &hot_pixel : hot_pixels)  {
-        m_hot_pixels_map[hot_pixel] = 1;
-    }
+    update_hot_pixels_index();
 };
 
 bool HotPixelIdentifier::is_hot_pixel(int x, int y) const   {
-    return m_hot_pixels_map.find(std::make_tuple(x,y)) != m_hot_pixels_map.end();
+    if (x < 0 || y < 0 || x >= m_bitmap_width || y >= m_bitmap_height) {
+        return false;
+    }
+    const size_t bit_index = size_t(y)*m_bitmap_width + x;
+    return (m_hot_pixels_bitmap[bit_index/64] >> (bit_index%64)) & 1;
+};
+
+std::vector<std::tuple<int,int>> HotPixelIdentifier::get_hot_pixels_in_lines(int y_min, int y_max) const  {
+    auto compare_y = [](const tuple<int,int> &hot_pixel, int y) { return get<1>(hot_pixel) < y; };
+    const auto begin = lower_bound(m_hot_pixels_sorted.begin(), m_hot_pixels_sorted.end(), y_min, compare_y);
+    const auto end   = lower_bound(begin, m_hot_pixels_sorted.end(), y_max, compare_y);
+    return vector<tuple<int,int>>(begin, end);
+};
+
+void HotPixelIdentifier::fix_hot_pixels(std::vector<PixelType> *data, int width, int height, const std::array<char, 4> &bayer_pattern, int y_min, int y_max) const {
+    // weights (1 for the same color, 0 otherwise) of the 3x3 and 5x5 neighborhood, for each position in the Bayer pattern
+    struct SameColorMask {
+        std::array<int, 25> weights;
+        int n_same_color_neighbors;
+    };
+    std::array<std::array<SameColorMask, 2>, 4> masks;
+    for (int bayer_index = 0; bayer_index < 4; bayer_index++) {
+        const int bayer_x = bayer_index%2;
+        const int bayer_y = bayer_index/2;
+        for (int shift_size = 1; shift_size <= 2; shift_size++) {
+            SameColorMask &mask = masks[bayer_index][shift_size-1];
+            mask.weights.fill(0);
+            mask.n_same_color_neighbors = 0;
+            for (int i_shift_y = -shift_size; i_shift_y <= shift_size; i_shift_y++) {
+                for (int i_shift_x = -shift_size; i_shift_x <= shift_size; i_shift_x++) {
+                    const int neighbor_bayer_index = ((bayer_y + i_shift_y) & 1)*2 + ((bayer_x + i_shift_x) & 1);
+                    if ((i_shift_x != 0 || i_shift_y != 0) && bayer_pattern[neighbor_bayer_index] == bayer_pattern[bayer_index]) {
+                        mask.weights[(i_shift_y+2)*5 + i_shift_x+2] = 1;
+                        mask.n_same_color_neighbors++;
+                    }
+                }
+            }
+        }
+    }
+
+    // pixels at the border - only the neighbors inside of the photo are used
+    auto fix_border_pixel = [data, width, height, &bayer_pattern](int x, int y) {
+        int n_same_color_neighbors = 0;
+        int new_value = 0;
+        const int color_this_pixel = bayer_pattern[(y%2)*2 + x%2];
+        for (int shift_size = 1; shift_size <= 2; shift_size++) {
+            for (int neighbor_y = max(y - shift_size, 0); neighbor_y <= min(y + shift_size, height-1); neighbor_y++) {
+                for (int neighbor_x = max(x - shift_size, 0); neighbor_x <= min(x + shift_size, width-1); neighbor_x++) {
+                    if ((neighbor_x != x || neighbor_y != y) && bayer_pattern[(neighbor_y%2)*2 + neighbor_x%2] == color_this_pixel) {
+                        n_same_color_neighbors++;
+                        new_value += (*data)[neighbor_y*width + neighbor_x];
+                    }
+                }
+            }
+            if (n_same_color_neighbors != 0) {
+                (*data)[y*width + x] = new_value/n_same_color_neighbors;
+                return;
+            }
+        }
+    };
+
+    // hot pixels are fixed in the row-major order, so the already fixed pixels are used for the following ones
+    for (const tuple<int,int> &hot_pixel : get_hot_pixels_in_lines(y_min, y_max)) {
+        const int x = get<0>(hot_pixel);
+        const int y = get<1>(hot_pixel);
+        if (x < 2 || y < 2 || x >= width-2 || y >= height-2) {
+            if (x >= 0 && x < width && y >= 0 && y < height) {
+                fix_border_pixel(x, y);
+            }
+            continue;
+        }
+
+        const PixelType *neighborhood = &(*data)[size_t(y-2)*width + x-2];
+        const int bayer_index = (y%2)*2 + x%2;
+        for (const SameColorMask &mask : masks[bayer_index]) {
+            if (mask.n_same_color_neighbors == 0) {
+                continue;
+            }
+            int sum = 0;
+            for (int i_row = 0; i_row < 5; i_row++) {
+                for (int i_column = 0; i_column < 5; i_column++) {
+                    sum += mask.weights[i_row*5 + i_column]*neighborhood[i_row*width + i_column];
+                }
+            }
+            (*data)[size_t(y)*width + x] = sum/mask.n_same_color_neighbors;
+            break;
+        }
+    }
+};
+
+void HotPixelIdentifier::update_hot_pixels_index()  {
+    m_hot_pixels_sorted = m_hot_pixels;
+    sort(m_hot_pixels_sorted.begin(), m_hot_pixels_sorted.end(), [](const tuple<int,int> &a, const tuple<int,int> &b) {
+        return make_tuple(get<1>(a), get<0>(a)) < make_tuple(get<1>(b), get<0>(b));
+    });
+    m_hot_pixels_sorted.erase(unique(m_hot_pixels_sorted.begin(), m_hot_pixels_sorted.end()), m_hot_pixels_sorted.end());
+
+    m_bitmap_width = 0;
+    m_bitmap_height = 0;
+    for (const tuple<int,int> &hot_pixel : m_hot_pixels_sorted) {
+        m_bitmap_width  = max(m_bitmap_width,  get<0>(hot_pixel) + 1);
+        m_bitmap_height = max(m_bitmap_height, get<1>(hot_pixel) + 1);
+    }
+    m_hot_pixels_bitmap = vector<uint64_t>((size_t(m_bitmap_width)*m_bitmap_height + 63)/64, 0);
+    for (const tuple<int,int> &hot_pixel : m_hot_pixels_sorted) {
+        const int x = get<0>(hot_pixel);
+        const int y = get<1>(hot_pixel);
+        if (x >= 0 && y >= 0) {
+            const size_t bit_index = size_t(y)*m_bitmap_width + x;
+            m_hot_pixels_bitmap[bit_index/64] |= uint64_t(1) << (bit_index%64);
+        }
+    }
 };
 
 const std::atomic<int>& HotPixelIdentifier::get_number_of_processed_photos() const  {
@@ -5,6 +5,7 @@
 #include "../headers/RawFileReaderFactory.h"
 
 #include "../headers/Debayring.h"
+#include "../headers/DecodedFrameCache.h"
 
 using namespace AstroPhotoStacker;
 using namespace std;
@@ -23,6 +24,23 @@ void InputFrameReader::load_input_frame_data() {
     if (m_data_are_loaded) {
         return;
     }
+
+    DecodedFrameCache &decoded_frame_cache = DecodedFrameCache::get_global_instance();
+    if (decoded_frame_cache.is_enabled()) {
+        const shared_ptr<const DecodedFrame> cached_frame = decoded_frame_cache.get(m_input_frame, DecodedFrameCache::DataType::frame_data);
+        if (cached_frame != nullptr) {
+            m_width                     = cached_frame->width;
+            m_height                    = cached_frame->height;
+            m_bayer_pattern             = cached_frame->bayer_pattern;
+            m_metadata                  = cached_frame->metadata;
+            m_shared_frame              = cached_frame;
+            m_is_raw_before_debayering  = cached_frame->is_raw;
+            m_is_raw_file               = cached_frame->is_raw;
+            m_data_are_loaded = true;
+            return;
+        }
+    }
+
     if (m_is_raw_before_debayering) {
         read_raw();
     }
@@ -30,6 +48,10 @@ void InputFrameReader::load_input_frame_data() {
         read_non_raw();
     }
     m_data_are_loaded = true;
+
+    if (decoded_frame_cache.is_enabled()) {
+        store_in_cache();
+    }
 };
 
 bool InputFrameReader::data_are_loaded() const {
@@ -59,7 +81,7 @@ bool InputFrameReader::is_raw_file_before_debayering() const {
     return m_is_raw_before_debayering;
 };
 
-void InputFrameReader::debayer() {
+void InputFrameReader::debayer(int y_min, int y_max) {
     if (!m_is_raw_file) {
         return;
     }
@@ -70,9 +92,11 @@ void InputFrameReader::debayer() {
         return;
     }
 
-    m_rgb_data = debayer_raw_data(m_raw_data, m_width, m_height, m_bayer_pattern);
+    m_rgb_data = debayer_raw_data(raw_data(), m_width, m_height, m_bayer_pattern, y_min, y_max);
     m_raw_data.clear();
+    m_shared_frame = nullptr;
     m_is_raw_before_debayering = false;
+    m_data_are_modified = true;
 };
 
 
@@ -80,32 +104,66 @@ const std::vector<std::vector<PixelType>>& InputFrameReader::get_rgb_data() {
     if (!m_data_are_loaded) {
         load_input_frame_data();
     }
-    return m_rgb_data;
+    return rgb_data();
+};
+
+const std::vector<PixelType> &InputFrameReader::get_raw_data() const {
+    return raw_data();
+};
+
+std::vector<PixelType>& InputFrameReader::get_raw_data_non_const() {
+    detach_from_shared_frame();
+    m_data_are_modified = true;
+    return m_raw_data;
 };
 
 std::vector<PixelType> InputFrameReader::get_monochrome_data() {
+    DecodedFrameCache &decoded_frame_cache = DecodedFrameCache::get_global_instance();
+    const bool use_cache = decoded_frame_cache.is_enabled() && !m_data_are_modified;
+    if (use_cache) {
+        const shared_ptr<const DecodedFrame> cached_frame = decoded_frame_cache.get(m_input_frame, DecodedFrameCache::DataType::monochrome);
+        if (cached_frame != nullptr) {
+            if (!m_data_are_loaded) {
+                m_width  = cached_frame->width;
+                m_height = cached_frame->height;
+            }
+            return cached_frame->raw_data;
+        }
+    }
+
     if (!m_data_are_loaded) {
         load_input_frame_data();
     }
 
-    if (m_raw_data.size() > 0) {
-        std::vector<PixelType> debayered_data = m_raw_data;
-        debayer_monochrome(&debayered_data, m_width, m_height, m_bayer_pattern);
-        return debayered_data;
+    const std::vector<PixelType> &raw = raw_data();
+    const std::vector<std::vector<PixelType>> &rgb = rgb_data();
+    std::vector<PixelType> result;
+    if (raw.size() > 0) {
+        result = raw;
+        debayer_monochrome(&result, m_width, m_height, m_bayer_pattern);
     }
-
-    if (m_rgb_data.size()== 0) {
-        return {};
+    else if (rgb.size() > 0) {
+        result = std::vector<PixelType>(rgb[0].size(), 0);
+        const int n_channels = rgb.size();
+        for (size_t i = 0; i < rgb[0].size(); i++) {
+            int value = 0;
+            for (int c = 0; c < n_channels; c++) {
+                value += static_cast<int>(rgb[c][i]);
+            }
+            result[i] = value / n_channels;
+        }
     }
 
-    std::vector<PixelType> result(m_rgb_data[0].size(), 0);
-    const int n_channels = m_rgb_data.size();
-    for (size_t i = 0; i < m_rgb_data[0].size(); i++) {
-        int value = 0;
-        for (int c = 0; c < n_channels; c++) {
-            value += static_cast<int>(m_rgb_data[c][i]);
+    if (use_cache && !result.empty()) {
+        shared_ptr<DecodedFrame> monochrome_frame = make_shared<DecodedFrame>();
+        monochrome_frame->width     = m_width;
+        monochrome_frame->height    = m_height;
+        monochrome_frame->metadata  = m_metadata;
+        monochrome_frame->raw_data  = std::move(result);
+        if (decoded_frame_cache.put(m_input_frame, DecodedFrameCache::DataType::monochrome, monochrome_frame)) {
+            return monochrome_frame->raw_data;
         }
-        result[i] = value / n_channels;
+        return std::move(monochrome_frame->raw_data);
     }
     return result;
 };
@@ -124,9 +182,9 @@ PixelType InputFrameReader::get_pixel_value(int x, int y, int channel) const {
         if (m_bayer_pattern[bayer_index] != channel) {
             return -1;
         }
-        return m_raw_data[x + y * m_width];
+        return raw_data()[x + y * m_width];
     }
-    return m_rgb_data[channel][x + y * m_width];
+    return rgb_data()[channel][x + y * m_width];
 }
 
 PixelType InputFrameReader::get_pixel_value(int pixel_index, int channel) const   {
@@ -135,15 +193,18 @@ PixelType InputFrameReader::get_pixel_value(int pixel_index, int channel) const
         if (m_bayer_pattern[bayer_index] != channel) {
             return -1;
         }
-        return m_raw_data[pixel_index];
+        return raw_data()[pixel_index];
     }
-    if (channel >= static_cast<int>(m_rgb_data.size())) {
+    const std::vector<std::vector<PixelType>> &rgb = rgb_data();
+    if (channel >= static_cast<int>(rgb.size())) {
         return -1;
     }
-    return m_rgb_data[channel][pixel_index];
+    return rgb[channel][pixel_index];
 };
 
 std::vector<std::vector<PixelType>*> InputFrameReader::get_all_data_for_calibration() {
+    detach_from_shared_frame();
+    m_data_are_modified = true;
     vector<vector<PixelType>*> result;
     const unsigned int resolution = m_width * m_height;
     if (m_raw_data.size() == resolution) {
@@ -178,3 +239,40 @@ void InputFrameReader::read_non_raw() {
     m_is_raw_file = false;
 };
 
+void InputFrameReader::store_in_cache()   {
+    // the decoded data are moved into the frame shared with the cache, the reader then reads them from there - if the cache does not take the frame, they are moved back
+    shared_ptr<DecodedFrame> decoded_frame = make_shared<DecodedFrame>();
+    decoded_frame->width            = m_width;
+    decoded_frame->height           = m_height;
+    decoded_frame->is_raw           = m_is_raw_before_debayering;
+    decoded_frame->bayer_pattern    = m_bayer_pattern;
+    decoded_frame->metadata         = m_metadata;
+    decoded_frame->raw_data         = std::move(m_raw_data);
+    decoded_frame->rgb_data         = std::move(m_rgb_data);
+    m_raw_data.clear();
+    m_rgb_data.clear();
+    if (DecodedFrameCache::get_global_instance().put(m_input_frame, DecodedFrameCache::DataType::frame_data, decoded_frame)) {
+        m_shared_frame = decoded_frame;
+    }
+    else {
+        m_raw_data = std::move(decoded_frame->raw_data);
+        m_rgb_data = std::move(decoded_frame->rgb_data);
+    }
+};
+
+const std::vector<PixelType> &InputFrameReader::raw_data() const {
+    return m_shared_frame != nullptr ? m_shared_frame->raw_data : m_raw_data;
+};
+
+const std::vector<std::vector<PixelType>> &InputFrameReader::rgb_data() const {
+    return m_shared_frame != nullptr ? m_shared_frame->rgb_data : m_rgb_data;
+};
+
+void InputFrameReader::detach_from_shared_frame() {
+    if (m_shared_frame == nullptr) {
+        return;
+    }
+    m_raw_data = m_shared_frame->raw_data;
+    m_rgb_data = m_shared_frame->rgb_data;
+    m_shared_frame = nullptr;
+};
@@ -0,0 +1,194 @@
+#include "../headers/KappaSigmaClippingKernel.h"
+#include "../headers/CpuFeatures.h"
+
+#include <cmath>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+void AstroPhotoStacker::apply_kappa_sigma_clipping_to_block_scalar( const PixelType *values,
+                                                                    std::uint8_t *valid_mask,
+                                                                    unsigned int n_values,
+                                                                    double kappa,
+                                                                    int n_iterations,
+                                                                    double *sums_of_kept_values,
+                                                                    unsigned int *numbers_of_kept_values)   {
+
+    constexpr unsigned int block_size = c_kappa_sigma_block_size;
+    for (unsigned int i_column = 0; i_column < block_size; i_column++) {
+        const uint8_t column_bit = 1 << i_column;
+
+        // sums are updated incrementally when values are clipped, they are exact, since the values are integers
+        double sum(0), sum2(0);
+        unsigned int n_kept = 0;
+        for (unsigned int i_value = 0; i_value < n_values; i_value++) {
+            if (valid_mask[i_value] & column_bit) {
+                const double value = values[i_value*block_size + i_column];
+                sum  += value;
+                sum2 += value*value;
+                n_kept++;
+            }
+        }
+
+        for (int i_iter = 0; i_iter < n_iterations && n_kept > 0; i_iter++) {
+            const double mean  = sum/n_kept;
+            const double mean2 = sum2/n_kept;
+            const double kappa_sigma = kappa*sqrt(mean2 - mean*mean);
+
+            unsigned int n_clipped = 0;
+            for (unsigned int i_value = 0; i_value < n_values; i_value++) {
+                if (!(valid_mask[i_value] & column_bit)) {
+                    continue;
+                }
+                const double value = values[i_value*block_size + i_column];
+                if (abs(value - mean) > kappa_sigma) {
+                    sum  -= value;
+                    sum2 -= value*value;
+                    valid_mask[i_value] &= ~column_bit;
+                    n_clipped++;
+                }
+            }
+
+            // nothing has been clipped -> mean and sigma would not change in the next iterations
+            if (n_clipped == 0) {
+                break;
+            }
+            n_kept -= n_clipped;
+        }
+
+        sums_of_kept_values[i_column]       = sum;
+        numbers_of_kept_values[i_column]    = n_kept;
+    }
+};
+
+#ifdef ASTRO_PHOTO_STACKER_AVX2_KERNELS
+
+namespace {
+    /**
+     * @brief Expand 4 bits of the validity bitmap into a mask of 4 double lanes
+     */
+    __attribute__((target("avx2")))
+    inline __m256d expand_mask_bits(uint8_t bits)    {
+        const __m256i lane_bits = _mm256_setr_epi64x(1, 2, 4, 8);
+        const __m256i broadcast = _mm256_set1_epi64x(bits);
+        return _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(broadcast, lane_bits), lane_bits));
+    };
+
+    /**
+     * @brief Load 8 values of one row of the block and convert them to two vectors of 4 doubles
+     */
+    __attribute__((target("avx2")))
+    inline void load_row(const PixelType *row, __m256d *values_low, __m256d *values_high)  {
+        const __m128i values_16bit = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row));
+        *values_low  = _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(values_16bit));
+        *values_high = _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(_mm_srli_si128(values_16bit, 8)));
+    };
+
+    __attribute__((target("avx2")))
+    void apply_kappa_sigma_clipping_to_block_avx2(  const PixelType *values,
+                                                    uint8_t *valid_mask,
+                                                    unsigned int n_values,
+                                                    double kappa,
+                                                    int n_iterations,
+                                                    double *sums_of_kept_values,
+                                                    unsigned int *numbers_of_kept_values)   {
+
+        static_assert(c_kappa_sigma_block_size == 8, "AVX2 kappa-sigma kernel expects 8 columns per block");
+
+        const __m256d ones = _mm256_set1_pd(1.0);
+        const __m256d sign_bit = _mm256_set1_pd(-0.0);
+
+        // columns 0-3 are in the "low" vectors, columns 4-7 in the "high" vectors
+        __m256d sum_low  = _mm256_setzero_pd(), sum_high  = _mm256_setzero_pd();
+        __m256d sum2_low = _mm256_setzero_pd(), sum2_high = _mm256_setzero_pd();
+        __m256d n_low    = _mm256_setzero_pd(), n_high    = _mm256_setzero_pd();
+
+        for (unsigned int i_value = 0; i_value < n_values; i_value++) {
+            __m256d values_low, values_high;
+            load_row(&values[i_value*8], &values_low, &values_high);
+            const __m256d mask_low  = expand_mask_bits(valid_mask[i_value] & 0xF);
+            const __m256d mask_high = expand_mask_bits(valid_mask[i_value] >> 4);
+
+            const __m256d masked_low  = _mm256_and_pd(values_low, mask_low);
+            const __m256d masked_high = _mm256_and_pd(values_high, mask_high);
+            sum_low   = _mm256_add_pd(sum_low,  masked_low);
+            sum_high  = _mm256_add_pd(sum_high, masked_high);
+            sum2_low  = _mm256_add_pd(sum2_low,  _mm256_mul_pd(masked_low, masked_low));
+            sum2_high = _mm256_add_pd(sum2_high, _mm256_mul_pd(masked_high, masked_high));
+            n_low     = _mm256_add_pd(n_low,  _mm256_and_pd(ones, mask_low));
+            n_high    = _mm256_add_pd(n_high, _mm256_and_pd(ones, mask_high));
+        }
+
+        for (int i_iter = 0; i_iter < n_iterations; i_iter++) {
+            // columns without values get NaN mean and sigma, comparisons with NaN are false, so nothing is clipped there
+            const __m256d mean_low   = _mm256_div_pd(sum_low, n_low);
+            const __m256d mean_high  = _mm256_div_pd(sum_high, n_high);
+            const __m256d mean2_low  = _mm256_div_pd(sum2_low, n_low);
+            const __m256d mean2_high = _mm256_div_pd(sum2_high, n_high);
+            const __m256d kappa_sigma_low  = _mm256_mul_pd(_mm256_set1_pd(kappa), _mm256_sqrt_pd(_mm256_sub_pd(mean2_low,  _mm256_mul_pd(mean_low,  mean_low))));
+            const __m256d kappa_sigma_high = _mm256_mul_pd(_mm256_set1_pd(kappa), _mm256_sqrt_pd(_mm256_sub_pd(mean2_high, _mm256_mul_pd(mean_high, mean_high))));
+
+            uint8_t any_clipped = 0;
+            for (unsigned int i_value = 0; i_value < n_values; i_value++) {
+                const uint8_t row_mask = valid_mask[i_value];
+                if (row_mask == 0) {
+                    continue;
+                }
+                __m256d values_low, values_high;
+                load_row(&values[i_value*8], &values_low, &values_high);
+
+                const __m256d distance_low  = _mm256_andnot_pd(sign_bit, _mm256_sub_pd(values_low, mean_low));
+                const __m256d distance_high = _mm256_andnot_pd(sign_bit, _mm256_sub_pd(values_high, mean_high));
+                const __m256d clipped_low   = _mm256_and_pd(_mm256_cmp_pd(distance_low,  kappa_sigma_low,  _CMP_GT_OQ), expand_mask_bits(row_mask & 0xF));
+                const __m256d clipped_high  = _mm256_and_pd(_mm256_cmp_pd(distance_high, kappa_sigma_high, _CMP_GT_OQ), expand_mask_bits(row_mask >> 4));
+
+                const uint8_t clipped_bits = _mm256_movemask_pd(clipped_low) | (_mm256_movemask_pd(clipped_high) << 4);
+                if (clipped_bits == 0) {
+                    continue;
+                }
+                any_clipped |= clipped_bits;
+                valid_mask[i_value] = row_mask & ~clipped_bits;
+
+                const __m256d clipped_values_low  = _mm256_and_pd(values_low, clipped_low);
+                const __m256d clipped_values_high = _mm256_and_pd(values_high, clipped_high);
+                sum_low   = _mm256_sub_pd(sum_low,  clipped_values_low);
+                sum_high  = _mm256_sub_pd(sum_high, clipped_values_high);
+                sum2_low  = _mm256_sub_pd(sum2_low,  _mm256_mul_pd(clipped_values_low, clipped_values_low));
+                sum2_high = _mm256_sub_pd(sum2_high, _mm256_mul_pd(clipped_values_high, clipped_values_high));
+                n_low     = _mm256_sub_pd(n_low,  _mm256_and_pd(ones, clipped_low));
+                n_high    = _mm256_sub_pd(n_high, _mm256_and_pd(ones, clipped_high));
+            }
+
+            if (any_clipped == 0) {
+                break;
+            }
+        }
+
+        double n_kept[8];
+        _mm256_storeu_pd(&sums_of_kept_values[0], sum_low);
+        _mm256_storeu_pd(&sums_of_kept_values[4], sum_high);
+        _mm256_storeu_pd(&n_kept[0], n_low);
+        _mm256_storeu_pd(&n_kept[4], n_high);
+        for (unsigned int i_column = 0; i_column < 8; i_column++) {
+            numbers_of_kept_values[i_column] = static_cast<unsigned int>(n_kept[i_column]);
+        }
+    };
+}
+
+#endif
+
+void AstroPhotoStacker::apply_kappa_sigma_clipping_to_block(const PixelType *values,
+                                                            std::uint8_t *valid_mask,
+                                                            unsigned int n_values,
+                                                            double kappa,
+                                                            int n_iterations,
+                                                            double *sums_of_kept_values,
+                                                            unsigned int *numbers_of_kept_values)   {
+#ifdef ASTRO_PHOTO_STACKER_AVX2_KERNELS
+    if (cpu_supports_avx2()) {
+        apply_kappa_sigma_clipping_to_block_avx2(values, valid_mask, n_values, kappa, n_iterations, sums_of_kept_values, numbers_of_kept_values);
+        return;
+    }
+#endif
+    apply_kappa_sigma_clipping_to_block_scalar(values, valid_mask, n_values, kappa, n_iterations, sums_of_kept_values, numbers_of_kept_values);
+};
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <tuple>
+#include <algorithm>
 
 using namespace AstroPhotoStacker;
 using namespace std;
@@ -11,6 +12,13 @@ LocalShiftsHandler::LocalShiftsHandler(const std::vector<LocalShift> &shifts)  {
     initialize(shifts);
 };
 
+LocalShiftsHandler::LocalShiftsHandler(const LocalShiftsHandler &local_shifts_handler) :
+    m_shifts(local_shifts_handler.m_shifts),
+    m_kd_tree_shifts_in_shifted_coordinates(local_shifts_handler.m_kd_tree_shifts_in_shifted_coordinates),
+    m_kd_tree_shifts_in_reference_coordinates(local_shifts_handler.m_kd_tree_shifts_in_reference_coordinates),
+    m_empty(local_shifts_handler.m_empty)  {
+};
+
 
 bool LocalShiftsHandler::transform_from_reference_to_shifted_frame(float *x, float *y, float *score) {
     return calculate_shifted_coordinates(x, y, m_kd_tree_shifts_in_reference_coordinates, score);
@@ -20,7 +28,67 @@ bool LocalShiftsHandler::transform_from_shifted_to_reference_frame(float *x, flo
     return calculate_shifted_coordinates(x, y, m_kd_tree_shifts_in_shifted_coordinates, score);
 };
 
-bool LocalShiftsHandler::calculate_shifted_coordinates(float *x, float *y, KDTreeWithBuffer<int,2,std::tuple<int,int,bool,float>> &kd_tree_shifts, float *score)   {
+void LocalShiftsHandler::transform_from_reference_to_shifted_frame_grid(float *x, float *y) const {
+    const DisplacementGrid *grid = get_displacement_grid(m_grid_reference_to_shifted.get(), true);
+    if (grid != nullptr) {
+        grid->transform(x, y);
+    }
+};
+
+void LocalShiftsHandler::transform_from_shifted_to_reference_frame_grid(float *x, float *y) const {
+    const DisplacementGrid *grid = get_displacement_grid(m_grid_shifted_to_reference.get(), false);
+    if (grid != nullptr) {
+        grid->transform(x, y);
+    }
+};
+
+void LocalShiftsHandler::transform_row_from_reference_to_shifted_frame_grid(int y, int x_begin, int x_end, float *x_shifted, float *y_shifted) const {
+    const DisplacementGrid *grid = get_displacement_grid(m_grid_reference_to_shifted.get(), true);
+    if (grid != nullptr) {
+        grid->transform_row(y, x_begin, x_end, x_shifted, y_shifted);
+        return;
+    }
+    for (int x = x_begin; x < x_end; x++) {
+        x_shifted[x - x_begin] = x;
+        y_shifted[x - x_begin] = y;
+    }
+};
+
+const DisplacementGrid *LocalShiftsHandler::get_displacement_grid(LazyDisplacementGrid *lazy_grid, bool reference_to_shifted) const {
+    if (empty()) {
+        return nullptr;
+    }
+
+    std::call_once(lazy_grid->once_flag, [this, lazy_grid, reference_to_shifted]() {
+        const KDTreeWithBuffer<int,2,std::tuple<int,int,bool,float>> &kd_tree_shifts = reference_to_shifted ?  m_kd_tree_shifts_in_reference_coordinates :
+                                                                                                                m_kd_tree_shifts_in_shifted_coordinates;
+
+        // grid covers the alignment points with a margin, further away the shifts change slowly and the edge of the grid is used
+        const int spacing = DisplacementGrid::c_default_spacing;
+        const int margin = 4*spacing;
+        int x_min = m_shifts[0].x, x_max = m_shifts[0].x, y_min = m_shifts[0].y, y_max = m_shifts[0].y;
+        for (const LocalShift &shift : m_shifts) {
+            const int x = reference_to_shifted ? shift.x - shift.dx : shift.x;
+            const int y = reference_to_shifted ? shift.y - shift.dy : shift.y;
+            x_min = min(x_min, x);
+            x_max = max(x_max, x);
+            y_min = min(y_min, y);
+            y_max = max(y_max, y);
+        }
+
+        lazy_grid->grid = make_unique<const DisplacementGrid>(x_min - margin, y_min - margin, x_max + margin, y_max + margin, spacing,
+            [this, &kd_tree_shifts](float x, float y, float *dx, float *dy) {
+                float x_shifted = x;
+                float y_shifted = y;
+                const bool valid = calculate_shifted_coordinates(&x_shifted, &y_shifted, kd_tree_shifts);
+                *dx = valid ? x_shifted - x : 0;
+                *dy = valid ? y_shifted - y : 0;
+            });
+    });
+    return lazy_grid->grid.get();
+};
+
+bool LocalShiftsHandler::calculate_shifted_coordinates(float *x, float *y, const KDTreeWithBuffer<int,2,std::tuple<int,int,bool,float>> &kd_tree_shifts, float *score) const  {
     if (empty()) {
         return false;
     }
@@ -55,8 +123,11 @@ bool LocalShiftsHandler::calculate_shifted_coordinates(float *x, float *y, KDTre
 
         const float dist2 = ((*x) - coordinates[0]) * ((*x) - coordinates[0]) + ((*y) - coordinates[1]) * ((*y) - coordinates[1]);
         if (dist2 == 0) {
-            *x = coordinates[0];
-            *y = coordinates[1];
+            *x = coordinates[0] + dx;
+            *y = coordinates[1] + dy;
+            if (score != nullptr) {
+                *score = score_leading;
+            }
             return true;
         }
         const float weight = 1.0 / dist2;
@@ -1,5 +1,6 @@
 #include "../headers/NonRawFrameReaderVideo.h"
 #include "../headers/MetadataCommon.h"
+#include "../headers/VideoDecodeSession.h"
 
 #include <exiv2/exiv2.hpp>
 #include <opencv2/opencv.hpp>
@@ -11,15 +12,7 @@ NonRawFrameReaderVideo::NonRawFrameReaderVideo(const InputFrame &input_frame) :
 };
 
 vector<vector<PixelType>> NonRawFrameReaderVideo::get_pixels_data(int *width, int *height) {
-    const string video_address = m_input_frame.get_file_address();
-    const int frame_id = m_input_frame.get_frame_number();
-    cv::VideoCapture video(video_address);
-    if (!video.isOpened()) {
-        throw std::runtime_error("Unable to open video file: " + video_address);
-    }
-    video.set(cv::CAP_PROP_POS_FRAMES, frame_id);
-    cv::Mat frame;
-    video.read(frame);
+    const cv::Mat frame = VideoDecodeSession::read_frame(m_input_frame.get_file_address(), m_input_frame.get_frame_number());
     int bit_depth = 0;
     vector<vector<PixelType>> result = opencv_rgb_image_to_vector_vector_short(frame, &m_width, &m_height, &bit_depth);
     if (bit_depth == 8) {
@@ -39,15 +32,7 @@ vector<vector<PixelType>> NonRawFrameReaderVideo::get_pixels_data(int *width, in
 
 
 std::vector<PixelType> NonRawFrameReaderVideo::get_pixels_data_monochrome(int *width, int *height) {
-    const string video_address = m_input_frame.get_file_address();
-    const int frame_id = m_input_frame.get_frame_number();
-    cv::VideoCapture video(video_address);
-    if (!video.isOpened()) {
-        throw std::runtime_error("Unable to open video file: " + video_address);
-    }
-    video.set(cv::CAP_PROP_POS_FRAMES, frame_id);
-    cv::Mat frame;
-    video.read(frame);
+    const cv::Mat frame = VideoDecodeSession::read_frame(m_input_frame.get_file_address(), m_input_frame.get_frame_number());
 
     // convert to grayscale
     cv::Mat image;
@@ -71,15 +56,7 @@ std::vector<PixelType> NonRawFrameReaderVideo::get_pixels_data_monochrome(int *w
 
 void NonRawFrameReaderVideo::get_photo_resolution(int *width, int *height) {
     if (m_width < 0 || m_height < 0) {
-        const string video_address = m_input_frame.get_file_address();
-        const int frame_id = m_input_frame.get_frame_number();
-        cv::VideoCapture video(video_address);
-        if (!video.isOpened()) {
-            throw std::runtime_error("Unable to open video file: " + video_address);
-        }
-        video.set(cv::CAP_PROP_POS_FRAMES, frame_id);
-        cv::Mat frame;
-        video.read(frame);
+        const cv::Mat frame = VideoDecodeSession::read_frame(m_input_frame.get_file_address(), m_input_frame.get_frame_number());
         m_width = frame.cols;
         m_height = frame.rows;
     }
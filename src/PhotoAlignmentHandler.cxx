@@ -4,6 +4,7 @@
 #include "../headers/PhotoRanker.h"
 #include "../headers/VideoReader.h"
 #include "../headers/TaskScheduler.hxx"
+#include "../headers/VideoDecodeSession.h"
 
 #include "../headers/AlignmentResultFactory.h"
 #include "../headers/ReferencePhotoHandlerFactory.h"
@@ -89,6 +90,7 @@ void PhotoAlignmentHandler::save_to_text_file(const std::string &alignment_file_
 };
 
 void PhotoAlignmentHandler::align_files(const InputFrame &reference_frame, const std::vector<InputFrame> &files) {
+    m_pinned_reference_frame = make_unique<DecodedFrameCache::PinnedFrame>(&DecodedFrameCache::get_global_instance(), reference_frame);
     m_reference_photo_handler = ReferencePhotoHandlerFactory::get_reference_photo_handler(reference_frame, m_alignment_method, m_configurable_algorithm_settings_map);
     m_reference_frame = reference_frame;
 
@@ -124,17 +126,41 @@ void PhotoAlignmentHandler::align_files(const InputFrame &reference_frame, const
         }
     };
 
-    m_n_files_aligned = 0;
-    TaskScheduler pool({size_t(m_n_cpu)});
-    for (unsigned int i_file = 0; i_file < files.size(); i_file++)   {
-        if (m_n_cpu == 1)   {
+    // each task aligns a range of consecutive files, so that video frames are decoded without seeking
+    auto align_files_range = [&files, &align_file_multicore](unsigned int first_file_index, unsigned int last_file_index) {
+        for (unsigned int i_file = first_file_index; i_file < last_file_index; i_file++) {
             align_file_multicore(files[i_file]);
         }
-        else    {
-            pool.submit(align_file_multicore, {1}, files[i_file]);
+    };
+
+    // the frames are read ahead in the background for each range being aligned, while the already loaded ones are being aligned
+    const unsigned int n_files = files.size();
+    const unsigned int files_per_task = get_number_of_consecutive_frames_per_task(n_files, m_n_cpu);
+    FramePrefetcher frame_prefetcher(files, files_per_task, m_n_cpu);
+    m_reference_photo_handler->set_frame_prefetcher(&frame_prefetcher);
+
+    m_n_files_aligned = 0;
+    try {
+        TaskScheduler pool({size_t(m_n_cpu)});
+        for (unsigned int i_first = 0; i_first < n_files; i_first += files_per_task)   {
+            const unsigned int i_last = min(i_first + files_per_task, n_files);
+            if (m_n_cpu == 1)   {
+                align_files_range(i_first, i_last);
+            }
+            else    {
+                pool.submit(align_files_range, {1}, i_first, i_last);
+            }
         }
+        pool.wait_for_tasks();
+    }
+    catch (...) {
+        m_reference_photo_handler->set_frame_prefetcher(nullptr);
+        VideoDecodeSession::release_all_sessions();
+        throw;
     }
-    pool.wait_for_tasks();
+    m_reference_photo_handler->set_frame_prefetcher(nullptr);
+    // the videos are not kept open by the threads of the pool once the alignment is finished
+    VideoDecodeSession::release_all_sessions();
 };
 
 void PhotoAlignmentHandler::align_all_files_in_folder(const InputFrame &reference_frame, const std::string &raw_files_folder) {
@@ -156,6 +182,7 @@ void PhotoAlignmentHandler::align_all_files_in_folder(const InputFrame &referenc
 void PhotoAlignmentHandler::reset() {
     m_alignment_results_map.clear();
     m_reference_photo_handler = nullptr;
+    m_pinned_reference_frame = nullptr;
 }
 
 std::unique_ptr<AlignmentResultBase> PhotoAlignmentHandler::get_alignment_parameters(const InputFrame &input_frame) const    {
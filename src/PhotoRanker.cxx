@@ -40,10 +40,11 @@ void PhotoRanker::rank_all_files()    {
 };
 
 float PhotoRanker::calculate_frame_ranking(const InputFrame &input_frame)  {
-    int width, height;
-    InputFrameReader input_frame_reader(input_frame);
+    // the monochrome image is usually cached from the alignment, the frame is then not decoded again
+    InputFrameReader input_frame_reader(input_frame, false);
     const std::vector<PixelType> brightness = input_frame_reader.get_monochrome_data();
-    input_frame_reader.get_photo_resolution(&width, &height);
+    const int width  = input_frame_reader.get_width();
+    const int height = input_frame_reader.get_height();
 
     const float threshold_value = get_threshold_value(brightness.data(), width*height, 0.002);
     std::vector<std::vector<std::tuple<int,int>>> clusters = get_clusters(brightness.data(), width, height, threshold_value);
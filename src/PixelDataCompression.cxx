@@ -0,0 +1,48 @@
+#include "../headers/PixelDataCompression.h"
+
+#include <cstdint>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+std::vector<unsigned char> AstroPhotoStacker::compress_pixel_data(const PixelType *data, std::size_t n_pixels)    {
+    vector<unsigned char> result;
+    result.reserve(n_pixels*2);
+    int previous_value = 0;
+    for (size_t i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+        // zig-zag encoding of the difference, so that small negative differences are small numbers as well
+        const int difference = int(data[i_pixel]) - previous_value;
+        uint32_t encoded_value = (uint32_t(difference) << 1) ^ uint32_t(difference >> 31);
+        while (encoded_value >= 0x80) {
+            result.push_back((encoded_value & 0x7F) | 0x80);
+            encoded_value >>= 7;
+        }
+        result.push_back(encoded_value);
+        previous_value = data[i_pixel];
+    }
+    return result;
+};
+
+bool AstroPhotoStacker::decompress_pixel_data(const unsigned char *compressed_data, std::size_t compressed_size, PixelType *output, std::size_t n_pixels)    {
+    int previous_value = 0;
+    size_t position = 0;
+    for (size_t i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+        uint32_t encoded_value = 0;
+        int shift = 0;
+        while (true) {
+            if (position >= compressed_size || shift >= 32) {
+                return false;
+            }
+            const unsigned char byte = compressed_data[position++];
+            encoded_value |= uint32_t(byte & 0x7F) << shift;
+            shift += 7;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+        const int difference = int(encoded_value >> 1) ^ -int(encoded_value & 1);
+        previous_value += difference;
+        output[i_pixel] = static_cast<PixelType>(previous_value);
+    }
+    return true;
+};
@@ -31,6 +31,7 @@ AlignmentResultPlateSolving PlateSolver::plate_solve(const std::vector<std::tupl
 AlignmentResultPlateSolving PlateSolver::plate_solve(const std::vector<std::tuple<float,float,int> > &stars, float position_tolerance, float fraction_of_matched_stars) const {
     AlignmentResultPlateSolving result;
     float highest_distance = 0;
+    KDTreeSearchBuffer search_buffer;   // reused by all the queries, to avoid memory allocations
     for (unsigned int i_star1 = 0; i_star1 < stars.size(); i_star1++)   {
         for (unsigned int i_star2 = i_star1+1; i_star2 < stars.size(); i_star2++)   {
             for (unsigned int i_star3 = i_star2+1; i_star3 < stars.size(); i_star3++)   {
@@ -47,11 +48,10 @@ AlignmentResultPlateSolving PlateSolver::plate_solve(const std::vector<std::tupl
                     }
 
                     // closest hashes and star indices from the reference photo
-                    const std::vector<std::tuple<std::array<float, 4>, StarIndices> > nearest_neighbors =
-                        m_kdtree->get_k_nearest_neighbors(asterism_hash.data(), 4);
+                    m_kdtree->get_k_nearest_neighbors(asterism_hash.data(), 4, &search_buffer);
 
-                    for (const tuple<std::array<float, 4>, StarIndices> &hash_tuple : nearest_neighbors)  {
-                        const StarIndices &reference_star_indices = get<1>(hash_tuple);
+                    for (const tuple<long long int, double> &index_and_distance : search_buffer.indices_and_distances)  {
+                        const StarIndices &reference_star_indices = m_kdtree->get_node(get<0>(index_and_distance)).m_value;
                         const tuple<float,float,int> &reference_star_A = m_reference_stars->at(get<0>(reference_star_indices));
                         const tuple<float,float,int> &reference_star_B = m_reference_stars->at(get<1>(reference_star_indices));
 
@@ -4,6 +4,7 @@
 #include <libraw/libraw.h>
 #include <iomanip>
 #include <algorithm>
+#include <stdexcept>
 
 using namespace AstroPhotoStacker;
 using namespace std;
@@ -11,18 +12,7 @@ using namespace std;
 
 
 std::vector<PixelType> RawFileReaderDSLR::read_raw_file(int *width, int *height, std::array<char, 4> *bayer_pattern) {
-    LibRaw raw_processor = get_libraw_processor();
-
-    raw_processor.imgdata.params.use_camera_wb = 1;
-    raw_processor.subtract_black();
-    raw_processor.dcraw_process();
-
-    int num_colors, bps;
-    raw_processor.get_mem_image_format(width, height, &num_colors, &bps);
-
-    if (*width < *height)   {
-        std::swap(*width, *height);
-    }
+    unique_ptr<LibRaw> raw_processor = open_raw_file(true);
 
     auto process_color = [](int color_code) -> char {
         if (color_code == 3)    {
@@ -32,57 +22,153 @@ std::vector<PixelType> RawFileReaderDSLR::read_raw_file(int *width, int *height,
     };
 
     if (bayer_pattern != nullptr)   {
-        bayer_pattern->at(0) = process_color(raw_processor.COLOR(0,0));
-        bayer_pattern->at(1) = process_color(raw_processor.COLOR(0,1));
-        bayer_pattern->at(2) = process_color(raw_processor.COLOR(1,0));
-        bayer_pattern->at(3) = process_color(raw_processor.COLOR(1,1));
+        bayer_pattern->at(0) = process_color(raw_processor->COLOR(0,0));
+        bayer_pattern->at(1) = process_color(raw_processor->COLOR(0,1));
+        bayer_pattern->at(2) = process_color(raw_processor->COLOR(1,0));
+        bayer_pattern->at(3) = process_color(raw_processor->COLOR(1,1));
     }
 
-    std::vector<PixelType> result((*width)*(*height));
-    const unsigned short int (*image_data)[4] = raw_processor.imgdata.image;
+    const bool bayer_raw_image = has_bayer_raw_image(*raw_processor);
+    std::vector<PixelType> result = bayer_raw_image ? read_bayer_raw_image(raw_processor.get()) : read_raw_file_with_dcraw_process(raw_processor.get());
 
-    for (int row = 0; row < *height; ++row) {
-        for (int col = 0; col < *width; ++col) {
-            const unsigned int index = row * (*width) + col;
-            const int color = raw_processor.COLOR(row, col);
-            result[index] = image_data[index][color]/2; // divide by 2 to get 15-bit values
-        }
+    if (width != nullptr) {
+        *width = bayer_raw_image ? raw_processor->imgdata.sizes.width : raw_processor->imgdata.sizes.iwidth;
+    }
+    if (height != nullptr) {
+        *height = bayer_raw_image ? raw_processor->imgdata.sizes.height : raw_processor->imgdata.sizes.iheight;
     }
 
-    raw_processor.recycle();
+    raw_processor->recycle();
     return result;
 };
 
 void RawFileReaderDSLR::get_photo_resolution(int *width, int *height) {
-    LibRaw raw_processor = get_libraw_processor();
-    raw_processor.imgdata.params.use_camera_wb = 1;
-    raw_processor.subtract_black();
-    raw_processor.dcraw_process();
-
-    int num_colors, bps;
-    raw_processor.get_mem_image_format(width, height, &num_colors, &bps);
-
+    // the sizes are known after opening the file, the data do not need to be unpacked
+    unique_ptr<LibRaw> raw_processor = open_raw_file(false);
+    if (width != nullptr) {
+        *width = raw_processor->imgdata.sizes.width;
+    }
+    if (height != nullptr) {
+        *height = raw_processor->imgdata.sizes.height;
+    }
+    raw_processor->recycle();
 };
 
-LibRaw RawFileReaderDSLR::get_libraw_processor() {
-    LibRaw raw_processor;
-    if (raw_processor.open_file(m_input_frame.get_file_address().c_str()) != LIBRAW_SUCCESS) {
+std::unique_ptr<LibRaw> RawFileReaderDSLR::open_raw_file(bool unpack) const {
+    unique_ptr<LibRaw> raw_processor = make_unique<LibRaw>();
+    if (raw_processor->open_file(m_input_frame.get_file_address().c_str()) != LIBRAW_SUCCESS) {
         throw std::runtime_error("Cannot open the raw file " + m_input_frame.get_file_address());
     }
-    if (raw_processor.unpack() != LIBRAW_SUCCESS) {
+    if (unpack && raw_processor->unpack() != LIBRAW_SUCCESS) {
         throw std::runtime_error("Cannot unpack the raw file " + m_input_frame.get_file_address());
     }
     return raw_processor;
 };
 
-Metadata RawFileReaderDSLR::read_metadata_without_cache() {
-    // create a LibRaw object
-    LibRaw raw_processor;
+bool RawFileReaderDSLR::has_bayer_raw_image(const LibRaw &raw_processor)   {
+    // filters < 1000 are X-Trans and other non-Bayer patterns, 0 means there is no color filter array (linear DNG, sRAW, ...)
+    return raw_processor.imgdata.rawdata.raw_image != nullptr && raw_processor.imgdata.idata.filters >= 1000;
+};
+
+void RawFileReaderDSLR::get_color_multipliers(const LibRaw &raw_processor, float multipliers[4])   {
+    const libraw_colordata_t &color = raw_processor.imgdata.color;
+
+    // camera white balance if available, daylight multipliers otherwise
+    const bool has_camera_white_balance = color.cam_mul[0] > 0 && color.cam_mul[2] > 0;
+    const float *white_balance_source = has_camera_white_balance ? color.cam_mul : color.pre_mul;
+    float white_balance[4];
+    std::copy(white_balance_source, white_balance_source + 4, white_balance);
+    if (white_balance[1] <= 0) {
+        white_balance[1] = 1;
+    }
+    if (white_balance[3] <= 0) {
+        white_balance[3] = raw_processor.imgdata.idata.colors < 4 ? white_balance[1] : 1;
+    }
+
+    float min_white_balance = white_balance[1];
+    for (int i_color = 0; i_color < 4; i_color++) {
+        if (white_balance[i_color] > 0) {
+            min_white_balance = min(min_white_balance, white_balance[i_color]);
+        }
+    }
 
-    // open the file
-    if (raw_processor.open_file(m_input_frame.get_file_address().c_str()) != LIBRAW_SUCCESS) {
-        throw std::runtime_error("Cannot open raw file " + m_input_frame.get_file_address());
+    const unsigned int common_black = color.black + *min_element(color.cblack, color.cblack + 4);
+    const float white_level = max<int>(int(color.maximum) - int(common_black), 1);
+    for (int i_color = 0; i_color < 4; i_color++) {
+        multipliers[i_color] = (white_balance[i_color]/min_white_balance) * 65535.f/white_level;
     }
+};
+
+std::vector<PixelType> RawFileReaderDSLR::read_bayer_raw_image(LibRaw *raw_processor)  {
+    const libraw_image_sizes_t &sizes = raw_processor->imgdata.sizes;
+    const libraw_colordata_t   &color = raw_processor->imgdata.color;
+    const int width  = sizes.width;
+    const int height = sizes.height;
+
+    // raw image contains also the masked pixels around the visible area
+    const unsigned short int *raw_image = raw_processor->imgdata.rawdata.raw_image;
+    const size_t raw_row_size = sizes.raw_pitch/sizeof(unsigned short int);
+
+    float multipliers[4];
+    get_color_multipliers(*raw_processor, multipliers);
+
+    // cblack[4] x cblack[5] is the size of the optional black level pattern stored from cblack[6]
+    const unsigned int black_pattern_height = color.cblack[4];
+    const unsigned int black_pattern_width  = color.cblack[5];
+    const bool has_black_pattern = black_pattern_height > 0 && black_pattern_width > 0;
+
+    std::vector<PixelType> result(size_t(width)*height);
+    for (int row = 0; row < height; ++row) {
+        const unsigned short int *raw_row = raw_image + (row + sizes.top_margin)*raw_row_size + sizes.left_margin;
+        PixelType *result_row = &result[size_t(row)*width];
+
+        // colors of the Bayer pattern alternate within the row
+        int row_black[2];
+        float row_multipliers[2];
+        for (int parity = 0; parity < 2; parity++) {
+            const int color_code = raw_processor->COLOR(row, parity);
+            row_black[parity]       = color.black + color.cblack[color_code];
+            row_multipliers[parity] = multipliers[color_code]*0.5f; // divide by 2 to get 15-bit values
+        }
+
+        for (int col = 0; col < width; ++col) {
+            const int parity = col & 1;
+            int value = int(raw_row[col]) - row_black[parity];
+            if (has_black_pattern) {
+                value -= color.cblack[6 + (row % black_pattern_height)*black_pattern_width + col % black_pattern_width];
+            }
+            const float scaled_value = max(value, 0)*row_multipliers[parity];
+            result_row[col] = static_cast<PixelType>(min(scaled_value, 32767.f));
+        }
+    }
+    return result;
+};
+
+std::vector<PixelType> RawFileReaderDSLR::read_raw_file_with_dcraw_process(LibRaw *raw_processor)  {
+    raw_processor->imgdata.params.use_camera_wb = 1;
+    raw_processor->subtract_black();
+    raw_processor->dcraw_process();
+
+    const int width  = raw_processor->imgdata.sizes.iwidth;
+    const int height = raw_processor->imgdata.sizes.iheight;
+
+    std::vector<PixelType> result(size_t(width)*height);
+    const unsigned short int (*image_data)[4] = raw_processor->imgdata.image;
+
+    for (int row = 0; row < height; ++row) {
+        for (int col = 0; col < width; ++col) {
+            const unsigned int index = row * width + col;
+            const int color = raw_processor->COLOR(row, col);
+            result[index] = image_data[index][color]/2; // divide by 2 to get 15-bit values
+        }
+    }
+    return result;
+};
+
+Metadata RawFileReaderDSLR::read_metadata_without_cache() {
+    // the metadata are available after opening the file, the data do not need to be unpacked
+    unique_ptr<LibRaw> raw_processor_ptr = open_raw_file(false);
+    LibRaw &raw_processor = *raw_processor_ptr;
 
     Metadata result;
 
@@ -4,6 +4,8 @@
 #include "../headers/MetadataCommon.h"
 
 #include <algorithm>
+#include <fstream>
+#include <cstring>
 
 using namespace AstroPhotoStacker;
 using namespace std;
@@ -17,12 +19,8 @@ bool AstroPhotoStacker::is_fit_file(const std::string &file_address) {
 RawFileReaderFit::RawFileReaderFit(const InputFrame &input_frame) : RawFileReaderBase(input_frame) {};
 
 std::vector<PixelType> RawFileReaderFit::read_raw_file(int *width, int *height, std::array<char, 4> *bayer_pattern) {
-    ifstream input_stream(m_input_frame.get_file_address(), ios::binary | ios::in);
-    if (!input_stream.is_open())    {
-        throw std::runtime_error("Could not open file " + m_input_frame.get_file_address());
-    }
-    read_header(&input_stream);
-    read_data(&input_stream);
+    read_header();
+    read_data();
 
     if (width != nullptr) {
         *width = m_width;
@@ -33,15 +31,11 @@ std::vector<PixelType> RawFileReaderFit::read_raw_file(int *width, int *height,
     if (bayer_pattern != nullptr) {
         *bayer_pattern = m_bayer_matrix;
     }
-    return m_data;
+    return std::move(m_data);
 };
 
 void RawFileReaderFit::get_photo_resolution(int *width, int *height) {
-    ifstream input_stream(m_input_frame.get_file_address(), ios::binary | ios::in);
-    if (!input_stream.is_open())    {
-        throw std::runtime_error("Could not open file " + m_input_frame.get_file_address());
-    }
-    read_header(&input_stream);
+    read_header();
 
     if (width != nullptr) {
         *width = m_width;
@@ -52,71 +46,72 @@ void RawFileReaderFit::get_photo_resolution(int *width, int *height) {
 };
 
 Metadata RawFileReaderFit::read_metadata_without_cache() {
-    ifstream input_stream(m_input_frame.get_file_address(), ios::binary | ios::in);
-    if (!input_stream.is_open())    {
-        throw std::runtime_error("Could not open file " + m_input_frame.get_file_address());
-    }
-    read_header(&input_stream);
+    read_header();
 
     return m_metadata;
 };
 
-void RawFileReaderFit::read_data(std::ifstream *file) {
-    const unsigned  int n_elements = m_width*m_height;
-    m_data = std::vector<PixelType>(n_elements);
-
-    // skip whitespaces
-    char x;
-    while (file->peek() == ' ') {
-        file->read(&x, 1);
+void RawFileReaderFit::convert_16bit_data(const unsigned char *source, PixelType *destination, std::size_t n_pixels, std::uint16_t zero_point)  {
+    // data are stored as big-endian 16 bit integers (first byte is the most significant one), BZERO is added to them
+    // then we need to divide them by 2 to be able to convert them to 16 bit signed integers (-1 is "no value")
+    // do not worry, if the resolution is 14 bits for example, the 2 least significant bits will be 0 (and not the two most significant ones)
+    for (size_t i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+        uint16_t value;
+        memcpy(&value, source + 2*i_pixel, sizeof(uint16_t));
+        value = (value >> 8) | (value << 8);
+        value += zero_point;
+        destination[i_pixel] = static_cast<PixelType>(value >> 1);
     }
+};
 
-    if (m_bit_depth == 16) {
-        read_data_16bit(file);
-    }
-    else if (m_bit_depth == 8) {
-        read_data_8bit(file);
-    }
-    else {
+void RawFileReaderFit::read_data() {
+    if (m_bit_depth != 16 && m_bit_depth != 8) {
         throw std::invalid_argument("Unsupported bit depth in FIT file: " + m_input_frame.get_file_address());
     }
-};
-
-void RawFileReaderFit::read_data_16bit(std::ifstream *file)   {
-    vector<unsigned short int> data_unsigned(m_width*m_height);
-
-    file->read(reinterpret_cast<char*>(data_unsigned.data()), data_unsigned.size()*2);
 
-    // data are not stored as usual 16 bit unsigned integers - first byte is the least significant one, second byte is the most significant one
-    std::transform(data_unsigned.begin(), data_unsigned.end(), data_unsigned.begin(), [](unsigned short int pixel_value) -> unsigned short int {
-        return pixel_value >> 8 | pixel_value << 8;
-    });
+    const size_t n_pixels = size_t(m_width)*m_height;
+    const size_t data_size = n_pixels*(m_bit_depth/8);
+    const size_t data_offset = m_header->get_data_offset();
+    if (data_offset + data_size > m_header->get_file_size()) {
+        throw std::runtime_error("FIT file does not contain all image data: " + m_input_frame.get_file_address());
+    }
 
-    // subtract zero point
-    std::transform(data_unsigned.begin(), data_unsigned.end(), data_unsigned.begin(), [this](unsigned short int x) -> unsigned short {return x + m_zero_point;});
+    m_data = std::vector<PixelType>(n_pixels);
+    if (n_pixels == 0) {
+        return;
+    }
 
-    // we need this to be able to convert it to 16 bit signed integers (-1 is "no value")
-    // do not worry, if the resolution is 14 bits for example, the 2 least significant bits will be 0 (and not the two most significant ones)
-    std::transform(data_unsigned.begin(), data_unsigned.end(), m_data.begin(), [](unsigned short int x) -> short {return x/2;});
+    // raw bytes are read directly into the output buffer (it is large enough for both bit depths) and converted in place
+    ifstream input_stream(m_input_frame.get_file_address(), ios::binary | ios::in);
+    if (!input_stream.is_open())    {
+        throw std::runtime_error("Could not open file " + m_input_frame.get_file_address());
+    }
+    input_stream.seekg(data_offset);
+    input_stream.read(reinterpret_cast<char*>(m_data.data()), data_size);
+    if (static_cast<size_t>(input_stream.gcount()) != data_size) {
+        throw std::runtime_error("Could not read image data from file " + m_input_frame.get_file_address());
+    }
+    convert_data(reinterpret_cast<const unsigned char*>(m_data.data()));
 };
 
-void RawFileReaderFit::read_data_8bit(std::ifstream *file) {
-    vector<char> signed_char_buffer(m_width*m_height);
-    file->read(reinterpret_cast<char*>(signed_char_buffer.data()), signed_char_buffer.size());
-
-    std::transform(signed_char_buffer.begin(), signed_char_buffer.end(), m_data.begin(), [this](char pixel_value) -> unsigned short int {
-        return static_cast<short unsigned int>(static_cast<PixelType>(pixel_value) + m_zero_point);
-    });
+void RawFileReaderFit::convert_data(const unsigned char *source)   {
+    const size_t n_pixels = m_data.size();
+    if (m_bit_depth == 16) {
+        convert_16bit_data(source, m_data.data(), n_pixels, m_zero_point);
+        return;
+    }
 
-    scale_8bit_image_to_16bit(&m_data);
+    // 8 bit data - going backwards, so that the in-place conversion does not overwrite the bytes which have not been converted yet
+    for (size_t i_pixel = n_pixels; i_pixel-- > 0;) {
+        const char pixel_value = static_cast<char>(source[i_pixel]);
+        const PixelType value_with_zero_point = static_cast<unsigned short int>(static_cast<PixelType>(pixel_value) + m_zero_point);
+        m_data[i_pixel] = static_cast<PixelType>(value_with_zero_point * 128);
+    }
 };
 
-
-void RawFileReaderFit::read_header(std::ifstream *file)   {
-    const string header = get_header_string(file);
-    parse_header(header);
-
+void RawFileReaderFit::read_header()   {
     try {
+        m_header = FitFileHeader::get_instance(m_input_frame.get_file_address());
         fill_metadata();
     }
     catch (const std::invalid_argument &e) {
@@ -124,92 +119,33 @@ void RawFileReaderFit::read_header(std::ifstream *file)   {
     }
 };
 
-void RawFileReaderFit::parse_header(const std::string &header)    {
-    int first_non_whitespace = -1;
-    int last_non_whitespace = -1;
-    bool reading_value = false;
-    string key, value;
-    bool previous_was_space = false;
-
-    for (unsigned int i = 0; i < header.size(); i++) {
-       // reading key
-        if (header[i] == ' ') {
-            previous_was_space = true;
-            if (!reading_value) {
-                continue;
-            }
-        }
-        // starting to read key
-        if (header[i] != ' ' && previous_was_space && !reading_value && header[i] != '=') {
-            first_non_whitespace = i;
-            last_non_whitespace = i;
-            previous_was_space = false;
-        }
-        // reading key
-        else if (header[i] != '=' && !reading_value){
-            if (first_non_whitespace == -1) {
-                first_non_whitespace = i;
-            }
-            last_non_whitespace = i;
-        }
-        // = sign, start reading value
-        else if (header[i] == '=' && !reading_value) {
-            key = header.substr(first_non_whitespace, last_non_whitespace - first_non_whitespace + 1);
-            first_non_whitespace = -1;
-            last_non_whitespace = -1;
-            reading_value = true;
-        }
-        else if (reading_value) {
-            if (header[i] != '/')   {
-                value += header[i];
-            }
-            else {
-                strip_string(&value, "\'\" ");
-                m_metadata_map[key] = value;
-                key = "";
-                value = "";
-                reading_value = false;
-            }
-        }
-    }
-};
-
-std::string RawFileReaderFit::get_header_string(std::ifstream *file)    {
-    string header;
-    char x;
-    while (!ends_with(header, " END ") && file->read(&x, 1)) {
-        header += x;
-    }
-    return header;
-};
-
 void RawFileReaderFit::fill_metadata()    {
-    m_width  = std::stoi(get_with_default<string,string>(m_metadata_map, "NAXIS1", "0"));
-    m_height = std::stoi(get_with_default<string,string>(m_metadata_map, "NAXIS2", "0"));
-    m_bit_depth = std::stoi(get_with_default<string,string>(m_metadata_map, "BITPIX", "16"));
-    m_metadata.exposure_time = std::stof(get_with_default<string,string>(m_metadata_map, "EXPTIME", "0"));
+    m_width  = std::stoi(get_with_default<string,string>(m_header->get_keywords(), "NAXIS1", "0"));
+    m_height = std::stoi(get_with_default<string,string>(m_header->get_keywords(), "NAXIS2", "0"));
+    m_bit_depth = std::stoi(get_with_default<string,string>(m_header->get_keywords(), "BITPIX", "16"));
+    m_metadata.exposure_time = std::stof(get_with_default<string,string>(m_header->get_keywords(), "EXPTIME", "0"));
 
-    const string bayer_matrix = get_with_default<string,string>(m_metadata_map, "BAYERPAT", "");
+    const string bayer_matrix = get_with_default<string,string>(m_header->get_keywords(), "BAYERPAT", "");
     process_bayer_matrix(bayer_matrix);
 
     // get zero point
-    m_zero_point = std::stoi(get_with_default<string,string>(m_metadata_map, "BZERO", "0"));
+    m_zero_point = std::stoi(get_with_default<string,string>(m_header->get_keywords(), "BZERO", "0"));
 
     // just for output metadata struct:
-    m_metadata.aperture = std::stof(get_with_default<string,string>(m_metadata_map, "APERTURE", "0"));
-    m_metadata.iso = std::stoi(get_with_default<string,string>(m_metadata_map, "ISO", "0"));
+    m_metadata.aperture = std::stof(get_with_default<string,string>(m_header->get_keywords(), "APERTURE", "0"));
+    m_metadata.iso = std::stoi(get_with_default<string,string>(m_header->get_keywords(), "ISO", "0"));
     if (m_metadata.iso == 0) {
-        m_metadata.iso = std::stoi(get_with_default<string,string>(m_metadata_map, "GAIN", "0"));
+        m_metadata.iso = std::stoi(get_with_default<string,string>(m_header->get_keywords(), "GAIN", "0"));
     }
 
-    m_metadata.focal_length = std::stof(get_with_default<string,string>(m_metadata_map, "FOCALLEN", "0"));
-    const std::string date_time_string = get_with_default<string,string>(m_metadata_map, "DATE-OBS", "");
+    m_metadata.focal_length = std::stof(get_with_default<string,string>(m_header->get_keywords(), "FOCALLEN", "0"));
+    const std::string date_time_string = get_with_default<string,string>(m_header->get_keywords(), "DATE-OBS", "");
     m_metadata.timestamp = RawFileReaderFit::get_unix_timestamp(date_time_string);
     m_metadata.monochrome = bayer_matrix == "";
     m_metadata.bayer_matrix = convert_bayer_int_array_to_string(m_bayer_matrix);
     m_metadata.is_raw = true;
-    m_metadata.camera_model = get_with_default<string,string>(m_metadata_map, "INSTRUME", "");
-    m_metadata.temperature = std::stof(get_with_default<string,string>(m_metadata_map, "CCD-TEMP", "-300"));
+    m_metadata.camera_model = get_with_default<string,string>(m_header->get_keywords(), "INSTRUME", "");
+    m_metadata.temperature = std::stof(get_with_default<string,string>(m_header->get_keywords(), "CCD-TEMP", "-300"));
 };
 
 void RawFileReaderFit::process_bayer_matrix(const std::string &bayer_matrix)  {
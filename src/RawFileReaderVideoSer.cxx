@@ -1,11 +1,11 @@
 #include "../headers/RawFileReaderVideoSer.h"
+#include "../headers/SerFileMapping.h"
 #include "../headers/MetadataCommon.h"
 #include "../headers/Common.h"
 
 #include <string>
 #include <vector>
 #include <stdexcept>
-#include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
@@ -16,72 +16,25 @@ using namespace std;
 
 
 std::vector<PixelType> RawFileReaderVideoSer::read_raw_file(int *width, int *height, std::array<char, 4> *bayer_pattern) {
-   std::ifstream file(m_input_frame.get_file_address(), std::ios::binary | std::ios::in);
-    if (!file.is_open()) {
-        throw std::runtime_error("Unable to open video file: " + m_input_frame.get_file_address());
-    }
-
-    const size_t file_size = std::filesystem::file_size(m_input_frame.get_file_address());
-    if (file_size < 178) {
-        throw std::runtime_error("File too small to be a valid SER video: " + m_input_frame.get_file_address());
-    }
-
-
-    const int frame_id = m_input_frame.get_frame_number();
-    *width = read_uint_from_file(&file, 26);
-    *height = read_uint_from_file(&file, 30);
-    const unsigned int bit_depth = read_uint_from_file(&file, 34);
-
-    const size_t bytes_per_pixel = bit_depth / 8;
-    const size_t frame_size = bytes_per_pixel * (*width) * (*height);
-    const size_t header_size = 178;
-
-    if (file_size < header_size + frame_size * (frame_id + 1)) {
-        throw std::runtime_error("File does not contain enough data for the requested frame: " + m_input_frame.get_file_address());
-    }
-    file.seekg(header_size + frame_id*frame_size, std::ios::beg);
-
-    std::vector<short unsigned int> result_unsigned_short(*width*(*height),0);
-
-    file.read(reinterpret_cast<char*>(result_unsigned_short.data()), frame_size);
+    const std::shared_ptr<const SerFileMapping> ser_file = SerFileMapping::get_instance(m_input_frame.get_file_address());
 
-    if (bit_depth == 16) {
-        std::transform(result_unsigned_short.begin(), result_unsigned_short.end(), result_unsigned_short.begin(), [](unsigned short int x) -> unsigned short {return x/2;});
-    }
-    else if (bit_depth == 8) {
-        for (int i_pixel = (*width)*(*height)-1; i_pixel >= 0; --i_pixel) {
-            result_unsigned_short[i_pixel] = reinterpret_cast<unsigned char*>(result_unsigned_short.data())[i_pixel];
-            reinterpret_cast<unsigned char*>(result_unsigned_short.data())[i_pixel] = 0;
-        }
-    }
-    else {
-        throw std::runtime_error("Unsupported bit depth in SER file: " + m_input_frame.get_file_address());
-    }
+    *width  = ser_file->get_width();
+    *height = ser_file->get_height();
 
     if (bayer_pattern != nullptr) {
-        const unsigned int bayer_pattern_code = read_uint_from_file(&file, 18);
-        const std::string bayer_pattern_string = RawFileReaderVideoSer::int_code_to_bayer_matrix(bayer_pattern_code);
+        const std::string bayer_pattern_string = RawFileReaderVideoSer::int_code_to_bayer_matrix(ser_file->get_bayer_pattern_code());
         *bayer_pattern = convert_bayer_string_to_int_array(bayer_pattern_string);
-
     }
 
-    std::vector<PixelType> result(*width*(*height),0);
-    std::transform(result_unsigned_short.begin(), result_unsigned_short.end(), result.begin(), [](unsigned short int x) -> PixelType { return static_cast<PixelType>(x); } );
-
-    if (bit_depth == 8) {
-        scale_8bit_image_to_16bit(&result);
-    }
+    std::vector<PixelType> result(size_t(*width)*(*height));
+    ser_file->read_frame(m_input_frame.get_frame_number(), result.data());
     return result;
 };
 
 void RawFileReaderVideoSer::get_photo_resolution(int *width, int *height) {
-   std::ifstream file(m_input_frame.get_file_address(), std::ios::binary | std::ios::in);
-    if (!file.is_open()) {
-        throw std::runtime_error("Unable to open video file: " + m_input_frame.get_file_address());
-    }
-
-    *width = read_uint_from_file(&file, 26);
-    *height = read_uint_from_file(&file, 30);
+    const std::shared_ptr<const SerFileMapping> ser_file = SerFileMapping::get_instance(m_input_frame.get_file_address());
+    *width  = ser_file->get_width();
+    *height = ser_file->get_height();
 };
 
 Metadata RawFileReaderVideoSer::read_metadata_without_cache() {
@@ -5,8 +5,11 @@ using namespace AstroPhotoStacker;
 using namespace std;
 
 std::vector<PixelType> ReferencePhotoHandlerBase::read_image_monochrome(const InputFrame &input_frame, int *width, int *height) const {
-    InputFrameReader input_frame_reader(input_frame);
-    *width = input_frame_reader.get_width();
-    *height = input_frame_reader.get_height();
-    return input_frame_reader.get_monochrome_data();
+    unique_ptr<InputFrameReader> input_frame_reader = m_frame_prefetcher != nullptr ?
+                                                        m_frame_prefetcher->get_frame(input_frame) :
+                                                        make_unique<InputFrameReader>(input_frame, false);
+    vector<PixelType> result = input_frame_reader->get_monochrome_data();
+    *width = input_frame_reader->get_width();
+    *height = input_frame_reader->get_height();
+    return result;
 };
\ No newline at end of file
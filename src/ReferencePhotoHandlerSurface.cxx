@@ -50,10 +50,8 @@ ReferencePhotoHandlerSurface::ReferencePhotoHandlerSurface(const PixelType *brig
 
 std::unique_ptr<AlignmentResultBase> ReferencePhotoHandlerSurface::calculate_alignment(const InputFrame &input_frame) const {
 
-    InputFrameReader reader(input_frame);
-    std::vector<PixelType> brightness = reader.get_monochrome_data();
-    const int width = reader.get_width();
-    const int height = reader.get_height();
+    int width, height;
+    std::vector<PixelType> brightness = read_image_monochrome(input_frame, &width, &height);
 
     MonochromeImageData image_data;
     image_data.brightness = brightness.data();
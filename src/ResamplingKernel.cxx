@@ -0,0 +1,284 @@
+#include "../headers/ResamplingKernel.h"
+#include "../headers/CpuFeatures.h"
+
+#include <stdexcept>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+std::string AstroPhotoStacker::interpolation_method_to_string(const InterpolationMethod &method)  {
+    switch (method)   {
+        case InterpolationMethod::NEAREST_NEIGHBOR:
+            return "nearest neighbor";
+        case InterpolationMethod::BILINEAR:
+            return "bilinear";
+        case InterpolationMethod::BICUBIC:
+            return "bicubic";
+        case InterpolationMethod::LANCZOS3:
+            return "lanczos-3";
+    }
+    return "nearest neighbor";
+};
+
+InterpolationMethod AstroPhotoStacker::string_to_interpolation_method(const std::string &method)  {
+    if (method == "nearest neighbor")   {
+        return InterpolationMethod::NEAREST_NEIGHBOR;
+    }
+    else if (method == "bilinear")  {
+        return InterpolationMethod::BILINEAR;
+    }
+    else if (method == "bicubic")   {
+        return InterpolationMethod::BICUBIC;
+    }
+    else if (method == "lanczos-3") {
+        return InterpolationMethod::LANCZOS3;
+    }
+    throw runtime_error("Unknown interpolation method: \'" + method + "\'");
+};
+
+const std::vector<std::string>& AstroPhotoStacker::get_interpolation_methods()    {
+    static const vector<string> methods({"nearest neighbor", "bilinear", "bicubic", "lanczos-3"});
+    return methods;
+};
+
+namespace {
+    // positions far outside of the image are moved closer, so that they can be safely converted to int
+    constexpr float c_max_distance_outside = 16;
+
+    inline float clamp_float(float value, float min_value, float max_value)    {
+        value = value < min_value ? min_value : value;
+        return value > max_value ? max_value : value;
+    };
+
+    inline int clamp_index(int value, int min_value, int max_value)  {
+        return min(max(value, min_value), max_value);
+    };
+}
+
+ResamplingKernel::ResamplingKernel(InterpolationMethod method) :
+    m_method(method)    {
+    switch (method) {
+        case InterpolationMethod::NEAREST_NEIGHBOR:
+            m_number_of_taps = 1;
+            m_first_tap_offset = 0;
+            break;
+        case InterpolationMethod::BILINEAR:
+            m_number_of_taps = 2;
+            m_first_tap_offset = 0;
+            break;
+        case InterpolationMethod::BICUBIC:
+            m_number_of_taps = 4;
+            m_first_tap_offset = -1;
+            break;
+        case InterpolationMethod::LANCZOS3:
+            m_number_of_taps = 6;
+            m_first_tap_offset = -2;
+            break;
+        default:
+            throw runtime_error("ResamplingKernel: unsupported interpolation method");
+    }
+
+    m_weights.resize((c_number_of_phases + 1)*m_number_of_taps);
+    for (int phase = 0; phase <= c_number_of_phases; phase++) {
+        const double fraction = double(phase)/c_number_of_phases;
+        double sum = 0;
+        for (int i_tap = 0; i_tap < m_number_of_taps; i_tap++) {
+            const double distance = m_first_tap_offset + i_tap - fraction;
+            sum += get_weight(method, distance);
+        }
+        // normalization, so that a flat image stays flat
+        for (int i_tap = 0; i_tap < m_number_of_taps; i_tap++) {
+            const double distance = m_first_tap_offset + i_tap - fraction;
+            m_weights[phase*m_number_of_taps + i_tap] = get_weight(method, distance)/sum;
+        }
+    }
+};
+
+float ResamplingKernel::get_weight(InterpolationMethod method, float distance)  {
+    distance = fabs(distance);
+    if (method == InterpolationMethod::NEAREST_NEIGHBOR) {
+        return 1;
+    }
+    else if (method == InterpolationMethod::BILINEAR) {
+        return max(0.f, 1 - distance);
+    }
+    else if (method == InterpolationMethod::BICUBIC) {
+        // Keys cubic convolution with a = -0.5 (Catmull-Rom spline)
+        const float a = -0.5;
+        if (distance <= 1) {
+            return ((a + 2)*distance - (a + 3))*distance*distance + 1;
+        }
+        if (distance < 2) {
+            return ((a*distance - 5*a)*distance + 8*a)*distance - 4*a;
+        }
+        return 0;
+    }
+    else {
+        const float lobes = 3;
+        if (distance < 1e-6) {
+            return 1;
+        }
+        if (distance >= lobes) {
+            return 0;
+        }
+        const double pi_distance = M_PI*distance;
+        return lobes*sin(pi_distance)*sin(pi_distance/lobes)/(pi_distance*pi_distance);
+    }
+};
+
+template<int n_taps>
+void ResamplingKernel::resample_scalar_n_taps(const float *source, int width, int line_begin, int line_end, const float *x, const float *y, int n_pixels, PixelType *output) const   {
+    constexpr float max_value = std::numeric_limits<PixelType>::max();
+    const float *weights = m_weights.data();
+    for (int i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+        const float x_clamped = clamp_float(x[i_pixel], -c_max_distance_outside, width + c_max_distance_outside);
+        const float y_clamped = clamp_float(y[i_pixel], line_begin - c_max_distance_outside, line_end + c_max_distance_outside);
+        const float x_floor = floor(x_clamped);
+        const float y_floor = floor(y_clamped);
+        const float *weights_x = &weights[int((x_clamped - x_floor)*c_number_of_phases + 0.5f)*n_taps];
+        const float *weights_y = &weights[int((y_clamped - y_floor)*c_number_of_phases + 0.5f)*n_taps];
+        const int x_first = int(x_floor) + m_first_tap_offset;
+        const int y_first = int(y_floor) + m_first_tap_offset;
+
+        float value = 0;
+        for (int i_y = 0; i_y < n_taps; i_y++) {
+            const float *line = &source[size_t(clamp_index(y_first + i_y, line_begin, line_end - 1) - line_begin)*width];
+            float line_sum = 0;
+            for (int i_x = 0; i_x < n_taps; i_x++) {
+                line_sum += weights_x[i_x]*line[clamp_index(x_first + i_x, 0, width - 1)];
+            }
+            value += weights_y[i_y]*line_sum;
+        }
+        value = clamp_float(value, 0, max_value);
+        output[i_pixel] = int(value + 0.5f);
+    }
+};
+
+void ResamplingKernel::resample_scalar(const float *source, int width, int line_begin, int line_end, const float *x, const float *y, int n_pixels, PixelType *output) const  {
+    if (line_begin >= line_end || width <= 0) {
+        throw runtime_error("ResamplingKernel::resample: empty source image");
+    }
+    switch (m_number_of_taps) {
+        case 1:
+            resample_scalar_n_taps<1>(source, width, line_begin, line_end, x, y, n_pixels, output);
+            break;
+        case 2:
+            resample_scalar_n_taps<2>(source, width, line_begin, line_end, x, y, n_pixels, output);
+            break;
+        case 4:
+            resample_scalar_n_taps<4>(source, width, line_begin, line_end, x, y, n_pixels, output);
+            break;
+        case 6:
+            resample_scalar_n_taps<6>(source, width, line_begin, line_end, x, y, n_pixels, output);
+            break;
+    }
+};
+
+#ifdef ASTRO_PHOTO_STACKER_AVX2_KERNELS
+
+namespace {
+    __attribute__((target("avx2")))
+    inline __m256 clamp_8_values(__m256 values, float min_value, float max_value)  {
+        // the same comparisons as in the scalar clamp_float
+        values = _mm256_blendv_ps(values, _mm256_set1_ps(min_value), _mm256_cmp_ps(values, _mm256_set1_ps(min_value), _CMP_LT_OQ));
+        return _mm256_blendv_ps(values, _mm256_set1_ps(max_value), _mm256_cmp_ps(values, _mm256_set1_ps(max_value), _CMP_GT_OQ));
+    };
+
+    /**
+     * @brief Interpolate 8 output pixels, each lane does the same operations in the same order as the scalar implementation
+    */
+    template<int n_taps>
+    __attribute__((target("avx2")))
+    void resample_8_pixels_avx2(const float *source, int width, int line_begin, int line_end, int first_tap_offset, const float *weights,
+                                const float *x, const float *y, PixelType *output)  {
+        constexpr int n_phases = ResamplingKernel::c_number_of_phases;
+        const __m256 x_clamped = clamp_8_values(_mm256_loadu_ps(x), -c_max_distance_outside, width + c_max_distance_outside);
+        const __m256 y_clamped = clamp_8_values(_mm256_loadu_ps(y), line_begin - c_max_distance_outside, line_end + c_max_distance_outside);
+        const __m256 x_floor = _mm256_floor_ps(x_clamped);
+        const __m256 y_floor = _mm256_floor_ps(y_clamped);
+        const __m256 phases_count = _mm256_set1_ps(n_phases);
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256i n_taps_vector = _mm256_set1_epi32(n_taps);
+        const __m256i weights_x_index = _mm256_mullo_epi32(_mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(x_clamped, x_floor), phases_count), half)), n_taps_vector);
+        const __m256i weights_y_index = _mm256_mullo_epi32(_mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(y_clamped, y_floor), phases_count), half)), n_taps_vector);
+        const __m256i offset = _mm256_set1_epi32(first_tap_offset);
+        const __m256i x_first = _mm256_add_epi32(_mm256_cvttps_epi32(x_floor), offset);
+        const __m256i y_first = _mm256_add_epi32(_mm256_cvttps_epi32(y_floor), offset);
+
+        const __m256i zero_int = _mm256_setzero_si256();
+        const __m256i x_max = _mm256_set1_epi32(width - 1);
+        const __m256i y_min = _mm256_set1_epi32(line_begin);
+        const __m256i y_max = _mm256_set1_epi32(line_end - 1);
+        const __m256i width_vector = _mm256_set1_epi32(width);
+
+        __m256i columns[n_taps];
+        __m256 weights_x[n_taps];
+        for (int i_x = 0; i_x < n_taps; i_x++) {
+            const __m256i i_x_vector = _mm256_set1_epi32(i_x);
+            columns[i_x] = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(x_first, i_x_vector), zero_int), x_max);
+            weights_x[i_x] = _mm256_i32gather_ps(weights, _mm256_add_epi32(weights_x_index, i_x_vector), 4);
+        }
+
+        __m256 value = _mm256_setzero_ps();
+        for (int i_y = 0; i_y < n_taps; i_y++) {
+            const __m256i i_y_vector = _mm256_set1_epi32(i_y);
+            const __m256i line = _mm256_sub_epi32(_mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(y_first, i_y_vector), y_min), y_max), y_min);
+            const __m256i line_start = _mm256_mullo_epi32(line, width_vector);
+            __m256 line_sum = _mm256_setzero_ps();
+            for (int i_x = 0; i_x < n_taps; i_x++) {
+                const __m256 source_values = _mm256_i32gather_ps(source, _mm256_add_epi32(line_start, columns[i_x]), 4);
+                line_sum = _mm256_add_ps(line_sum, _mm256_mul_ps(weights_x[i_x], source_values));
+            }
+            const __m256 weight_y = _mm256_i32gather_ps(weights, _mm256_add_epi32(weights_y_index, i_y_vector), 4);
+            value = _mm256_add_ps(value, _mm256_mul_ps(weight_y, line_sum));
+        }
+
+        value = clamp_8_values(value, 0, std::numeric_limits<PixelType>::max());
+        const __m256i result = _mm256_cvttps_epi32(_mm256_add_ps(value, half));
+        const __m128i result_16bit = _mm_packs_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output), result_16bit);
+    };
+
+    template<int n_taps>
+    __attribute__((target("avx2")))
+    int resample_avx2(const float *source, int width, int line_begin, int line_end, int first_tap_offset, const float *weights,
+                      const float *x, const float *y, int n_pixels, PixelType *output)  {
+        int i_pixel = 0;
+        for (; i_pixel + 8 <= n_pixels; i_pixel += 8) {
+            resample_8_pixels_avx2<n_taps>(source, width, line_begin, line_end, first_tap_offset, weights, &x[i_pixel], &y[i_pixel], &output[i_pixel]);
+        }
+        return i_pixel;
+    };
+}
+
+#endif
+
+void ResamplingKernel::resample(const float *source, int width, int line_begin, int line_end, const float *x, const float *y, int n_pixels, PixelType *output) const    {
+#ifdef ASTRO_PHOTO_STACKER_AVX2_KERNELS
+    // indices of the gathered source pixels are 32-bit integers
+    const bool indices_fit_into_int = (long long)(line_end - line_begin)*width < std::numeric_limits<int>::max();
+    if (cpu_supports_avx2() && indices_fit_into_int && line_begin < line_end && width > 0) {
+        int n_processed = 0;
+        switch (m_number_of_taps) {
+            case 1:
+                n_processed = resample_avx2<1>(source, width, line_begin, line_end, m_first_tap_offset, m_weights.data(), x, y, n_pixels, output);
+                break;
+            case 2:
+                n_processed = resample_avx2<2>(source, width, line_begin, line_end, m_first_tap_offset, m_weights.data(), x, y, n_pixels, output);
+                break;
+            case 4:
+                n_processed = resample_avx2<4>(source, width, line_begin, line_end, m_first_tap_offset, m_weights.data(), x, y, n_pixels, output);
+                break;
+            case 6:
+                n_processed = resample_avx2<6>(source, width, line_begin, line_end, m_first_tap_offset, m_weights.data(), x, y, n_pixels, output);
+                break;
+        }
+        resample_scalar(source, width, line_begin, line_end, &x[n_processed], &y[n_processed], n_pixels - n_processed, &output[n_processed]);
+        return;
+    }
+#endif
+    resample_scalar(source, width, line_begin, line_end, x, y, n_pixels, output);
+};
@@ -0,0 +1,108 @@
+#include "../headers/SerFileMapping.h"
+#include "../headers/SharedInstanceCache.hxx"
+
+#include <stdexcept>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+SerFileMapping::SerFileMapping(const std::string &file_address) :
+    m_file_address(file_address)  {
+
+    const int file_descriptor = open(file_address.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        throw runtime_error("Unable to open video file: " + file_address);
+    }
+
+    if (!get_file_status(file_descriptor, &m_file_status)) {
+        close(file_descriptor);
+        throw runtime_error("Unable to get size of video file: " + file_address);
+    }
+    const size_t file_size = m_file_status.size;
+
+    if (file_size < c_header_size) {
+        close(file_descriptor);
+        throw runtime_error("File too small to be a valid SER video: " + file_address);
+    }
+
+    void *mapping = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    close(file_descriptor); // the mapping keeps its own reference to the file
+    if (mapping == MAP_FAILED) {
+        throw runtime_error("Unable to map video file into memory: " + file_address);
+    }
+    m_data = static_cast<const unsigned char*>(mapping);
+
+    // frames are usually read sequentially
+    madvise(mapping, file_size, MADV_SEQUENTIAL);
+
+    m_bayer_pattern_code = read_uint32(18);
+    m_width     = read_uint32(26);
+    m_height    = read_uint32(30);
+    m_bit_depth = read_uint32(34);
+
+    if (m_bit_depth != 8 && m_bit_depth != 16) {
+        munmap(mapping, file_size);
+        throw runtime_error("Unsupported bit depth in SER file: " + file_address);
+    }
+
+    m_frame_size_in_bytes = size_t(m_bit_depth/8) * m_width * m_height;
+    m_number_of_frames = m_frame_size_in_bytes > 0 ? (file_size - c_header_size)/m_frame_size_in_bytes : 0;
+};
+
+SerFileMapping::~SerFileMapping()   {
+    if (m_data != nullptr) {
+        munmap(const_cast<unsigned char*>(m_data), m_file_status.size);
+    }
+};
+
+std::shared_ptr<const SerFileMapping> SerFileMapping::get_instance(const std::string &file_address)    {
+    // the least recently used mapping is dropped from the cache, it is unmapped once the last reader using it is destroyed
+    static SharedInstanceCache<std::string, SerFileMapping, FileStatus> s_cache(c_max_cached_mappings);
+
+    FileStatus file_status;
+    if (!get_file_status(file_address, &file_status)) {
+        throw runtime_error("Unable to open video file: " + file_address);
+    }
+
+    // if the file was modified between the stat call and the mapping, the mapping is not reused by the next call, since its status does not match
+    return s_cache.get_instance(file_address, file_status, [&file_address]() {
+        return make_shared<const SerFileMapping>(file_address);
+    });
+};
+
+const unsigned char *SerFileMapping::get_frame_data(unsigned int frame_id) const   {
+    if (frame_id >= m_number_of_frames) {
+        throw runtime_error("File does not contain enough data for the requested frame: " + m_file_address);
+    }
+    return m_data + c_header_size + frame_id*m_frame_size_in_bytes;
+};
+
+void SerFileMapping::read_frame(unsigned int frame_id, PixelType *destination) const   {
+    const unsigned char *frame_data = get_frame_data(frame_id);
+    const size_t n_pixels = size_t(m_width)*m_height;
+
+    if (m_bit_depth == 16) {
+        // the data in the mapping do not have to be aligned for unsigned short, so memcpy is used to read them
+        for (size_t i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+            uint16_t value;
+            memcpy(&value, frame_data + 2*i_pixel, sizeof(uint16_t));
+            destination[i_pixel] = static_cast<PixelType>(value >> 1);
+        }
+    }
+    else {
+        for (size_t i_pixel = 0; i_pixel < n_pixels; i_pixel++) {
+            destination[i_pixel] = static_cast<PixelType>(frame_data[i_pixel] * 128);
+        }
+    }
+};
+
+std::uint32_t SerFileMapping::read_uint32(std::size_t position_in_file) const  {
+    uint32_t value;
+    memcpy(&value, m_data + position_in_file, sizeof(uint32_t));
+    return value;
+};
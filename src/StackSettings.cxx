@@ -1,5 +1,6 @@
 #include "../headers/StackSettings.h"
 #include "../headers/StackerFactory.h"
+#include "../headers/ResamplingKernel.h"
 
 #include <stdexcept>
 #include <algorithm>
@@ -8,7 +9,7 @@ using namespace AstroPhotoStacker;
 using namespace std;
 
 
-const std::vector<std::string> StackSettings::m_stacking_algorithms({"kappa-sigma median", "kappa-sigma mean", "average", "median", "cut-off average", "maximum", "minimum", "center", "quantil", "rms"});
+const std::vector<std::string> StackSettings::m_stacking_algorithms({"kappa-sigma median", "kappa-sigma mean", "average", "median", "cut-off average", "maximum", "minimum", "center", "quantil", "rms", "drizzle 1.5x", "drizzle 2x", "drizzle 3x"});
 
 void StackSettings::set_alignment_frame(const AstroPhotoStacker::InputFrame& alignment_frame)       {
     m_alignment_frame = alignment_frame;
@@ -47,6 +48,30 @@ int StackSettings::get_max_memory() const      {
     return m_max_memory;
 };
 
+void StackSettings::set_decoded_frame_cache_memory(int decoded_frame_cache_memory)    {
+    m_decoded_frame_cache_memory = decoded_frame_cache_memory;
+};
+
+int StackSettings::get_decoded_frame_cache_memory() const  {
+    return m_decoded_frame_cache_memory;
+};
+
+void StackSettings::set_decoded_frame_cache_folder(const std::string& decoded_frame_cache_folder)  {
+    m_decoded_frame_cache_folder = decoded_frame_cache_folder;
+};
+
+const std::string& StackSettings::get_decoded_frame_cache_folder() const   {
+    return m_decoded_frame_cache_folder;
+};
+
+void StackSettings::set_decoded_frame_cache_disk_limit(int decoded_frame_cache_disk_limit)    {
+    m_decoded_frame_cache_disk_limit = decoded_frame_cache_disk_limit;
+};
+
+int StackSettings::get_decoded_frame_cache_disk_limit() const  {
+    return m_decoded_frame_cache_disk_limit;
+};
+
 const std::vector<std::string>& StackSettings::get_stacking_algorithms() const {
     return m_stacking_algorithms;
 };
@@ -64,6 +89,24 @@ const std::string& StackSettings::get_stacking_algorithm() const       {
     return m_stacking_algorithm;
 };
 
+const std::vector<std::string>& StackSettings::get_interpolation_methods() const {
+    return AstroPhotoStacker::get_interpolation_methods();
+};
+
+void StackSettings::set_interpolation_method(const std::string& interpolation_method)      {
+    const std::vector<std::string> &interpolation_methods = get_interpolation_methods();
+    if (std::find(interpolation_methods.begin(), interpolation_methods.end(), interpolation_method) != interpolation_methods.end())    {
+        m_interpolation_method = interpolation_method;
+    }
+    else    {
+        throw std::invalid_argument("Interpolation method not found: \'" + interpolation_method + "\'");
+    }
+};
+
+const std::string& StackSettings::get_interpolation_method() const       {
+    return m_interpolation_method;
+};
+
 void StackSettings::set_hot_pixel_correction(bool hot_pixel_correction)    {
     m_hot_pixel_correction = hot_pixel_correction;
 };
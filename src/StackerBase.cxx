@@ -2,6 +2,10 @@
 #include "../headers/ImageFilesInputOutput.h"
 
 #include "../headers/AlignmentResultDummy.h"
+#include "../headers/TaskScheduler.hxx"
+#include "../headers/VideoDecodeSession.h"
+
+#include <algorithm>
 
 using namespace std;
 using namespace AstroPhotoStacker;
@@ -11,6 +15,10 @@ StackerBase::StackerBase(int number_of_colors, int width, int height, bool inter
     m_width = width;
     m_height = height;
     m_interpolate_colors = interpolate_colors;
+
+    m_configurable_algorithm_settings.add_additional_setting_bool("decode frames only once", &m_decode_frames_only_once);
+    m_configurable_algorithm_settings.add_additional_setting_numerical("prefetch queue depth", &m_prefetch_queue_depth, 0, 64, 1);
+    m_configurable_algorithm_settings.add_additional_setting_numerical("prefetch memory budget [MB]", &m_prefetch_memory_budget_in_mb, 0, 65536, 256);
 };
 
 void StackerBase::set_memory_usage_limit(int memory_usage_limit_in_mb)  {
@@ -113,13 +121,26 @@ void StackerBase::save_stacked_photo(const std::string &file_address, const std:
     }
 };
 
+void StackerBase::set_aligned_frame_store(const std::string &folder, bool compress)  {
+    m_aligned_frame_store_folder = folder;
+    m_aligned_frame_store_compress = compress;
+};
+
+void StackerBase::set_interpolation_method(InterpolationMethod interpolation_method)  {
+    m_interpolation_method = interpolation_method;
+};
+
 void StackerBase::set_number_of_cpu_threads(unsigned int n_cpu) {
     m_n_cpu = n_cpu;
 };
 
 void StackerBase::calculate_stacked_photo()  {
     m_stacked_image = vector<vector<double> >(m_number_of_colors, vector<double>(m_width*m_height, c_empty_pixel_value));
+    if (use_calibrated_frames_slab()) {
+        fill_calibrated_frames_slab();
+    }
     calculate_stacked_photo_internal();
+    m_calibrated_frames_slab = nullptr;
 };
 
 void StackerBase::fix_empty_pixels()    {
@@ -144,18 +165,49 @@ void StackerBase::fix_empty_pixels()    {
         return n_pixels != 0 ? sum/n_pixels : 0.;
     };
 
+    // Searching for the empty pixels is the expensive part, it is done in parallel. There are usually only a few empty pixels,
+    // they are fixed sequentially in the original order, since a fixed pixel is used when fixing its neighbours.
     for (vector<double> &color : m_stacked_image) {
-        for (int i_y = 0; i_y < m_height; i_y++) {
-            for (int i_x = 0; i_x < m_width; i_x++) {
-                const int i_pixel = i_x + i_y*m_width;
-                if (color[i_pixel] == c_empty_pixel_value) {
-                    color[i_pixel] = get_average_from_pixels_around(color, i_x, i_y, m_width, m_height);
+        vector<vector<int>> empty_pixels_in_lines(m_height);
+        process_lines_in_parallel(0, m_height, [this, &color, &empty_pixels_in_lines](int y_begin, int y_end) {
+            for (int i_y = y_begin; i_y < y_end; i_y++) {
+                const double *line = &color[size_t(i_y)*m_width];
+                for (int i_x = 0; i_x < m_width; i_x++) {
+                    if (line[i_x] == c_empty_pixel_value) {
+                        empty_pixels_in_lines[i_y].push_back(i_x);
+                    }
                 }
             }
+        });
+
+        for (int i_y = 0; i_y < m_height; i_y++) {
+            for (int i_x : empty_pixels_in_lines[i_y]) {
+                color[i_x + size_t(i_y)*m_width] = get_average_from_pixels_around(color, i_x, i_y, m_width, m_height);
+            }
         }
     }
 };
 
+void StackerBase::process_lines_in_parallel(int y_min, int y_max, const std::function<void(int y_begin, int y_end)> &process_lines) const  {
+    const int n_lines = y_max - y_min;
+    if (m_n_cpu < 2 || n_lines < 2) {
+        process_lines(y_min, y_max);
+        return;
+    }
+
+    // a few blocks per thread to balance the load
+    const int n_blocks = min<int>(n_lines, 4*m_n_cpu);
+    const int lines_per_block = (n_lines + n_blocks - 1)/n_blocks;
+    TaskScheduler pool({size_t(m_n_cpu)});
+    for (int y_begin = y_min; y_begin < y_max; y_begin += lines_per_block) {
+        const int y_end = min(y_begin + lines_per_block, y_max);
+        pool.submit([&process_lines, y_begin, y_end]() {
+            process_lines(y_begin, y_end);
+        }, {1});
+    }
+    pool.wait_for_tasks();
+};
+
 int StackerBase::get_output_bit_depth(int open_cv_image_type)    {
     const int bit_depth_mask = 0b111;
     const int bit_depth_code = open_cv_image_type & bit_depth_mask;
@@ -207,8 +259,24 @@ CalibratedPhotoHandler StackerBase::get_calibrated_photo(unsigned int i_file, in
     const InputFrame &input_frame = m_frames_to_stack[i_file];
     const bool apply_alignment = m_apply_alignment[i_file];
     unique_ptr<AlignmentResultBase> alignment_result = apply_alignment ? m_photo_alignment_handler->get_alignment_parameters(input_frame) : nullptr;
+    unique_ptr<InputFrameReader> input_frame_reader = m_frame_prefetcher != nullptr ?
+                                                        m_frame_prefetcher->get_frame(input_frame) :
+                                                        make_unique<InputFrameReader>(input_frame);
+    return calibrate_frame(std::move(input_frame_reader), alignment_result.get(), m_calibration_frame_handlers.at(i_file), y_min, y_max);
+};
+
+CalibratedPhotoHandler StackerBase::calibrate_frame(const InputFrame &input_frame,
+                                                    const AlignmentResultBase *alignment_result,
+                                                    const std::vector<std::shared_ptr<const CalibrationFrameBase> > &calibration_frame_handlers,
+                                                    int y_min, int y_max) const {
+    return calibrate_frame(make_unique<InputFrameReader>(input_frame), alignment_result, calibration_frame_handlers, y_min, y_max);
+};
 
-    CalibratedPhotoHandler calibrated_photo(input_frame, m_interpolate_colors);
+CalibratedPhotoHandler StackerBase::calibrate_frame(std::unique_ptr<InputFrameReader> input_frame_reader,
+                                                    const AlignmentResultBase *alignment_result,
+                                                    const std::vector<std::shared_ptr<const CalibrationFrameBase> > &calibration_frame_handlers,
+                                                    int y_min, int y_max) const {
+    CalibratedPhotoHandler calibrated_photo(std::move(input_frame_reader), m_interpolate_colors);
     if (alignment_result != nullptr) {
         calibrated_photo.define_alignment(*alignment_result);
     }
@@ -217,12 +285,178 @@ CalibratedPhotoHandler StackerBase::get_calibrated_photo(unsigned int i_file, in
     }
 
     calibrated_photo.limit_y_range(y_min, y_max);
+    calibrated_photo.set_interpolation_method(m_interpolation_method);
+    // with fewer frames than threads, the frames are not processed in parallel - use the threads inside of the frame
+    if (m_frames_to_stack.size() < m_n_cpu) {
+        calibrated_photo.set_number_of_threads(m_n_cpu);
+    }
     if (m_hot_pixel_identifier != nullptr)  {
         calibrated_photo.register_hot_pixel_identifier(m_hot_pixel_identifier.get());
     }
-    for (const std::shared_ptr<const CalibrationFrameBase> &calibration_frame : m_calibration_frame_handlers.at(i_file)) {
+    for (const std::shared_ptr<const CalibrationFrameBase> &calibration_frame : calibration_frame_handlers) {
         calibrated_photo.register_calibration_frame(calibration_frame);
     }
     calibrated_photo.calibrate();
     return calibrated_photo;
 };
+
+
+std::vector<std::vector<PixelType>> StackerBase::get_calibrated_data(unsigned int i_file, int y_min, int y_max) const  {
+    if (m_calibrated_frames_slab != nullptr) {
+        return m_calibrated_frames_slab->read_lines(i_file, y_min, y_max);
+    }
+
+    CalibratedPhotoHandler calibrated_photo = get_calibrated_photo(i_file, y_min, y_max);
+    return calibrated_photo.release_calibrated_data_after_color_interpolation();
+};
+
+bool StackerBase::use_calibrated_frames_slab() const {
+    if (m_frames_to_stack.empty()) {
+        return false;
+    }
+    if (!m_aligned_frame_store_folder.empty()) {
+        return true;
+    }
+    if (!m_decode_frames_only_once) {
+        return false;
+    }
+    const int height_range = get_height_range_limit();
+    return height_range > 0 && height_range < m_height;
+};
+
+void StackerBase::start_frame_prefetching()  {
+    start_frame_prefetching(m_frames_to_stack, get_number_of_consecutive_frames_per_task(m_frames_to_stack.size(), m_n_cpu));
+};
+
+void StackerBase::start_frame_prefetching(const std::vector<InputFrame> &frames_to_prefetch, unsigned int frames_per_range)  {
+    m_frame_prefetcher = nullptr;
+    m_decoded_frame_cache_pass_guard = nullptr;
+    if (m_calibrated_frames_slab != nullptr || frames_to_prefetch.empty()) {
+        return;
+    }
+
+    const size_t memory_per_frame = size_t(m_number_of_colors)*m_width*m_height*sizeof(PixelType);
+    m_decoded_frame_cache_pass_guard = make_unique<DecodedFrameCache::PassGuard>(&DecodedFrameCache::get_global_instance(), frames_to_prefetch.size(), memory_per_frame);
+    if (m_prefetch_queue_depth > 0) {
+        m_frame_prefetcher = make_unique<FramePrefetcher>(frames_to_prefetch, frames_per_range, m_n_cpu, m_prefetch_queue_depth, get_prefetch_memory_budget_in_mb());
+    }
+};
+
+void StackerBase::stop_frame_prefetching()   {
+    m_frame_prefetcher = nullptr;
+    m_decoded_frame_cache_pass_guard = nullptr;
+    // the videos are not kept open by the threads of the pool between the passes
+    VideoDecodeSession::release_all_sessions();
+};
+
+int StackerBase::get_prefetch_memory_budget_in_mb() const  {
+    if (m_memory_usage_limit_in_mb <= 0) {
+        return m_prefetch_memory_budget_in_mb;
+    }
+    // 0 means unlimited prefetch budget, with the memory usage limit set it has to be limited as well
+    const int limit_from_memory_usage = max(1, m_memory_usage_limit_in_mb/4);
+    return m_prefetch_memory_budget_in_mb > 0 ? min(m_prefetch_memory_budget_in_mb, limit_from_memory_usage) : limit_from_memory_usage;
+};
+
+unsigned long long int StackerBase::get_memory_available_for_stacking(unsigned long long int memory_reserved) const  {
+    const unsigned long long int memory_usage_limit = m_memory_usage_limit_in_mb*1024ULL*1024ULL;
+    if (m_prefetch_queue_depth > 0) {
+        memory_reserved += get_prefetch_memory_budget_in_mb()*1024ULL*1024ULL;
+    }
+    memory_reserved += DecodedFrameCache::get_global_instance().get_memory_budget();
+    return memory_usage_limit > memory_reserved ? memory_usage_limit - memory_reserved : 0;
+};
+
+std::string StackerBase::get_calibrated_frame_description(  unsigned int i_file,
+                                                            const std::map<const CalibrationFrameBase*, unsigned long long> &calibration_frame_checksums,
+                                                            const std::string &hot_pixels_description) const  {
+    const InputFrame &input_frame = m_frames_to_stack[i_file];
+    unique_ptr<AlignmentResultBase> alignment_result = m_apply_alignment[i_file] ? m_photo_alignment_handler->get_alignment_parameters(input_frame) : nullptr;
+
+    string description = "frame: " + input_frame.to_string() + "\n";
+    description += "alignment: " + (alignment_result != nullptr ? alignment_result->get_description_string() : string("none")) + "\n";
+    description += "colors: " + to_string(m_number_of_colors) + ", size: " + to_string(m_width) + "x" + to_string(m_height);
+    description += ", interpolate colors: " + to_string(m_interpolate_colors);
+    description += ", interpolation: " + interpolation_method_to_string(m_interpolation_method) + "\n";
+    for (const std::shared_ptr<const CalibrationFrameBase> &calibration_frame : m_calibration_frame_handlers.at(i_file)) {
+        description += "calibration frame: " + to_string(calibration_frame_checksums.at(calibration_frame.get())) + "\n";
+    }
+    description += hot_pixels_description;
+    return description;
+};
+
+void StackerBase::fill_calibrated_frames_slab()   {
+    m_calibrated_frames_slab = nullptr;
+    const bool use_store = !m_aligned_frame_store_folder.empty();
+    auto calibrated_frames_slab = make_unique<CalibratedFramesSlab>(m_number_of_colors, m_width, m_height,
+                                                                    m_aligned_frame_store_folder,
+                                                                    use_store && m_aligned_frame_store_compress);
+
+    // the descriptions are needed only to recognize the frames stored by the previous runs, the calibration frames are shared by the light frames - their checksums are calculated only once
+    const unsigned int n_files = m_frames_to_stack.size();
+    vector<string> frame_descriptions(n_files);
+    if (use_store) {
+        map<const CalibrationFrameBase*, unsigned long long> calibration_frame_checksums;
+        for (const vector<shared_ptr<const CalibrationFrameBase>> &calibration_frames : m_calibration_frame_handlers) {
+            for (const shared_ptr<const CalibrationFrameBase> &calibration_frame : calibration_frames) {
+                if (calibration_frame_checksums.find(calibration_frame.get()) == calibration_frame_checksums.end()) {
+                    calibration_frame_checksums[calibration_frame.get()] = calibration_frame->get_checksum();
+                }
+            }
+        }
+        const string hot_pixels_description = m_hot_pixel_identifier != nullptr ?
+                                                "hot pixels: " + to_string(m_hot_pixel_identifier->get_hot_pixels().size()) + ", checksum: " + to_string(m_hot_pixel_identifier->get_hot_pixels_checksum()) + "\n" :
+                                                "";
+        for (unsigned int i_file = 0; i_file < n_files; i_file++) {
+            frame_descriptions[i_file] = get_calibrated_frame_description(i_file, calibration_frame_checksums, hot_pixels_description);
+        }
+    }
+
+    vector<unsigned int> files_to_calibrate;
+    vector<InputFrame> frames_to_calibrate;
+    for (unsigned int i_file = 0; i_file < n_files; i_file++) {
+        if (!calibrated_frames_slab->contains_frame(i_file, m_frames_to_stack[i_file].to_string(), frame_descriptions[i_file])) {
+            files_to_calibrate.push_back(i_file);
+            frames_to_calibrate.push_back(m_frames_to_stack[i_file]);
+        }
+    }
+
+    if (use_store) {
+        cout << "Aligned frame store: " << n_files - files_to_calibrate.size() << " frames reused, "
+             << files_to_calibrate.size() << " frames will be calibrated" << endl;
+    }
+    else {
+        cout << "Stacking will be split into several slices, calibrated frames will be stored in temporary files ("
+             << calibrated_frames_slab->get_disk_space_needed(n_files)/(1024*1024) << " MB)" << endl;
+    }
+    m_n_tasks_processed += n_files - files_to_calibrate.size();
+    const size_t n_to_calibrate = files_to_calibrate.size();
+    const size_t files_per_task = get_number_of_consecutive_frames_per_task(n_to_calibrate, m_n_cpu);
+    start_frame_prefetching(frames_to_calibrate, files_per_task);
+
+    // ranges of consecutive frames are processed by one task, so that video frames are decoded without seeking
+    auto store_frames = [&](size_t first_index, size_t last_index) {
+        for (size_t index = first_index; index < last_index; index++) {
+            const unsigned int i_file = files_to_calibrate[index];
+            cout << "Calibrating " + m_frames_to_stack[i_file].to_string() + "\n";
+            const CalibratedPhotoHandler calibrated_photo = get_calibrated_photo(i_file, 0, m_height);
+            calibrated_frames_slab->store_frame(i_file, m_frames_to_stack[i_file].to_string(), frame_descriptions[i_file],
+                                                calibrated_photo.get_calibrated_data_after_color_interpolation());
+            m_n_tasks_processed++;
+        }
+    };
+
+    TaskScheduler pool({size_t(m_n_cpu)});
+    for (size_t i_first = 0; i_first < n_to_calibrate; i_first += files_per_task) {
+        const size_t i_last = min(i_first + files_per_task, n_to_calibrate);
+        if (m_n_cpu > 1) {
+            pool.submit(store_frames, {1}, i_first, i_last);
+        }
+        else {
+            store_frames(i_first, i_last);
+        }
+    }
+    pool.wait_for_tasks();
+    stop_frame_prefetching();
+    m_calibrated_frames_slab = std::move(calibrated_frames_slab);
+};
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "../headers/StackerCutOffAverage.h"
+#include "../headers/PixelSelection.hxx"
 
 
 StackerCutOffAverage::StackerCutOffAverage(int number_of_colors, int width, int height, bool interpolate_colors) :
@@ -7,19 +8,21 @@ StackerCutOffAverage::StackerCutOffAverage(int number_of_colors, int width, int
     m_configurable_algorithm_settings.add_additional_setting_numerical("tail_fraction_to_cut_off", &m_tail_fraction_to_cut_off, 0.0, 0.45, 0.01);
 };
 
-double StackerCutOffAverage::get_stacked_value_from_pixel_array(PixelType *ordered_array_begin, unsigned int number_of_stacked_pixels) {
+double StackerCutOffAverage::get_stacked_value_from_pixel_array(PixelType *array_begin, unsigned int number_of_stacked_pixels) {
     unsigned int pixels_to_cut_off = int(m_tail_fraction_to_cut_off*number_of_stacked_pixels + 0.5);
     if (number_of_stacked_pixels == 0) {
         return c_empty_pixel_value;
     }
 
     if (pixels_to_cut_off*2 >= number_of_stacked_pixels) {
-        return ordered_array_begin[number_of_stacked_pixels/2];
+        return AstroPhotoStacker::PixelSelection::select_nth_element(array_begin, number_of_stacked_pixels, number_of_stacked_pixels/2);
     }
 
+    // only the tails have to be separated, the order of the remaining values does not matter for the average
+    AstroPhotoStacker::PixelSelection::separate_tails(array_begin, number_of_stacked_pixels, pixels_to_cut_off, pixels_to_cut_off);
     double sum = 0;
     for (int i = pixels_to_cut_off; i < int(number_of_stacked_pixels - pixels_to_cut_off); i++) {
-        sum += ordered_array_begin[i];
+        sum += array_begin[i];
     }
     return sum/(number_of_stacked_pixels - 2*pixels_to_cut_off);
 };
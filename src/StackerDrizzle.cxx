@@ -0,0 +1,201 @@
+#include "../headers/StackerDrizzle.h"
+#include "../headers/CalibratedPhotoHandler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+StackerDrizzle::StackerDrizzle(int number_of_colors, int width, int height, bool interpolate_colors, float scale) :
+    StackerSimpleBase(number_of_colors, int(width*scale), int(height*scale), interpolate_colors)  {
+
+    m_input_width   = width;
+    m_input_height  = height;
+    m_scale         = scale;
+    m_configurable_algorithm_settings.add_additional_setting_numerical("drop size", &m_drop_size, 0.1, 1.0, 0.05);
+};
+
+void StackerDrizzle::allocate_arrays_for_stacking(int dy) {
+    const size_t accumulator_size_total = size_t(m_n_cpu)*m_number_of_colors*m_width*dy;
+    m_flux_individual_threads    = vector<float>(accumulator_size_total, 0);
+    m_weights_individual_threads = vector<float>(accumulator_size_total, 0);
+};
+
+void StackerDrizzle::reset_values_in_arrays_for_stacking()  {
+    fill(m_flux_individual_threads.begin(), m_flux_individual_threads.end(), 0);
+    fill(m_weights_individual_threads.begin(), m_weights_individual_threads.end(), 0);
+};
+
+void StackerDrizzle::deallocate_arrays_for_stacking() {
+    m_flux_individual_threads.clear();
+    m_weights_individual_threads.clear();
+};
+
+void StackerDrizzle::add_values_to_stack(int i_color, const PixelType *values, size_t n_values, int i_thread) {
+    throw runtime_error("StackerDrizzle::add_values_to_stack: drizzle needs the positions of the input pixels, use add_photo_to_accumulators instead");
+};
+
+void StackerDrizzle::get_input_line_range(const AlignmentResultBase *alignment_result, int y_min, int y_max, int *input_y_min, int *input_y_max) const  {
+    // reference frame pixel "i" covers <i - 0.5, i + 0.5), output pixel "j" covers <j/scale - 0.5, (j+1)/scale - 0.5) in the reference frame
+    const float y_reference_min = y_min/m_scale - 0.5f;
+    const float y_reference_max = y_max/m_scale - 0.5f;
+    if (alignment_result == nullptr) {
+        *input_y_min = max(0, int(floor(y_reference_min)) - 1);
+        *input_y_max = min(m_input_height, int(ceil(y_reference_max)) + 2);
+        return;
+    }
+
+    // the same coarse grid sampling as in CalibratedPhotoHandler::get_y_range_in_original_photo
+    const int step = 16;
+    float y_original_min = m_input_height;
+    float y_original_max = -1;
+    auto update_range = [&](float x, float y) {
+        float x_original = x;
+        float y_original = y;
+        alignment_result->transform_from_reference_to_shifted_frame(&x_original, &y_original);
+        y_original_min = min(y_original_min, y_original);
+        y_original_max = max(y_original_max, y_original);
+    };
+    const float x_reference_max = m_input_width - 0.5f;
+    for (float y = y_reference_min; y < y_reference_max + step; y += step) {
+        const float y_sample = min(y, y_reference_max);
+        for (float x = -0.5f; x < x_reference_max + step; x += step) {
+            update_range(min(x, x_reference_max), y_sample);
+        }
+    }
+
+    // the drops are at most one input pixel large, the rest of the margin covers non-linear local shifts between the grid points
+    const int margin = 2;
+    *input_y_min = max(0, int(floor(y_original_min)) - margin);
+    *input_y_max = min(m_input_height, int(ceil(y_original_max)) + margin + 1);
+};
+
+void StackerDrizzle::add_photo_to_accumulators(unsigned int i_file, int y_min, int y_max, unsigned int i_thread)  {
+    cout << "Adding " + m_frames_to_stack[i_file].to_string() + " to stack\n";
+    const InputFrame &input_frame = m_frames_to_stack[i_file];
+    const unique_ptr<AlignmentResultBase> alignment_result = m_apply_alignment[i_file] ? m_photo_alignment_handler->get_alignment_parameters(input_frame) : nullptr;
+    // the frame has to be taken from the prefetcher even if it does not overlap with the slice
+    unique_ptr<InputFrameReader> input_frame_reader =   m_frame_prefetcher != nullptr ?
+                                                        m_frame_prefetcher->get_frame(input_frame) :
+                                                        make_unique<InputFrameReader>(input_frame);
+
+    int input_y_min, input_y_max;
+    get_input_line_range(alignment_result.get(), y_min, y_max, &input_y_min, &input_y_max);
+    if (input_y_min >= input_y_max) {
+        m_n_tasks_processed++;
+        return;
+    }
+
+    // calibrated, but not shifted - the alignment is applied to the drops
+    const CalibratedPhotoHandler calibrated_photo = calibrate_frame(std::move(input_frame_reader), nullptr, m_calibration_frame_handlers.at(i_file), input_y_min, input_y_max);
+    const vector<vector<PixelType>> &calibrated_data = calibrated_photo.get_calibrated_data_after_color_interpolation();
+    const int input_width = calibrated_photo.get_width();
+    input_y_max = min(input_y_max, calibrated_photo.get_height());
+
+    vector<float*>  flux(m_number_of_colors);
+    vector<float*>  weights(m_number_of_colors);
+    for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
+        flux[i_color]       = &m_flux_individual_threads[get_accumulator_index(i_thread, i_color)];
+        weights[i_color]    = &m_weights_individual_threads[get_accumulator_index(i_thread, i_color)];
+    }
+
+    // positions of the input pixels in the reference frame, transformed for the whole line at once
+    vector<float> x_reference_line(input_width);
+    vector<float> y_reference_line(input_width);
+
+    const float half_drop_size = 0.5f*m_drop_size*m_scale;
+    for (int y = input_y_min; y < input_y_max; y++) {
+        const size_t line_index = size_t(y - input_y_min)*input_width;
+        if (alignment_result != nullptr) {
+            alignment_result->transform_row_to_reference_frame(y, 0, input_width, x_reference_line.data(), y_reference_line.data());
+        }
+        else {
+            for (int x = 0; x < input_width; x++) {
+                x_reference_line[x] = x;
+                y_reference_line[x] = y;
+            }
+        }
+
+        for (int x = 0; x < input_width; x++) {
+            // drop in the coordinates of the output grid, where output pixel "j" covers <j, j+1)
+            const float x_center = (x_reference_line[x] + 0.5f)*m_scale;
+            const float y_center = (y_reference_line[x] + 0.5f)*m_scale;
+            const float drop_x_min = x_center - half_drop_size;
+            const float drop_x_max = x_center + half_drop_size;
+            const float drop_y_min = y_center - half_drop_size;
+            const float drop_y_max = y_center + half_drop_size;
+
+            const int output_x_begin = max(0, int(floor(drop_x_min)));
+            const int output_x_end   = min(m_width, int(ceil(drop_x_max)));
+            const int output_y_begin = max(y_min, int(floor(drop_y_min)));
+            const int output_y_end   = min(y_max, int(ceil(drop_y_max)));
+            if (output_x_begin >= output_x_end || output_y_begin >= output_y_end) {
+                continue;
+            }
+
+            for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
+                const PixelType value = calibrated_data[i_color][line_index + x];
+                if (value < 0) {
+                    continue;
+                }
+                for (int output_y = output_y_begin; output_y < output_y_end; output_y++) {
+                    const float overlap_y = min(drop_y_max, output_y + 1.f) - max(drop_y_min, float(output_y));
+                    const size_t output_line_index = size_t(output_y - y_min)*m_width;
+                    for (int output_x = output_x_begin; output_x < output_x_end; output_x++) {
+                        const float overlap_x = min(drop_x_max, output_x + 1.f) - max(drop_x_min, float(output_x));
+                        const float overlap = overlap_x*overlap_y;
+                        flux[i_color][output_line_index + output_x]     += overlap*value;
+                        weights[i_color][output_line_index + output_x]  += overlap;
+                    }
+                }
+            }
+        }
+    }
+
+    m_n_tasks_processed++;
+};
+
+void StackerDrizzle::calculate_final_image(int y_min, int y_max)    {
+    const int pixel_shift = y_min*m_width;
+    const int dy = y_max - y_min;
+
+    // sum partial results
+    reduce_accumulators(size_t(m_width)*dy, [this](int i_thread_target, int i_thread_source, int i_color, size_t pixel_begin, size_t pixel_end) {
+        float       *flux_target    = &m_flux_individual_threads[get_accumulator_index(i_thread_target, i_color)];
+        float       *weights_target = &m_weights_individual_threads[get_accumulator_index(i_thread_target, i_color)];
+        const float *flux_source    = &m_flux_individual_threads[get_accumulator_index(i_thread_source, i_color)];
+        const float *weights_source = &m_weights_individual_threads[get_accumulator_index(i_thread_source, i_color)];
+        for (size_t i_pixel = pixel_begin; i_pixel < pixel_end; i_pixel++) {
+            flux_target[i_pixel]    += flux_source[i_pixel];
+            weights_target[i_pixel] += weights_source[i_pixel];
+        }
+    });
+
+    process_lines_in_parallel(y_min, y_max, [this, y_min, pixel_shift](int y_begin, int y_end) {
+        const size_t pixel_begin = size_t(y_begin - y_min)*m_width;
+        const size_t pixel_end   = size_t(y_end - y_min)*m_width;
+        for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
+            const float *flux       = &m_flux_individual_threads[get_accumulator_index(0, i_color)];
+            const float *weights    = &m_weights_individual_threads[get_accumulator_index(0, i_color)];
+            double      *result     = &m_stacked_image[i_color][pixel_shift];
+            for (size_t i_pixel = pixel_begin; i_pixel < pixel_end; i_pixel++) {
+                const float weight = weights[i_pixel];
+                result[i_pixel] = weight > 0 ? double(flux[i_pixel])/weight : c_empty_pixel_value;
+            }
+        }
+    });
+};
+
+int StackerDrizzle::get_height_range_limit() const {
+    int height_range = m_height;
+    if (m_memory_usage_limit_in_mb > 0) {
+        const unsigned long long int memory_needed_for_stacked_image = 3*sizeof(double)*m_width*m_height;
+        const unsigned long long int memory_needed_for_calibrated_photos = m_n_cpu*3*sizeof(PixelType)*m_input_width*m_input_height;
+        const unsigned long long int memory_for_accumulators = get_memory_available_for_stacking(memory_needed_for_stacked_image + memory_needed_for_calibrated_photos);
+        const unsigned long long int memory_usage_per_line = m_number_of_colors*m_n_cpu*2ULL*sizeof(float)*m_width;
+        height_range = min<unsigned long long int>(height_range, memory_for_accumulators/memory_usage_per_line);
+    }
+    return height_range;
+};
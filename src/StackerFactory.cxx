@@ -11,8 +11,12 @@
 #include "../headers/StackerCenter.h"
 #include "../headers/StackerQuantil.h"
 #include "../headers/StackerRMS.h"
+#include "../headers/StackerDrizzle.h"
 
 #include "../headers/ConfigurableAlgorithmSettings.h"
+#include "../headers/DecodedFrameCache.h"
+
+#include <algorithm>
 
 
 
@@ -46,20 +50,37 @@ std::unique_ptr<StackerBase> AstroPhotoStacker::create_stacker(const std::string
     else if (stacker_type == "rms") {
         return std::make_unique<StackerRMS>(number_of_colors, width, height, interpolate_colors);
     }
+    else if (stacker_type == "drizzle 1.5x") {
+        return std::make_unique<StackerDrizzle>(number_of_colors, width, height, interpolate_colors, 1.5);
+    }
+    else if (stacker_type == "drizzle 2x") {
+        return std::make_unique<StackerDrizzle>(number_of_colors, width, height, interpolate_colors, 2);
+    }
+    else if (stacker_type == "drizzle 3x") {
+        return std::make_unique<StackerDrizzle>(number_of_colors, width, height, interpolate_colors, 3);
+    }
     else {
         throw std::runtime_error("Unknown stacker type: " + stacker_type);
     }
 };
 
 void AstroPhotoStacker::configure_stacker(StackerBase* stacker, const StackSettings &settings)   {
+    configure_decoded_frame_cache(settings);
     stacker->set_number_of_cpu_threads(settings.get_n_cpus());
     stacker->set_memory_usage_limit(settings.get_max_memory());
+    stacker->set_interpolation_method(string_to_interpolation_method(settings.get_interpolation_method()));
 
     const ConfigurableAlgorithmSettingsMap configuration_map = settings.get_algorithm_specific_settings();
     ConfigurableAlgorithmSettings& configurable_settings = stacker->get_configurable_algorithm_settings();
     configurable_settings.set_values_from_configuration_map(configuration_map);
 };
 
+void AstroPhotoStacker::configure_decoded_frame_cache(const StackSettings &settings)  {
+    DecodedFrameCache &decoded_frame_cache = DecodedFrameCache::get_global_instance();
+    decoded_frame_cache.set_memory_budget(size_t(max(settings.get_decoded_frame_cache_memory(), 0))*1024*1024);
+    decoded_frame_cache.set_disk_cache(settings.get_decoded_frame_cache_folder(), size_t(max(settings.get_decoded_frame_cache_disk_limit(), 0))*1024*1024);
+};
+
 std::unique_ptr<StackerBase> AstroPhotoStacker::create_stacker(const StackSettings &settings, int number_of_colors, int width, int height) {
     bool interpolate_colors = settings.use_color_interpolation();
     std::unique_ptr<StackerBase> stacker = create_stacker(settings.get_stacking_algorithm(), number_of_colors, width, height, interpolate_colors);
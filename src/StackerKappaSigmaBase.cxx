@@ -1,6 +1,8 @@
 #include "../headers/StackerKappaSigmaBase.h"
+#include "../headers/KappaSigmaClippingKernel.h"
 
 #include <algorithm>
+#include <cstdint>
 
 using namespace std;
 using namespace AstroPhotoStacker;
@@ -12,42 +14,48 @@ StackerKappaSigmaBase::StackerKappaSigmaBase(int number_of_colors, int width, in
         m_configurable_algorithm_settings.add_additional_setting_numerical("n_iterations", &m_n_iterations, 1, 20, 1);
 };
 
+void StackerKappaSigmaBase::process_line(int y_index_final_array, int y_index_values_to_stack_array, int i_color)    {
+    const unsigned int n_files = m_frames_to_stack.size();
+    constexpr unsigned int block_size = c_kappa_sigma_block_size;
+
+    vector<PixelType>   block_values(n_files*block_size);
+    vector<uint8_t>     block_valid_mask(n_files);
+    vector<PixelType>   kept_values(n_files);
+    double              sums_of_kept_values[block_size];
+    unsigned int        numbers_of_kept_values[block_size];
+
+    const bool keep_values = needs_kept_values();
+    const size_t line_start_index = size_t(m_width)*y_index_values_to_stack_array;
+    for (int x_block_start = 0; x_block_start < m_width; x_block_start += block_size) {
+        const unsigned int n_columns = min<int>(block_size, m_width - x_block_start);
+        const size_t block_start_index = line_start_index + x_block_start;
+
+        // frames are stored contiguously in m_values_to_stack, so each row of the structure-of-arrays block is a short contiguous copy
+        for (unsigned int i_file = 0; i_file < n_files; i_file++) {
+            const PixelType *line_segment = get_values_to_stack(i_color, i_file, block_start_index);
+            copy(line_segment, line_segment + n_columns, &block_values[i_file*block_size]);
+            block_valid_mask[i_file] = get_validity_bits(i_color, i_file, block_start_index, n_columns);
+        }
 
-void StackerKappaSigmaBase::apply_kappa_sigma_clipping(PixelType **ordered_array_begin, unsigned int *number_of_stacked_pixels)    {
-    PixelType * const current_begin = *ordered_array_begin;
-    for (int i_iter = 0; i_iter < m_n_iterations; i_iter++)    {
+        apply_kappa_sigma_clipping_to_block(block_values.data(), block_valid_mask.data(), n_files, m_kappa, m_n_iterations, sums_of_kept_values, numbers_of_kept_values);
 
-        double mean(0), mean2(0);
-        int n = 0;
-        for (unsigned int i_pixel = 0; i_pixel < *number_of_stacked_pixels; i_pixel++) {
-            if (current_begin[i_pixel] >= 0) {
-                mean += current_begin[i_pixel];
-                mean2 += current_begin[i_pixel]*current_begin[i_pixel];
-                n++;
+        for (unsigned int i_column = 0; i_column < n_columns; i_column++) {
+            const unsigned long long int pixel_index = m_width*y_index_final_array + x_block_start + i_column;
+            const unsigned int n_kept = numbers_of_kept_values[i_column];
+            if (n_kept == 0) {
+                m_stacked_image[i_color][pixel_index] = c_empty_pixel_value;
+                continue;
             }
-        }
-        mean /= n;
-        mean2 /= n;
-        const double sigma = sqrt(mean2 - mean*mean);
-        const double kappa_sigma = m_kappa*sigma;
-        for (unsigned int i_pixel = 0; i_pixel < *number_of_stacked_pixels; i_pixel++) {
-            if (current_begin[i_pixel] >= 0) {
-                if (abs(current_begin[i_pixel] - mean) > kappa_sigma) {
-                    current_begin[i_pixel] = -1;
+
+            if (keep_values) {
+                unsigned int i_kept = 0;
+                for (unsigned int i_file = 0; i_file < n_files; i_file++) {
+                    if (block_valid_mask[i_file] & (1 << i_column)) {
+                        kept_values[i_kept++] = block_values[i_file*block_size + i_column];
+                    }
                 }
             }
+            m_stacked_image[i_color][pixel_index] = get_stacked_value_from_kept_values(kept_values.data(), n_kept, sums_of_kept_values[i_column]);
         }
     }
-
-    sort(*ordered_array_begin, *ordered_array_begin + *number_of_stacked_pixels);
-
-    // adjust new number of pixels and begin of array
-    unsigned int new_number_of_stacked_pixels = 0;
-    for (unsigned int i_pixel = 0; i_pixel < *number_of_stacked_pixels; i_pixel++) {
-        if (current_begin[i_pixel] >= 0) {
-            new_number_of_stacked_pixels++;
-        }
-    }
-    *ordered_array_begin = *ordered_array_begin + *number_of_stacked_pixels - new_number_of_stacked_pixels;
-    *number_of_stacked_pixels = new_number_of_stacked_pixels;
-};
\ No newline at end of file
+};
@@ -10,14 +10,6 @@ StackerKappaSigmaClipping::StackerKappaSigmaClipping(int number_of_colors, int w
     StackerKappaSigmaBase(number_of_colors, width, height, interpolate_colors)   {
 };
 
-double StackerKappaSigmaClipping::get_stacked_value_from_pixel_array(PixelType *ordered_array_begin, unsigned int number_of_stacked_pixels) {
-    apply_kappa_sigma_clipping(&ordered_array_begin, &number_of_stacked_pixels);
-    if (number_of_stacked_pixels == 0) {
-        return c_empty_pixel_value;
-    }
-    double result = 0;
-    for (unsigned int i = 0; i < number_of_stacked_pixels; i++) {
-        result += ordered_array_begin[i];
-    }
-    return result/number_of_stacked_pixels;
+double StackerKappaSigmaClipping::get_stacked_value_from_kept_values(PixelType *kept_values, unsigned int number_of_kept_values, double sum_of_kept_values) {
+    return sum_of_kept_values/number_of_kept_values;
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "../headers/StackerKappaSigmaMedian.h"
+#include "../headers/PixelSelection.hxx"
 
 #include <cmath>
 
@@ -10,15 +11,8 @@ StackerKappaSigmaMedian::StackerKappaSigmaMedian(int number_of_colors, int width
     StackerKappaSigmaBase(number_of_colors, width, height, interpolate_colors)   {
 };
 
-double StackerKappaSigmaMedian::get_stacked_value_from_pixel_array(PixelType *ordered_array_begin, unsigned int number_of_stacked_pixels) {
-    apply_kappa_sigma_clipping(&ordered_array_begin, &number_of_stacked_pixels);
-    if (number_of_stacked_pixels == 0) {
-        return c_empty_pixel_value;
-    }
-    else if (number_of_stacked_pixels % 2 == 0) {
-        return (ordered_array_begin[number_of_stacked_pixels/2] + ordered_array_begin[number_of_stacked_pixels/2 - 1])/2;
-    }
-    else {
-        return ordered_array_begin[number_of_stacked_pixels/2];
-    }
+double StackerKappaSigmaMedian::get_stacked_value_from_kept_values(PixelType *kept_values, unsigned int number_of_kept_values, double sum_of_kept_values) {
+    PixelType lower_middle, upper_middle;
+    PixelSelection::select_middle_elements(kept_values, number_of_kept_values, &lower_middle, &upper_middle);
+    return (lower_middle + upper_middle)/2;
 };
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include "../headers/StackerLive.h"
+#include "../headers/TaskScheduler.hxx"
+
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+StackerLive::StackerLive(int number_of_colors, int width, int height, bool interpolate_colors, const std::string &stacking_algorithm) :
+    StackerBase(number_of_colors, width, height, interpolate_colors) {
+
+    if (stacking_algorithm == "kappa-sigma mean") {
+        m_use_kappa_sigma_rejection = true;
+        m_configurable_algorithm_settings.add_additional_setting_numerical("kappa", &m_kappa, 0.1, 10.0, 0.1);
+        m_configurable_algorithm_settings.add_additional_setting_numerical("min frames for rejection", &m_min_frames_for_rejection, 2, 100, 1);
+    }
+    else if (stacking_algorithm != "average") {
+        throw runtime_error("Live stacking is not supported for stacking algorithm: " + stacking_algorithm);
+    }
+
+    const size_t n_pixels = size_t(m_width)*m_height;
+    m_counts = vector<vector<unsigned int>>(m_number_of_colors, vector<unsigned int>(n_pixels, 0));
+    m_means  = vector<vector<double>>(m_number_of_colors, vector<double>(n_pixels, 0.));
+    m_m2     = vector<vector<double>>(m_use_kappa_sigma_rejection ? m_number_of_colors : 0, vector<double>(n_pixels, 0.));
+    m_line_block_mutexes = vector<mutex>((m_height + c_lines_per_lock - 1)/c_lines_per_lock);
+};
+
+void StackerLive::push_frame(  const InputFrame &input_frame,
+                                const AlignmentResultBase &alignment_result,
+                                const std::vector<std::shared_ptr<const CalibrationFrameBase> > &calibration_frame_handlers)  {
+    CalibratedPhotoHandler calibrated_photo = calibrate_frame(input_frame, &alignment_result, calibration_frame_handlers, 0, m_height);
+    push_frame(calibrated_photo.get_calibrated_data_after_color_interpolation());
+};
+
+void StackerLive::push_frame(const std::vector<std::vector<PixelType>> &calibrated_data)   {
+    if (int(calibrated_data.size()) != m_number_of_colors) {
+        throw runtime_error("StackerLive::push_frame: wrong number of colors in the calibrated data");
+    }
+
+    for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
+        if (calibrated_data[i_color].size() != size_t(m_width)*m_height) {
+            throw runtime_error("StackerLive::push_frame: size of the calibrated data does not match the size of the stacked image");
+        }
+    }
+
+    // no lock is held here - while waiting for the parallel tasks, this thread may run another push_frame
+    process_lines_in_parallel(0, m_height, [this, &calibrated_data](int y_begin, int y_end) {
+        for_each_locked_line_block(y_begin, y_end, [this, &calibrated_data](int y_block_begin, int y_block_end) {
+            for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
+                add_lines_to_accumulators(i_color, calibrated_data[i_color].data(), y_block_begin, y_block_end, 0);
+            }
+        });
+    });
+
+    scoped_lock lock(m_mutex);
+    m_n_pushed_frames++;
+};
+
+std::vector<std::vector<double> > StackerLive::snapshot() const {
+    vector<vector<double>> result(m_number_of_colors, vector<double>(size_t(m_width)*m_height));
+
+    process_lines_in_parallel(0, m_height, [this, &result](int y_begin, int y_end) {
+        for_each_locked_line_block(y_begin, y_end, [this, &result](int y_block_begin, int y_block_end) {
+            const size_t pixel_begin = size_t(y_block_begin)*m_width;
+            const size_t pixel_end   = size_t(y_block_end)*m_width;
+            for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
+                const unsigned int  *counts = m_counts[i_color].data();
+                const double        *means  = m_means[i_color].data();
+                double              *output = result[i_color].data();
+                for (size_t i_pixel = pixel_begin; i_pixel < pixel_end; i_pixel++) {
+                    output[i_pixel] = counts[i_pixel] > 0 ? means[i_pixel] : c_empty_pixel_value;
+                }
+            }
+        });
+    });
+    return result;
+};
+
+unsigned int StackerLive::get_number_of_pushed_frames() const {
+    scoped_lock lock(m_mutex);
+    return m_n_pushed_frames;
+};
+
+void StackerLive::reset()   {
+    for_each_locked_line_block(0, m_height, [this](int y_block_begin, int y_block_end) {
+        const size_t pixel_begin = size_t(y_block_begin)*m_width;
+        const size_t pixel_end   = size_t(y_block_end)*m_width;
+        for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
+            fill(m_counts[i_color].begin() + pixel_begin, m_counts[i_color].begin() + pixel_end, 0);
+            fill(m_means[i_color].begin() + pixel_begin, m_means[i_color].begin() + pixel_end, 0.);
+        }
+        for (vector<double> &m2 : m_m2) {
+            fill(m2.begin() + pixel_begin, m2.begin() + pixel_end, 0.);
+        }
+    });
+
+    scoped_lock lock(m_mutex);
+    m_n_pushed_frames = 0;
+    m_n_frames_from_stack_pushed = 0;
+};
+
+int StackerLive::get_tasks_total() const  {
+    const long long int n_files = m_frames_to_stack.size();
+    const int n_slab_tasks = use_calibrated_frames_slab() ? n_files : 0;
+
+    return n_files + 1 + n_slab_tasks;
+};
+
+unsigned long long StackerLive::get_maximal_memory_usage(int number_of_frames) const {
+    const unsigned long long n_values = static_cast<unsigned long long>(m_number_of_colors) * static_cast<unsigned long long>(m_width) * static_cast<unsigned long long>(m_height);
+    const unsigned long long accumulators_size = n_values*(sizeof(unsigned int) + sizeof(double)*(m_use_kappa_sigma_rejection ? 2 : 1));
+
+    // one calibrated frame per thread
+    return accumulators_size + n_values*sizeof(PixelType)*m_n_cpu;
+};
+
+void StackerLive::calculate_stacked_photo_internal()  {
+    // the prefetcher reads all the frames from the beginning, which is useless if some of them were already pushed
+    if (m_n_frames_from_stack_pushed == 0) {
+        // one task per frame, the threads take the frames in order
+        start_frame_prefetching(m_frames_to_stack, 1);
+    }
+    TaskScheduler pool({size_t(m_n_cpu)});
+    for (unsigned int i_file = m_n_frames_from_stack_pushed; i_file < m_frames_to_stack.size(); i_file++) {
+        if (m_n_cpu > 1) {
+            pool.submit([this](unsigned int i_file) {
+                add_photo_to_stack(i_file, 0, m_height);
+            }, {1}, i_file);
+        }
+        else {
+            add_photo_to_stack(i_file, 0, m_height);
+        }
+    }
+    pool.wait_for_tasks();
+    stop_frame_prefetching();
+    m_n_frames_from_stack_pushed = m_frames_to_stack.size();
+
+    m_stacked_image = snapshot();
+    m_n_tasks_processed++;
+};
+
+void StackerLive::add_photo_to_stack(unsigned int file_index, int y_min, int y_max)  {
+    const vector<vector<PixelType>> calibrated_data = get_calibrated_data(file_index, y_min, y_max);
+
+    // called from the stacking threads, so the lines are not split into parallel tasks here - the frames themselves are processed in parallel
+    for_each_locked_line_block(y_min, y_max, [this, &calibrated_data, y_min](int y_block_begin, int y_block_end) {
+        for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
+            add_lines_to_accumulators(i_color, calibrated_data[i_color].data(), y_block_begin, y_block_end, y_min);
+        }
+    });
+
+    scoped_lock lock(m_mutex);
+    m_n_pushed_frames++;
+    m_n_tasks_processed++;
+};
+
+void StackerLive::for_each_locked_line_block(int y_begin, int y_end, const std::function<void(int y_begin, int y_end)> &process_lines) const  {
+    int y = y_begin;
+    while (y < y_end) {
+        const int i_block = y/c_lines_per_lock;
+        const int y_block_end = min(y_end, (i_block + 1)*c_lines_per_lock);
+        scoped_lock lock(m_line_block_mutexes[i_block]);
+        process_lines(y, y_block_end);
+        y = y_block_end;
+    }
+};
+
+int StackerLive::get_height_range_limit() const  {
+    return m_height;
+};
+
+void StackerLive::add_lines_to_accumulators(int i_color, const PixelType *values, int y_begin, int y_end, int y_min)   {
+    const size_t pixel_begin = size_t(y_begin)*m_width;
+    const size_t pixel_end   = size_t(y_end)*m_width;
+    const PixelType *values_shifted = values - size_t(y_min)*m_width;
+    unsigned int    *counts = m_counts[i_color].data();
+    double          *means  = m_means[i_color].data();
+
+    if (!m_use_kappa_sigma_rejection) {
+        for (size_t i_pixel = pixel_begin; i_pixel < pixel_end; i_pixel++) {
+            const double value = values_shifted[i_pixel];
+            const unsigned int is_valid = value >= 0;
+            const unsigned int count = counts[i_pixel] + is_valid;
+            counts[i_pixel] = count;
+            means[i_pixel] += is_valid*(value - means[i_pixel])/max(count, 1u);
+        }
+        return;
+    }
+
+    // Welford's algorithm, the value is rejected if it is too far from the running mean of the previous values
+    double *m2 = m_m2[i_color].data();
+    const unsigned int min_frames_for_rejection = max(m_min_frames_for_rejection, 2);
+    for (size_t i_pixel = pixel_begin; i_pixel < pixel_end; i_pixel++) {
+        const double value = values_shifted[i_pixel];
+        if (value < 0) {
+            continue;
+        }
+        unsigned int count = counts[i_pixel];
+        const double delta = value - means[i_pixel];
+        if (count >= min_frames_for_rejection) {
+            const double sigma = sqrt(m2[i_pixel]/(count - 1));
+            // if all the previous values were identical, sigma is zero and there is nothing to compare to
+            if (sigma > 0 && abs(delta) > m_kappa*sigma) {
+                continue;
+            }
+        }
+        count++;
+        counts[i_pixel] = count;
+        means[i_pixel] += delta/count;
+        m2[i_pixel] += delta*(value - means[i_pixel]);
+    }
+};
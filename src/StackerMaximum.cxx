@@ -1,5 +1,7 @@
 #include "../headers/StackerMaximum.h"
 
+#include <algorithm>
+
 using namespace std;
 using namespace AstroPhotoStacker;
 
@@ -7,38 +9,46 @@ StackerMaximum::StackerMaximum(int number_of_colors, int width, int height, bool
     StackerSimpleBase(number_of_colors, width, height, interpolate_colors)  {};
 
 void StackerMaximum::allocate_arrays_for_stacking(int dy) {
-    m_max_values_individual_threads = vector<vector<vector<int>>>(m_n_cpu, vector<vector<int>>(m_number_of_colors, vector<int>(m_width*dy, c_empty_pixel_value)));
+    m_max_values_individual_threads = vector<int>(size_t(m_n_cpu)*m_number_of_colors*m_width*dy, c_empty_pixel_value);
 };
 
 void StackerMaximum::reset_values_in_arrays_for_stacking() {
-    for (vector<vector<int>> &stacked_image : m_max_values_individual_threads) {
-        for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
-            for (unsigned int i_pixel = 0; i_pixel < stacked_image[i_color].size(); i_pixel++) {
-                stacked_image[i_color][i_pixel] = c_empty_pixel_value;
-            }
-        }
-    }
+    fill(m_max_values_individual_threads.begin(), m_max_values_individual_threads.end(), c_empty_pixel_value);
 };
 
 void StackerMaximum::deallocate_arrays_for_stacking() {
     m_max_values_individual_threads.clear();
 };
 
-void StackerMaximum::process_pixel(int i_color, int i_pixel, int value, int i_thread) {
-    m_max_values_individual_threads[i_thread][i_color][i_pixel] = std::max<int>(value, m_max_values_individual_threads[i_thread][i_color][i_pixel]);
+void StackerMaximum::add_values_to_stack(int i_color, const PixelType *values, size_t n_values, int i_thread) {
+    // invalid values are negative, so they never exceed the initial value (c_empty_pixel_value)
+    int *max_values = &m_max_values_individual_threads[get_accumulator_index(i_thread, i_color)];
+    for (size_t i_pixel = 0; i_pixel < n_values; i_pixel++) {
+        max_values[i_pixel] = std::max<int>(values[i_pixel], max_values[i_pixel]);
+    }
 };
 
 void StackerMaximum::calculate_final_image(int y_min, int y_max)    {
     const int dy = y_max - y_min;
-    // sum partial results
     const int pixel_shift = y_min*m_width;
-    for (unsigned int i_thread = 0; i_thread < m_n_cpu; i_thread++) {
+
+    // merge partial results
+    reduce_accumulators(size_t(m_width)*dy, [this](int i_thread_target, int i_thread_source, int i_color, size_t pixel_begin, size_t pixel_end) {
+        int         *max_values_target = &m_max_values_individual_threads[get_accumulator_index(i_thread_target, i_color)];
+        const int   *max_values_source = &m_max_values_individual_threads[get_accumulator_index(i_thread_source, i_color)];
+        for (size_t i_pixel = pixel_begin; i_pixel < pixel_end; i_pixel++) {
+            max_values_target[i_pixel] = std::max(max_values_target[i_pixel], max_values_source[i_pixel]);
+        }
+    });
+
+    process_lines_in_parallel(y_min, y_max, [this, y_min, pixel_shift](int y_begin, int y_end) {
+        const size_t pixel_begin = size_t(y_begin - y_min)*m_width;
+        const size_t pixel_end   = size_t(y_end - y_min)*m_width;
         for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
-            for (int i_pixel = 0; i_pixel < m_width*dy; i_pixel++) {
-                m_stacked_image[i_color][i_pixel+pixel_shift] = std::max<int>(m_max_values_individual_threads[i_thread][i_color][i_pixel], m_stacked_image[i_color][i_pixel+pixel_shift]);
-            }
+            const int *max_values = &m_max_values_individual_threads[get_accumulator_index(0, i_color)];
+            std::copy(max_values + pixel_begin, max_values + pixel_end, &m_stacked_image[i_color][pixel_shift + pixel_begin]);
         }
-    }
+    });
 }
 
 int StackerMaximum::get_height_range_limit() const {
@@ -46,9 +56,9 @@ int StackerMaximum::get_height_range_limit() const {
     if (m_memory_usage_limit_in_mb > 0) {
         const unsigned long long int memory_needed_for_stacked_image = 3*sizeof(double)*m_width*m_height;
         const unsigned long long int memory_needed_for_calibrated_photos = m_n_cpu*3*sizeof(PixelType)*m_width*m_height;
-        const unsigned long long int memory_usage_limit = m_memory_usage_limit_in_mb*1024ULL*1024ULL - memory_needed_for_stacked_image - memory_needed_for_calibrated_photos;
+        const unsigned long long int memory_usage_limit = get_memory_available_for_stacking(memory_needed_for_stacked_image + memory_needed_for_calibrated_photos);
         const unsigned long long int memory_usage_per_line = m_number_of_colors*m_n_cpu*12ULL*m_width;
-        height_range = min(height_range, int(memory_usage_limit/memory_usage_per_line));
+        height_range = min<unsigned long long int>(height_range, memory_usage_limit/memory_usage_per_line);
     }
     return height_range;
 };
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "../headers/StackerMeanValue.h"
 
+#include <algorithm>
+
 using namespace std;
 using namespace AstroPhotoStacker;
 
@@ -7,22 +9,14 @@ StackerMeanValue::StackerMeanValue(int number_of_colors, int width, int height,
     StackerSimpleBase(number_of_colors, width, height, interpolate_colors)  {};
 
 void StackerMeanValue::allocate_arrays_for_stacking(int dy) {
-    m_values_to_stack_individual_threads = vector<vector<vector<int>>>(m_n_cpu, vector<vector<int>>(m_number_of_colors, vector<int>(m_width*dy, 0)));
-    m_counts_to_stack_individual_threads = vector<vector<vector<short unsigned int>>>(m_n_cpu, vector<vector<short unsigned int>>(m_number_of_colors, vector<short unsigned int>(m_width*dy, 0)));
+    const size_t accumulator_size_total = size_t(m_n_cpu)*m_number_of_colors*m_width*dy;
+    m_values_to_stack_individual_threads = vector<int>(accumulator_size_total, 0);
+    m_counts_to_stack_individual_threads = vector<short unsigned int>(accumulator_size_total, 0);
 };
 
 void StackerMeanValue::reset_values_in_arrays_for_stacking()  {
-    for (unsigned int i_thread = 0; i_thread < m_n_cpu; i_thread++) {
-        vector<vector<int>>                 &stacked_image = m_values_to_stack_individual_threads[i_thread];
-        vector<vector<short unsigned int>>  &number_of_stacked_pixels = m_counts_to_stack_individual_threads[i_thread];
-
-        for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
-            for (unsigned int i_pixel = 0; i_pixel < stacked_image[i_color].size(); i_pixel++) {
-                stacked_image[i_color][i_pixel] = 0;
-                number_of_stacked_pixels[i_color][i_pixel] = 0;
-            }
-        }
-    }
+    fill(m_values_to_stack_individual_threads.begin(), m_values_to_stack_individual_threads.end(), 0);
+    fill(m_counts_to_stack_individual_threads.begin(), m_counts_to_stack_individual_threads.end(), 0);
 };
 
 void StackerMeanValue::deallocate_arrays_for_stacking() {
@@ -30,39 +24,48 @@ void StackerMeanValue::deallocate_arrays_for_stacking() {
     m_counts_to_stack_individual_threads.clear();
 };
 
-void StackerMeanValue::process_pixel(int i_color, int i_pixel, int value, int i_thread) {
-    m_values_to_stack_individual_threads[i_thread][i_color][i_pixel] += value;
-    m_counts_to_stack_individual_threads[i_thread][i_color][i_pixel] += 1;
+void StackerMeanValue::add_values_to_stack(int i_color, const PixelType *values, size_t n_values, int i_thread) {
+    const size_t accumulator_index = get_accumulator_index(i_thread, i_color);
+    int                 *sums   = &m_values_to_stack_individual_threads[accumulator_index];
+    short unsigned int  *counts = &m_counts_to_stack_individual_threads[accumulator_index];
+    for (size_t i_pixel = 0; i_pixel < n_values; i_pixel++) {
+        const int value = values[i_pixel];
+        const bool is_valid = value >= 0;
+        sums[i_pixel]   += is_valid ? value : 0;
+        counts[i_pixel] += is_valid;
+    }
 };
 
 void StackerMeanValue::calculate_final_image(int y_min, int y_max)    {
     const int pixel_shift = y_min*m_width;
     const int dy = y_max - y_min;
-    std::vector<std::vector<unsigned short>> number_of_stacked_pixels_total(m_number_of_colors, vector<unsigned short>(m_width*dy, 0));
 
     // sum partial results
-    for (unsigned int i_thread = 0; i_thread < m_n_cpu; i_thread++) {
-        vector<vector<int>>                 &stacked_image = m_values_to_stack_individual_threads[i_thread];
-        vector<vector<short unsigned int>>  &number_of_stacked_pixels = m_counts_to_stack_individual_threads[i_thread];
-
-        for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
-            for (int i_pixel = 0; i_pixel < m_width*dy; i_pixel++) {
-                m_stacked_image[i_color][i_pixel+pixel_shift] += stacked_image[i_color][i_pixel];
-                number_of_stacked_pixels_total[i_color][i_pixel] += number_of_stacked_pixels[i_color][i_pixel];
-            }
+    reduce_accumulators(size_t(m_width)*dy, [this](int i_thread_target, int i_thread_source, int i_color, size_t pixel_begin, size_t pixel_end) {
+        int                         *sums_target    = &m_values_to_stack_individual_threads[get_accumulator_index(i_thread_target, i_color)];
+        short unsigned int          *counts_target  = &m_counts_to_stack_individual_threads[get_accumulator_index(i_thread_target, i_color)];
+        const int                   *sums_source    = &m_values_to_stack_individual_threads[get_accumulator_index(i_thread_source, i_color)];
+        const short unsigned int    *counts_source  = &m_counts_to_stack_individual_threads[get_accumulator_index(i_thread_source, i_color)];
+        for (size_t i_pixel = pixel_begin; i_pixel < pixel_end; i_pixel++) {
+            sums_target[i_pixel]    += sums_source[i_pixel];
+            counts_target[i_pixel]  += counts_source[i_pixel];
         }
-    }
+    });
 
-    for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
-        for (int i_pixel = 0; i_pixel < m_width*dy; i_pixel++) {
-            if (number_of_stacked_pixels_total[i_color][i_pixel] > 0) {
-                m_stacked_image[i_color][i_pixel+pixel_shift] /= number_of_stacked_pixels_total[i_color][i_pixel];
-            }
-            else {
-                m_stacked_image[i_color][i_pixel+pixel_shift] = c_empty_pixel_value;
+    process_lines_in_parallel(y_min, y_max, [this, y_min, pixel_shift](int y_begin, int y_end) {
+        const size_t pixel_begin = size_t(y_begin - y_min)*m_width;
+        const size_t pixel_end   = size_t(y_end - y_min)*m_width;
+        for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
+            const int                   *stacked_image              = &m_values_to_stack_individual_threads[get_accumulator_index(0, i_color)];
+            const short unsigned int    *number_of_stacked_pixels   = &m_counts_to_stack_individual_threads[get_accumulator_index(0, i_color)];
+            double                      *result                     = &m_stacked_image[i_color][pixel_shift];
+            for (size_t i_pixel = pixel_begin; i_pixel < pixel_end; i_pixel++) {
+                const int count = number_of_stacked_pixels[i_pixel];
+                const double mean = double(stacked_image[i_pixel])/std::max(count, 1);
+                result[i_pixel] = count > 0 ? mean : c_empty_pixel_value;
             }
         }
-    }
+    });
 }
 
 int StackerMeanValue::get_height_range_limit() const {
@@ -70,9 +73,9 @@ int StackerMeanValue::get_height_range_limit() const {
     if (m_memory_usage_limit_in_mb > 0) {
         const unsigned long long int memory_needed_for_stacked_image = 3*sizeof(double)*m_width*m_height;
         const unsigned long long int memory_needed_for_calibrated_photos = m_n_cpu*3*sizeof(PixelType)*m_width*m_height;
-        const unsigned long long int memory_usage_limit = m_memory_usage_limit_in_mb*1024ULL*1024ULL - memory_needed_for_stacked_image - memory_needed_for_calibrated_photos;
+        const unsigned long long int memory_usage_limit = get_memory_available_for_stacking(memory_needed_for_stacked_image + memory_needed_for_calibrated_photos);
         const unsigned long long int memory_usage_per_line = m_number_of_colors*m_n_cpu*((unsigned long long int)(sizeof(int) + sizeof(short unsigned int)))*m_width;
-        height_range = min(height_range, int(memory_usage_limit/memory_usage_per_line));
+        height_range = min<unsigned long long int>(height_range, memory_usage_limit/memory_usage_per_line);
     }
     return height_range;
 };
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "../headers/StackerMedian.h"
 #include "../headers/CalibratedPhotoHandler.h"
 #include "../headers/TaskScheduler.hxx"
+#include "../headers/PixelSelection.hxx"
+#include "../headers/VideoDecodeSession.h"
 
 #include <iostream>
 #include <algorithm>
@@ -20,8 +22,11 @@ void StackerMedian::calculate_stacked_photo_internal()  {
         throw runtime_error("The memory set by the user is not sufficient, please increase it");
     }
 
+    m_values_to_stack_frame_size = size_t(m_width)*height_range;
+    m_validity_words_per_frame   = (m_values_to_stack_frame_size + 63)/64;
     for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
-        m_values_to_stack.push_back(vector<PixelType>(m_width*height_range*n_files, -1));
+        m_values_to_stack.push_back(vector<PixelType>(m_values_to_stack_frame_size*n_files, -1));
+        m_valid_values_bitmap.push_back(vector<uint64_t>(m_validity_words_per_frame*n_files, 0));
     }
 
     int i_slice = 0;
@@ -32,22 +37,31 @@ void StackerMedian::calculate_stacked_photo_internal()  {
         const int y_max = min(y_min + height_range, m_height);
         cout << "Stacking slice " << i_slice << " of " << n_slices << endl;
 
-        auto submit_photo_stack = [this, y_min, y_max](unsigned int file_index) {
-            cout << string("Adding ") + m_frames_to_stack[file_index].to_string() + string(" to stack\n");
-            add_photo_to_stack(file_index, y_min, y_max);
-            m_n_tasks_processed++;
+        // each task stacks a range of consecutive files, so that video frames are decoded without seeking
+        auto submit_photo_stack = [this, y_min, y_max](unsigned int first_file_index, unsigned int last_file_index) {
+            for (unsigned int file_index = first_file_index; file_index < last_file_index; file_index++) {
+                cout << string("Adding ") + m_frames_to_stack[file_index].to_string() + string(" to stack\n");
+                add_photo_to_stack(file_index, y_min, y_max);
+                m_n_tasks_processed++;
+            }
         };
 
+        start_frame_prefetching();
         TaskScheduler pool({size_t(m_n_cpu)});
-        for (unsigned int i_file = 0; i_file < m_frames_to_stack.size(); i_file++) {
+        const unsigned int n_files = m_frames_to_stack.size();
+        const unsigned int files_per_task = get_number_of_consecutive_frames_per_task(n_files, m_n_cpu);
+        for (unsigned int i_first = 0; i_first < n_files; i_first += files_per_task) {
+            const unsigned int i_last = min(i_first + files_per_task, n_files);
             if (m_n_cpu > 1) {
-                pool.submit(submit_photo_stack, {1}, i_file);
+                pool.submit(submit_photo_stack, {1}, i_first, i_last);
             }
             else {
-                submit_photo_stack(i_file);
+                submit_photo_stack(i_first, i_last);
             }
         }
         pool.wait_for_tasks();
+        stop_frame_prefetching();
+
         auto submit_median_calculation = [this, y_min, y_max](int i_color, int y_final_array, int y_values_to_stack_array ) {
             process_line(y_final_array, y_values_to_stack_array, i_color);
         };
@@ -68,27 +82,45 @@ void StackerMedian::calculate_stacked_photo_internal()  {
 
 
     m_values_to_stack.clear();
+    m_valid_values_bitmap.clear();
 
     fix_empty_pixels();
 };
 
 void StackerMedian::add_photo_to_stack(unsigned int file_index, int y_min, int y_max)  {
-    const unsigned long long int n_files = m_frames_to_stack.size();
-
-    CalibratedPhotoHandler calibrated_photo = get_calibrated_photo(file_index, y_min, y_max);
+    const vector<vector<PixelType>> calibrated_data = get_calibrated_data(file_index, y_min, y_max);
+    const size_t n_pixels = size_t(y_max - y_min)*m_width;
 
+    // each frame has its own block of the array and its own words of the bitmap, so no locking is needed
     for (int color = 0; color < 3; color++)   {
-        const unsigned int slice_shift = y_min*m_width;
-        for (int y = y_min; y < y_max; y++)  {
-            const unsigned int start_of_line_index_reference_frame = y*m_width;
-            const unsigned int start_of_line_index_this_slice = (y*m_width - slice_shift)*n_files + file_index;
-            for (int x = 0; x < m_width; x++)   {
-                m_values_to_stack[color][start_of_line_index_this_slice + x*n_files] = calibrated_photo.get_value_by_reference_frame_index(start_of_line_index_reference_frame+x, color);
+        const PixelType *calibrated_data_color = calibrated_data[color].data();
+        copy(calibrated_data_color, calibrated_data_color + n_pixels, m_values_to_stack[color].begin() + file_index*m_values_to_stack_frame_size);
+
+        uint64_t *validity_words = &m_valid_values_bitmap[color][file_index*m_validity_words_per_frame];
+        for (size_t i_word = 0; i_word*64 < n_pixels; i_word++) {
+            const size_t first_pixel = i_word*64;
+            const unsigned int n_bits = min<size_t>(64, n_pixels - first_pixel);
+            uint64_t word = 0;
+            for (unsigned int i_bit = 0; i_bit < n_bits; i_bit++) {
+                word |= uint64_t(calibrated_data_color[first_pixel + i_bit] >= 0) << i_bit;
             }
+            validity_words[i_word] = word;
         }
     }
 };
 
+uint64_t StackerMedian::get_validity_bits(int i_color, unsigned int file_index, size_t first_pixel_index_in_slice, unsigned int n_pixels) const    {
+    const uint64_t *validity_words = &m_valid_values_bitmap[i_color][file_index*m_validity_words_per_frame];
+    const size_t i_word = first_pixel_index_in_slice >> 6;
+    const unsigned int shift = first_pixel_index_in_slice & 63;
+
+    uint64_t bits = validity_words[i_word] >> shift;
+    if (shift + n_pixels > 64) {
+        bits |= validity_words[i_word + 1] << (64 - shift);
+    }
+    return n_pixels < 64 ? bits & ((uint64_t(1) << n_pixels) - 1) : bits;
+};
+
 
 int StackerMedian::get_height_range_limit() const {
     int height_range = m_height;
@@ -96,62 +128,66 @@ int StackerMedian::get_height_range_limit() const {
     if (m_memory_usage_limit_in_mb > 0) {
         const unsigned long long int memory_needed_for_stacked_image = 3*sizeof(double)*m_width*m_height;
         const unsigned long long int memory_needed_for_calibrated_photos = m_n_cpu*3*sizeof(PixelType)*m_width*m_height;
-        const unsigned long long int memory_usage_limit = m_memory_usage_limit_in_mb*1024ULL*1024ULL - memory_needed_for_stacked_image - memory_needed_for_calibrated_photos;
-        const unsigned long long int memory_usage_per_line = m_number_of_colors*m_width*n_files*sizeof(PixelType);
-        height_range = min(height_range, int(memory_usage_limit/memory_usage_per_line));
+        const unsigned long long int memory_usage_limit = get_memory_available_for_stacking(memory_needed_for_stacked_image + memory_needed_for_calibrated_photos);
+        const unsigned long long int memory_usage_per_line = m_number_of_colors*n_files*(m_width*sizeof(PixelType) + m_width/8 + 1);
+        height_range = min<unsigned long long int>(height_range, memory_usage_limit/memory_usage_per_line);
     }
     return height_range;
 };
 
 
 void StackerMedian::process_line(int y_index_final_array, int y_index_values_to_stack_array, int i_color)    {
-    const long long int n_files = m_frames_to_stack.size();
-    for (int i_width = 0; i_width < m_width; i_width++) {
-        const unsigned long long int pixel_index = m_width*y_index_final_array + i_width;
-        const unsigned long long int pixel_index_stacking_array = m_width*y_index_values_to_stack_array*n_files + i_width*n_files;
-
-        PixelType *slice_begin = &m_values_to_stack[i_color][pixel_index_stacking_array];
-        PixelType *slice_end   = &m_values_to_stack[i_color][pixel_index_stacking_array + n_files];
-
-        int number_of_stacked_pixels = 0;
-        for (int i = 0; i < n_files; i++) {
-            if (slice_begin[i] >= 0) {
-                number_of_stacked_pixels++;
+    const unsigned int n_files = m_frames_to_stack.size();
+    const size_t line_start_index = size_t(m_width)*y_index_values_to_stack_array;
+
+    // blocked transpose: for a tile of pixels, read the line segment of each frame and append valid values to the columns of the corresponding pixels
+    vector<PixelType>       columns(c_transpose_tile_width*n_files);
+    vector<unsigned int>    numbers_of_valid_values(c_transpose_tile_width);
+    for (int x_tile_start = 0; x_tile_start < m_width; x_tile_start += c_transpose_tile_width) {
+        const unsigned int tile_width = min<int>(c_transpose_tile_width, m_width - x_tile_start);
+        const size_t tile_start_index = line_start_index + x_tile_start;
+
+        fill(numbers_of_valid_values.begin(), numbers_of_valid_values.end(), 0);
+        for (unsigned int i_file = 0; i_file < n_files; i_file++) {
+            const PixelType *line_segment = get_values_to_stack(i_color, i_file, tile_start_index);
+            const uint64_t validity_bits = get_validity_bits(i_color, i_file, tile_start_index, tile_width);
+            for (unsigned int i_column = 0; i_column < tile_width; i_column++) {
+                // branchless - invalid value is written, but it is overwritten by the next valid one
+                columns[i_column*n_files + numbers_of_valid_values[i_column]] = line_segment[i_column];
+                numbers_of_valid_values[i_column] += (validity_bits >> i_column) & 1;
             }
         }
-        int first_non_negative_index = n_files - number_of_stacked_pixels;
 
-        sort(slice_begin, slice_end);
-
-        m_stacked_image[i_color][pixel_index] = get_stacked_value_from_pixel_array(slice_begin + first_non_negative_index, number_of_stacked_pixels);
+        for (unsigned int i_column = 0; i_column < tile_width; i_column++) {
+            const unsigned long long int pixel_index = m_width*y_index_final_array + x_tile_start + i_column;
+            m_stacked_image[i_color][pixel_index] = get_stacked_value_from_pixel_array(&columns[i_column*n_files], numbers_of_valid_values[i_column]);
+        }
     }
 };
 
 
-double StackerMedian::get_stacked_value_from_pixel_array(PixelType *ordered_array_begin, unsigned int number_of_stacked_pixels) {
+double StackerMedian::get_stacked_value_from_pixel_array(PixelType *array_begin, unsigned int number_of_stacked_pixels) {
     if (number_of_stacked_pixels == 0) {
         return c_empty_pixel_value;
     }
-    else if (number_of_stacked_pixels % 2 == 0) {
-        return (ordered_array_begin[number_of_stacked_pixels/2] + ordered_array_begin[number_of_stacked_pixels/2 - 1])/2;
-    }
-    else {
-        return ordered_array_begin[number_of_stacked_pixels/2];
-    }
+    PixelType lower_middle, upper_middle;
+    PixelSelection::select_middle_elements(array_begin, number_of_stacked_pixels, &lower_middle, &upper_middle);
+    return (lower_middle + upper_middle)/2;
 };
 
 int StackerMedian::get_tasks_total() const  {
     const long long int n_files = m_frames_to_stack.size();
     const int height_range = get_height_range_limit();
-    int n_slices = m_height/height_range + (m_height % height_range > 0);
+    int n_slices = height_range > 0 ? m_height/height_range + (m_height % height_range > 0) : 0;
+    const int n_slab_tasks = use_calibrated_frames_slab() ? n_files : 0;
 
-    return n_slices*n_files;
+    return n_slices*n_files + n_slab_tasks;
 };
 
 unsigned long long StackerMedian::get_maximal_memory_usage(int number_of_frames) const {
     const unsigned long long resolution = m_width*m_height;
     const unsigned long long stacked_image_size = m_number_of_colors*sizeof(double)*resolution;
-    const unsigned long long all_frames_data    = m_number_of_colors*number_of_frames*sizeof(PixelType)*resolution;
+    const unsigned long long all_frames_data    = m_number_of_colors*number_of_frames*(sizeof(PixelType)*resolution + resolution/8);
 
     const unsigned long long memory_usage_total = stacked_image_size + all_frames_data;
 
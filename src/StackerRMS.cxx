@@ -1,5 +1,8 @@
 #include "../headers/StackerRMS.h"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace std;
 using namespace AstroPhotoStacker;
 
@@ -7,25 +10,16 @@ StackerRMS::StackerRMS(int number_of_colors, int width, int height, bool interpo
     StackerSimpleBase(number_of_colors, width, height, interpolate_colors)  {};
 
 void StackerRMS::allocate_arrays_for_stacking(int dy) {
-    m_values_to_stack_individual_threads_sum  = vector<vector<vector<int>>>(m_n_cpu, vector<vector<int>>(m_number_of_colors, vector<int>(m_width*dy, 0)));
-    m_values_to_stack_individual_threads_sum2 = vector<vector<vector<double>>>(m_n_cpu, vector<vector<double>>(m_number_of_colors, vector<double>(m_width*dy, 0)));
-    m_counts_to_stack_individual_threads = vector<vector<vector<short unsigned int>>>(m_n_cpu, vector<vector<short unsigned int>>(m_number_of_colors, vector<short unsigned int>(m_width*dy, 0)));
+    const size_t accumulator_size_total = size_t(m_n_cpu)*m_number_of_colors*m_width*dy;
+    m_values_to_stack_individual_threads_sum  = vector<int>(accumulator_size_total, 0);
+    m_values_to_stack_individual_threads_sum2 = vector<double>(accumulator_size_total, 0);
+    m_counts_to_stack_individual_threads = vector<short unsigned int>(accumulator_size_total, 0);
 };
 
 void StackerRMS::reset_values_in_arrays_for_stacking()  {
-    for (unsigned int i_thread = 0; i_thread < m_n_cpu; i_thread++) {
-        vector<vector<int>>                 &stacked_image = m_values_to_stack_individual_threads_sum[i_thread];
-        vector<vector<double>>              &stacked_image2 = m_values_to_stack_individual_threads_sum2[i_thread];
-        vector<vector<short unsigned int>>  &number_of_stacked_pixels = m_counts_to_stack_individual_threads[i_thread];
-
-        for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
-            for (unsigned int i_pixel = 0; i_pixel < stacked_image[i_color].size(); i_pixel++) {
-                stacked_image[i_color][i_pixel] = 0;
-                stacked_image2[i_color][i_pixel] = 0.0;
-                number_of_stacked_pixels[i_color][i_pixel] = 0;
-            }
-        }
-    }
+    fill(m_values_to_stack_individual_threads_sum.begin(), m_values_to_stack_individual_threads_sum.end(), 0);
+    fill(m_values_to_stack_individual_threads_sum2.begin(), m_values_to_stack_individual_threads_sum2.end(), 0.0);
+    fill(m_counts_to_stack_individual_threads.begin(), m_counts_to_stack_individual_threads.end(), 0);
 };
 
 void StackerRMS::deallocate_arrays_for_stacking() {
@@ -34,48 +28,61 @@ void StackerRMS::deallocate_arrays_for_stacking() {
     m_counts_to_stack_individual_threads.clear();
 };
 
-void StackerRMS::process_pixel(int i_color, int i_pixel, int value, int i_thread) {
-    m_values_to_stack_individual_threads_sum[i_thread][i_color][i_pixel] += value;
-    m_values_to_stack_individual_threads_sum2[i_thread][i_color][i_pixel] += static_cast<double>(value)*static_cast<double>(value);
-    m_counts_to_stack_individual_threads[i_thread][i_color][i_pixel] += 1;
+void StackerRMS::add_values_to_stack(int i_color, const PixelType *values, size_t n_values, int i_thread) {
+    const size_t accumulator_index = get_accumulator_index(i_thread, i_color);
+    int                 *sums   = &m_values_to_stack_individual_threads_sum[accumulator_index];
+    double              *sums2  = &m_values_to_stack_individual_threads_sum2[accumulator_index];
+    short unsigned int  *counts = &m_counts_to_stack_individual_threads[accumulator_index];
+    for (size_t i_pixel = 0; i_pixel < n_values; i_pixel++) {
+        const int value = values[i_pixel];
+        const bool is_valid = value >= 0;
+        const int value_to_add = is_valid ? value : 0;
+        sums[i_pixel]   += value_to_add;
+        sums2[i_pixel]  += static_cast<double>(value_to_add)*static_cast<double>(value_to_add);
+        counts[i_pixel] += is_valid;
+    }
 };
 
 void StackerRMS::calculate_final_image(int y_min, int y_max)    {
     const int pixel_shift = y_min*m_width;
     const int dy = y_max - y_min;
-    std::vector<std::vector<unsigned short>> number_of_stacked_pixels_total(m_number_of_colors, vector<unsigned short>(m_width*dy, 0));
-    std::vector<std::vector<double>>         stacked_sum(m_number_of_colors, vector<double>(m_width*dy, 0));
 
     // sum partial results
-    for (unsigned int i_thread = 0; i_thread < m_n_cpu; i_thread++) {
-        const vector<vector<int>>                 &stacked_image  = m_values_to_stack_individual_threads_sum[i_thread];
-        const vector<vector<double>>              &stacked_image2 = m_values_to_stack_individual_threads_sum2[i_thread];
-        const vector<vector<short unsigned int>>  &number_of_stacked_pixels = m_counts_to_stack_individual_threads[i_thread];
-
-        for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
-            for (int i_pixel = 0; i_pixel < m_width*dy; i_pixel++) {
-                m_stacked_image[i_color][i_pixel+pixel_shift]   += stacked_image2[i_color][i_pixel];
-                stacked_sum[i_color][i_pixel]                   += stacked_image[i_color][i_pixel];
-                number_of_stacked_pixels_total[i_color][i_pixel] += number_of_stacked_pixels[i_color][i_pixel];
-            }
+    reduce_accumulators(size_t(m_width)*dy, [this](int i_thread_target, int i_thread_source, int i_color, size_t pixel_begin, size_t pixel_end) {
+        const size_t index_target = get_accumulator_index(i_thread_target, i_color);
+        const size_t index_source = get_accumulator_index(i_thread_source, i_color);
+        int                         *sums_target    = &m_values_to_stack_individual_threads_sum[index_target];
+        double                      *sums2_target   = &m_values_to_stack_individual_threads_sum2[index_target];
+        short unsigned int          *counts_target  = &m_counts_to_stack_individual_threads[index_target];
+        const int                   *sums_source    = &m_values_to_stack_individual_threads_sum[index_source];
+        const double                *sums2_source   = &m_values_to_stack_individual_threads_sum2[index_source];
+        const short unsigned int    *counts_source  = &m_counts_to_stack_individual_threads[index_source];
+        for (size_t i_pixel = pixel_begin; i_pixel < pixel_end; i_pixel++) {
+            sums_target[i_pixel]    += sums_source[i_pixel];
+            sums2_target[i_pixel]   += sums2_source[i_pixel];
+            counts_target[i_pixel]  += counts_source[i_pixel];
         }
-    }
+    });
 
-    for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
-        for (int i_pixel = 0; i_pixel < m_width*dy; i_pixel++) {
-            if (number_of_stacked_pixels_total[i_color][i_pixel] > 0) {
-                m_stacked_image[i_color][i_pixel+pixel_shift] -= (stacked_sum[i_color][i_pixel]*static_cast<double>(stacked_sum[i_color][i_pixel]))/number_of_stacked_pixels_total[i_color][i_pixel];
-                m_stacked_image[i_color][i_pixel+pixel_shift] /= number_of_stacked_pixels_total[i_color][i_pixel];
-                if (m_stacked_image[i_color][i_pixel+pixel_shift] < 0) {
-                    m_stacked_image[i_color][i_pixel+pixel_shift] = 0;
-                }
-                m_stacked_image[i_color][i_pixel+pixel_shift] = sqrt(m_stacked_image[i_color][i_pixel+pixel_shift]);
-            }
-            else {
-                m_stacked_image[i_color][i_pixel+pixel_shift] = c_empty_pixel_value;
+    process_lines_in_parallel(y_min, y_max, [this, y_min, pixel_shift](int y_begin, int y_end) {
+        const size_t pixel_begin = size_t(y_begin - y_min)*m_width;
+        const size_t pixel_end   = size_t(y_end - y_min)*m_width;
+        for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
+            const size_t accumulator_index = get_accumulator_index(0, i_color);
+            const int                   *stacked_sum                = &m_values_to_stack_individual_threads_sum[accumulator_index];
+            const double                *stacked_sum2               = &m_values_to_stack_individual_threads_sum2[accumulator_index];
+            const short unsigned int    *number_of_stacked_pixels   = &m_counts_to_stack_individual_threads[accumulator_index];
+            double                      *result                     = &m_stacked_image[i_color][pixel_shift];
+            for (size_t i_pixel = pixel_begin; i_pixel < pixel_end; i_pixel++) {
+                const int count = number_of_stacked_pixels[i_pixel];
+                const double n = std::max(count, 1);
+                const double sum = stacked_sum[i_pixel];
+                const double variance = (stacked_sum2[i_pixel] - sum*sum/n)/n;
+                const double rms = std::sqrt(std::max(variance, 0.0));
+                result[i_pixel] = count > 0 ? rms : c_empty_pixel_value;
             }
         }
-    }
+    });
 }
 
 int StackerRMS::get_height_range_limit() const {
@@ -83,9 +90,9 @@ int StackerRMS::get_height_range_limit() const {
     if (m_memory_usage_limit_in_mb > 0) {
         const unsigned long long int memory_needed_for_stacked_image = 3*sizeof(double)*m_width*m_height;
         const unsigned long long int memory_needed_for_calibrated_photos = m_n_cpu*3*sizeof(PixelType)*m_width*m_height;
-        const unsigned long long int memory_usage_limit = m_memory_usage_limit_in_mb*1024ULL*1024ULL - memory_needed_for_stacked_image - memory_needed_for_calibrated_photos;
+        const unsigned long long int memory_usage_limit = get_memory_available_for_stacking(memory_needed_for_stacked_image + memory_needed_for_calibrated_photos);
         const unsigned long long int memory_usage_per_line = m_number_of_colors*m_n_cpu*((unsigned long long int)(sizeof(int) + sizeof(short unsigned int) + sizeof(double)))*m_width;
-        height_range = min(height_range, int(memory_usage_limit/memory_usage_per_line));
+        height_range = min<unsigned long long int>(height_range, memory_usage_limit/memory_usage_per_line);
     }
     return height_range;
 };
\ No newline at end of file
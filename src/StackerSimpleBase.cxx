@@ -1,24 +1,27 @@
 #include "../headers/StackerSimpleBase.h"
 #include "../headers/CalibratedPhotoHandler.h"
-#include "../headers/CustomScopeMutex.h"
-
 #include "../headers/TaskScheduler.hxx"
+#include "../headers/VideoDecodeSession.h"
 
 #include <iostream>
+#include <atomic>
+#include <algorithm>
 
 using namespace std;
 using namespace AstroPhotoStacker;
 
 StackerSimpleBase::StackerSimpleBase(int number_of_colors, int width, int height, bool interpolate_colors) :
-    StackerBase(number_of_colors, width, height, interpolate_colors),
-    m_number_of_stacked_pixels(number_of_colors, vector<unsigned short>(width*height, 0))   {
+    StackerBase(number_of_colors, width, height, interpolate_colors)   {
 };
 
 void StackerSimpleBase::calculate_stacked_photo_internal()  {
-    m_mutexes = vector<mutex>(m_n_cpu);
-
     const int height_range = get_height_range_limit();
 
+    if (height_range == 0) {
+        throw runtime_error("The memory set by the user is not sufficient, please increase it");
+    }
+
+    m_accumulator_size = size_t(m_width)*height_range;
     allocate_arrays_for_stacking(height_range);
 
     for (int y_min = 0; y_min < m_height; y_min += height_range) {
@@ -27,20 +30,33 @@ void StackerSimpleBase::calculate_stacked_photo_internal()  {
         }
 
         const int y_max = min(y_min + height_range, m_height);
+        start_frame_prefetching();
         if (m_n_cpu == 1)   {
             for (unsigned int i_file = 0; i_file < m_frames_to_stack.size(); i_file++) {
-                add_photo_to_stack(i_file, y_min, y_max);
+                add_photo_to_accumulators(i_file, y_min, y_max, 0);
             }
         }
         else    {
+            // one task per thread, each owning its accumulators and taking the next range of consecutive files from the shared counter (consecutive video frames are decoded without seeking)
+            const unsigned int n_files = m_frames_to_stack.size();
+            const unsigned int files_per_range = get_number_of_consecutive_frames_per_task(n_files, m_n_cpu);
+            atomic<unsigned int> next_file_index = 0;
+            auto stack_files = [this, n_files, files_per_range, y_min, y_max, &next_file_index](unsigned int i_thread) {
+                for (unsigned int i_first = next_file_index.fetch_add(files_per_range); i_first < n_files; i_first = next_file_index.fetch_add(files_per_range)) {
+                    const unsigned int i_last = min(i_first + files_per_range, n_files);
+                    for (unsigned int i_file = i_first; i_file < i_last; i_file++) {
+                        add_photo_to_accumulators(i_file, y_min, y_max, i_thread);
+                    }
+                }
+            };
+
             TaskScheduler pool({size_t(m_n_cpu)});
-            for (unsigned int i_file = 0; i_file < m_frames_to_stack.size(); i_file++) {
-                pool.submit([this, i_file, y_min, y_max]() {
-                    add_photo_to_stack(i_file, y_min, y_max);
-                }, {1});
+            for (unsigned int i_thread = 0; i_thread < min(m_n_cpu, n_files); i_thread++) {
+                pool.submit(stack_files, {1}, i_thread);
             }
             pool.wait_for_tasks();
         }
+        stop_frame_prefetching();
         calculate_final_image(y_min, y_max);
     }
 
@@ -55,35 +71,42 @@ void StackerSimpleBase::set_number_of_cpu_threads(unsigned int n_cpu) {
 
 
 void StackerSimpleBase::add_photo_to_stack(unsigned int i_file, int y_min, int y_max)  {
+    add_photo_to_accumulators(i_file, y_min, y_max, 0);
+};
+
+void StackerSimpleBase::add_photo_to_accumulators(unsigned int i_file, int y_min, int y_max, unsigned int i_thread)  {
     cout << "Adding " + m_frames_to_stack[i_file].to_string() + " to stack\n";
-    CalibratedPhotoHandler calibrated_photo = get_calibrated_photo(i_file, y_min, y_max);
+    const vector<vector<PixelType>> calibrated_data = get_calibrated_data(i_file, y_min, y_max);
 
-    const int pixel_shift = y_min*m_width;
+    const size_t n_values = size_t(y_max - y_min)*m_width;
+    for (int color = 0; color < m_number_of_colors; color++)   {
+        add_values_to_stack(color, calibrated_data[color].data(), n_values, i_thread);
+    }
 
-    unsigned int i_thread = 0;
-    while (true) {
-        i_thread = (i_thread+1) % m_mutexes.size();
-        CustomScopeMutex scope_mutex(&m_mutexes[i_thread]);
-        if (!scope_mutex.is_locked()) {
-            continue;
-        }
+    m_n_tasks_processed++;
+};
 
-        for (int color = 0; color < 3; color++)   {
-            for (int y = y_min; y < y_max; y++)  {
-                for (int x = 0; x < m_width; x++)   {
-                    const int index = y*m_width + x;
-                    const PixelType value = calibrated_photo.get_value_by_reference_frame_index(index, color);
-                    if (value >= 0) {
-                        process_pixel(color, index - pixel_shift, value, i_thread);
-                    }
+void StackerSimpleBase::reduce_accumulators(size_t n_pixels, const std::function<void(int i_thread_target, int i_thread_source, int i_color, size_t pixel_begin, size_t pixel_end)> &merge_accumulators) {
+    if (m_n_cpu < 2 || n_pixels == 0) {
+        return;
+    }
+
+    const size_t min_chunk_size = 4096;
+    const size_t chunk_size = max<size_t>(min_chunk_size, (n_pixels + m_n_cpu - 1)/m_n_cpu);
+    for (unsigned int step = 1; step < m_n_cpu; step *= 2) {
+        TaskScheduler pool({size_t(m_n_cpu)});
+        for (unsigned int i_thread_target = 0; i_thread_target + step < m_n_cpu; i_thread_target += 2*step) {
+            for (int i_color = 0; i_color < m_number_of_colors; i_color++) {
+                for (size_t pixel_begin = 0; pixel_begin < n_pixels; pixel_begin += chunk_size) {
+                    const size_t pixel_end = min(pixel_begin + chunk_size, n_pixels);
+                    pool.submit([&merge_accumulators, i_thread_target, step, i_color, pixel_begin, pixel_end]() {
+                        merge_accumulators(i_thread_target, i_thread_target + step, i_color, pixel_begin, pixel_end);
+                    }, {1});
                 }
             }
         }
-
-        break;
+        pool.wait_for_tasks();
     }
-
-    m_n_tasks_processed++;
 };
 
 int StackerSimpleBase::get_height_range_limit() const  {
@@ -93,9 +116,10 @@ int StackerSimpleBase::get_height_range_limit() const  {
 int StackerSimpleBase::get_tasks_total() const  {
     const long long int n_files = m_frames_to_stack.size();
     const int height_range = get_height_range_limit();
-    int n_slices = m_height/height_range + (m_height % height_range > 0);
+    int n_slices = height_range > 0 ? m_height/height_range + (m_height % height_range > 0) : 0;
+    const int n_slab_tasks = use_calibrated_frames_slab() ? n_files : 0;
 
-    return n_slices*n_files;
+    return n_slices*n_files + n_slab_tasks;
 };
 
 unsigned long long StackerSimpleBase::get_maximal_memory_usage(int number_of_frames) const {
@@ -168,6 +168,7 @@ std::vector<std::string> SummaryYamlCreator::get_stack_settings_summary() const
     result.push_back(s_indent + "stacking_algorithm: \"" + m_stack_settings.get_stacking_algorithm() + "\"");
     result.push_back(s_indent + "hot_pixel_correction: " + (m_stack_settings.use_hot_pixel_correction() ? "True" : "False"));
     result.push_back(s_indent + "use_color_interpolation: " + (m_stack_settings.use_color_interpolation() ? "True" : "False"));
+    result.push_back(s_indent + "interpolation_method: \"" + m_stack_settings.get_interpolation_method() + "\"");
     result.push_back(s_indent + "apply_color_stretching: " + (m_stack_settings.apply_color_stretching() ? "True" : "False"));
 
     const std::map<std::string, double> algorithm_specific_settings = m_stack_settings.get_algorithm_specific_settings().numerical_settings;
@@ -80,26 +80,31 @@ void SyntheticFlatCreator::replace_values_above_threshold() {
     }
     kdtree.build_tree_structure();
 
-    // replace values above threshold by average of N nearest neighbors below threshold
+    // replace values above threshold by average of N nearest neighbors below threshold, all such pixels are searched at once
+    vector<unsigned int> query_points;
+    vector<size_t> query_pixel_indices;
     for (unsigned int y = 0; y < m_height; y++) {
-        coordinate_buffer[1] = y;
         for (unsigned int x = 0; x < m_width; x++) {
-            const unsigned short pixel_value = m_original_gray_scale_data[y * m_width + x];
-            coordinate_buffer[0] = x;
-            if (pixel_value >= m_threshold) {
-                const std::vector<std::tuple<std::array<unsigned,2>, unsigned>> neighbors = kdtree.get_k_nearest_neighbors(coordinate_buffer, 5);
-
-                if (neighbors.size() > 0) {
-                    unsigned sum = 0;
-                    for (const auto &neighbor : neighbors) {
-                        const unsigned brightness = std::get<1>(neighbor);
-                        sum += brightness;
-                    }
-                    m_original_gray_scale_data[y * m_width + x] = sum / neighbors.size();
-                }
+            if (m_original_gray_scale_data[y * m_width + x] >= m_threshold) {
+                query_points.push_back(x);
+                query_points.push_back(y);
+                query_pixel_indices.push_back(y * m_width + x);
             }
         }
     }
+
+    const unsigned int n_neighbors = std::min<long long int>(5, kdtree.get_n_nodes());
+    if (n_neighbors == 0) {
+        return;
+    }
+    const vector<long long int> neighbor_indices = kdtree.get_k_nearest_neighbors_indices(query_points.data(), query_pixel_indices.size(), n_neighbors);
+    for (size_t i_query = 0; i_query < query_pixel_indices.size(); i_query++) {
+        unsigned sum = 0;
+        for (unsigned int i_neighbor = 0; i_neighbor < n_neighbors; i_neighbor++) {
+            sum += kdtree.get_node(neighbor_indices[i_query*n_neighbors + i_neighbor]).m_value;
+        }
+        m_original_gray_scale_data[query_pixel_indices[i_query]] = sum / n_neighbors;
+    }
 };
 
 void SyntheticFlatCreator::rebin_data(unsigned int new_bin_size)    {
@@ -0,0 +1,122 @@
+#include "../headers/VideoDecodeSession.h"
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+namespace {
+    struct ThreadSessions;
+
+    // sessions of all threads, so that they can be closed from another thread once a pass over the frames is finished (threads of the global pool live until the program ends)
+    std::mutex                  s_all_thread_sessions_mutex;
+    std::set<ThreadSessions*>   s_all_thread_sessions;
+
+    struct ThreadSessions {
+        ThreadSessions()    {
+            scoped_lock lock(s_all_thread_sessions_mutex);
+            s_all_thread_sessions.insert(this);
+        };
+
+        ~ThreadSessions()   {
+            scoped_lock lock(s_all_thread_sessions_mutex);
+            s_all_thread_sessions.erase(this);
+        };
+
+        // locked by the owning thread while reading, and by release_all_sessions
+        std::mutex mutex;
+        std::map<std::string, std::unique_ptr<VideoDecodeSession>> sessions;
+        unsigned long long use_counter = 0;
+    };
+
+    thread_local ThreadSessions s_thread_sessions;
+}
+
+VideoDecodeSession::VideoDecodeSession(const std::string &video_address) :
+    m_video_address(video_address),
+    m_capture(video_address)    {
+
+    if (!m_capture.isOpened() || !get_file_status(video_address, &m_file_status)) {
+        throw std::runtime_error("Unable to open video file: " + video_address);
+    }
+};
+
+VideoDecodeSession::VideoDecodeSession(const std::string &video_address, const FileStatus &file_status) :
+    m_video_address(video_address),
+    m_file_status(file_status),
+    m_capture(video_address)    {
+
+    if (!m_capture.isOpened()) {
+        throw std::runtime_error("Unable to open video file: " + video_address);
+    }
+};
+
+void VideoDecodeSession::release_all_sessions()    {
+    scoped_lock lock(s_all_thread_sessions_mutex);
+    for (ThreadSessions *thread_sessions : s_all_thread_sessions) {
+        scoped_lock thread_lock(thread_sessions->mutex);
+        thread_sessions->sessions.clear();
+    }
+};
+
+cv::Mat VideoDecodeSession::read_frame(const std::string &video_address, int frame_id)  {
+    FileStatus file_status;
+    if (!get_file_status(video_address, &file_status)) {
+        throw std::runtime_error("Unable to open video file: " + video_address);
+    }
+
+    scoped_lock lock(s_thread_sessions.mutex);
+    map<string, unique_ptr<VideoDecodeSession>> &sessions = s_thread_sessions.sessions;
+    auto it = sessions.find(video_address);
+    if (it != sessions.end() && it->second->m_file_status != file_status) {
+        // the video has been modified since the session was opened
+        sessions.erase(it);
+        it = sessions.end();
+    }
+    if (it == sessions.end()) {
+        if (sessions.size() >= c_max_sessions_per_thread) {
+            auto oldest = min_element(sessions.begin(), sessions.end(), [](const auto &a, const auto &b) {
+                return a.second->m_last_use < b.second->m_last_use;
+            });
+            sessions.erase(oldest);
+        }
+        it = sessions.emplace(video_address, make_unique<VideoDecodeSession>(video_address, file_status)).first;
+    }
+    it->second->m_last_use = ++s_thread_sessions.use_counter;
+    return it->second->read_frame(frame_id);
+};
+
+cv::Mat VideoDecodeSession::read_frame(int frame_id)   {
+    const int gap = frame_id - m_next_frame_id;
+    if (gap < 0 || gap > c_max_frames_to_decode_instead_of_seek) {
+        m_capture.set(cv::CAP_PROP_POS_FRAMES, frame_id);
+    }
+    else {
+        for (int i_frame = 0; i_frame < gap; i_frame++) {
+            m_capture.grab();
+        }
+    }
+
+    cv::Mat frame;
+    if (m_capture.read(frame)) {
+        m_next_frame_id = frame_id + 1;
+    }
+    else {
+        // position of the capture is not known after a failed read, the next read will seek
+        m_next_frame_id = numeric_limits<int>::max();
+    }
+    return frame;
+};
+
+unsigned int AstroPhotoStacker::get_number_of_consecutive_frames_per_task(size_t n_frames, unsigned int n_threads)    {
+    // a few tasks per thread for load balancing, but not too many frames per task, so that the threads finish at similar time
+    constexpr size_t max_frames_per_task = 16;
+    const size_t frames_per_task = n_frames/(4*max(n_threads, 1u));
+    return std::clamp<size_t>(frames_per_task, 1, max_frames_per_task);
+};
@@ -6,6 +6,7 @@
 #include "../headers/InputArgumentsParser.h"
 #include "../headers/PhotoRanker.h"
 #include "../headers/FlatFrameHandler.h"
+#include "../headers/DecodedFrameCache.h"
 
 #include <thread>
 #include <string>
@@ -109,6 +110,32 @@ void configure_stacker_with_optional_arguments(StackerBase *stacker, const Input
         if (print_info) cout << "Memory limit: " << memory_limit << "\n";
     }
 
+    // decoded frames kept in the memory (and optionally on the local disk), so that the slices of the stacking do not decode the same frame again
+    const unsigned int decoded_frame_cache = input_parser.get_optional_argument<unsigned int>("decoded_frame_cache", 0);
+    if (decoded_frame_cache > 0)    {
+        DecodedFrameCache &decoded_frame_cache_instance = DecodedFrameCache::get_global_instance();
+        decoded_frame_cache_instance.set_memory_budget(size_t(decoded_frame_cache)*1024*1024);
+        if (print_info) cout << "Decoded frame cache (MB): " << decoded_frame_cache << "\n";
+
+        const string decoded_frame_cache_folder = input_parser.get_optional_argument<string>("decoded_frame_cache_folder", "");
+        if (decoded_frame_cache_folder != "")   {
+            const unsigned int decoded_frame_cache_disk_limit = input_parser.get_optional_argument<unsigned int>("decoded_frame_cache_disk_limit", 20000);
+            decoded_frame_cache_instance.set_disk_cache(decoded_frame_cache_folder, size_t(decoded_frame_cache_disk_limit)*1024*1024);
+            if (print_info) cout << "Decoded frame cache folder: " << decoded_frame_cache_folder << " (limit " << decoded_frame_cache_disk_limit << " MB)\n";
+        }
+    }
+
+    // interpolation used when shifting the frames into the reference frame
+    const string interpolation_method = input_parser.get_optional_argument<string>("interpolation", "nearest neighbor");
+    stacker->set_interpolation_method(string_to_interpolation_method(interpolation_method));
+    if (print_info) cout << "Interpolation method: " << interpolation_method << "\n";
+
+    // calibrated and aligned frames kept on disk for repeated stacking with different settings
+    const string aligned_frame_store = input_parser.get_optional_argument<string>("aligned_frame_store", "");
+    if (aligned_frame_store != "")  {
+        stacker->set_aligned_frame_store(aligned_frame_store);
+        if (print_info) cout << "Aligned frame store: " << aligned_frame_store << "\n";
+    }
 
     const std::string algorithm_specifict_settings_string = input_parser.get_optional_argument<std::string>("algorithm_specific_settings", "");
     if (algorithm_specifict_settings_string != "")   {
@@ -0,0 +1,101 @@
+#include "../headers/PixelType.h"
+#include "../headers/PixelSelection.hxx"
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+/**
+ * @brief Compare the time needed to get median, quantil and cut-off average of pixel columns using full sort and using partial selection from PixelSelection.hxx
+ */
+
+double measure_time_in_ms(const vector<PixelType> &original_columns, unsigned int n_files, const function<double(PixelType *, unsigned int)> &reduce_column, double *checksum)    {
+    vector<PixelType> columns = original_columns;
+    const size_t n_columns = columns.size()/n_files;
+
+    const auto start = chrono::high_resolution_clock::now();
+    *checksum = 0;
+    for (size_t i_column = 0; i_column < n_columns; i_column++) {
+        *checksum += reduce_column(&columns[i_column*n_files], n_files);
+    }
+    const auto end = chrono::high_resolution_clock::now();
+    return chrono::duration<double, milli>(end - start).count();
+};
+
+int main(int argc, char **argv) {
+    if (argc > 3)  {
+        cerr << "Usage: " << argv[0] << " [number_of_frames] [number_of_pixels]" << endl;
+        return 1;
+    }
+
+    const unsigned int n_files  = argc > 1 ? stoi(argv[1]) : 500;
+    const unsigned int n_pixels = argc > 2 ? stoi(argv[2]) : 100000;
+
+    mt19937 random_generator(1);
+    normal_distribution<double> distribution(2000, 200);
+    vector<PixelType> columns(size_t(n_files)*n_pixels);
+    for (PixelType &value : columns) {
+        value = max<double>(0, distribution(random_generator));
+    }
+
+    const double quantil_fraction = 0.3;
+    const double tail_fraction = 0.1;
+    const unsigned int n_tail = tail_fraction*n_files + 0.5;
+
+    auto median_sort = [](PixelType *values, unsigned int n) -> double {
+        sort(values, values + n);
+        return (values[n/2] + values[(n-1)/2])/2;
+    };
+    auto median_selection = [](PixelType *values, unsigned int n) -> double {
+        PixelType lower_middle, upper_middle;
+        PixelSelection::select_middle_elements(values, n, &lower_middle, &upper_middle);
+        return (lower_middle + upper_middle)/2;
+    };
+    auto quantil_sort = [quantil_fraction](PixelType *values, unsigned int n) -> double {
+        sort(values, values + n);
+        return values[int(quantil_fraction*n + 0.5)];
+    };
+    auto quantil_selection = [quantil_fraction](PixelType *values, unsigned int n) -> double {
+        return PixelSelection::select_nth_element(values, n, int(quantil_fraction*n + 0.5));
+    };
+    auto cut_off_sort = [n_tail](PixelType *values, unsigned int n) -> double {
+        sort(values, values + n);
+        double sum = 0;
+        for (unsigned int i = n_tail; i < n - n_tail; i++) {
+            sum += values[i];
+        }
+        return sum/(n - 2*n_tail);
+    };
+    auto cut_off_selection = [n_tail](PixelType *values, unsigned int n) -> double {
+        PixelSelection::separate_tails(values, n, n_tail, n_tail);
+        double sum = 0;
+        for (unsigned int i = n_tail; i < n - n_tail; i++) {
+            sum += values[i];
+        }
+        return sum/(n - 2*n_tail);
+    };
+
+    const vector<tuple<string, function<double(PixelType *, unsigned int)>, function<double(PixelType *, unsigned int)>>> benchmarks = {
+        {"median",   median_sort,  median_selection},
+        {"quantil",  quantil_sort, quantil_selection},
+        {"cut-off",  cut_off_sort, cut_off_selection},
+    };
+
+    cout << "Number of frames: " << n_files << ", number of pixels: " << n_pixels << endl;
+    for (const auto &[name, full_sort, selection] : benchmarks) {
+        double checksum_sort, checksum_selection;
+        const double time_sort      = measure_time_in_ms(columns, n_files, full_sort, &checksum_sort);
+        const double time_selection = measure_time_in_ms(columns, n_files, selection, &checksum_selection);
+        cout << name << ":\tfull sort " << time_sort << " ms,\tpartial selection " << time_selection << " ms,\tspeed-up " << time_sort/time_selection;
+        cout << (checksum_sort == checksum_selection ? "" : "\tRESULTS DIFFER!") << endl;
+    }
+
+    return 0;
+}
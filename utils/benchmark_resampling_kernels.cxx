@@ -0,0 +1,67 @@
+#include "../headers/PixelType.h"
+#include "../headers/ResamplingKernel.h"
+#include "../headers/AlignmentResultPlateSolving.h"
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <functional>
+
+using namespace std;
+using namespace AstroPhotoStacker;
+
+/**
+ * @brief Measure the throughput of the interpolation kernels (SIMD and scalar implementation) when shifting and rotating an image, as done when stacking the frames
+ */
+
+double measure_throughput_in_mpix_per_s(int width, int height, const function<void(int y, PixelType *output)> &resample_line) {
+    vector<PixelType> output(width);
+    const auto start = chrono::high_resolution_clock::now();
+    for (int y = 0; y < height; y++) {
+        resample_line(y, output.data());
+    }
+    const auto end = chrono::high_resolution_clock::now();
+    return double(width)*height/chrono::duration<double, micro>(end - start).count();
+};
+
+int main(int argc, char **argv) {
+    if (argc > 3)  {
+        cerr << "Usage: " << argv[0] << " [width] [height]" << endl;
+        return 1;
+    }
+
+    const int width  = argc > 1 ? stoi(argv[1]) : 6000;
+    const int height = argc > 2 ? stoi(argv[2]) : 4000;
+
+    mt19937 random_generator(1);
+    normal_distribution<float> distribution(2000, 200);
+    vector<float> image(size_t(width)*height);
+    for (float &value : image) {
+        value = max<float>(0, distribution(random_generator));
+    }
+
+    const AlignmentResultPlateSolving alignment_result(3.3, -7.6, width/2, height/2, 0.01);
+    vector<float> x_shifted(width), y_shifted(width);
+
+    cout << "Image size: " << width << "x" << height << endl;
+    for (const string &method_name : get_interpolation_methods()) {
+        const ResamplingKernel kernel(string_to_interpolation_method(method_name));
+        auto resample_line = [&](int y, PixelType *output, bool use_simd) {
+            alignment_result.transform_row_from_reference_to_shifted_frame(y, 0, width, x_shifted.data(), y_shifted.data());
+            if (use_simd) {
+                kernel.resample(image.data(), width, 0, height, x_shifted.data(), y_shifted.data(), width, output);
+            }
+            else {
+                kernel.resample_scalar(image.data(), width, 0, height, x_shifted.data(), y_shifted.data(), width, output);
+            }
+        };
+
+        const double throughput_simd    = measure_throughput_in_mpix_per_s(width, height, [&](int y, PixelType *output){ resample_line(y, output, true); });
+        const double throughput_scalar  = measure_throughput_in_mpix_per_s(width, height, [&](int y, PixelType *output){ resample_line(y, output, false); });
+        cout << method_name << ":\tSIMD " << throughput_simd << " Mpix/s,\tscalar " << throughput_scalar << " Mpix/s,\tspeed-up " << throughput_simd/throughput_scalar << endl;
+    }
+
+    return 0;
+}